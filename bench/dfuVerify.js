@@ -0,0 +1,66 @@
+// Measures how fast verifyDfu() checks DfuSe files of a few sizes. The files are generated, with a
+// made-up CRC, since only the time to compute it matters here. Each file is verified once before
+// timing, so the numbers are for a file already in the page cache, as when a file is verified
+// right before it is flashed.
+//
+// Usage: node bench/dfuVerify.js [runs]
+
+const addon = require("../dist/binding.js");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const {performance} = require("perf_hooks");
+
+const canBridge = new addon.CanBridge();
+
+const runs = Number(process.argv[2] ?? 20);
+const sizesMiB = [1, 4, 16, 64];
+
+// One image with one element of the given size
+function buildDfuSeFile(elementSize) {
+    const headerSize = 11 + 274 + 8;
+    const file = Buffer.alloc(headerSize + elementSize + 16);
+    file.write("DfuSe", 0, "latin1");
+    file.writeUInt8(1, 5);
+    file.writeUInt32LE(headerSize + elementSize, 6);
+    file.writeUInt8(1, 10);
+    file.write("Target", 11, "latin1");
+    file.writeUInt32LE(8 + elementSize, 11 + 266);
+    file.writeUInt32LE(1, 11 + 270);
+    file.writeUInt32LE(0x08000000, 11 + 274);
+    file.writeUInt32LE(elementSize, 11 + 278);
+    for (let i = headerSize; i < headerSize + elementSize; i++) {
+        file[i] = Math.imul(i, 0x9E3779B1) >>> 24;
+    }
+    return file;
+}
+
+async function run(sizeMiB) {
+    const fileName = path.join(os.tmpdir(), `canbridge-bench-${process.pid}.dfu`);
+    fs.writeFileSync(fileName, buildDfuSeFile(sizeMiB << 20));
+    try {
+        const first = await canBridge.verifyDfu(fileName);
+        if (first.error) throw new Error(first.error);
+
+        const start = performance.now();
+        for (let i = 0; i < runs; i++) {
+            await canBridge.verifyDfu(fileName);
+        }
+        const msPerFile = (performance.now() - start) / runs;
+        return {
+            sizeMiB,
+            msPerFile: Number(msPerFile.toFixed(3)),
+            mibPerSecond: Math.round(sizeMiB / (msPerFile / 1000)),
+        };
+    } finally {
+        fs.rmSync(fileName, {force: true});
+    }
+}
+
+(async () => {
+    const results = [];
+    for (const sizeMiB of sizesMiB) {
+        results.push(await run(sizeMiB));
+    }
+    console.table(results);
+})();
@@ -0,0 +1,247 @@
+// Microbenchmarks of the native code under the bindings, using virtual devices
+// in place of hardware. Built by the node_canbridge_bench target and run by
+// `npm run bench`, which merges its results with the JS-side ones.
+//
+// Prints one JSON object: {"benchmarks": [{"name", "nsPerOp", "iterations"}]}.
+// nsPerOp is the median of BENCH_SAMPLES samples.
+//
+// Usage: node_canbridge_bench [nameFilter]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Crc32.h"
+#include "DeviceRegistry.h"
+#include "DfuSeFile.h"
+#include "FrameFilter.h"
+#include "LatestValueCache.h"
+#include "VirtualCANBus.h"
+#include "VirtualCANDevice.h"
+
+#define BENCH_SAMPLES 5
+#define BENCH_SAMPLE_MS 50
+#define BENCH_DEVICE_COUNT 8
+#define BENCH_CONTENDING_THREADS 3
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string name;
+    double nsPerOp;
+    uint64_t iterations;
+};
+
+std::vector<Result> results;
+const char* nameFilter = nullptr;
+
+// Keeps the compiler from optimizing away a benchmark's work
+volatile uint64_t sink;
+
+// Runs fn(iterations) with doubling iteration counts until a run takes long enough to time,
+// then takes BENCH_SAMPLES samples of that length
+template <typename Fn>
+void measure(const char* name, Fn fn) {
+    if (nameFilter != nullptr && std::strstr(name, nameFilter) == nullptr) return;
+
+    uint64_t iterations = 1;
+    while (true) {
+        auto start = Clock::now();
+        fn(iterations);
+        auto elapsed = Clock::now() - start;
+        if (elapsed >= std::chrono::milliseconds(BENCH_SAMPLE_MS) || iterations >= (1ull << 40)) break;
+        iterations *= 2;
+    }
+
+    std::vector<double> samples;
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        auto start = Clock::now();
+        fn(iterations);
+        double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        samples.push_back(elapsedNs / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+    results.push_back({name, samples[BENCH_SAMPLES / 2], iterations * BENCH_SAMPLES});
+    fprintf(stderr, "%-40s %12.1f ns/op\n", name, samples[BENCH_SAMPLES / 2]);
+}
+
+void benchDeviceRegistry() {
+    DeviceRegistry registry;
+    auto bus = std::make_shared<VirtualCANBus>();
+    std::vector<std::string> descriptors;
+    std::vector<uint32_t> handles;
+    for (int i = 0; i < BENCH_DEVICE_COUNT; i++) {
+        std::string descriptor = std::string(VIRTUAL_DEVICE_DESCRIPTOR_PREFIX) + "bench" + std::to_string(i);
+        registry.Add(descriptor, std::make_shared<VirtualCANDevice>(descriptor, bus));
+        descriptors.push_back(descriptor);
+        handles.push_back(registry.OpenHandle(descriptor));
+    }
+
+    auto find = [&](uint64_t iterations) {
+        uint64_t found = 0;
+        for (uint64_t i = 0; i < iterations; i++) {
+            found += registry.Find(descriptors[i % BENCH_DEVICE_COUNT]) != nullptr;
+        }
+        sink = found;
+    };
+    measure("registry.find", find);
+    measure("registry.findByHandle", [&](uint64_t iterations) {
+        uint64_t found = 0;
+        std::string descriptor;
+        for (uint64_t i = 0; i < iterations; i++) {
+            found += registry.FindByHandle(handles[i % BENCH_DEVICE_COUNT], &descriptor) != nullptr;
+        }
+        sink = found;
+    });
+
+    // The same lookups while other threads look devices up too, as the native threads do
+    std::atomic<bool> contending{true};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < BENCH_CONTENDING_THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            uint64_t i = t;
+            while (contending.load(std::memory_order_relaxed)) {
+                sink = registry.Find(descriptors[i++ % BENCH_DEVICE_COUNT]) != nullptr;
+            }
+        });
+    }
+    measure("registry.find.contended", find);
+    contending = false;
+    for (std::thread& thread : threads) thread.join();
+}
+
+void benchVirtualDevice() {
+    auto bus = std::make_shared<VirtualCANBus>();
+    VirtualCANDevice sender("virtual:benchSender", bus);
+    VirtualCANDevice receiver("virtual:benchReceiver", bus);
+    uint32_t sessionHandle;
+    receiver.OpenStreamSession(&sessionHandle, rev::usb::CANBridge_CANFilter{0, 0}, 1024);
+
+    uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    HAL_CANStreamMessage messages[256];
+    measure("virtualDevice.sendAndRead", [&](uint64_t iterations) {
+        uint32_t messagesRead = 0;
+        for (uint64_t i = 0; i < iterations; i++) {
+            rev::usb::CANMessage message(0x2051800 + (i & 63), data, sizeof(data));
+            sender.SendCANMessage(message, 0);
+            if ((i & 255) == 255) receiver.ReadStreamSession(sessionHandle, messages, 256, &messagesRead);
+        }
+        receiver.ReadStreamSession(sessionHandle, messages, 256, &messagesRead);
+        sink = messagesRead;
+    });
+    receiver.CloseStreamSession(sessionHandle);
+}
+
+void benchFrameFilter() {
+    // Like bench/streamFilters.js: one filter per device, ignoring the API bits
+    std::vector<FrameFilter::Filter> filters;
+    for (uint32_t i = 0; i < 400; i++) {
+        filters.emplace_back(0x2000000 + ((i >> 6) << 16) + (i & 63), 0x1FFF003F);
+    }
+    FrameFilter filter(filters);
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 0; i < 1024; i++) {
+        uint32_t device = (i * 7919) % 800;
+        ids.push_back(0x2000000 + ((device >> 6) << 16) + ((i & 0x3FF) << 6) + (device & 63));
+    }
+    measure("frameFilter.matches.400", [&](uint64_t iterations) {
+        uint64_t matched = 0;
+        for (uint64_t i = 0; i < iterations; i++) matched += filter.Matches(ids[i & 1023]);
+        sink = matched;
+    });
+}
+
+void benchLatestValueCache() {
+    auto cache = std::make_unique<LatestValueCache>();
+    uint8_t data[8] = {};
+    measure("latestValueCache.update", [&](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++) {
+            data[0] = (uint8_t)i;
+            cache->Update(0x2051800 + (i & 255), i, data, sizeof(data));
+        }
+    });
+    // What getLatestMessageOfEveryReceivedArbId() copies out before building JS objects, for 256 IDs
+    measure("latestValueCache.scan.256", [&](uint64_t iterations) {
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < iterations; i++) {
+            cache->ForEachUpdatedSince(0, [&](const LatestValueCache::Entry& entry) { total += entry.data[0]; });
+        }
+        sink = total;
+    });
+}
+
+// Same layout as the files built by bench/dfuVerify.js: one image with the given elements
+std::vector<uint8_t> buildDfuSeFile(uint32_t elementCount, uint32_t elementSize) {
+    const uint32_t imageSize = 274 + elementCount * (8 + elementSize);
+    std::vector<uint8_t> file(11 + imageSize + 16);
+    auto put32 = [&](size_t offset, uint32_t value) { std::memcpy(&file[offset], &value, 4); };
+    std::memcpy(&file[0], "DfuSe", 5);
+    file[5] = 1;
+    put32(6, 11 + imageSize);
+    file[10] = 1;
+    std::memcpy(&file[11], "Target", 6);
+    put32(11 + 266, imageSize - 274);
+    put32(11 + 270, elementCount);
+    size_t offset = 11 + 274;
+    for (uint32_t e = 0; e < elementCount; e++) {
+        put32(offset, 0x08000000 + e * elementSize);
+        put32(offset + 4, elementSize);
+        for (uint32_t i = 0; i < elementSize; i++) file[offset + 8 + i] = (uint8_t)(i * 31 + e);
+        offset += 8 + elementSize;
+    }
+    return file;
+}
+
+void benchDfu() {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "canbridge-bench.dfu";
+    std::vector<uint8_t> contents = buildDfuSeFile(16, 64 * 1024);
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((const char*)contents.data(), contents.size());
+    }
+    std::string pathString = path.string();
+
+    measure("dfu.parse.16x64KiB", [&](uint64_t iterations) {
+        uint64_t elements = 0;
+        for (uint64_t i = 0; i < iterations; i++) {
+            dfuse::DFUFile dfuFile(pathString.c_str());
+            elements += dfuFile ? dfuFile.Images()[0].Elements().size() : 0;
+        }
+        sink = elements;
+    });
+    measure("dfu.crc.1MiB", [&](uint64_t iterations) {
+        uint32_t crc = 0;
+        for (uint64_t i = 0; i < iterations; i++) crc ^= crc32Update(0xFFFFFFFF, contents.data(), 1 << 20);
+        sink = crc;
+    });
+
+    std::error_code error;
+    std::filesystem::remove(path, error);
+}
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) nameFilter = argv[1];
+
+    benchDeviceRegistry();
+    benchVirtualDevice();
+    benchFrameFilter();
+    benchLatestValueCache();
+    benchDfu();
+
+    printf("{\"benchmarks\":[");
+    for (size_t i = 0; i < results.size(); i++) {
+        printf("%s\n{\"name\":\"%s\",\"nsPerOp\":%.3f,\"iterations\":%llu}", i == 0 ? "" : ",",
+               results[i].name.c_str(), results[i].nsPerOp, (unsigned long long)results[i].iterations);
+    }
+    printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Compares the object-per-frame readStreamSession() with readStreamSessionPacked().
+// Uses a virtual device, so no hardware is needed.
+//
+// Usage: node bench/readStreamSession.js [framesPerSecond] [durationMs]
+
+const addon = require("../dist/binding.js");
+const {performance, PerformanceObserver} = require("perf_hooks");
+
+const canBridge = new addon.CanBridge();
+
+const framesPerSecond = Number(process.argv[2] ?? 10000);
+const durationMs = Number(process.argv[3] ?? 3000);
+const messageId = 0x2051801;
+const readSize = 1024;
+const readIntervalMs = 10;
+
+let gcTimeMs = 0;
+const gcObserver = new PerformanceObserver((list) => {
+    for (const entry of list.getEntries()) gcTimeMs += entry.duration;
+});
+gcObserver.observe({entryTypes: ["gc"]});
+
+async function run(name, read) {
+    const descriptor = canBridge.createVirtualDevice();
+    const sessionHandle = canBridge.openStreamSession(descriptor, 0, 0, framesPerSecond);
+    canBridge.setVirtualDeviceInjection(descriptor, messageId, framesPerSecond);
+
+    gcTimeMs = 0;
+    let frames = 0;
+    let readTimeMs = 0;
+    let checksum = 0;
+    const end = performance.now() + durationMs;
+    while (performance.now() < end) {
+        await new Promise(resolve => setTimeout(resolve, readIntervalMs));
+        const start = performance.now();
+        const result = read(descriptor, sessionHandle);
+        readTimeMs += performance.now() - start;
+        frames += result.count;
+        checksum += result.checksum;
+    }
+
+    canBridge.setVirtualDeviceInjection(descriptor, messageId, 0);
+    canBridge.closeStreamSession(descriptor, sessionHandle);
+    canBridge.destroyVirtualDevice(descriptor);
+    // Let pending GC entries arrive before reading gcTimeMs
+    await new Promise(resolve => setImmediate(resolve));
+
+    return {
+        mode: name,
+        frames,
+        nsPerFrame: Math.round(readTimeMs * 1e6 / Math.max(frames, 1)),
+        readTimeMs: Math.round(readTimeMs),
+        gcTimeMs: Math.round(gcTimeMs),
+        checksum,
+    };
+}
+
+function readObjects(descriptor, sessionHandle) {
+    const messages = canBridge.readStreamSession(descriptor, sessionHandle, readSize);
+    let checksum = 0;
+    for (const message of messages) checksum += message.data[0];
+    return {count: messages.length, checksum};
+}
+
+const packedBuffer = addon.PackedFrameView.allocate(readSize);
+function readPacked(descriptor, sessionHandle) {
+    const count = canBridge.readStreamSessionPacked(descriptor, sessionHandle, packedBuffer);
+    const frames = new addon.PackedFrameView(packedBuffer, count);
+    let checksum = 0;
+    for (let i = 0; i < frames.count; i++) checksum += frames.dataByte(i, 0);
+    return {count, checksum};
+}
+
+(async () => {
+    const results = [];
+    results.push(await run("objects", readObjects));
+    results.push(await run("packed", readPacked));
+    gcObserver.disconnect();
+    console.table(results);
+})();
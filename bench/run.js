@@ -0,0 +1,198 @@
+// Runs the JS-side microbenchmarks against virtual devices, then the native ones from the
+// node_canbridge_bench target if it was built, and prints one JSON report of both. Reports of two
+// releases can be compared with --baseline. The JS benchmarks time whole binding calls, so the
+// difference between the object and packed reads is the cost of building the JS objects.
+//
+// Usage: node bench/run.js [--out report.json] [--baseline report.json] [--filter name]
+
+const addon = require("../dist/binding.js");
+const {execFileSync} = require("child_process");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const {performance} = require("perf_hooks");
+
+const canBridge = new addon.CanBridge();
+
+const samples = 5;
+const sampleMs = 50;
+const batchSize = 256;
+
+function option(name) {
+    const index = process.argv.indexOf(name);
+    return index >= 0 ? process.argv[index + 1] : undefined;
+}
+const nameFilter = option("--filter");
+
+const results = [];
+let sink = 0;
+
+// Runs fn(iterations) with doubling iteration counts until a run takes long enough to time, then
+// takes the median of several samples of that length. Same scheme as bench/native/bench.cc.
+function measure(name, fn) {
+    if (nameFilter && !name.includes(nameFilter)) return;
+    let iterations = 1;
+    for (;;) {
+        const start = performance.now();
+        fn(iterations);
+        if (performance.now() - start >= sampleMs || iterations >= 2 ** 30) break;
+        iterations *= 2;
+    }
+    const nsPerOp = [];
+    for (let i = 0; i < samples; i++) {
+        const start = performance.now();
+        fn(iterations);
+        nsPerOp.push((performance.now() - start) * 1e6 / iterations);
+    }
+    nsPerOp.sort((a, b) => a - b);
+    results.push({name, source: "js", nsPerOp: Number(nsPerOp[samples >> 1].toFixed(3)), iterations: iterations * samples});
+}
+
+async function waitFor(condition, timeoutMs) {
+    const end = performance.now() + timeoutMs;
+    while (!condition()) {
+        if (performance.now() > end) throw new Error("Timed out setting up a benchmark");
+        await new Promise(resolve => setTimeout(resolve, 10));
+    }
+}
+
+function benchSends() {
+    const device = canBridge.createVirtualDevice();
+    const handle = canBridge.openDevice(device);
+    const data = [1, 2, 3, 4, 5, 6, 7, 8];
+    measure("js.sendCANMessage", (iterations) => {
+        for (let i = 0; i < iterations; i++) sink += canBridge.sendCANMessage(device, 0x2051800, data, 0);
+    });
+    measure("js.sendCANMessage.handle", (iterations) => {
+        for (let i = 0; i < iterations; i++) sink += canBridge.sendCANMessage(handle, 0x2051800, data, 0);
+    });
+    canBridge.closeDevice(handle);
+    canBridge.destroyVirtualDevice(device);
+}
+
+function benchStreamReads() {
+    const sender = canBridge.createVirtualDevice({bus: 100});
+    const receiver = canBridge.createVirtualDevice({bus: 100});
+    const sessionHandle = canBridge.openStreamSession(receiver, 0, 0, batchSize * 2);
+    const messages = [];
+    for (let i = 0; i < batchSize; i++) {
+        messages.push({messageId: 0x2051800 + i, data: [i & 0xFF, 1, 2, 3, 4, 5, 6, 7], repeatPeriod: 0});
+    }
+    const packed = addon.packCanMessages(messages);
+    const buffer = addon.PackedFrameView.allocate(batchSize);
+
+    // Each op sends and reads a batch, so the two differ only in how the frames reach JS
+    measure(`js.readStreamSession.${batchSize}`, (iterations) => {
+        for (let i = 0; i < iterations; i++) {
+            canBridge.sendCANMessages(sender, packed);
+            sink += canBridge.readStreamSession(receiver, sessionHandle, batchSize).length;
+        }
+    });
+    measure(`js.readStreamSessionPacked.${batchSize}`, (iterations) => {
+        for (let i = 0; i < iterations; i++) {
+            canBridge.sendCANMessages(sender, packed);
+            sink += canBridge.readStreamSessionPacked(receiver, sessionHandle, buffer);
+        }
+    });
+
+    canBridge.closeStreamSession(receiver, sessionHandle);
+    canBridge.destroyVirtualDevice(sender);
+    canBridge.destroyVirtualDevice(receiver);
+}
+
+async function benchLatestMessages() {
+    const sender = canBridge.createVirtualDevice({bus: 101});
+    const receiver = canBridge.createVirtualDevice({bus: 101});
+    const latest = () => canBridge.getLatestMessageOfEveryReceivedArbId(receiver, 60000);
+    latest();
+    for (let i = 0; i < batchSize; i++) canBridge.sendCANMessage(sender, 0x2051800 + i, [i & 0xFF], 0);
+    await waitFor(() => Object.keys(latest()).length === batchSize, 5000);
+
+    measure(`js.getLatestMessageOfEveryReceivedArbId.${batchSize}`, (iterations) => {
+        for (let i = 0; i < iterations; i++) sink += latest()[0x2051800].data[0];
+    });
+
+    canBridge.destroyVirtualDevice(sender);
+    canBridge.destroyVirtualDevice(receiver);
+}
+
+// Same layout as bench/dfuVerify.js, with 16 elements of 64 KiB
+function benchDfu() {
+    const elementCount = 16;
+    const elementSize = 64 * 1024;
+    const imageSize = 274 + elementCount * (8 + elementSize);
+    const file = Buffer.alloc(11 + imageSize + 16);
+    file.write("DfuSe", 0, "latin1");
+    file.writeUInt8(1, 5);
+    file.writeUInt32LE(11 + imageSize, 6);
+    file.writeUInt8(1, 10);
+    file.write("Target", 11, "latin1");
+    file.writeUInt32LE(imageSize - 274, 11 + 266);
+    file.writeUInt32LE(elementCount, 11 + 270);
+    for (let e = 0, offset = 11 + 274; e < elementCount; e++, offset += 8 + elementSize) {
+        file.writeUInt32LE(0x08000000 + e * elementSize, offset);
+        file.writeUInt32LE(elementSize, offset + 4);
+    }
+    const fileName = path.join(os.tmpdir(), `canbridge-bench-${process.pid}.dfu`);
+    fs.writeFileSync(fileName, file);
+    try {
+        measure("js.getImageElements.16x64KiB", (iterations) => {
+            for (let i = 0; i < iterations; i++) sink += canBridge.getImageElements(fileName, 0).length;
+        });
+    } finally {
+        fs.rmSync(fileName, {force: true});
+    }
+}
+
+function runNative() {
+    const name = process.platform === "win32" ? "node_canbridge_bench.exe" : "node_canbridge_bench";
+    const candidates = [path.join(__dirname, "../build/Release", name), path.join(__dirname, "../build", name)];
+    const executable = candidates.find(candidate => fs.existsSync(candidate));
+    if (!executable) {
+        console.error("node_canbridge_bench was not built, skipping the native benchmarks");
+        return;
+    }
+    const output = execFileSync(executable, nameFilter ? [nameFilter] : [], {stdio: ["ignore", "pipe", "inherit"]});
+    for (const benchmark of JSON.parse(output.toString()).benchmarks) {
+        results.push({name: benchmark.name, source: "native", nsPerOp: benchmark.nsPerOp, iterations: benchmark.iterations});
+    }
+}
+
+(async () => {
+    benchSends();
+    benchStreamReads();
+    await benchLatestMessages();
+    benchDfu();
+    runNative();
+
+    const baselineFile = option("--baseline");
+    if (baselineFile) {
+        const baseline = new Map(JSON.parse(fs.readFileSync(baselineFile, "utf8")).benchmarks.map(result => [result.name, result]));
+        for (const result of results) {
+            const previous = baseline.get(result.name);
+            if (!previous) continue;
+            result.baselineNsPerOp = previous.nsPerOp;
+            // Above 1 is slower than the baseline
+            result.ratio = Number((result.nsPerOp / previous.nsPerOp).toFixed(3));
+        }
+    }
+
+    const report = {
+        version: require("../package.json").version,
+        node: process.version,
+        platform: process.platform,
+        arch: process.arch,
+        cpu: os.cpus()[0]?.model,
+        date: new Date().toISOString(),
+        benchmarks: results,
+    };
+    // The report may be going to stdout
+    new console.Console(process.stderr).table(results);
+    const json = JSON.stringify(report, null, 2);
+    const outFile = option("--out");
+    if (outFile) {
+        fs.writeFileSync(outFile, json + "\n");
+    } else {
+        process.stdout.write(json + "\n");
+    }
+})();
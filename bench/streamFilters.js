@@ -0,0 +1,76 @@
+// Compares a stream session opened with a list of filters, matched in native code, with one
+// wide-open session filtered in JS. Frames come from a second virtual device on a loopback bus,
+// so no hardware is needed.
+//
+// Usage: node bench/streamFilters.js [filterCount] [frames]
+
+const addon = require("../dist/binding.js");
+const {performance} = require("perf_hooks");
+
+const canBridge = new addon.CanBridge();
+
+const filterCount = Number(process.argv[2] ?? 400);
+const frameCount = Number(process.argv[3] ?? 200000);
+const batchSize = 1000;
+
+// One filter per device, across several device types and manufacturers, ignoring the API bits.
+// Frames are spread over twice as many devices, so about half of them match.
+const filters = [];
+for (let i = 0; i < filterCount; i++) {
+    filters.push({messageId: 0x2000000 + ((i >> 6) << 16) + (i & 63), messageMask: 0x1FFF003F});
+}
+const messages = [];
+for (let i = 0; i < batchSize; i++) {
+    const device = (i * 7919) % (filterCount * 2);
+    messages.push({messageId: 0x2000000 + ((device >> 6) << 16) + ((i & 0x3FF) << 6) + (device & 63), data: [i & 0xFF], repeatPeriod: 0});
+}
+const packed = addon.packCanMessages(messages);
+const buffer = addon.PackedFrameView.allocate(batchSize);
+
+function matchesInJs(messageId) {
+    for (const filter of filters) {
+        if (((messageId ^ filter.messageId) & filter.messageMask) === 0) return true;
+    }
+    return false;
+}
+
+function run(name, openSession, countMatches) {
+    const sender = canBridge.createVirtualDevice({bus: 0});
+    const receiver = canBridge.createVirtualDevice({bus: 0});
+    const sessionHandle = openSession(receiver);
+
+    let matched = 0;
+    let readTimeMs = 0;
+    for (let sent = 0; sent < frameCount; sent += batchSize) {
+        canBridge.sendCANMessages(sender, packed);
+        const start = performance.now();
+        const count = canBridge.readStreamSessionPacked(receiver, sessionHandle, buffer);
+        matched += countMatches(new addon.PackedFrameView(buffer, count));
+        readTimeMs += performance.now() - start;
+    }
+
+    canBridge.closeStreamSession(receiver, sessionHandle);
+    canBridge.destroyVirtualDevice(sender);
+    canBridge.destroyVirtualDevice(receiver);
+    return {
+        mode: name,
+        filters: filterCount,
+        frames: frameCount,
+        matched,
+        nsPerFrame: Math.round(readTimeMs * 1e6 / frameCount),
+        framesPerSecond: Math.round(frameCount / (readTimeMs / 1000)),
+    };
+}
+
+console.table([
+    run("native", (receiver) => canBridge.openStreamSession(receiver, filters, batchSize),
+        (frames) => frames.count),
+    run("js", (receiver) => canBridge.openStreamSession(receiver, 0, 0, batchSize),
+        (frames) => {
+            let matched = 0;
+            for (let i = 0; i < frames.count; i++) {
+                if (matchesInJs(frames.messageId(i))) matched++;
+            }
+            return matched;
+        }),
+]);
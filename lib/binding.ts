@@ -6,12 +6,414 @@ export interface DfuImageElement {
     size: number;
 }
 
+export interface DfuExtraction {
+    /** Defaults to 0 */
+    image?: number;
+    element: number;
+    fileName: string;
+}
+
+export interface DfuVerification {
+    /** Whether the file is laid out correctly and its CRC matches */
+    valid: boolean;
+    storedCrc: number;
+    computedCrc: number;
+    /** Why the file could not be read, if it could not */
+    error?: string;
+}
+
 export interface CanMessage {
     data: number[];
     messageID: number;
+    /** Device time the frame was received at, in microseconds. Map it to host time with getDeviceClock(). */
     timeStamp: number;
 }
 
+/** Size in bytes of one record written by readStreamSessionPacked() and readHALStreamSessionPacked() */
+export const PACKED_FRAME_RECORD_SIZE = 24;
+
+/**
+ * Decodes the fixed-size records written by the packed read functions without copying them.
+ * Keep in sync with src/PackedFrames.h.
+ */
+export class PackedFrameView {
+    readonly count: number;
+    private readonly view: DataView;
+    private readonly bytes: Uint8Array;
+
+    /** Allocates a buffer that can hold up to maxMessages records */
+    static allocate(maxMessages: number): Uint8Array {
+        return new Uint8Array(maxMessages * PACKED_FRAME_RECORD_SIZE);
+    }
+
+    constructor(buffer: ArrayBuffer | ArrayBufferView, count: number) {
+        if (buffer instanceof ArrayBuffer) {
+            this.bytes = new Uint8Array(buffer);
+        } else {
+            this.bytes = new Uint8Array(buffer.buffer, buffer.byteOffset, buffer.byteLength);
+        }
+        this.view = new DataView(this.bytes.buffer, this.bytes.byteOffset, this.bytes.byteLength);
+        this.count = count;
+    }
+
+    messageId(index: number): number {
+        return this.view.getUint32(index * PACKED_FRAME_RECORD_SIZE, true);
+    }
+
+    timeStamp(index: number): number {
+        const offset = index * PACKED_FRAME_RECORD_SIZE;
+        return this.view.getUint32(offset + 8, true) * 0x100000000 + this.view.getUint32(offset + 4, true);
+    }
+
+    dataSize(index: number): number {
+        return this.bytes[index * PACKED_FRAME_RECORD_SIZE + 12];
+    }
+
+    dataByte(index: number, byteIndex: number): number {
+        return this.bytes[index * PACKED_FRAME_RECORD_SIZE + 16 + byteIndex];
+    }
+
+    /** @return View of the payload bytes. It is overwritten by the next read into the same buffer. */
+    data(index: number): Uint8Array {
+        const offset = index * PACKED_FRAME_RECORD_SIZE + 16;
+        return this.bytes.subarray(offset, offset + this.dataSize(index));
+    }
+
+    toCanMessage(index: number): CanMessage {
+        return {
+            messageID: this.messageId(index),
+            timeStamp: this.timeStamp(index),
+            data: Array.from(this.data(index)),
+        };
+    }
+
+    toCanMessages(): CanMessage[] {
+        const messages: CanMessage[] = [];
+        for (let i = 0; i < this.count; i++) {
+            messages.push(this.toCanMessage(i));
+        }
+        return messages;
+    }
+}
+
+/**
+ * Fields of the FRC arbitration ID of each record, filled in by the packed read functions. Each column
+ * holds one byte per record. Columns that are left out are not decoded.
+ */
+export interface ArbIdColumns {
+    /** Bits 24-28 */
+    deviceType?: Uint8Array;
+    /** Bits 16-23 */
+    manufacturer?: Uint8Array;
+    /** Bits 10-15 */
+    apiClass?: Uint8Array;
+    /** Bits 6-9 */
+    apiIndex?: Uint8Array;
+    /** Bits 0-5 */
+    deviceNumber?: Uint8Array;
+}
+
+/** Allocates every column for up to maxMessages records */
+export function allocateArbIdColumns(maxMessages: number): Required<ArbIdColumns> {
+    return {
+        deviceType: new Uint8Array(maxMessages),
+        manufacturer: new Uint8Array(maxMessages),
+        apiClass: new Uint8Array(maxMessages),
+        apiIndex: new Uint8Array(maxMessages),
+        deviceNumber: new Uint8Array(maxMessages),
+    };
+}
+
+/** Size in bytes of one record read by sendCANMessages() */
+export const PACKED_SEND_RECORD_SIZE = 24;
+
+export interface OutgoingCanMessage {
+    messageId: number;
+    data: ArrayLike<number>;
+    repeatPeriod: number;
+}
+
+/**
+ * Packs messages into the record format read by sendCANMessages(). Keep in sync with src/PackedFrames.h.
+ * @param target Buffer to reuse across calls. A new one is allocated if it is missing or too small.
+ */
+export function packCanMessages(messages: OutgoingCanMessage[], target?: Uint8Array): Uint8Array {
+    const byteLength = messages.length * PACKED_SEND_RECORD_SIZE;
+    const bytes = target && target.byteLength >= byteLength ? target.subarray(0, byteLength) : new Uint8Array(byteLength);
+    const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+    bytes.fill(0);
+    messages.forEach((message, i) => {
+        const offset = i * PACKED_SEND_RECORD_SIZE;
+        const dataSize = Math.min(message.data.length, 8);
+        view.setUint32(offset, message.messageId, true);
+        view.setInt32(offset + 4, message.repeatPeriod, true);
+        bytes[offset + 8] = dataSize;
+        for (let b = 0; b < dataSize; b++) {
+            bytes[offset + 16 + b] = message.data[b];
+        }
+    });
+    return bytes;
+}
+
+/** Size in bytes of one record written by readCaptureRecords() */
+export const CAPTURE_RECORD_SIZE = 32;
+
+/** Channel of frames sent through the HAL */
+export const CAPTURE_CHANNEL_HAL = 0xFE;
+/** Channel of frames sent to a device that was not in the capture's device list */
+export const CAPTURE_CHANNEL_UNKNOWN = 0xFF;
+
+/**
+ * Decodes the records written by readCaptureRecords() without copying them.
+ * Keep in sync with src/CaptureFormat.h.
+ */
+export class CaptureRecordView {
+    readonly count: number;
+    private readonly view: DataView;
+    private readonly bytes: Uint8Array;
+
+    /** Allocates a buffer that can hold up to maxRecords records */
+    static allocate(maxRecords: number): Uint8Array {
+        return new Uint8Array(maxRecords * CAPTURE_RECORD_SIZE);
+    }
+
+    constructor(buffer: ArrayBuffer | ArrayBufferView, count: number) {
+        if (buffer instanceof ArrayBuffer) {
+            this.bytes = new Uint8Array(buffer);
+        } else {
+            this.bytes = new Uint8Array(buffer.buffer, buffer.byteOffset, buffer.byteLength);
+        }
+        this.view = new DataView(this.bytes.buffer, this.bytes.byteOffset, this.bytes.byteLength);
+        this.count = count;
+    }
+
+    /** Microseconds since the capture started */
+    timestampUs(index: number): number {
+        const offset = index * CAPTURE_RECORD_SIZE;
+        return this.view.getUint32(offset + 4, true) * 0x100000000 + this.view.getUint32(offset, true);
+    }
+
+    messageId(index: number): number {
+        return this.view.getUint32(index * CAPTURE_RECORD_SIZE + 8, true);
+    }
+
+    /** Index into the channels of openCaptureFile(), or CAPTURE_CHANNEL_HAL or CAPTURE_CHANNEL_UNKNOWN */
+    channel(index: number): number {
+        return this.bytes[index * CAPTURE_RECORD_SIZE + 12];
+    }
+
+    isTransmit(index: number): boolean {
+        return (this.bytes[index * CAPTURE_RECORD_SIZE + 13] & 1) !== 0;
+    }
+
+    dataSize(index: number): number {
+        return this.bytes[index * CAPTURE_RECORD_SIZE + 14];
+    }
+
+    /** @return View of the payload bytes. It is overwritten by the next read into the same buffer. */
+    data(index: number): Uint8Array {
+        const offset = index * CAPTURE_RECORD_SIZE + 16;
+        return this.bytes.subarray(offset, offset + this.dataSize(index));
+    }
+}
+
+/** A signal in DBC terms. Decoded values are raw * scale + offset. */
+export interface SignalLayout {
+    messageId: number;
+    /** Least significant bit for little-endian signals, most significant bit for big-endian ones, as in DBC files */
+    startBit: number;
+    /** In bits, up to 64 */
+    length: number;
+    /** Defaults to true */
+    littleEndian?: boolean;
+    /** Defaults to false */
+    signed?: boolean;
+    /** Defaults to 1 */
+    scale?: number;
+    /** Defaults to 0 */
+    offset?: number;
+}
+
+export interface HeartbeatWatchdogStats {
+    acks: number;
+    /** Times the timeout expired and the heartbeats were disabled */
+    timeouts: number;
+    /** Times an ack re-enabled the heartbeats after a timeout */
+    recoveries: number;
+    lastAckIntervalUs: number;
+    maxAckIntervalUs: number;
+    meanAckIntervalUs: number;
+    /** Longest delay between a timeout expiring and the heartbeats being disabled */
+    maxTimeoutLatencyUs: number;
+}
+
+export interface TrafficStats {
+    /** Number of arbitration IDs. The arrays hold one element per ID, in ascending ID order. */
+    count: number;
+    messageId: Uint32Array;
+    frames: Uint32Array;
+    /** Measured over the last whole second the ID was received in */
+    framesPerSecond: Float64Array;
+    /** Estimated from the inter-arrival times, ignoring gaps counted as missed frames */
+    periodUs: Uint32Array;
+    maxGapUs: Uint32Array;
+    /** Frames estimated to be missing from gaps longer than 1.5 periods */
+    missed: Uint32Array;
+    /** Time between the ID's last frame and the newest frame of any ID */
+    sinceLastUs: Uint32Array;
+    /** Inter-arrival histogram, histogramBucketLowerUs.length counts per ID, one ID after the other */
+    histogram: Uint32Array;
+    /** Lower bound of each histogram bucket. Each bucket ends where the next begins. */
+    histogramBucketLowerUs: Uint32Array;
+    /** Frames not counted because too many distinct IDs were received */
+    overflows: number;
+}
+
+/**
+ * How the timestamps of a device's frames map to host time, estimated from every read of the device so far.
+ * A frame stamped t was received at host time t + offsetUs + (t - referenceUs) * driftPpm / 1e6. Host time is
+ * the native steady clock in microseconds, which hostNowUs relates to performance.now().
+ */
+export interface DeviceClock {
+    /** Reads the estimate is based on. offsetUs, referenceUs, driftPpm and deviceNowUs are 0 while this is. */
+    samples: number;
+    offsetUs: number;
+    referenceUs: number;
+    /** How much faster the host clock runs than the device's, in parts per million */
+    driftPpm: number;
+    /** One-second windows the estimate was fitted to, up to 32 */
+    windows: number;
+    /** Times the estimate started over because the device clock jumped */
+    resyncs: number;
+    hostNowUs: number;
+    /** Timestamp a frame received now would have */
+    deviceNowUs: number;
+}
+
+export interface PerfCounters {
+    /** Number of bindings called since the last reset */
+    count: number;
+    /** Name of each binding */
+    names: string[];
+    /** What the typed arrays hold a value for, per binding: ["total", "lockWait", "driver", "convert"] */
+    phases: string[];
+    /** Calls that entered each phase, phases.length values per binding, one binding after the other */
+    calls: Float64Array;
+    totalNs: Float64Array;
+    maxNs: Float64Array;
+    /** Latency histogram, histogramBucketLowerNs.length counts per phase, in the order of calls */
+    histogram: Float64Array;
+    /** Lower bound of each histogram bucket. Each bucket ends where the next begins. */
+    histogramBucketLowerNs: Float64Array;
+}
+
+export interface TraceStats {
+    /** Events written */
+    events: number;
+    /** Events lost because a thread recorded more than its buffer holds between writes */
+    dropped: number;
+}
+
+export interface CaptureOptions {
+    /** How many records the ring file holds before the oldest are overwritten. Defaults to 1048576 (32 MiB) */
+    maxRecords?: number;
+}
+
+export interface CaptureStats {
+    recorded: number;
+    /** Frames lost because the writer thread fell behind */
+    dropped: number;
+}
+
+export interface CaptureFileInfo {
+    handle: number;
+    recordCount: number;
+    droppedRecords: number;
+    /** Wall-clock time of timestamp 0, in microseconds since the Unix epoch */
+    startWallTimeUs: number;
+    frozen: boolean;
+    /** Descriptor of each channel */
+    channels: string[];
+}
+
+export interface ReplayOptions {
+    /** Playback speed multiplier. Defaults to 1 */
+    speed?: number;
+    /** Start over from the first record after the last one. Defaults to false */
+    loop?: boolean;
+    /** Which recorded frames to send. Defaults to "all" */
+    direction?: "all" | "received" | "sent";
+    /** Only records matching one of these are sent. Defaults to all records */
+    filters?: CanFilter[];
+}
+
+export interface ReplayStats {
+    sent: number;
+    failedSends: number;
+    /** Frames sent more than 1 ms after their scheduled time */
+    lateSends: number;
+    loops: number;
+    /** How long after its scheduled time each frame was sent */
+    maxErrorUs: number;
+    meanErrorUs: number;
+    stdDevErrorUs: number;
+    stopped: boolean;
+}
+
+export interface TransactionRequest {
+    messageId: number;
+    data: number[];
+    /** A received frame answers the request if it matches all of these */
+    response: {
+        messageId: number;
+        /** Defaults to 0x1FFFFFFF */
+        messageMask?: number;
+        /** Bytes the response payload starts with */
+        data?: number[];
+        /** Which bits of each byte of data are compared. Defaults to every bit of every given byte */
+        dataMask?: number[];
+    };
+    /** Overrides TransactionOptions.timeoutMs for this request */
+    timeoutMs?: number;
+    /** Overrides TransactionOptions.retries for this request */
+    retries?: number;
+}
+
+export interface TransactionOptions {
+    /** How many requests may wait for a response at once. Defaults to 8 */
+    window?: number;
+    /** How long to wait for a response before sending again. Defaults to 100, at most 4294967 */
+    timeoutMs?: number;
+    /** How many times an unanswered request is sent again. Defaults to 2 */
+    retries?: number;
+}
+
+export interface TransactionResult {
+    status: "ok" | "timeout" | "sendFailed" | "aborted";
+    /** How many times the request was sent */
+    attempts: number;
+    /** From the last send of the request to its response. Only set when status is "ok" */
+    latencyUs?: number;
+    /** Status of the last failed send. Only set when status is "sendFailed" */
+    sendStatus?: number;
+    /** The response. Only set when status is "ok" */
+    message?: CanMessage;
+}
+
+export interface VirtualBusOptions {
+    /** Bits per second. Each frame takes up the bus for its nominal bit time. Defaults to 0, which is unlimited */
+    bitrate?: number;
+    /** Delay between the end of a frame's transmission and its delivery. Defaults to 0 */
+    latencyUs?: number;
+    /** Probability from 0 to 1 that a frame is lost. Defaults to 0 */
+    dropRate?: number;
+}
+
+export interface VirtualDeviceOptions extends VirtualBusOptions {
+    /** Devices created with the same bus number receive each other's frames. Defaults to a bus of the device's own */
+    bus?: number;
+}
+
 export interface CanDeviceInfo {
     descriptor: string;
     name: string;
@@ -28,6 +430,61 @@ export interface CanDeviceStatus {
     lastErrorTime: number;
 }
 
+/** A frame matches if (frame ID & messageMask) == (messageId & messageMask) */
+export interface CanFilter {
+    messageId: number;
+    messageMask: number;
+}
+
+export interface SubscribeOptions {
+    /** A batch is delivered once it holds this many messages. Defaults to 64 */
+    maxBatchSize?: number;
+    /** A non-empty batch is delivered at most this many ms after its first message arrived. Defaults to 10 */
+    maxLatencyMs?: number;
+    /** Size of the underlying stream session buffer. Defaults to 1024 */
+    maxSize?: number;
+    /** Only messages that also match one of these are delivered. They are matched in native code. */
+    filters?: CanFilter[];
+}
+
+export interface PeriodicNotifierStats {
+    ticks: number;
+    /** Ticks skipped because the notifier thread woke up more than one period late */
+    missedTicks: number;
+    /** Ticks not delivered because the previous onTick call had not run yet */
+    droppedCallbacks: number;
+    minJitterUs: number;
+    maxJitterUs: number;
+    meanJitterUs: number;
+    stdDevJitterUs: number;
+}
+
+export interface NotifierStats {
+    alarms: number;
+    /** Alarms that fired while nobody was waiting on the notifier */
+    overruns: number;
+    /** Alarms that fired more than 1 ms after their trigger time */
+    lateWakes: number;
+    maxLatenessUs: number;
+    meanLatenessUs: number;
+}
+
+export interface PeriodicFrameStats {
+    sent: number;
+    /** Frames handed to the driver more than 1 ms after their deadline */
+    lateSends: number;
+    /** Deadlines dropped because the scheduler fell more than one period behind */
+    skipped: number;
+    failedSends: number;
+    lastStatus: number;
+    minJitterUs: number;
+    maxJitterUs: number;
+    meanJitterUs: number;
+}
+
+/** Returned by openDevice(). Accepted in place of a descriptor by the send, receive and stream functions. */
+export type DeviceHandle = number;
+
 export enum ThreadPriority {
     Low,
     BelowNormal,
@@ -51,63 +508,326 @@ export class CanBridgeInitializationError extends Error {
 
 export class CanBridge {
     getDevices: () => Promise<CanDeviceInfo[]>;
+    /**
+     * Resolves a descriptor once so that later calls skip the descriptor lookup.
+     * Opening the same descriptor again returns the same handle with an extra reference.
+     */
+    openDevice: (descriptor: string) => DeviceHandle;
+    closeDevice: (deviceHandle: DeviceHandle) => void;
     registerDeviceToHAL: (descriptor:string, messageId:Number, messageMask:number) => number;
     unregisterDeviceFromHAL: (descriptor:string) => Promise<number>;
-    receiveMessage: (descriptor:string, messageId:number, messageMask:number) => CanMessage;
-    openStreamSession: (descriptor:string, messageId:number, messageMask:number, maxSize:number) => number;
-    readStreamSession: (descriptor:string, sessionHandle:number, messagesToRead:number) => CanMessage[];
-    closeStreamSession: (descriptor:string, sessionHandle:number) => number;
-    getCANDetailStatus: (descriptor:string) => CanDeviceStatus;
-    sendRtrMessage: (descriptor:string, messageId: number, messageData: number[], repeatPeriod: number) => number;
-    sendCANMessage: (descriptor:string, messageId: number, messageData: number[], repeatPeriod: number) => number;
+    receiveMessage: (descriptor: string | DeviceHandle, messageId:number, messageMask:number) => CanMessage;
+    /**
+     * Pass a list of filters instead of messageId and messageMask to read the messages that match any of them.
+     * The list is matched in native code, but the session buffer also holds the messages it drops.
+     */
+    openStreamSession: ((descriptor: string | DeviceHandle, messageId:number, messageMask:number, maxSize:number) => number) &
+        ((descriptor: string | DeviceHandle, filters: CanFilter[], maxSize:number) => number);
+    readStreamSession: (descriptor: string | DeviceHandle, sessionHandle:number, messagesToRead:number) => CanMessage[];
+    /**
+     * Fills buffer with PACKED_FRAME_RECORD_SIZE byte records. Decode them with PackedFrameView.
+     * @param columns Also filled with the fields of each record's arbitration ID. Reads no more records than they hold.
+     * @return Number of records written
+     */
+    readStreamSessionPacked: (descriptor: string | DeviceHandle, sessionHandle:number, buffer: ArrayBuffer | ArrayBufferView, columns?: ArbIdColumns) => number;
+    closeStreamSession: (descriptor: string | DeviceHandle, sessionHandle:number) => number;
+    getCANDetailStatus: (descriptor: string | DeviceHandle) => CanDeviceStatus;
+    sendRtrMessage: (descriptor: string | DeviceHandle, messageId: number, messageData: number[], repeatPeriod: number) => number;
+    sendCANMessage: (descriptor: string | DeviceHandle, messageId: number, messageData: number[], repeatPeriod: number) => number;
+    /**
+     * Sends every record of a buffer built with packCanMessages() in one native call
+     * @return Status of each message, in order
+     */
+    sendCANMessages: (descriptor: string | DeviceHandle, messages: ArrayBuffer | ArrayBufferView) => Int32Array;
     sendHALMessage: (messageId: number, messageData: number[], repeatPeriod: number) => number;
+    /**
+     * Sends a frame every periodMs from a native scheduler thread for the device. Works with devices registered to the HAL.
+     * The driver cancels its repeat of an ID that is sent once, so an ID that sendCANMessage() repeats cannot be
+     * scheduled (this throws), and while sendCANMessage() repeats a scheduled ID, its scheduled sends are skipped and
+     * counted in failedSends.
+     * @param phaseMs Offset of the deadlines within the period. Frames with the same period on one device keep this offset from each other.
+     * @return Handle to pass to updatePeriodicFrame(), getPeriodicFrameStats() and removePeriodicFrame()
+     */
+    addPeriodicFrame: (descriptor: string, messageId: number, messageData: number[], periodMs: number, phaseMs?: number) => number;
+    /** Replaces the payload without moving the next deadline */
+    updatePeriodicFrame: (scheduleHandle: number, messageData: number[]) => void;
+    getPeriodicFrameStats: (scheduleHandle: number) => PeriodicFrameStats;
+    removePeriodicFrame: (scheduleHandle: number) => void;
     initializeNotifier: () => void;
+    /**
+     * Waits off the JS thread for time microseconds
+     * @return FPGA time the alarm fired at, or 0 if the notifier was stopped
+     */
     waitForNotifierAlarm: (time:number) => Promise<number>;
-    stopNotifier: () => void;
+    /**
+     * Stops a notifier from createNotifier(), or the one from initializeNotifier() if no handle is given
+     */
+    stopNotifier: (notifierHandle?: number) => void;
+    /** @return Current FPGA time in microseconds, the time base of notifier alarms */
+    getFPGATime: () => number;
+    /**
+     * Creates a notifier. All notifiers share one native timing thread.
+     * @return Handle to pass to the other notifier functions
+     */
+    createNotifier: () => number;
+    updateNotifierAlarm: (notifierHandle: number, triggerTime: number) => void;
+    cancelNotifierAlarm: (notifierHandle: number) => void;
+    /**
+     * Resolves immediately if the alarm already fired since the last wait
+     * @return FPGA time the alarm fired at, or 0 once the notifier is stopped
+     */
+    waitForNotifier: (notifierHandle: number) => Promise<number>;
+    /** Stops the notifier and frees its handle */
+    cleanNotifier: (notifierHandle: number) => void;
+    getNotifierStats: (notifierHandle: number) => NotifierStats | undefined;
+    /**
+     * Calls onTick every periodUs from a native thread. A tick is dropped if the previous onTick call has not run yet.
+     * @return Handle to pass to getPeriodicNotifierStats() and stopPeriodicNotifier()
+     */
+    startPeriodicNotifier: (periodUs: number, onTick: (time: number, jitterUs: number) => void) => number;
+    getPeriodicNotifierStats: (notifierHandle: number) => PeriodicNotifierStats | undefined;
+    stopPeriodicNotifier: (notifierHandle: number) => PeriodicNotifierStats | undefined;
+    /**
+     * Writes an element of the first image of a DfuSe file to binFileName
+     * @return Resolves to 0. Rejects if the file is malformed or the element does not exist.
+     */
     writeDfuToBin: (dfuFileName:string, binFileName:string, elementIndex?: number) => Promise<number>;
+    /**
+     * Writes elements of a DfuSe file to files, parsing it once. Nothing is written if any index is out of range.
+     * @return Number of bytes written
+     */
+    extractDfuElements: (dfuFileName: string, extractions: DfuExtraction[]) => Promise<number>;
     getImageElements: (dfuFileName: string, imageIndex: number) => DfuImageElement[];
+    /** Checks the layout and the CRC of a DfuSe file without blocking the JS thread */
+    verifyDfu: (dfuFileName: string) => Promise<DfuVerification>;
     openHALStreamSession: (messageId: number, messageMask:number, numMessages:number) => number;
     readHALStreamSession: (streamHandle:number, numMessages:number) => CanMessage[];
+    readHALStreamSessionPacked: (streamHandle:number, buffer: ArrayBuffer | ArrayBufferView, columns?: ArbIdColumns) => number;
     closeHALStreamSession: (streamHandle:number) => void;
-    setThreadPriority: (descriptor: string, priority: ThreadPriority) => void;
+    setThreadPriority: (descriptor: string | DeviceHandle, priority: ThreadPriority) => void;
     setSparkMaxHeartbeatData: (descriptor: string, heartbeatData: number[]) => void;
     startRevCommonHeartbeat: (descriptor: string) => void;
     stopHeartbeats: (descriptor: string, sendDisabledHeartbeatsFirst: boolean) => void;
     ackHeartbeats: () => void;
     /**
+     * Sets how long after the last ackHeartbeats() call the heartbeats are disabled. Defaults to 1000 ms.
+     * @throws RangeError if timeoutMs is not a number greater than 0 and at most 2147483647
+     */
+    setHeartbeatTimeout: (timeoutMs: number) => void;
+    getHeartbeatWatchdogStats: () => HeartbeatWatchdogStats;
+    /**
+     * Served from a latest-value cache that a native thread keeps up to date by reading a stream session that passes
+     * every frame. The first call for a device opens the session and starts the thread. They keep running until
+     * releaseReceiveTap() is called, the device goes away, or 10 seconds pass without a call to any function served
+     * from the cache (this one, getLatestMessagesSince(), readLatestMessagesPacked(), updateSignals() and
+     * getTrafficStats()) while no capture records the device. The next call starts them again.
+     *
+     * Ages are measured on the device's clock, which is learned from the frames read from the device. Until one has
+     * been read, the ages of the frames it received are unknown, and they are left out.
      * @return Object that maps arbitration IDs to the last-received message with that ID
      */
-    getLatestMessageOfEveryReceivedArbId: (descriptor: string, maxAgeMs: number) => Record<number, CanMessage>;
+    getLatestMessageOfEveryReceivedArbId: (descriptor: string | DeviceHandle, maxAgeMs: number) => Record<number, CanMessage>;
+    /**
+     * Like getLatestMessageOfEveryReceivedArbId(), but only returns the IDs updated after sinceSequence
+     * @param sinceSequence 0, or the sequence returned by the previous call
+     */
+    getLatestMessagesSince: (descriptor: string | DeviceHandle, sinceSequence: number, maxAgeMs?: number) => {sequence: number, messages: Record<number, CanMessage>};
+    /**
+     * Stops the native thread and closes the stream session behind the latest-value cache and traffic statistics of a
+     * device (see getLatestMessageOfEveryReceivedArbId()) without waiting for them to go idle. The next query starts
+     * them again with a new cache, so pass 0 as its sinceSequence.
+     * @return false if the device had no cache running, or it is recording a capture
+     */
+    releaseReceiveTap: (descriptor: string | DeviceHandle) => boolean;
+    /**
+     * Writes the latest message of every ID updated after sinceSequence into buffer as PACKED_FRAME_RECORD_SIZE byte
+     * records. Decode them with PackedFrameView. If buffer is too small, pass the returned sequence to get the rest.
+     * @param columns Also filled with the fields of each record's arbitration ID
+     */
+    readLatestMessagesPacked: (descriptor: string | DeviceHandle, buffer: ArrayBuffer | ArrayBufferView, sinceSequence: number, columns?: ArbIdColumns) => {count: number, sequence: number};
+    /**
+     * Reads a stream session on a native thread and calls onBatch with the received messages
+     * @return Handle to pass to unsubscribe()
+     */
+    subscribe: (descriptor: string | DeviceHandle, messageId: number, messageMask: number, onBatch: (messages: CanMessage[]) => void, options?: SubscribeOptions) => number;
+    unsubscribe: (subscriptionHandle: number) => void;
+    /**
+     * Decodes the device's frames into values as receiveMessage(), readStreamSession() and readStreamSessionPacked()
+     * read them. values[i] holds the latest value of layouts[i].
+     * @return Handle to pass to updateSignals() and unregisterSignals()
+     */
+    registerSignals: (descriptor: string | DeviceHandle, layouts: SignalLayout[], values: Float64Array) => number;
+    /**
+     * Decodes the frames the device received since the last call, without consuming any stream session
+     * @return Number of frames decoded
+     */
+    updateSignals: (decoderHandle: number) => number;
+    unregisterSignals: (decoderHandle: number) => void;
+    /**
+     * Per-ID rates, periods, gaps and inter-arrival histograms of the frames the device received. Collection
+     * starts with the first call, and starts over if the cache it shares with getLatestMessageOfEveryReceivedArbId()
+     * went idle.
+     */
+    getTrafficStats: (descriptor: string | DeviceHandle) => TrafficStats;
+    resetTrafficStats: (descriptor: string | DeviceHandle) => void;
+    /** Offset and drift of the device's clock against the host's. Frames read through the HAL share one clock. */
+    getDeviceClock: (descriptor: string | DeviceHandle) => DeviceClock;
+    /**
+     * Records frames received by the given devices, and frames sent to any device, into a memory-mapped ring file
+     */
+    startCapture: (fileName: string, descriptors: (string | DeviceHandle)[], options?: CaptureOptions) => void;
+    stopCapture: () => CaptureStats;
+    /** Stops the capture and trims the file to the last lastSeconds seconds */
+    freezeCapture: (lastSeconds: number) => CaptureStats;
+    getCaptureStats: () => CaptureStats;
+    /**
+     * Copies the running capture, or its last lastSeconds seconds, to a new file
+     * @return Number of records copied
+     */
+    snapshotCapture: (fileName: string, lastSeconds?: number) => number;
+    /** Maps a capture file for reading. It is not loaded into memory. */
+    openCaptureFile: (fileName: string) => CaptureFileInfo;
+    /**
+     * Fills buffer with CAPTURE_RECORD_SIZE byte records, oldest first. Decode them with CaptureRecordView.
+     * @return Number of records written
+     */
+    readCaptureRecords: (handle: number, firstRecord: number, buffer: ArrayBuffer | ArrayBufferView) => number;
+    /** @return Index of the first record at or after timeUs, or the record count if there is none */
+    findCaptureRecord: (handle: number, timeUs: number) => number;
+    closeCaptureFile: (handle: number) => void;
+    /**
+     * Sends the records of a capture file to a device with their recorded timing. The driver cancels its repeat of an
+     * ID that is sent once, so records of an ID that sendCANMessage() repeats are skipped and counted in failedSends.
+     * @return Handle to pass to waitForReplay(), getReplayStats() and stopReplay()
+     */
+    startReplay: (fileName: string, descriptor: string, options?: ReplayOptions) => number;
+    /**
+     * Resolves once the replay has sent every record or was stopped, and releases the handle. Wait for a stopped
+     * replay in the same tick as stopReplay(), since its handle is released once it has ended.
+     */
+    waitForReplay: (replayHandle: number) => Promise<ReplayStats>;
+    /** @return undefined if the handle is unknown or was released */
+    getReplayStats: (replayHandle: number) => ReplayStats | undefined;
+    stopReplay: (replayHandle: number) => void;
+    /**
+     * Sends requests and waits for their responses on a native thread, sending unanswered requests again. The driver
+     * cancels its repeat of an ID that is sent once, so requests with an ID that sendCANMessage() repeats are not sent
+     * and end as "sendFailed".
+     * @return Resolves once every request has a result, with the results in the order of requests
+     * @throws RangeError if a timeoutMs is not greater than 0 and at most 4294967
+     */
+    transact: (descriptor: string | DeviceHandle, requests: TransactionRequest[], options?: TransactionOptions) => Promise<TransactionResult[]>;
+    /**
+     * Call counts and latencies of every binding since the last reset, split into the time spent waiting
+     * for the device registry lock, inside CANBridge or the HAL, and building JS values
+     * @return undefined if the addon was built with CANBRIDGE_PERF_COUNTERS off
+     */
+    getPerfCounters: () => PerfCounters | undefined;
+    resetPerfCounters: () => void;
+    /** Starts recording begin/end and instant events from the native threads, discarding events not written yet */
+    startTrace: () => void;
+    stopTrace: () => void;
+    /**
+     * Writes the events recorded since startTrace() or the last writeTrace(), on a worker thread. Tracing can keep running.
+     * @param format Chrome trace-event JSON, or Perfetto protobuf. Defaults to "chrome". Both open in ui.perfetto.dev.
+     */
+    writeTrace: (fileName: string, format?: "chrome" | "perfetto") => Promise<TraceStats>;
+    /**
+     * Creates an in-process CAN device that works with every function that takes a descriptor
+     * @return Descriptor of the new device
+     */
+    createVirtualDevice: (options?: VirtualDeviceOptions) => string;
+    /** Changes the options of the bus the virtual device is on */
+    setVirtualBusOptions: (descriptor: string, options: VirtualBusOptions) => void;
+    setVirtualDeviceInjection: (descriptor: string, messageId: number, framesPerSecond: number) => void;
+    destroyVirtualDevice: (descriptor: string) => void;
 
     constructor() {
         try {
             const addon = require("pkg-prebuilds")(path.join(__dirname, '..'), bindingOptions);
 
             this.getDevices = promisify(addon.getDevices);
+            this.openDevice = addon.openDevice;
+            this.closeDevice = addon.closeDevice;
             this.registerDeviceToHAL = addon.registerDeviceToHAL;
             this.unregisterDeviceFromHAL = promisify(addon.unregisterDeviceFromHAL);
             this.receiveMessage = addon.receiveMessage;
             this.openStreamSession = addon.openStreamSession;
             this.readStreamSession = addon.readStreamSession;
+            this.readStreamSessionPacked = addon.readStreamSessionPacked;
             this.closeStreamSession = addon.closeStreamSession;
             this.getCANDetailStatus = addon.getCANDetailStatus;
             this.sendRtrMessage = addon.sendRtrMessage;
             this.sendCANMessage = addon.sendCANMessage;
+            this.sendCANMessages = addon.sendCANMessages;
             this.sendHALMessage = addon.sendHALMessage;
+            this.addPeriodicFrame = addon.addPeriodicFrame;
+            this.updatePeriodicFrame = addon.updatePeriodicFrame;
+            this.getPeriodicFrameStats = addon.getPeriodicFrameStats;
+            this.removePeriodicFrame = addon.removePeriodicFrame;
             this.initializeNotifier = addon.initializeNotifier;
             this.waitForNotifierAlarm = promisify(addon.waitForNotifierAlarm);
             this.stopNotifier = addon.stopNotifier;
+            this.getFPGATime = addon.getFPGATime;
+            this.createNotifier = addon.createNotifier;
+            this.updateNotifierAlarm = addon.updateNotifierAlarm;
+            this.cancelNotifierAlarm = addon.cancelNotifierAlarm;
+            this.waitForNotifier = addon.waitForNotifier;
+            this.cleanNotifier = addon.cleanNotifier;
+            this.getNotifierStats = addon.getNotifierStats;
+            this.startPeriodicNotifier = addon.startPeriodicNotifier;
+            this.getPeriodicNotifierStats = addon.getPeriodicNotifierStats;
+            this.stopPeriodicNotifier = addon.stopPeriodicNotifier;
             this.writeDfuToBin = addon.writeDfuToBin;
+            this.extractDfuElements = addon.extractDfuElements;
             this.getImageElements = addon.getImageElements;
+            this.verifyDfu = promisify(addon.verifyDfu);
             this.openHALStreamSession = addon.openHALStreamSession;
             this.readHALStreamSession = addon.readHALStreamSession;
+            this.readHALStreamSessionPacked = addon.readHALStreamSessionPacked;
             this.closeHALStreamSession = addon.closeHALStreamSession;
             this.setThreadPriority = addon.setThreadPriority;
             this.setSparkMaxHeartbeatData = addon.setSparkMaxHeartbeatData;
             this.startRevCommonHeartbeat = addon.startRevCommonHeartbeat;
             this.ackHeartbeats = addon.ackHeartbeats;
+            this.setHeartbeatTimeout = addon.setHeartbeatTimeout;
+            this.getHeartbeatWatchdogStats = addon.getHeartbeatWatchdogStats;
             this.stopHeartbeats = addon.stopHeartbeats;
             this.getLatestMessageOfEveryReceivedArbId = addon.getLatestMessageOfEveryReceivedArbId;
+            this.getLatestMessagesSince = addon.getLatestMessagesSince;
+            this.releaseReceiveTap = addon.releaseReceiveTap;
+            this.readLatestMessagesPacked = addon.readLatestMessagesPacked;
+            this.subscribe = addon.subscribe;
+            this.unsubscribe = addon.unsubscribe;
+            this.registerSignals = addon.registerSignals;
+            this.updateSignals = addon.updateSignals;
+            this.unregisterSignals = addon.unregisterSignals;
+            this.getTrafficStats = addon.getTrafficStats;
+            this.resetTrafficStats = addon.resetTrafficStats;
+            this.getDeviceClock = addon.getDeviceClock;
+            this.startCapture = addon.startCapture;
+            this.stopCapture = addon.stopCapture;
+            this.freezeCapture = addon.freezeCapture;
+            this.getCaptureStats = addon.getCaptureStats;
+            this.snapshotCapture = addon.snapshotCapture;
+            this.openCaptureFile = addon.openCaptureFile;
+            this.readCaptureRecords = addon.readCaptureRecords;
+            this.findCaptureRecord = addon.findCaptureRecord;
+            this.closeCaptureFile = addon.closeCaptureFile;
+            this.startReplay = addon.startReplay;
+            this.waitForReplay = addon.waitForReplay;
+            this.getReplayStats = addon.getReplayStats;
+            this.stopReplay = addon.stopReplay;
+            this.transact = addon.transact;
+            this.getPerfCounters = addon.getPerfCounters;
+            this.resetPerfCounters = addon.resetPerfCounters;
+            this.startTrace = addon.startTrace;
+            this.stopTrace = addon.stopTrace;
+            this.writeTrace = addon.writeTrace;
+            this.createVirtualDevice = addon.createVirtualDevice;
+            this.setVirtualBusOptions = addon.setVirtualBusOptions;
+            this.setVirtualDeviceInjection = addon.setVirtualDeviceInjection;
+            this.destroyVirtualDevice = addon.destroyVirtualDevice;
         } catch (e: any) {
             throw new CanBridgeInitializationError(e);
         }
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "PackedFrames.h"
+
+// FRC CAN arbitration IDs are 29-bit extended IDs laid out as
+//
+//   bits    field
+//   24-28   device type
+//   16-23   manufacturer
+//   10-15   API class
+//   6-9     API index
+//   0-5     device number
+#define ARB_ID_DEVICE_TYPE_SHIFT 24
+#define ARB_ID_DEVICE_TYPE_MASK 0x1F
+#define ARB_ID_MANUFACTURER_SHIFT 16
+#define ARB_ID_MANUFACTURER_MASK 0xFF
+#define ARB_ID_API_CLASS_SHIFT 10
+#define ARB_ID_API_CLASS_MASK 0x3F
+#define ARB_ID_API_INDEX_SHIFT 6
+#define ARB_ID_API_INDEX_MASK 0x0F
+#define ARB_ID_DEVICE_NUMBER_SHIFT 0
+#define ARB_ID_DEVICE_NUMBER_MASK 0x3F
+
+#define FRC_ARB_ID(deviceType, manufacturer, apiClass, apiIndex, deviceNumber) \
+    (((uint32_t)(deviceType) << ARB_ID_DEVICE_TYPE_SHIFT) | \
+     ((uint32_t)(manufacturer) << ARB_ID_MANUFACTURER_SHIFT) | \
+     ((uint32_t)(apiClass) << ARB_ID_API_CLASS_SHIFT) | \
+     ((uint32_t)(apiIndex) << ARB_ID_API_INDEX_SHIFT) | \
+     ((uint32_t)(deviceNumber) << ARB_ID_DEVICE_NUMBER_SHIFT))
+
+#define FRC_DEVICE_TYPE_BROADCAST 0
+#define FRC_DEVICE_TYPE_MOTOR_CONTROLLER 2
+#define FRC_MANUFACTURER_REV 5
+
+// IDs are decoded this many at a time
+#define ARB_ID_DECODE_CHUNK 256
+
+// One byte per frame for each field. Fields whose pointer is null are skipped.
+struct ArbIdColumns {
+    uint8_t* deviceType = nullptr;
+    uint8_t* manufacturer = nullptr;
+    uint8_t* apiClass = nullptr;
+    uint8_t* apiIndex = nullptr;
+    uint8_t* deviceNumber = nullptr;
+};
+
+// A plain loop over contiguous arrays, which the compiler turns into SIMD shifts and masks
+inline void extractArbIdField(const uint32_t* __restrict ids, uint32_t count, uint32_t shift, uint32_t mask, uint8_t* __restrict field) {
+    for (uint32_t i = 0; i < count; i++) {
+        field[i] = (uint8_t)((ids[i] >> shift) & mask);
+    }
+}
+
+inline void decodeArbIds(const uint32_t* ids, uint32_t count, const ArbIdColumns& columns, uint32_t first) {
+    if (columns.deviceType) extractArbIdField(ids, count, ARB_ID_DEVICE_TYPE_SHIFT, ARB_ID_DEVICE_TYPE_MASK, columns.deviceType + first);
+    if (columns.manufacturer) extractArbIdField(ids, count, ARB_ID_MANUFACTURER_SHIFT, ARB_ID_MANUFACTURER_MASK, columns.manufacturer + first);
+    if (columns.apiClass) extractArbIdField(ids, count, ARB_ID_API_CLASS_SHIFT, ARB_ID_API_CLASS_MASK, columns.apiClass + first);
+    if (columns.apiIndex) extractArbIdField(ids, count, ARB_ID_API_INDEX_SHIFT, ARB_ID_API_INDEX_MASK, columns.apiIndex + first);
+    if (columns.deviceNumber) extractArbIdField(ids, count, ARB_ID_DEVICE_NUMBER_SHIFT, ARB_ID_DEVICE_NUMBER_MASK, columns.deviceNumber + first);
+}
+
+// Decodes the IDs of records written by the packed read functions. The IDs are first copied
+// out of the records in chunks, so that each field is extracted from a contiguous array.
+inline void decodePackedArbIds(const uint8_t* records, uint32_t count, const ArbIdColumns& columns) {
+    uint32_t ids[ARB_ID_DECODE_CHUNK];
+    for (uint32_t first = 0; first < count; first += ARB_ID_DECODE_CHUNK) {
+        uint32_t chunkSize = std::min<uint32_t>(count - first, ARB_ID_DECODE_CHUNK);
+        for (uint32_t i = 0; i < chunkSize; i++) {
+            std::memcpy(&ids[i], records + (first + i) * PACKED_FRAME_RECORD_SIZE, 4);
+        }
+        decodeArbIds(ids, chunkSize, columns, first);
+    }
+}
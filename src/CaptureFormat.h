@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// On-disk layout of a capture file, in host byte order (little-endian on every
+// platform we ship for). Keep in sync with CaptureRecordView in lib/binding.ts.
+//
+// A file is a CaptureFileHeader padded to CAPTURE_HEADER_SIZE bytes, then the
+// index, then recordCapacity records used as a ring: record number n lives in
+// slot n % recordCapacity, and the file holds the last
+// min(recordCount, recordCapacity) records. Entry b of the index holds the
+// timestamp of whatever record is in slot b * CAPTURE_INDEX_STRIDE, which lets
+// readers find a time without touching every page of the file.
+//
+// Record timestamps never decrease with the record number. A record that
+// reaches the writer after a newer one was written takes the newer one's
+// timestamp, which is at most a scheduling delay later than its own.
+#define CAPTURE_FILE_MAGIC "CANCAP01"
+#define CAPTURE_FILE_VERSION 1
+#define CAPTURE_HEADER_SIZE 4096
+#define CAPTURE_INDEX_STRIDE 1024
+#define CAPTURE_MAX_CHANNELS 16
+#define CAPTURE_CHANNEL_NAME_SIZE 64
+
+// Channel of frames sent through the HAL, and of frames sent to a device that is not being captured
+#define CAPTURE_CHANNEL_HAL 0xFE
+#define CAPTURE_CHANNEL_UNKNOWN 0xFF
+
+#define CAPTURE_FLAG_FROZEN 1
+#define CAPTURE_FLAG_CLOSED 2
+
+#define CAPTURE_RECORD_FLAG_TRANSMIT 1
+
+struct CaptureFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint32_t indexStride;
+    uint64_t recordCapacity;
+    // Records ever written. Updated after the records themselves.
+    uint64_t recordCount;
+    uint64_t droppedRecords;
+    // Wall-clock time of timestamp 0, in microseconds since the Unix epoch
+    uint64_t startWallTimeUs;
+    // Records older than this are not part of the capture. Set when it is frozen.
+    uint64_t validFromUs;
+    uint32_t flags;
+    uint32_t channelCount;
+    // Descriptor of each channel, NUL-terminated
+    char channels[CAPTURE_MAX_CHANNELS][CAPTURE_CHANNEL_NAME_SIZE];
+};
+
+static_assert(sizeof(CaptureFileHeader) <= CAPTURE_HEADER_SIZE, "Header does not fit");
+
+//   offset  size  field
+//   0       8     timestampUs, since the capture started
+//   8       4     messageID
+//   12      1     channel
+//   13      1     flags
+//   14      1     dataSize
+//   15      1     reserved
+//   16      8     data
+//   24      8     record number
+struct CaptureRecord {
+    uint64_t timestampUs;
+    uint32_t messageId;
+    uint8_t channel;
+    uint8_t flags;
+    uint8_t dataSize;
+    uint8_t reserved;
+    uint8_t data[8];
+    uint64_t recordNumber;
+};
+
+#define CAPTURE_RECORD_SIZE 32
+static_assert(sizeof(CaptureRecord) == CAPTURE_RECORD_SIZE, "Unexpected record padding");
+
+inline size_t captureIndexEntries(uint64_t recordCapacity) {
+    return (recordCapacity + CAPTURE_INDEX_STRIDE - 1) / CAPTURE_INDEX_STRIDE;
+}
+
+inline size_t captureRecordsOffset(uint64_t recordCapacity) {
+    size_t indexEnd = CAPTURE_HEADER_SIZE + captureIndexEntries(recordCapacity) * sizeof(uint64_t);
+    return (indexEnd + CAPTURE_RECORD_SIZE - 1) / CAPTURE_RECORD_SIZE * CAPTURE_RECORD_SIZE;
+}
+
+inline size_t captureFileSize(uint64_t recordCapacity) {
+    return captureRecordsOffset(recordCapacity) + recordCapacity * CAPTURE_RECORD_SIZE;
+}
+
+// Record number of the first record in [first, end) with a timestamp of at least timeUs, or end if
+// there is none. Narrows the range with the index first, so only one block of records is touched.
+// Relies on the records being in timestamp order.
+// The record capacity must be a multiple of CAPTURE_INDEX_STRIDE.
+inline uint64_t captureLowerBound(const uint64_t* index, const CaptureRecord* records, uint64_t recordCapacity,
+                                  uint64_t first, uint64_t end, uint64_t timeUs) {
+    auto indexTimestamp = [&](uint64_t block) {
+        return index[(block * CAPTURE_INDEX_STRIDE % recordCapacity) / CAPTURE_INDEX_STRIDE];
+    };
+
+    // First whole block that starts at or after timeUs
+    uint64_t low = (first + CAPTURE_INDEX_STRIDE - 1) / CAPTURE_INDEX_STRIDE;
+    uint64_t high = end / CAPTURE_INDEX_STRIDE;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (indexTimestamp(mid) < timeUs) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    // The answer is in the block before it
+    uint64_t from = low > 0 && (low - 1) * CAPTURE_INDEX_STRIDE > first ? (low - 1) * CAPTURE_INDEX_STRIDE : first;
+    uint64_t to = low * CAPTURE_INDEX_STRIDE < end ? low * CAPTURE_INDEX_STRIDE : end;
+    while (from < to) {
+        uint64_t mid = from + (to - from) / 2;
+        if (records[mid % recordCapacity].timestampUs < timeUs) {
+            from = mid + 1;
+        } else {
+            to = mid;
+        }
+    }
+    return from;
+}
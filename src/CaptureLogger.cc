@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cstring>
+#include "CaptureLogger.h"
+
+// How long the writer thread sleeps when no producer had anything
+#define CAPTURE_WRITER_IDLE_US 1000
+
+namespace {
+// Gives the ring back when its thread exits, so short-lived threads do not leak rings
+struct RingLease {
+    SpscRing<CaptureRecord>* ring = nullptr;
+    std::atomic<bool>* owned = nullptr;
+
+    ~RingLease() {
+        if (owned != nullptr) owned->store(false, std::memory_order_release);
+    }
+};
+
+thread_local RingLease ringLease;
+
+int64_t steadyNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t roundUpToIndexStride(uint64_t recordCount) {
+    recordCount = std::max<uint64_t>(recordCount, 1);
+    return (recordCount + CAPTURE_INDEX_STRIDE - 1) / CAPTURE_INDEX_STRIDE * CAPTURE_INDEX_STRIDE;
+}
+
+// Lays out a new capture file and returns its header
+CaptureFileHeader* initializeFile(MappedFile& file, uint64_t recordCapacity) {
+    std::memset(file.Data(), 0, captureRecordsOffset(recordCapacity));
+    CaptureFileHeader* header = (CaptureFileHeader*)file.Data();
+    std::memcpy(header->magic, CAPTURE_FILE_MAGIC, sizeof(header->magic));
+    header->version = CAPTURE_FILE_VERSION;
+    header->headerSize = CAPTURE_HEADER_SIZE;
+    header->recordSize = CAPTURE_RECORD_SIZE;
+    header->indexStride = CAPTURE_INDEX_STRIDE;
+    header->recordCapacity = recordCapacity;
+    return header;
+}
+}
+
+CaptureLogger& CaptureLogger::Instance() {
+    static CaptureLogger* instance = new CaptureLogger();
+    return *instance;
+}
+
+uint64_t CaptureLogger::NowUs() const {
+    int64_t elapsed = steadyNowUs() - m_startUs.load(std::memory_order_relaxed);
+    return elapsed > 0 ? elapsed : 0;
+}
+
+bool CaptureLogger::Start(const std::string& path, uint64_t recordCapacity,
+                          const std::vector<std::pair<std::string, const void*>>& channels, std::string* error) {
+    if (m_running) {
+        *error = "A capture is already running";
+        return false;
+    }
+    if (channels.size() > CAPTURE_MAX_CHANNELS) {
+        *error = "A capture can record at most " + std::to_string(CAPTURE_MAX_CHANNELS) + " devices";
+        return false;
+    }
+
+    recordCapacity = roundUpToIndexStride(recordCapacity);
+    std::unique_ptr<MappedFile> file = MappedFile::Create(path, captureFileSize(recordCapacity), error);
+    if (!file) return false;
+
+    std::scoped_lock lock{m_fileMtx};
+    m_header = initializeFile(*file, recordCapacity);
+    m_header->startWallTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    m_header->channelCount = channels.size();
+    for (size_t i = 0; i < channels.size(); i++) {
+        std::strncpy(m_header->channels[i], channels[i].first.c_str(), CAPTURE_CHANNEL_NAME_SIZE - 1);
+        m_channelDevices[i].store(channels[i].second, std::memory_order_relaxed);
+    }
+    m_channelCount.store(channels.size(), std::memory_order_relaxed);
+    m_index = (uint64_t*)(file->Data() + CAPTURE_HEADER_SIZE);
+    m_records = (CaptureRecord*)(file->Data() + captureRecordsOffset(recordCapacity));
+    m_file = std::move(file);
+
+    // Throw away whatever producers pushed after the previous capture stopped
+    std::vector<CaptureRecord> stale;
+    Drain(stale);
+
+    m_startUs.store(steadyNowUs(), std::memory_order_relaxed);
+    m_dropped = 0;
+    m_running = true;
+    m_writer = std::thread(&CaptureLogger::Run, this);
+    m_active.store(true, std::memory_order_release);
+    return true;
+}
+
+CaptureStats CaptureLogger::Stop(double lastSeconds) {
+    m_active.store(false, std::memory_order_relaxed);
+    if (m_running) {
+        m_running = false;
+        m_writer.join();
+    }
+
+    CaptureStats stats = GetStats();
+    std::scoped_lock lock{m_fileMtx};
+    if (!m_file) return stats;
+
+    if (lastSeconds > 0) {
+        uint64_t window = (uint64_t)(lastSeconds * 1e6);
+        uint64_t now = NowUs();
+        m_header->validFromUs = now > window ? now - window : 0;
+        m_header->flags |= CAPTURE_FLAG_FROZEN;
+    }
+    m_header->flags |= CAPTURE_FLAG_CLOSED;
+    m_file->Flush();
+    m_file.reset();
+    m_header = nullptr;
+    m_index = nullptr;
+    m_records = nullptr;
+    m_channelCount.store(0, std::memory_order_relaxed);
+    return stats;
+}
+
+CaptureStats CaptureLogger::GetStats() {
+    CaptureStats stats;
+    stats.dropped = m_dropped.load(std::memory_order_relaxed);
+    std::scoped_lock lock{m_fileMtx};
+    if (m_header != nullptr) stats.recorded = m_header->recordCount;
+    return stats;
+}
+
+uint8_t CaptureLogger::ChannelForDevice(const void* device) const {
+    uint32_t channelCount = m_channelCount.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < channelCount; i++) {
+        if (m_channelDevices[i].load(std::memory_order_relaxed) == device) return i;
+    }
+    return device == nullptr ? CAPTURE_CHANNEL_HAL : CAPTURE_CHANNEL_UNKNOWN;
+}
+
+SpscRing<CaptureRecord>* CaptureLogger::AcquireRing() {
+    std::scoped_lock lock{m_ringsMtx};
+    for (auto& producerRing : m_rings) {
+        bool expected = false;
+        if (producerRing->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            ringLease.owned = &producerRing->owned;
+            return &producerRing->ring;
+        }
+    }
+    m_rings.push_back(std::make_unique<ProducerRing>());
+    m_rings.back()->owned = true;
+    ringLease.owned = &m_rings.back()->owned;
+    return &m_rings.back()->ring;
+}
+
+void CaptureLogger::RecordSlow(uint8_t channel, bool transmit, uint32_t messageId, const uint8_t* data, uint8_t dataSize) {
+    if (ringLease.ring == nullptr) ringLease.ring = AcquireRing();
+
+    CaptureRecord record;
+    record.timestampUs = NowUs();
+    record.messageId = messageId;
+    record.channel = channel;
+    record.flags = transmit ? CAPTURE_RECORD_FLAG_TRANSMIT : 0;
+    record.dataSize = std::min<uint8_t>(dataSize, 8);
+    record.reserved = 0;
+    std::memset(record.data, 0, sizeof(record.data));
+    std::memcpy(record.data, data, record.dataSize);
+    record.recordNumber = 0;
+
+    if (!ringLease.ring->TryPush(record)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+size_t CaptureLogger::Drain(std::vector<CaptureRecord>& batch) {
+    std::vector<Ring*> rings;
+    {
+        std::scoped_lock lock{m_ringsMtx};
+        for (auto& producerRing : m_rings) rings.push_back(&producerRing->ring);
+    }
+
+    batch.clear();
+    CaptureRecord record;
+    for (Ring* ring : rings) {
+        while (ring->TryPop(&record)) batch.push_back(record);
+    }
+    return batch.size();
+}
+
+void CaptureLogger::WriteRecords(const std::vector<CaptureRecord>& batch) {
+    std::scoped_lock lock{m_fileMtx};
+    uint64_t recordCount = m_header->recordCount;
+    uint64_t recordCapacity = m_header->recordCapacity;
+    uint64_t newestUs = recordCount > 0 ? m_records[(recordCount - 1) % recordCapacity].timestampUs : 0;
+    for (const CaptureRecord& record : batch) {
+        uint64_t slot = recordCount % recordCapacity;
+        m_records[slot] = record;
+        m_records[slot].recordNumber = recordCount;
+        // A producer that was preempted between taking its timestamp and pushing the record can reach
+        // us after a newer record was written. Keep the file in order, which the index relies on.
+        newestUs = std::max(newestUs, record.timestampUs);
+        m_records[slot].timestampUs = newestUs;
+        if (slot % CAPTURE_INDEX_STRIDE == 0) {
+            m_index[slot / CAPTURE_INDEX_STRIDE] = newestUs;
+        }
+        recordCount++;
+    }
+    m_header->droppedRecords = m_dropped.load(std::memory_order_relaxed);
+    m_header->recordCount = recordCount;
+}
+
+void CaptureLogger::Run() {
+    std::vector<CaptureRecord> batch;
+    while (m_running) {
+        if (Drain(batch) == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(CAPTURE_WRITER_IDLE_US));
+            continue;
+        }
+        // Each producer's frames are in order already, this interleaves the producers
+        std::stable_sort(batch.begin(), batch.end(), [](const CaptureRecord& a, const CaptureRecord& b) {
+            return a.timestampUs < b.timestampUs;
+        });
+        WriteRecords(batch);
+    }
+
+    if (Drain(batch) > 0) {
+        std::stable_sort(batch.begin(), batch.end(), [](const CaptureRecord& a, const CaptureRecord& b) {
+            return a.timestampUs < b.timestampUs;
+        });
+        WriteRecords(batch);
+    }
+}
+
+int64_t CaptureLogger::Snapshot(const std::string& path, double lastSeconds, std::string* error) {
+    std::scoped_lock lock{m_fileMtx};
+    if (!m_file) {
+        *error = "No capture is running";
+        return -1;
+    }
+
+    uint64_t recordCapacity = m_header->recordCapacity;
+    uint64_t end = m_header->recordCount;
+    uint64_t first = end > recordCapacity ? end - recordCapacity : 0;
+    if (lastSeconds > 0) {
+        uint64_t window = (uint64_t)(lastSeconds * 1e6);
+        uint64_t now = NowUs();
+        first = captureLowerBound(m_index, m_records, recordCapacity, first, end, now > window ? now - window : 0);
+    }
+    uint64_t count = end - first;
+
+    uint64_t snapshotCapacity = roundUpToIndexStride(count);
+    std::unique_ptr<MappedFile> file = MappedFile::Create(path, captureFileSize(snapshotCapacity), error);
+    if (!file) return -1;
+
+    CaptureFileHeader* header = initializeFile(*file, snapshotCapacity);
+    header->startWallTimeUs = m_header->startWallTimeUs;
+    header->droppedRecords = m_header->droppedRecords;
+    header->channelCount = m_header->channelCount;
+    std::memcpy(header->channels, m_header->channels, sizeof(header->channels));
+    header->flags = CAPTURE_FLAG_CLOSED;
+
+    uint64_t* index = (uint64_t*)(file->Data() + CAPTURE_HEADER_SIZE);
+    CaptureRecord* records = (CaptureRecord*)(file->Data() + captureRecordsOffset(snapshotCapacity));
+    for (uint64_t i = 0; i < count; i++) {
+        records[i] = m_records[(first + i) % recordCapacity];
+        records[i].recordNumber = i;
+        if (i % CAPTURE_INDEX_STRIDE == 0) index[i / CAPTURE_INDEX_STRIDE] = records[i].timestampUs;
+    }
+    header->recordCount = count;
+    file->Flush();
+    return count;
+}
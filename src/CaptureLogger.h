@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CaptureFormat.h"
+#include "MappedFile.h"
+#include "SpscRing.h"
+
+#define CAPTURE_PRODUCER_RING_SIZE 4096
+
+struct CaptureStats {
+    uint64_t recorded = 0;
+    // Frames lost because a producer ring was full
+    uint64_t dropped = 0;
+};
+
+// Records frames into a memory-mapped ring file. Record() never blocks and
+// never takes a lock once a thread has its ring: every thread that records
+// gets its own SpscRing, and one writer thread drains all of them into the file.
+//
+// There is one logger per process, see Instance(). It is never destroyed, so
+// the rings handed out to threads stay valid.
+class CaptureLogger {
+public:
+    static CaptureLogger& Instance();
+
+    // Starts a new capture. channels holds the descriptor of each channel and the device behind it
+    // (nullptr for a device registered to the HAL). Returns false and sets error on failure.
+    bool Start(const std::string& path, uint64_t recordCapacity,
+               const std::vector<std::pair<std::string, const void*>>& channels, std::string* error);
+    // Stops the capture and flushes the file. lastSeconds > 0 freezes it: readers will only see
+    // the records from the last lastSeconds seconds.
+    CaptureStats Stop(double lastSeconds = 0);
+    bool IsActive() const { return m_active.load(std::memory_order_relaxed); }
+    CaptureStats GetStats();
+
+    // Writes the records from the last lastSeconds seconds (all if 0) of the running capture to a
+    // new file, oldest first. The writer thread waits while the records are copied, and producers
+    // keep filling their rings meanwhile. Returns the number of records written, or -1 and sets error.
+    int64_t Snapshot(const std::string& path, double lastSeconds, std::string* error);
+
+    void Record(uint8_t channel, bool transmit, uint32_t messageId, const uint8_t* data, uint8_t dataSize) {
+        if (!m_active.load(std::memory_order_relaxed)) return;
+        RecordSlow(channel, transmit, messageId, data, dataSize);
+    }
+    // Channel of a device, or CAPTURE_CHANNEL_UNKNOWN if it is not being captured
+    uint8_t ChannelForDevice(const void* device) const;
+
+private:
+    using Ring = SpscRing<CaptureRecord>;
+
+    struct ProducerRing {
+        Ring ring{CAPTURE_PRODUCER_RING_SIZE};
+        std::atomic<bool> owned{false};
+    };
+
+    CaptureLogger() = default;
+
+    void RecordSlow(uint8_t channel, bool transmit, uint32_t messageId, const uint8_t* data, uint8_t dataSize);
+    Ring* AcquireRing();
+    void Run();
+    size_t Drain(std::vector<CaptureRecord>& batch);
+    void WriteRecords(const std::vector<CaptureRecord>& batch);
+    uint64_t NowUs() const;
+
+    std::atomic<bool> m_active{false};
+    std::atomic<uint64_t> m_dropped{0};
+    // Steady clock time of timestamp 0, in microseconds
+    std::atomic<int64_t> m_startUs{0};
+    std::atomic<const void*> m_channelDevices[CAPTURE_MAX_CHANNELS] = {};
+    std::atomic<uint32_t> m_channelCount{0};
+
+    std::mutex m_ringsMtx;
+    // Only grows. Should only be accessed while holding m_ringsMtx.
+    std::vector<std::unique_ptr<ProducerRing>> m_rings;
+
+    std::atomic<bool> m_running{false};
+    std::thread m_writer;
+
+    std::mutex m_fileMtx;
+    // These values should only be accessed while holding m_fileMtx
+    std::unique_ptr<MappedFile> m_file;
+    CaptureFileHeader* m_header = nullptr;
+    uint64_t* m_index = nullptr;
+    CaptureRecord* m_records = nullptr;
+};
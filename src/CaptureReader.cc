@@ -0,0 +1,50 @@
+#include <cstring>
+#include <string>
+#include "CaptureReader.h"
+
+std::unique_ptr<CaptureReader> CaptureReader::Open(const std::string& path, std::string* error) {
+    std::unique_ptr<CaptureReader> reader(new CaptureReader());
+    reader->m_file = MappedFile::Open(path, error);
+    if (!reader->m_file) return nullptr;
+
+    const MappedFile& file = *reader->m_file;
+    const CaptureFileHeader* header = (const CaptureFileHeader*)file.Data();
+    if (file.Size() < CAPTURE_HEADER_SIZE || std::memcmp(header->magic, CAPTURE_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        *error = path + " is not a capture file";
+        return nullptr;
+    }
+    if (header->version != CAPTURE_FILE_VERSION || header->headerSize != CAPTURE_HEADER_SIZE ||
+        header->recordSize != CAPTURE_RECORD_SIZE || header->indexStride != CAPTURE_INDEX_STRIDE) {
+        *error = path + " uses an unsupported capture format";
+        return nullptr;
+    }
+    if (header->recordCapacity == 0 || header->recordCapacity % CAPTURE_INDEX_STRIDE != 0 ||
+        file.Size() < captureFileSize(header->recordCapacity) || header->channelCount > CAPTURE_MAX_CHANNELS) {
+        *error = path + " is truncated or corrupt";
+        return nullptr;
+    }
+
+    reader->m_header = header;
+    reader->m_index = (const uint64_t*)(file.Data() + CAPTURE_HEADER_SIZE);
+    reader->m_records = (const CaptureRecord*)(file.Data() + captureRecordsOffset(header->recordCapacity));
+    reader->m_end = header->recordCount;
+    reader->m_first = reader->m_end > header->recordCapacity ? reader->m_end - header->recordCapacity : 0;
+    if (header->validFromUs > 0) {
+        reader->m_first = captureLowerBound(reader->m_index, reader->m_records, header->recordCapacity,
+                                            reader->m_first, reader->m_end, header->validFromUs);
+    }
+
+    // Readers copy dataSize bytes out of records, so this is the one field a damaged record must not get wrong.
+    // Checking it loads every page of the file, which anything that reads the records does anyway.
+    for (uint64_t i = 0; i < reader->Count(); i++) {
+        if (reader->At(i).dataSize > 8) {
+            *error = path + " is corrupt: record " + std::to_string(i) + " has a payload longer than 8 bytes";
+            return nullptr;
+        }
+    }
+    return reader;
+}
+
+uint64_t CaptureReader::Find(uint64_t timeUs) const {
+    return captureLowerBound(m_index, m_records, m_header->recordCapacity, m_first, m_end, timeUs) - m_first;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "CaptureFormat.h"
+#include "MappedFile.h"
+
+// Read-only view of a capture file. The file is mapped rather than loaded, so
+// opening it is quick regardless of its size and only the pages that are read
+// get loaded.
+//
+// Records are numbered from 0, oldest first, starting at the oldest record
+// that is still in the ring and not before the freeze window.
+class CaptureReader {
+public:
+    // Returns nullptr and sets error if the file cannot be mapped, is not a capture file, or has a
+    // record with a payload longer than 8 bytes
+    static std::unique_ptr<CaptureReader> Open(const std::string& path, std::string* error);
+
+    const CaptureFileHeader& Header() const { return *m_header; }
+    uint64_t Count() const { return m_end - m_first; }
+    const CaptureRecord& At(uint64_t i) const { return m_records[(m_first + i) % m_header->recordCapacity]; }
+    // Number of the first record with a timestamp of at least timeUs, or Count() if there is none
+    uint64_t Find(uint64_t timeUs) const;
+
+private:
+    CaptureReader() = default;
+
+    std::unique_ptr<MappedFile> m_file;
+    const CaptureFileHeader* m_header = nullptr;
+    const uint64_t* m_index = nullptr;
+    const CaptureRecord* m_records = nullptr;
+    uint64_t m_first = 0;
+    uint64_t m_end = 0;
+};
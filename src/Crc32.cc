@@ -0,0 +1,209 @@
+#include <array>
+#include <cstring>
+#include "Crc32.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32_HAVE_PCLMUL 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC32_TARGET_PCLMUL
+#else
+#include <cpuid.h>
+#define CRC32_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#define CRC32_HAVE_ARM_CRC 1
+#include <arm_acle.h>
+#endif
+
+// Reflected IEEE 802.3 polynomial
+#define CRC32_POLYNOMIAL 0xEDB88320u
+
+namespace {
+// tables[0] is the classic byte-at-a-time table. tables[k] advances a byte that is followed by k more.
+constexpr std::array<std::array<uint32_t, 256>, 8> makeSliceBy8Tables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : crc >> 1;
+        }
+        tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr auto sliceBy8Tables = makeSliceBy8Tables();
+
+#ifdef CRC32_HAVE_PCLMUL
+bool cpuSupportsPclmul() {
+    unsigned int registers[4] = {};
+#ifdef _MSC_VER
+    __cpuid((int*)registers, 1);
+#else
+    if (!__get_cpuid(1, &registers[0], &registers[1], &registers[2], &registers[3])) return false;
+#endif
+    // ECX bit 1 is PCLMULQDQ, bit 19 is SSE4.1
+    return (registers[2] & (1u << 1)) && (registers[2] & (1u << 19));
+}
+
+// Folds 64 bytes at a time with carry-less multiplication, then reduces to 32 bits with Barrett
+// reduction, as described in Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+// Instruction". The constants are that paper's, for the reflected IEEE polynomial.
+// size must be a multiple of 16 and at least 64.
+CRC32_TARGET_PCLMUL
+uint32_t crc32UpdatePclmul(uint32_t crc, const uint8_t* data, size_t size) {
+    alignas(16) static const uint64_t k1k2[] = {0x0154442BD4, 0x01C6E41596};
+    alignas(16) static const uint64_t k3k4[] = {0x01751997D0, 0x00CCAA009E};
+    alignas(16) static const uint64_t k5k0[] = {0x0163CD6124, 0x0000000000};
+    alignas(16) static const uint64_t poly[] = {0x01DB710641, 0x01F7011641};
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    __m128i k = _mm_load_si128((const __m128i*)k1k2);
+    data += 64;
+    size -= 64;
+
+    // Fold four blocks in parallel
+    while (size >= 64) {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, k, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, k, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, k, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(data + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(data + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(data + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(data + 0x30)));
+        data += 64;
+        size -= 64;
+    }
+
+    // Fold the four blocks into one
+    k = _mm_load_si128((const __m128i*)k3k4);
+    for (__m128i next : {x2, x3, x4}) {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, next), x5);
+    }
+
+    // Fold the remaining 16 byte blocks
+    while (size >= 16) {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)data)), x5);
+        data += 16;
+        size -= 16;
+    }
+
+    // Fold 128 bits down to 64
+    __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    k = _mm_loadl_epi64((const __m128i*)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    k = _mm_load_si128((const __m128i*)poly);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+#endif
+
+#ifdef CRC32_HAVE_ARM_CRC
+uint32_t crc32UpdateArm(uint32_t crc, const uint8_t* data, size_t size) {
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        crc = __crc32d(crc, word);
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = __crc32b(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+enum class Implementation { SliceBy8, Pclmul, ArmCrc };
+
+Implementation pickImplementation() {
+#if defined(CRC32_HAVE_PCLMUL)
+    if (cpuSupportsPclmul()) return Implementation::Pclmul;
+#elif defined(CRC32_HAVE_ARM_CRC)
+    return Implementation::ArmCrc;
+#endif
+    return Implementation::SliceBy8;
+}
+
+Implementation implementation() {
+    static const Implementation picked = pickImplementation();
+    return picked;
+}
+}
+
+uint32_t crc32UpdateSliceBy8(uint32_t crc, const uint8_t* data, size_t size) {
+    const auto& t = sliceBy8Tables;
+    // Assumes a little-endian CPU, like the rest of the file parsing
+    while (size >= 8) {
+        uint32_t low;
+        uint32_t high;
+        std::memcpy(&low, data, 4);
+        std::memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size) {
+    switch (implementation()) {
+#ifdef CRC32_HAVE_PCLMUL
+        case Implementation::Pclmul:
+            if (size >= 64) {
+                size_t folded = size & ~(size_t)15;
+                crc = crc32UpdatePclmul(crc, data, folded);
+                data += folded;
+                size -= folded;
+            }
+            return crc32UpdateSliceBy8(crc, data, size);
+#endif
+#ifdef CRC32_HAVE_ARM_CRC
+        case Implementation::ArmCrc:
+            return crc32UpdateArm(crc, data, size);
+#endif
+        default:
+            return crc32UpdateSliceBy8(crc, data, size);
+    }
+}
+
+const char* crc32Implementation() {
+    switch (implementation()) {
+        case Implementation::Pclmul: return "pclmul";
+        case Implementation::ArmCrc: return "armv8-crc";
+        default: return "slice-by-8";
+    }
+}
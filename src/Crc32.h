@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 with the IEEE 802.3 polynomial, bit-reflected, as used by zlib and DFU files.
+//
+// crc32Update() advances the raw CRC register, without the initial and final
+// inversions, so callers can pick their own convention. DFU files start from
+// 0xFFFFFFFF and store the register without the final inversion; zlib's
+// crc32() is ~crc32Update(~crc, data, size).
+//
+// The fastest implementation the CPU supports is picked on first use: carry-less
+// multiplication folding on x86-64 CPUs with PCLMULQDQ, the CRC32 instructions
+// on ARMv8 builds that enable them, and slice-by-8 tables everywhere else.
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size);
+
+// Name of the implementation crc32Update() uses, for benchmarks
+const char* crc32Implementation();
+
+// The portable implementation, exposed so that the others can be checked against it
+uint32_t crc32UpdateSliceBy8(uint32_t crc, const uint8_t* data, size_t size);
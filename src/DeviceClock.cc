@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "DeviceClock.h"
+
+int64_t ClockModel::OffsetAt(uint64_t deviceUs) const {
+    return offsetUs + (int64_t)std::llround(drift * (double)(int64_t)(deviceUs - referenceUs));
+}
+
+uint64_t ClockModel::ToHostUs(uint64_t deviceUs) const {
+    int64_t hostUs = (int64_t)deviceUs + OffsetAt(deviceUs);
+    return hostUs > 0 ? hostUs : 0;
+}
+
+uint64_t ClockModel::ToDeviceUs(uint64_t hostUs) const {
+    // Inverts hostUs = deviceUs + offsetUs + drift * (deviceUs - referenceUs)
+    double sinceReferenceUs = (double)((int64_t)hostUs - offsetUs - (int64_t)referenceUs) / (1 + drift);
+    int64_t deviceUs = (int64_t)referenceUs + std::llround(sinceReferenceUs);
+    return deviceUs > 0 ? deviceUs : 0;
+}
+
+Napi::Object DeviceClockStats::ToObject(Napi::Env env) const {
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("samples", Napi::Number::New(env, samples));
+    stats.Set("offsetUs", Napi::Number::New(env, model.offsetUs));
+    stats.Set("referenceUs", Napi::Number::New(env, model.referenceUs));
+    stats.Set("driftPpm", Napi::Number::New(env, model.drift * 1e6));
+    stats.Set("windows", Napi::Number::New(env, windows));
+    stats.Set("resyncs", Napi::Number::New(env, resyncs));
+    stats.Set("hostNowUs", Napi::Number::New(env, hostNowUs));
+    stats.Set("deviceNowUs", Napi::Number::New(env, deviceNowUs));
+    return stats;
+}
+
+uint64_t DeviceClock::HostNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t DeviceClock::ExtendNear(uint32_t deviceUs, uint64_t nearUs) {
+    int32_t deltaUs = (int32_t)(deviceUs - (uint32_t)nearUs);
+    if (deltaUs < 0 && (uint64_t)-(int64_t)deltaUs > nearUs) return deviceUs;
+    return nearUs + deltaUs;
+}
+
+uint64_t DeviceClock::Observe(uint32_t deviceUs) {
+    uint64_t hostUs = HostNowUs();
+    std::scoped_lock lock{m_mtx};
+    m_samples++;
+
+    // The model knows roughly what the device clock reads now, even after a long time without frames
+    uint64_t nearUs = m_model.valid ? m_model.ToDeviceUs(hostUs) : m_newestUs.load(std::memory_order_relaxed);
+    uint64_t extendedUs = ExtendNear(deviceUs, nearUs);
+    int64_t offsetUs = (int64_t)hostUs - (int64_t)extendedUs;
+    if (!m_model.valid) {
+        Restart(extendedUs, offsetUs, hostUs);
+        return extendedUs;
+    }
+    if (extendedUs > m_newestUs.load(std::memory_order_relaxed)) m_newestUs.store(extendedUs, std::memory_order_relaxed);
+
+    // The frame got here quicker than the estimate allows, so the offset is smaller
+    int64_t excessUs = m_model.OffsetAt(extendedUs) - offsetUs;
+    if (excessUs > DEVICE_CLOCK_RESYNC_US) {
+        Restart(extendedUs, offsetUs, hostUs);
+        return extendedUs;
+    }
+    if (excessUs > 0) m_model.offsetUs -= excessUs;
+
+    if (offsetUs < m_window.offsetUs) m_window = {extendedUs, offsetUs};
+    if (hostUs - m_windowStartUs >= DEVICE_CLOCK_WINDOW_US) CloseWindow(hostUs);
+    return extendedUs;
+}
+
+void DeviceClock::Restart(uint64_t deviceUs, int64_t offsetUs, uint64_t hostUs) {
+    if (m_model.valid) m_resyncs++;
+    m_model = {true, deviceUs, offsetUs, 0};
+    m_newestUs.store(deviceUs, std::memory_order_relaxed);
+    m_window = {deviceUs, offsetUs};
+    m_windowStartUs = hostUs;
+    m_windowCount = 0;
+    m_nextWindow = 0;
+    m_lateWindows = 0;
+}
+
+void DeviceClock::CloseWindow(uint64_t hostUs) {
+    // A device clock that jumped back makes every frame look late
+    if (m_window.offsetUs - m_model.OffsetAt(m_window.deviceUs) > DEVICE_CLOCK_RESYNC_US) {
+        if (++m_lateWindows >= DEVICE_CLOCK_RESYNC_WINDOWS) {
+            Restart(m_window.deviceUs, m_window.offsetUs, hostUs);
+            return;
+        }
+    } else {
+        m_lateWindows = 0;
+        m_windows[m_nextWindow] = m_window;
+        m_nextWindow = (m_nextWindow + 1) % DEVICE_CLOCK_WINDOWS;
+        m_windowCount = std::min<uint32_t>(m_windowCount + 1, DEVICE_CLOCK_WINDOWS);
+        Fit();
+    }
+    m_window = {0, INT64_MAX};
+    m_windowStartUs = hostUs;
+}
+
+void DeviceClock::Fit() {
+    // Relative to the newest window, so the sums keep their precision
+    const Window& newest = m_windows[(m_nextWindow + DEVICE_CLOCK_WINDOWS - 1) % DEVICE_CLOCK_WINDOWS];
+    auto window = [&](uint32_t i) -> const Window& {
+        return m_windows[(m_nextWindow + DEVICE_CLOCK_WINDOWS - m_windowCount + i) % DEVICE_CLOCK_WINDOWS];
+    };
+    auto x = [&](const Window& w) { return (double)(int64_t)(w.deviceUs - newest.deviceUs); };
+    auto y = [&](const Window& w) { return (double)(w.offsetUs - newest.offsetUs); };
+
+    double drift = 0;
+    double spanUs = -x(window(0));
+    if (m_windowCount >= 2 && spanUs >= DEVICE_CLOCK_MIN_FIT_SPAN_US) {
+        double meanX = 0, meanY = 0;
+        for (uint32_t i = 0; i < m_windowCount; i++) {
+            meanX += x(window(i));
+            meanY += y(window(i));
+        }
+        meanX /= m_windowCount;
+        meanY /= m_windowCount;
+        double sumXX = 0, sumXY = 0;
+        for (uint32_t i = 0; i < m_windowCount; i++) {
+            double dx = x(window(i)) - meanX;
+            sumXX += dx * dx;
+            sumXY += dx * (y(window(i)) - meanY);
+        }
+        if (sumXX > 0) drift = std::clamp(sumXY / sumXX, -DEVICE_CLOCK_MAX_DRIFT_PPM * 1e-6, DEVICE_CLOCK_MAX_DRIFT_PPM * 1e-6);
+    }
+
+    int64_t offsetUs = INT64_MAX;
+    for (uint32_t i = 0; i < m_windowCount; i++) {
+        offsetUs = std::min(offsetUs, window(i).offsetUs - (int64_t)std::llround(drift * x(window(i))));
+    }
+    m_model = {true, newest.deviceUs, offsetUs, drift};
+}
+
+ClockModel DeviceClock::Model() const {
+    std::scoped_lock lock{m_mtx};
+    return m_model;
+}
+
+DeviceClockStats DeviceClock::Stats() const {
+    DeviceClockStats stats;
+    {
+        std::scoped_lock lock{m_mtx};
+        stats.model = m_model;
+        stats.samples = m_samples;
+        stats.windows = m_windowCount;
+        stats.resyncs = m_resyncs;
+    }
+    stats.hostNowUs = HostNowUs();
+    if (stats.model.valid) stats.deviceNowUs = stats.model.ToDeviceUs(stats.hostNowUs);
+    return stats;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <napi.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// Length of the windows whose smallest offsets the estimate is fitted to, in host microseconds
+#define DEVICE_CLOCK_WINDOW_US 1000000
+#define DEVICE_CLOCK_WINDOWS 32
+// The drift is only fitted once the windows span this long
+#define DEVICE_CLOCK_MIN_FIT_SPAN_US 4000000
+// Fitted drifts are clamped to this. Crystals are good to about 100 ppm.
+#define DEVICE_CLOCK_MAX_DRIFT_PPM 500
+// An offset this far under the estimate, or windows in a row this far over it,
+// mean the device clock jumped (for example because the device restarted) and
+// the estimate starts over. A single late window is more likely frames that
+// sat in a session for a while.
+#define DEVICE_CLOCK_RESYNC_US 10000000
+#define DEVICE_CLOCK_RESYNC_WINDOWS 3
+
+// Maps device time to host time, both in microseconds. Host time is the steady
+// clock, which CaptureLogger and the transaction engine use as well.
+struct ClockModel {
+    bool valid = false;
+    // Device time the offset is given at
+    uint64_t referenceUs = 0;
+    // Host time minus device time at referenceUs
+    int64_t offsetUs = 0;
+    // Host microseconds per device microsecond, minus 1
+    double drift = 0;
+
+    int64_t OffsetAt(uint64_t deviceUs) const;
+    uint64_t ToHostUs(uint64_t deviceUs) const;
+    uint64_t ToDeviceUs(uint64_t hostUs) const;
+};
+
+struct DeviceClockStats {
+    ClockModel model;
+    // Reads that fed the estimate
+    uint64_t samples = 0;
+    // Windows the current estimate was fitted to
+    uint32_t windows = 0;
+    // Times the estimate started over
+    uint32_t resyncs = 0;
+    uint64_t hostNowUs = 0;
+    uint64_t deviceNowUs = 0;
+
+    Napi::Object ToObject(Napi::Env env) const;
+};
+
+// Extends the 32-bit microsecond timestamps a device (or the HAL) stamps its
+// frames with to 64 bits, and keeps estimating the offset and drift of the
+// device clock against the host clock.
+//
+// Every read of the device feeds the timestamp of the newest frame it got to
+// Observe(). Host time minus device time is then the clock offset plus however
+// long the frame took to reach us, so the smallest difference in each window
+// is the closest to the offset. The drift is the slope of a line fitted to the
+// window minima, and the offset puts that line as high as it can go while
+// staying under all of them. A frame that arrives quicker than the estimate
+// allows moves the estimate down right away, so a frame mapped to host time
+// is never later than when it was read.
+//
+// Timestamps are extended to the value closest to the newest one observed, so
+// they are correct for frames up to 35 minutes (half of the 32-bit range)
+// older than that. The first timestamp observed is taken as is, so extended
+// timestamps equal the device's own until its clock first wraps.
+//
+// Any thread may call any method.
+class DeviceClock {
+public:
+    // Records that a frame stamped deviceUs was just read, and returns its extended timestamp
+    uint64_t Observe(uint32_t deviceUs);
+    // Extends the timestamp of a frame that was read before the newest one observed
+    uint64_t Extend(uint32_t deviceUs) const { return ExtendNear(deviceUs, m_newestUs.load(std::memory_order_relaxed)); }
+    ClockModel Model() const;
+    DeviceClockStats Stats() const;
+
+    static uint64_t HostNowUs();
+    // The 64-bit value with the low 32 bits of deviceUs closest to nearUs, never below 0
+    static uint64_t ExtendNear(uint32_t deviceUs, uint64_t nearUs);
+
+private:
+    struct Window {
+        uint64_t deviceUs;
+        int64_t offsetUs;
+    };
+
+    // Only call these while holding m_mtx
+    void Restart(uint64_t deviceUs, int64_t offsetUs, uint64_t hostUs);
+    void CloseWindow(uint64_t hostUs);
+    void Fit();
+
+    std::atomic<uint64_t> m_newestUs{0};
+
+    mutable std::mutex m_mtx;
+    // These values should only be accessed while holding m_mtx
+    ClockModel m_model;
+    // The smallest offset of the window being filled, and when it started
+    Window m_window = {0, INT64_MAX};
+    uint64_t m_windowStartUs = 0;
+    // Minima of the last windows, oldest overwritten first
+    std::array<Window, DEVICE_CLOCK_WINDOWS> m_windows;
+    uint32_t m_windowCount = 0;
+    uint32_t m_nextWindow = 0;
+    // Windows in a row that were too late to fit
+    uint32_t m_lateWindows = 0;
+    uint64_t m_samples = 0;
+    uint32_t m_resyncs = 0;
+};
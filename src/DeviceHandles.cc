@@ -0,0 +1,81 @@
+#include "DeviceHandles.h"
+
+#define DEVICE_HANDLE_INDEX_BITS 8
+#define DEVICE_HANDLE_INDEX_MASK ((1u << DEVICE_HANDLE_INDEX_BITS) - 1)
+
+static_assert(MAX_DEVICE_HANDLES <= DEVICE_HANDLE_INDEX_MASK + 1, "Slot index must fit in the handle");
+
+namespace {
+uint32_t makeHandle(uint32_t index, uint32_t generation) {
+    return (generation << DEVICE_HANDLE_INDEX_BITS) | index;
+}
+}
+
+uint32_t DeviceHandleTable::Open(const std::string& descriptor, std::shared_ptr<rev::usb::CANDevice> device) {
+    std::scoped_lock allocationLock{m_allocationMtx};
+
+    Slot* freeSlot = nullptr;
+    uint32_t freeIndex = 0;
+    for (uint32_t i = 0; i < m_slots.size(); i++) {
+        Slot& slot = m_slots[i];
+        std::scoped_lock lock{slot.mtx};
+        if (slot.refCount > 0 && slot.descriptor == descriptor) {
+            slot.refCount++;
+            slot.device = device;
+            return makeHandle(i, slot.generation);
+        }
+        if (slot.refCount == 0 && freeSlot == nullptr) {
+            freeSlot = &slot;
+            freeIndex = i;
+        }
+    }
+
+    if (freeSlot == nullptr) return 0;
+
+    std::scoped_lock lock{freeSlot->mtx};
+    freeSlot->descriptor = descriptor;
+    freeSlot->device = std::move(device);
+    freeSlot->refCount = 1;
+    return makeHandle(freeIndex, freeSlot->generation);
+}
+
+bool DeviceHandleTable::Close(uint32_t handle) {
+    std::scoped_lock allocationLock{m_allocationMtx};
+
+    uint32_t index = handle & DEVICE_HANDLE_INDEX_MASK;
+    if (index >= m_slots.size()) return false;
+
+    Slot& slot = m_slots[index];
+    std::scoped_lock lock{slot.mtx};
+    if (slot.refCount == 0 || slot.generation != handle >> DEVICE_HANDLE_INDEX_BITS) return false;
+
+    if (--slot.refCount == 0) {
+        slot.device.reset();
+        slot.descriptor.clear();
+        // Generation 0 is skipped so that no valid handle is ever 0
+        slot.generation = (slot.generation + 1) & (UINT32_MAX >> DEVICE_HANDLE_INDEX_BITS);
+        if (slot.generation == 0) slot.generation = 1;
+    }
+    return true;
+}
+
+std::shared_ptr<rev::usb::CANDevice> DeviceHandleTable::Get(uint32_t handle, std::string* descriptor) {
+    uint32_t index = handle & DEVICE_HANDLE_INDEX_MASK;
+    if (index >= m_slots.size()) return nullptr;
+
+    Slot& slot = m_slots[index];
+    std::scoped_lock lock{slot.mtx};
+    if (slot.refCount == 0 || slot.generation != handle >> DEVICE_HANDLE_INDEX_BITS) return nullptr;
+
+    if (descriptor != nullptr) *descriptor = slot.descriptor;
+    return slot.device;
+}
+
+void DeviceHandleTable::Update(const std::string& descriptor, std::shared_ptr<rev::usb::CANDevice> device) {
+    for (Slot& slot : m_slots) {
+        std::scoped_lock lock{slot.mtx};
+        if (slot.refCount > 0 && slot.descriptor == descriptor) {
+            slot.device = device;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <rev/CANDevice.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#define MAX_DEVICE_HANDLES 64
+
+// Small integer handles for devices, handed out by openDevice(). A handle
+// resolves to its slot by index, so looking it up never touches
+// the DeviceRegistry lock, and each slot has its own mutex so traffic
+// to one device never waits on another.
+//
+// A handle encodes the slot index in its low 8 bits and the slot generation
+// above that. Closing the last reference bumps the generation, so a stale
+// handle is rejected instead of resolving to whichever device reuses the slot.
+class DeviceHandleTable {
+public:
+    // Returns a handle for the descriptor, reusing (and referencing) an existing one if
+    // the descriptor is already open. Returns 0 if every slot is in use.
+    uint32_t Open(const std::string& descriptor, std::shared_ptr<rev::usb::CANDevice> device);
+
+    // Drops one reference. Returns false if the handle was not open.
+    bool Close(uint32_t handle);
+
+    // Returns the device behind the handle, or nullptr if the handle is invalid or its device
+    // has been removed. Unless the handle is invalid, descriptor is set to the one it was opened
+    // for, so state kept by descriptor is shared with callers that pass it, and a caller whose
+    // device was removed can fall back to the HAL.
+    std::shared_ptr<rev::usb::CANDevice> Get(uint32_t handle, std::string* descriptor);
+
+    // Called when a device enters or leaves the DeviceRegistry. device is nullptr when it leaves.
+    void Update(const std::string& descriptor, std::shared_ptr<rev::usb::CANDevice> device);
+
+private:
+    struct Slot {
+        std::mutex mtx;
+        // These values should only be accessed while holding mtx
+        std::string descriptor;
+        std::shared_ptr<rev::usb::CANDevice> device;
+        uint32_t generation = 1;
+        uint32_t refCount = 0;
+    };
+
+    // Serializes Open() and Close() so two calls cannot claim the same free slot
+    std::mutex m_allocationMtx;
+    std::array<Slot, MAX_DEVICE_HANDLES> m_slots;
+};
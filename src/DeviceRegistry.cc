@@ -0,0 +1,107 @@
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "DeviceRegistry.h"
+#include "PerfCounters.h"
+
+std::shared_lock<std::shared_mutex> DeviceRegistry::SharedLock() const {
+    PERF_PHASE(kLockWait);
+    return std::shared_lock{m_mtx};
+}
+
+std::unique_lock<std::shared_mutex> DeviceRegistry::ExclusiveLock() {
+    PERF_PHASE(kLockWait);
+    return std::unique_lock{m_mtx};
+}
+
+std::shared_ptr<rev::usb::CANDevice> DeviceRegistry::Find(const std::string& descriptor) const {
+    std::shared_lock lock = SharedLock();
+    auto deviceIterator = m_devices.find(descriptor);
+    if (deviceIterator == m_devices.end()) return nullptr;
+    return deviceIterator->second;
+}
+
+bool DeviceRegistry::Contains(const std::string& descriptor) const {
+    std::shared_lock lock = SharedLock();
+    return m_devices.find(descriptor) != m_devices.end();
+}
+
+std::vector<std::string> DeviceRegistry::Descriptors() const {
+    std::shared_lock lock = SharedLock();
+    std::vector<std::string> descriptors;
+    for (const auto& entry : m_devices) {
+        descriptors.push_back(entry.first);
+    }
+    return descriptors;
+}
+
+void DeviceRegistry::Add(const std::string& descriptor, std::shared_ptr<rev::usb::CANDevice> device) {
+    std::shared_ptr<rev::usb::CANDevice> replaced;
+    {
+        std::unique_lock lock = ExclusiveLock();
+        replaced = std::exchange(m_devices[descriptor], device);
+        m_handles.Update(descriptor, device);
+    }
+}
+
+void DeviceRegistry::Remove(const std::string& descriptor) {
+    std::shared_ptr<rev::usb::CANDevice> removed;
+    {
+        std::unique_lock lock = ExclusiveLock();
+        auto deviceIterator = m_devices.find(descriptor);
+        if (deviceIterator == m_devices.end()) return;
+        removed = std::move(deviceIterator->second);
+        m_devices.erase(deviceIterator);
+        m_handles.Update(descriptor, nullptr);
+    }
+}
+
+void DeviceRegistry::ReplaceScannedDevices(DeviceMap scannedDevices, const std::function<bool(const std::string&)>& keep) {
+    std::vector<std::shared_ptr<rev::usb::CANDevice>> removed;
+    {
+        std::unique_lock lock = ExclusiveLock();
+        for (auto& entry : m_devices) {
+            if (scannedDevices.find(entry.first) != scannedDevices.end()) continue;
+            if (keep(entry.first)) {
+                scannedDevices[entry.first] = entry.second;
+            } else {
+                removed.push_back(entry.second);
+                m_handles.Update(entry.first, nullptr);
+            }
+        }
+        for (auto& entry : scannedDevices) {
+            auto deviceIterator = m_devices.find(entry.first);
+            if (deviceIterator == m_devices.end() || deviceIterator->second != entry.second) {
+                m_handles.Update(entry.first, entry.second);
+            }
+        }
+        m_devices.swap(scannedDevices);
+    }
+    // The removed devices (and the old map) are released here, outside the lock
+}
+
+bool DeviceRegistry::IsRegisteredToHal(const std::string& descriptor) const {
+    std::shared_lock lock = SharedLock();
+    return m_registeredToHal.find(descriptor) != m_registeredToHal.end();
+}
+
+void DeviceRegistry::SetRegisteredToHal(const std::string& descriptor, bool registered) {
+    std::unique_lock lock = ExclusiveLock();
+    if (registered) {
+        m_registeredToHal.insert(descriptor);
+    } else {
+        m_registeredToHal.erase(descriptor);
+    }
+}
+
+uint32_t DeviceRegistry::OpenHandle(const std::string& descriptor) {
+    // A shared lock is enough: it keeps m_devices (and so the handle's device) from changing
+    // while the handle is opened, and DeviceHandleTable serializes concurrent Open() calls itself
+    std::shared_lock lock = SharedLock();
+    auto deviceIterator = m_devices.find(descriptor);
+    if (deviceIterator == m_devices.end()) {
+        if (m_registeredToHal.find(descriptor) == m_registeredToHal.end()) return 0;
+        return m_handles.Open(descriptor, nullptr);
+    }
+    return m_handles.Open(descriptor, deviceIterator->second);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <rev/CANDevice.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "DeviceHandles.h"
+
+// Every device the bindings can talk to, by descriptor, plus the descriptors
+// that have been handed over to the HAL.
+//
+// Lookups take a shared lock just long enough to copy a shared_ptr, so they
+// never wait on each other. Writers take the exclusive lock only to swap
+// entries in and out: scans open their new devices before calling
+// ReplaceScannedDevices(), and removed devices are destroyed after the lock
+// is released, because closing a USB device can take a while.
+class DeviceRegistry {
+public:
+    using DeviceMap = std::map<std::string, std::shared_ptr<rev::usb::CANDevice>>;
+
+    // Returns nullptr if there is no device with this descriptor
+    std::shared_ptr<rev::usb::CANDevice> Find(const std::string& descriptor) const;
+    bool Contains(const std::string& descriptor) const;
+    std::vector<std::string> Descriptors() const;
+
+    void Add(const std::string& descriptor, std::shared_ptr<rev::usb::CANDevice> device);
+    void Remove(const std::string& descriptor);
+
+    // Makes scannedDevices the new set of devices. Devices for which keep() returns
+    // true are left alone even if the scan did not report them.
+    void ReplaceScannedDevices(DeviceMap scannedDevices, const std::function<bool(const std::string&)>& keep);
+
+    bool IsRegisteredToHal(const std::string& descriptor) const;
+    void SetRegisteredToHal(const std::string& descriptor, bool registered);
+
+    // Handles resolve without taking the registry lock, see DeviceHandleTable
+    uint32_t OpenHandle(const std::string& descriptor);
+    bool CloseHandle(uint32_t handle) { return m_handles.Close(handle); }
+    std::shared_ptr<rev::usb::CANDevice> FindByHandle(uint32_t handle, std::string* descriptor) { return m_handles.Get(handle, descriptor); }
+
+private:
+    // Take m_mtx, counting the wait as lock wait of the binding call on this thread
+    std::shared_lock<std::shared_mutex> SharedLock() const;
+    std::unique_lock<std::shared_mutex> ExclusiveLock();
+
+    mutable std::shared_mutex m_mtx;
+    // These values should only be accessed while holding m_mtx
+    DeviceMap m_devices;
+    std::set<std::string> m_registeredToHal;
+
+    // Only updated while holding m_mtx exclusively, so it always mirrors m_devices
+    DeviceHandleTable m_handles;
+};
@@ -32,44 +32,61 @@
 #include <vector>
 #include <string>
 #include <cstring>
-#include <iostream>
 #include <fstream>
 #include <memory>
+#include <span>
+#include "Crc32.h"
+#include "MappedFile.h"
 
 namespace dfuse {
 
-class DFUTarget {
+namespace detail {
+// Reads little-endian fields from a byte range. Every read checks that it stays inside the range,
+// so the ranges handed out afterwards need no further checks.
+class Reader {
 public:
-    uint32_t Address() { return m_prefix.Address; }
-    int Size() { return m_prefix.Size; }
-    const std::vector<uint8_t>& Data() const { return m_elements; }
-private:
-    friend std::istream & operator >> (std::istream &in,  DFUTarget &obj) {
-        in >> obj.m_prefix;
+    explicit Reader(std::span<const uint8_t> bytes) : m_bytes(bytes) {}
+
+    template <typename T>
+    bool Read(T* value) {
+        if (m_bytes.size() - m_offset < sizeof(T)) return false;
+        std::memcpy(value, m_bytes.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
 
-        // We will stream in the elements later, save the stream location
-        obj.m_elements.resize(obj.m_prefix.Size);
-        in.read((char*)obj.m_elements.data(), obj.m_prefix.Size);
+    bool Bytes(size_t count, std::span<const uint8_t>* bytes) {
+        if (m_bytes.size() - m_offset < count) return false;
+        *bytes = m_bytes.subspan(m_offset, count);
+        m_offset += count;
+        return true;
+    }
+
+private:
+    std::span<const uint8_t> m_bytes;
+    size_t m_offset = 0;
+};
+}
 
-        //in.seekg(obj.m_prefix.Size, std::ios_base::cur);
+// Element data points into the mapped file and is valid as long as the DFUFile it came from
+class DFUTarget {
+public:
+    uint32_t Address() const { return m_address; }
+    int Size() const { return (int)m_data.size(); }
+    std::span<const uint8_t> Data() const { return m_data; }
+private:
+    friend class DFUImage;
 
-        return in;
+    bool Parse(detail::Reader& in) {
+        //   <   little endian
+        //   I   uint32_t    element address
+        //   I   uint32_t    element size
+        uint32_t size;
+        return in.Read(&m_address) && in.Read(&size) && in.Bytes(size, &m_data);
     }
-    struct Prefix {
-        uint32_t Address;
-        uint32_t Size;
 
-        friend std::istream & operator >> (std::istream &in,  Prefix &obj) {
-            //   <   little endian
-            //   I   uint32_t    element address
-            //   I   uint32_t    element size
-            in.read((char*)&obj.Address, 4);
-            in.read((char*)&obj.Size, 4);
-            return in;
-        }
-    };
-    Prefix m_prefix;
-    std::vector<uint8_t> m_elements;
+    uint32_t m_address = 0;
+    std::span<const uint8_t> m_data;
 };
 
 namespace writer {
@@ -91,158 +108,160 @@ public:
 };
 }
 
-detail::BinWriter Bin;
+inline detail::BinWriter Bin;
 
 } // namespace writer
 
 class DFUImage {
 public:
-    int Id() { return m_prefix.AltSetting; }
-    const char* Name() { return m_prefix.Name; }
-    int Size() { return m_prefix.Size; }
+    int Id() const { return m_altSetting; }
+    const char* Name() const { return m_name.c_str(); }
+    int Size() const { return (int)m_size; }
     const std::vector<DFUTarget>& Elements() const { return m_targets; }
-    void Write(const std::string filename, const int elementIndex, writer::detail::FileWriter& writer) const {
-        std::ofstream outputFile(filename, std::ofstream::binary);
-        auto fw = writer.Clone();
-
-        if(elementIndex >= m_targets.size()) {
-            throw std::invalid_argument("Element index out of range");
+    // The element is written straight from the mapped file, in one write. Returns false and sets
+    // error if there is no element elementIndex or the output file could not be written.
+    bool Write(const std::string filename, const int elementIndex, writer::detail::FileWriter& writer, std::string* error = nullptr) const {
+        if(elementIndex < 0 || elementIndex >= m_targets.size()) {
+            if (error) *error = "Element index out of range";
+            return false;
         }
 
+        std::ofstream outputFile(filename, std::ofstream::binary);
+        auto fw = writer.Clone();
         fw->Write(outputFile, m_targets[elementIndex]);
         outputFile.close();
+        if (!outputFile) {
+            if (error) *error = "Writing " + filename + " failed";
+            return false;
+        }
+        return true;
     }
 
-    operator bool() const {return m_valid;}
-    bool operator!() const {return !m_valid;}
-
 private:
-    friend std::istream & operator >> (std::istream &in,  DFUImage &obj) {
-        obj.m_valid = false;
-        in >> obj.m_prefix;
-
-        if (!in || std::memcmp(obj.m_prefix.Signature,"Target",6) != 0) {
-            return in;
-        }
+    friend class DFUFile;
 
-        obj.m_targets.resize(obj.m_prefix.Elements);
-
-        for (DFUTarget& target : obj.m_targets) {
-            in >> target;
-            if (!in) {
-                return in;
-            }
+    bool Parse(detail::Reader& in) {
+        //   <   little endian
+        //   6s      char[6]     signature   "Target"
+        //   B       uint8_t     altsetting
+        //   I       uint32_t    named       bool indicating if a name was used
+        //   255s    char[255]   name        name of the target
+        //   I       uint32_t    size        size of image (not incl prefix)
+        //   I       uint32_t    elements    Number of elements in the image
+        char signature[6];
+        uint32_t isNamed;
+        char name[255];
+        uint32_t elements;
+        if (!in.Read(&signature) || std::memcmp(signature, "Target", 6) != 0) return false;
+        if (!in.Read(&m_altSetting) || !in.Read(&isNamed) || !in.Read(&name)) return false;
+        if (!in.Read(&m_size) || !in.Read(&elements)) return false;
+        m_name.assign(name, strnlen(name, sizeof(name)));
+
+        // The elements, prefixes included, must fit inside the image
+        std::span<const uint8_t> imageBytes;
+        if (!in.Bytes(m_size, &imageBytes)) return false;
+        detail::Reader elementReader(imageBytes);
+        // Every element takes at least its 8 byte prefix, so a corrupt count cannot allocate much
+        if (elements > m_size / 8) return false;
+        m_targets.resize(elements);
+        for (DFUTarget& target : m_targets) {
+            if (!target.Parse(elementReader)) return false;
         }
-
-        obj.m_valid = true;
-        return in;
+        return true;
     }
-    struct Prefix {
-        uint8_t Signature[6];
-        uint8_t AltSetting;
-        uint32_t IsNamed;
-        char Name[255];
-        uint32_t Size;
-        uint32_t Elements;
-
-        friend std::istream & operator >> (std::istream &in,  Prefix &obj) {
-            //   <   little endian
-            //   6s      char[6]     signature   "Target"
-            //   B       uint8_t     altsetting
-            //   I       uint32_t    named       bool indicating if a name was used
-            //   255s    char[255]   name        name of the target
-            //   I       uint32_t    size        size of image (not incl prefix)
-            //   I       uint32_t    elements    Number of elements in the image
-            in.read((char*)obj.Signature, 6);
-            in.read((char*)&obj.AltSetting, 1);
-            in.read((char*)&obj.IsNamed, 4);
-
-            // TODO: Is this field always there
-            in.read(obj.Name, 255);
-
-            in.read((char*)&obj.Size, 4);
-            in.read((char*)&obj.Elements, 4);
-            return in;
-        }
-    };
-    Prefix m_prefix;
+
+    uint8_t m_altSetting = 0;
+    std::string m_name;
+    uint32_t m_size = 0;
     std::vector<DFUTarget> m_targets;
-    bool m_valid;
 };
 
+// Maps the file into memory and validates its layout once, up front. Images and their elements
+// then refer to the mapping instead of holding copies, so the file is never copied.
 class DFUFile {
 public:
     DFUFile(const char* filename) {
-        std::ifstream dfuFile(filename, std::ios_base::binary);
-        m_valid = false;
+        m_file = MappedFile::Open(filename, &m_error);
+        if (!m_file) return;
 
-        if (!dfuFile) {
-            // TODO: Throw an error
+        std::span<const uint8_t> bytes(m_file->Data(), m_file->Size());
+        detail::Reader in(bytes);
+        if (!ParsePrefix(in) || std::memcmp(m_prefix.Signature,"DfuSe",5) != 0) {
+            m_error = "Not a DfuSe file";
             return;
         }
-
-        dfuFile >> m_prefix;
-
-        if (!dfuFile || std::memcmp(m_prefix.Signature,"DfuSe",5) != 0) {
-            // TODO: Throw an error
+        if (m_prefix.Size < PREFIX_SIZE || m_prefix.Size > bytes.size() || bytes.size() - m_prefix.Size < SUFFIX_SIZE) {
+            m_error = "DfuSe file is truncated";
             return;
         }
-        m_images.resize(m_prefix.Targets);
 
+        // Images must end before the suffix
+        detail::Reader imageReader(bytes.subspan(PREFIX_SIZE, m_prefix.Size - PREFIX_SIZE));
+        m_images.resize(m_prefix.Targets);
         for (DFUImage& image : m_images) {
-            dfuFile >> image;
-            if (!dfuFile || !image) {
-                // TODO: Throw an error
+            if (!image.Parse(imageReader)) {
+                m_error = "DfuSe image is malformed";
                 return;
             }
         }
 
-        dfuFile >> m_suffix;
+        detail::Reader suffixReader(bytes.subspan(m_prefix.Size, SUFFIX_SIZE));
+        ParseSuffix(suffixReader);
 
-        // TODO: Check CRC
+        // The CRC is only checked by CrcValid(), since that reads every byte of the file
         m_valid = true;
-        dfuFile.close();
     };
 
-    //uint32_t Write(std::string filename) {
-    //    return 0;
-    //}
+    DFUFile(const DFUFile&) = delete;
+    DFUFile& operator=(const DFUFile&) = delete;
 
     operator bool() const {return m_valid;}
     bool operator!() const {return !m_valid;}
+    // Why the file is not valid
+    const std::string& Error() const { return m_error; }
 
-    unsigned int FileFormatVersion() { return m_prefix.Version; }
-    unsigned int Vendor() { return m_suffix.Vendor; }
-    unsigned int Product() { return m_suffix.Product; }
-    unsigned int DeviceVersion() { return m_suffix.DeviceVersion; }
+    unsigned int FileFormatVersion() const { return m_prefix.Version; }
+    unsigned int Vendor() const { return m_suffix.Vendor; }
+    unsigned int Product() const { return m_suffix.Product; }
+    unsigned int DeviceVersion() const { return m_suffix.DeviceVersion; }
     const std::vector<DFUImage>& Images() const { return m_images; }
-    uint32_t Crc() { return m_suffix.Crc32; }
+    uint32_t Crc() const { return m_suffix.Crc32; }
+    // CRC of everything before the CRC field, computed the way the suffix stores it
+    uint32_t ComputeCrc() const {
+        if (!m_valid) return 0;
+        return crc32Update(0xFFFFFFFF, m_file->Data(), m_prefix.Size + SUFFIX_SIZE - sizeof(m_suffix.Crc32));
+    }
+    bool CrcValid() const { return m_valid && ComputeCrc() == m_suffix.Crc32; }
+    // The whole file, suffix included
+    std::span<const uint8_t> Bytes() const {
+        return m_file ? std::span<const uint8_t>(m_file->Data(), m_file->Size()) : std::span<const uint8_t>();
+    }
 
 private:
-    DFUFile() {};
-    bool m_valid;
+    static constexpr uint32_t PREFIX_SIZE = 11;
+    static constexpr uint32_t SUFFIX_SIZE = 16;
+
+    std::unique_ptr<MappedFile> m_file;
+    bool m_valid = false;
+    std::string m_error;
 
     struct Prefix {
         uint8_t Signature[5];
         uint8_t Version;
         uint32_t Size;
         uint8_t Targets;
-
-        //   <   little endian
-        //   5s  char[5]     signature   "DfuSe"
-        //   B   uint8_t     version     1
-        //   I   uint32_t    size        Size of the DFU file (not including suffix)
-        //   B   uint8_t     targets     Number of targets
-        friend std::istream & operator >> (std::istream &in,  Prefix &obj) {
-            in.read((char*)obj.Signature, 5);
-            in.read((char*)&obj.Version,1);
-            in.read((char*)&obj.Size,4);
-            in.read((char*)&obj.Targets,1);
-            return in;
-        }
     };
 
-    Prefix m_prefix;
+    //   <   little endian
+    //   5s  char[5]     signature   "DfuSe"
+    //   B   uint8_t     version     1
+    //   I   uint32_t    size        Size of the DFU file (not including suffix)
+    //   B   uint8_t     targets     Number of targets
+    bool ParsePrefix(detail::Reader& in) {
+        return in.Read(&m_prefix.Signature) && in.Read(&m_prefix.Version) && in.Read(&m_prefix.Size) && in.Read(&m_prefix.Targets);
+    }
+
+    Prefix m_prefix = {};
 
     std::vector<DFUImage> m_images;
 
@@ -254,27 +273,22 @@ private:
         uint8_t Ufd[3];
         uint8_t Length;
         uint32_t Crc32;
-
-        //   <   little endian
-        //   H   uint16_t    device  Firmware version
-        //   H   uint16_t    product
-        //   H   uint16_t    vendor
-        //   H   uint16_t    dfu     0x11a   (DFU file format version)
-        //   3s  char[3]     ufd     'UFD'
-        //   B   uint8_t     len     16
-        //   I   uint32_t    crc32
-        friend std::istream & operator >> (std::istream &in,  Suffix &obj) {
-            in.read((char*)&obj.DeviceVersion, 2);
-            in.read((char*)&obj.Product, 2);
-            in.read((char*)&obj.Vendor, 2);
-            in.read((char*)&obj.DfuFormat, 2);
-            in.read((char*)obj.Ufd, 3);
-            in.read((char*)&obj.Length, 1);
-            in.read((char*)&obj.Crc32, 4);
-            return in;
-        }
     };
-    Suffix m_suffix;
+
+    //   <   little endian
+    //   H   uint16_t    device  Firmware version
+    //   H   uint16_t    product
+    //   H   uint16_t    vendor
+    //   H   uint16_t    dfu     0x11a   (DFU file format version)
+    //   3s  char[3]     ufd     'UFD'
+    //   B   uint8_t     len     16
+    //   I   uint32_t    crc32
+    bool ParseSuffix(detail::Reader& in) {
+        return in.Read(&m_suffix.DeviceVersion) && in.Read(&m_suffix.Product) && in.Read(&m_suffix.Vendor) &&
+               in.Read(&m_suffix.DfuFormat) && in.Read(&m_suffix.Ufd) && in.Read(&m_suffix.Length) && in.Read(&m_suffix.Crc32);
+    }
+
+    Suffix m_suffix = {};
 };
 
 } // namespace dfusefile
@@ -0,0 +1,81 @@
+#include <bit>
+#include <map>
+#include <set>
+#include "FrameFilter.h"
+
+#define FRAME_FILTER_EMPTY_SLOT UINT64_MAX
+
+namespace {
+uint64_t slotFor(uint32_t maskedId, uint32_t shift) {
+    return (maskedId * 0x9E3779B97F4A7C15ull) >> shift;
+}
+}
+
+FrameFilter::FrameFilter(const std::vector<Filter>& filters) {
+    m_cover.messageId = 0;
+    m_cover.messageMask = 0;
+    if (filters.empty()) return;
+
+    uint32_t coverMask = UINT32_MAX;
+    std::map<uint32_t, std::set<uint32_t>> idsByMask;
+    for (const Filter& filter : filters) {
+        uint32_t maskedId = filter.first & filter.second;
+        coverMask &= filter.second & ~(maskedId ^ (filters[0].first & filters[0].second));
+        if (filter.second == 0) m_matchesAll = true;
+        idsByMask[filter.second].insert(maskedId);
+    }
+    m_cover.messageId = filters[0].first & coverMask;
+    m_cover.messageMask = coverMask;
+
+    for (uint32_t messageId = 0; messageId < FRAME_FILTER_STANDARD_ID_COUNT; messageId++) {
+        for (const auto& entry : idsByMask) {
+            if (entry.second.count(messageId & entry.first)) {
+                m_standardIds[messageId >> 6] |= 1ull << (messageId & 63);
+                break;
+            }
+        }
+    }
+
+    for (const auto& entry : idsByMask) {
+        size_t capacity = std::max<size_t>(std::bit_ceil(entry.second.size() * 2), 4);
+        MaskGroup group;
+        group.mask = entry.first;
+        group.shift = 64 - std::countr_zero(capacity);
+        group.slots.assign(capacity, FRAME_FILTER_EMPTY_SLOT);
+        for (uint32_t maskedId : entry.second) {
+            uint64_t slot = slotFor(maskedId, group.shift);
+            while (group.slots[slot] != FRAME_FILTER_EMPTY_SLOT) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            group.slots[slot] = maskedId;
+        }
+        m_groups.push_back(std::move(group));
+    }
+    // Try the groups most likely to match first
+    std::stable_sort(m_groups.begin(), m_groups.end(), [](const MaskGroup& a, const MaskGroup& b) {
+        return a.slots.size() > b.slots.size();
+    });
+}
+
+bool FrameFilter::MatchesExtended(uint32_t messageId) const {
+    if (m_matchesAll) return true;
+    for (const MaskGroup& group : m_groups) {
+        const uint32_t maskedId = messageId & group.mask;
+        const uint64_t capacityMask = group.slots.size() - 1;
+        for (uint64_t slot = slotFor(maskedId, group.shift);; slot = (slot + 1) & capacityMask) {
+            if (group.slots[slot] == maskedId) return true;
+            if (group.slots[slot] == FRAME_FILTER_EMPTY_SLOT) break;
+        }
+    }
+    return false;
+}
+
+uint32_t FrameFilter::Apply(HAL_CANStreamMessage* messages, uint32_t count) const {
+    uint32_t matched = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!Matches(messages[i].messageID)) continue;
+        if (matched != i) messages[matched] = messages[i];
+        matched++;
+    }
+    return matched;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <rev/CANBridgeUtils.h>
+#include <hal/CAN.h>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// IDs below this fit in 11 bits and are matched with a direct bitmap
+#define FRAME_FILTER_STANDARD_ID_COUNT 2048
+
+// A compiled set of id/mask filters. A frame matches if it matches any of them.
+//
+// Standard (11-bit) IDs are looked up in a bitmap built by evaluating every
+// filter against every standard ID. Other IDs are matched per distinct mask:
+// the filters sharing a mask are stored as an open-addressed set of their
+// masked IDs, so a frame costs one hash probe per distinct mask rather than
+// one comparison per filter. Filter lists keyed by device number share a
+// handful of masks however many devices they name.
+//
+// Immutable once built, so it can be shared between threads.
+class FrameFilter {
+public:
+    using Filter = std::pair<uint32_t, uint32_t>;
+
+    // filters are (messageId, messageMask) pairs
+    explicit FrameFilter(const std::vector<Filter>& filters);
+
+    bool Matches(uint32_t messageId) const {
+        if (messageId < FRAME_FILTER_STANDARD_ID_COUNT) {
+            return (m_standardIds[messageId >> 6] >> (messageId & 63)) & 1;
+        }
+        return MatchesExtended(messageId);
+    }
+
+    // Moves the matching messages to the front, keeping their order. Returns how many matched.
+    uint32_t Apply(HAL_CANStreamMessage* messages, uint32_t count) const;
+
+    // Calls read until messages is full or a read comes back short, keeping only the matching
+    // frames, so that a burst of filtered-out frames does not look like an empty session.
+    // read takes (messages, maxMessages, messagesRead) and returns false on failure.
+    template <typename ReadFunction>
+    bool ReadMatching(ReadFunction&& read, HAL_CANStreamMessage* messages, uint32_t maxMessages, uint32_t* messagesRead) const {
+        *messagesRead = 0;
+        while (*messagesRead < maxMessages) {
+            uint32_t requested = maxMessages - *messagesRead;
+            uint32_t count = 0;
+            if (!read(messages + *messagesRead, requested, &count)) return false;
+            count = std::min(count, requested);
+            *messagesRead += Apply(messages + *messagesRead, count);
+            if (count < requested) break;
+        }
+        return true;
+    }
+
+    // The narrowest single filter that passes every frame this one does, for
+    // opening the underlying stream session
+    rev::usb::CANBridge_CANFilter Cover() const { return m_cover; }
+
+private:
+    struct MaskGroup {
+        uint32_t mask;
+        uint32_t shift;
+        // Masked IDs, or FRAME_FILTER_EMPTY_SLOT
+        std::vector<uint64_t> slots;
+    };
+
+    bool MatchesExtended(uint32_t messageId) const;
+
+    uint64_t m_standardIds[FRAME_FILTER_STANDARD_ID_COUNT / 64] = {};
+    std::vector<MaskGroup> m_groups;
+    bool m_matchesAll = false;
+    rev::usb::CANBridge_CANFilter m_cover;
+};
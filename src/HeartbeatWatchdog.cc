@@ -0,0 +1,109 @@
+#include <algorithm>
+#include "HeartbeatWatchdog.h"
+#include "Tracer.h"
+
+Napi::Object HeartbeatWatchdogStats::ToObject(Napi::Env env) const {
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("acks", Napi::Number::New(env, acks));
+    stats.Set("timeouts", Napi::Number::New(env, timeouts));
+    stats.Set("recoveries", Napi::Number::New(env, recoveries));
+    stats.Set("lastAckIntervalUs", Napi::Number::New(env, lastAckIntervalUs));
+    stats.Set("maxAckIntervalUs", Napi::Number::New(env, maxAckIntervalUs));
+    stats.Set("meanAckIntervalUs", Napi::Number::New(env, meanAckIntervalUs));
+    stats.Set("maxTimeoutLatencyUs", Napi::Number::New(env, maxTimeoutLatencyUs));
+    return stats;
+}
+
+void HeartbeatWatchdog::Start() {
+    std::scoped_lock lock{m_mtx};
+    m_lastAck = Clock::now();
+    m_ackedSinceExpiry = true;
+    if (m_running) {
+        if (m_expired) m_cv.notify_one();
+        return;
+    }
+    m_running = true;
+    m_expired = true;
+    m_thread = std::thread(&HeartbeatWatchdog::Run, this);
+}
+
+void HeartbeatWatchdog::Stop() {
+    {
+        std::scoped_lock lock{m_mtx};
+        m_running = false;
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool HeartbeatWatchdog::IsRunning() {
+    std::scoped_lock lock{m_mtx};
+    return m_running;
+}
+
+void HeartbeatWatchdog::Ack() {
+    auto now = Clock::now();
+    std::scoped_lock lock{m_mtx};
+    RecordAck(now);
+    m_lastAck = now;
+    if (m_expired && !m_ackedSinceExpiry) {
+        m_ackedSinceExpiry = true;
+        m_cv.notify_one();
+    }
+}
+
+void HeartbeatWatchdog::RecordAck(Clock::time_point now) {
+    if (m_stats.acks > 0) {
+        uint64_t intervalUs = std::chrono::duration_cast<std::chrono::microseconds>(now - m_lastAck).count();
+        m_stats.lastAckIntervalUs = intervalUs;
+        if (intervalUs > m_stats.maxAckIntervalUs) m_stats.maxAckIntervalUs = intervalUs;
+        m_stats.meanAckIntervalUs += (intervalUs - m_stats.meanAckIntervalUs) / m_stats.acks;
+    }
+    m_stats.acks++;
+}
+
+void HeartbeatWatchdog::SetTimeout(std::chrono::microseconds timeout) {
+    {
+        std::scoped_lock lock{m_mtx};
+        m_timeout = timeout;
+        m_timeoutSetAt = Clock::now();
+    }
+    // The deadline the thread is sleeping until may have moved closer
+    m_cv.notify_one();
+}
+
+HeartbeatWatchdogStats HeartbeatWatchdog::GetStats() {
+    std::scoped_lock lock{m_mtx};
+    return m_stats;
+}
+
+void HeartbeatWatchdog::Run() {
+    Tracer::SetThreadName("Heartbeat watchdog");
+    std::unique_lock lock{m_mtx};
+    while (m_running) {
+        if (m_expired) {
+            m_cv.wait(lock, [this] { return !m_running || m_ackedSinceExpiry; });
+            if (!m_running) break;
+            m_expired = false;
+            m_stats.recoveries++;
+        } else {
+            auto deadline = m_lastAck + m_timeout;
+            auto now = Clock::now();
+            if (now < deadline) {
+                m_cv.wait_until(lock, deadline);
+                continue;
+            }
+            uint64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(now - std::max(deadline, m_timeoutSetAt)).count();
+            if (latencyUs > m_stats.maxTimeoutLatencyUs) m_stats.maxTimeoutLatencyUs = latencyUs;
+            TRACE_INSTANT_ARG("heartbeat timeout", latencyUs);
+            m_expired = true;
+            m_ackedSinceExpiry = false;
+            m_stats.timeouts++;
+        }
+
+        bool expired = m_expired;
+        lock.unlock();
+        m_onTransition(expired);
+        lock.lock();
+    }
+}
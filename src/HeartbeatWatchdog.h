@@ -0,0 +1,76 @@
+#pragma once
+
+#include <napi.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct HeartbeatWatchdogStats {
+    uint64_t acks = 0;
+    // Times the timeout expired, and times an ack ended an expiry
+    uint64_t timeouts = 0;
+    uint64_t recoveries = 0;
+    // Time between consecutive acks, in microseconds
+    uint64_t lastAckIntervalUs = 0;
+    uint64_t maxAckIntervalUs = 0;
+    double meanAckIntervalUs = 0;
+    // How long after the deadline the watchdog thread noticed an expiry, in microseconds
+    uint64_t maxTimeoutLatencyUs = 0;
+
+    Napi::Object ToObject(Napi::Env env) const;
+};
+
+// Calls onTransition(true) on its own thread as soon as no Ack() has come for
+// the timeout, and onTransition(false) as soon as the next Ack() comes in.
+//
+// The thread sleeps on a condition variable until the deadline of the latest
+// ack, so it reacts to an expiry as soon as the scheduler wakes it rather
+// than on the next tick of a polling loop. Acks before the deadline only move
+// the deadline and never wake the thread; the thread picks up the new one
+// when it wakes at the old one.
+//
+// A watchdog starts out expired, so the first transition after Start() is a
+// recovery. onTransition runs without the watchdog's lock held, so it may call
+// Ack() or SetTimeout(), but not Stop(), which joins the thread.
+class HeartbeatWatchdog {
+public:
+    using TransitionFunction = std::function<void(bool expired)>;
+    using Clock = std::chrono::steady_clock;
+
+    HeartbeatWatchdog(std::chrono::microseconds timeout, TransitionFunction onTransition)
+        : m_onTransition(std::move(onTransition)), m_timeout(timeout) {}
+    ~HeartbeatWatchdog() { Stop(); }
+
+    // Counts as an ack. Starts the thread if it is not running.
+    void Start();
+    void Stop();
+    bool IsRunning();
+
+    void Ack();
+    void SetTimeout(std::chrono::microseconds timeout);
+    HeartbeatWatchdogStats GetStats();
+
+private:
+    void Run();
+    // Should only be called while holding m_mtx
+    void RecordAck(Clock::time_point now);
+
+    TransitionFunction m_onTransition;
+    std::thread m_thread;
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    // These values should only be accessed while holding m_mtx
+    bool m_running = false;
+    bool m_expired = true;
+    // Whether an ack came in since the timeout expired
+    bool m_ackedSinceExpiry = false;
+    std::chrono::microseconds m_timeout;
+    // A shorter timeout can put the deadline in the past, which is not counted as latency
+    Clock::time_point m_timeoutSetAt;
+    Clock::time_point m_lastAck;
+    HeartbeatWatchdogStats m_stats;
+};
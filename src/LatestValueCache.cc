@@ -0,0 +1,63 @@
+#include <cstring>
+#include "LatestValueCache.h"
+
+static_assert((LATEST_VALUE_CACHE_CAPACITY & (LATEST_VALUE_CACHE_CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+LatestValueCache::LatestValueCache() {}
+
+LatestValueCache::Slot* LatestValueCache::FindOrClaim(uint32_t messageId) {
+    uint32_t index = (messageId * 0x9E3779B1u) & (LATEST_VALUE_CACHE_CAPACITY - 1);
+    for (uint32_t probes = 0; probes < LATEST_VALUE_CACHE_CAPACITY; probes++) {
+        Slot& slot = m_slots[index];
+        uint32_t key = slot.key.load(std::memory_order_relaxed);
+        // Only the writer thread claims slots, so an empty slot cannot be taken from under us
+        if (key == messageId || key == EMPTY_KEY) return &slot;
+        index = (index + 1) & (LATEST_VALUE_CACHE_CAPACITY - 1);
+    }
+    return nullptr;
+}
+
+void LatestValueCache::Update(uint32_t messageId, uint64_t timeStamp, const uint8_t* data, uint8_t dataSize) {
+    Slot* slot = FindOrClaim(messageId);
+    if (slot == nullptr) {
+        m_overflows.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (dataSize > 8) dataSize = 8;
+    uint64_t packedData = 0;
+    std::memcpy(&packedData, data, dataSize);
+    uint64_t updateSequence = m_sequence.load(std::memory_order_relaxed) + 1;
+
+    uint32_t seq = slot->seq.load(std::memory_order_relaxed);
+    slot->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->updateSequence.store(updateSequence, std::memory_order_relaxed);
+    slot->timeStamp.store(timeStamp, std::memory_order_relaxed);
+    slot->data.store(packedData, std::memory_order_relaxed);
+    slot->dataSize.store(dataSize, std::memory_order_relaxed);
+    slot->seq.store(seq + 2, std::memory_order_release);
+
+    // Published after the slot holds a complete frame, so readers never see a claimed but unwritten slot
+    if (slot->key.load(std::memory_order_relaxed) == EMPTY_KEY) {
+        slot->key.store(messageId, std::memory_order_release);
+    }
+    m_sequence.store(updateSequence, std::memory_order_release);
+}
+
+void LatestValueCache::Read(const Slot& slot, Entry* entry) {
+    uint32_t before;
+    uint32_t after;
+    uint64_t packedData;
+    do {
+        before = slot.seq.load(std::memory_order_acquire);
+        entry->messageId = slot.key.load(std::memory_order_relaxed);
+        entry->updateSequence = slot.updateSequence.load(std::memory_order_relaxed);
+        entry->timeStamp = slot.timeStamp.load(std::memory_order_relaxed);
+        packedData = slot.data.load(std::memory_order_relaxed);
+        entry->dataSize = slot.dataSize.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.seq.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    std::memcpy(entry->data, &packedData, sizeof(entry->data));
+}
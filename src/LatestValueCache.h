@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Must be a power of two. A few hundred IDs are live on a busy bus.
+#define LATEST_VALUE_CACHE_CAPACITY 2048
+
+// The most recent frame for every arbitration ID, written by a single thread
+// and readable from any thread without locks.
+//
+// The table is open-addressed with linear probing and never shrinks, so once
+// an ID has a slot it keeps it. Each slot is a seqlock: the writer makes the
+// slot's sequence odd while it writes, and readers retry until they see the
+// same even sequence before and after copying the slot. Every write also takes
+// a value from a cache-wide update counter, which lets readers ask for only the
+// IDs that changed since a previous read.
+class LatestValueCache {
+public:
+    struct Entry {
+        uint32_t messageId;
+        uint8_t dataSize;
+        uint8_t data[8];
+        uint64_t timeStamp;
+        // Value of the update counter when this entry was written
+        uint64_t updateSequence;
+    };
+
+    LatestValueCache();
+
+    // Only call from the writer thread. Frames for new IDs are dropped once the table is full.
+    void Update(uint32_t messageId, uint64_t timeStamp, const uint8_t* data, uint8_t dataSize);
+
+    // Calls fn(const Entry&) for every ID written after sinceSequence and returns the update counter
+    // as it was before the scan. An entry written during the scan may be reported again by the next
+    // call that passes the returned value.
+    template <typename Fn>
+    uint64_t ForEachUpdatedSince(uint64_t sinceSequence, Fn fn) const {
+        uint64_t sequence = m_sequence.load(std::memory_order_acquire);
+        Entry entry;
+        for (const Slot& slot : m_slots) {
+            if (slot.key.load(std::memory_order_acquire) == EMPTY_KEY) continue;
+            Read(slot, &entry);
+            if (entry.updateSequence > sinceSequence) fn(entry);
+        }
+        return sequence;
+    }
+
+    uint64_t Sequence() const { return m_sequence.load(std::memory_order_acquire); }
+    // Frames dropped because their ID did not fit in the table
+    uint64_t Overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t EMPTY_KEY = UINT32_MAX;
+
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> key{EMPTY_KEY};
+        std::atomic<uint32_t> seq{0};
+        std::atomic<uint64_t> updateSequence{0};
+        std::atomic<uint64_t> timeStamp{0};
+        std::atomic<uint64_t> data{0};
+        std::atomic<uint8_t> dataSize{0};
+    };
+
+    Slot* FindOrClaim(uint32_t messageId);
+    static void Read(const Slot& slot, Entry* entry);
+
+    Slot m_slots[LATEST_VALUE_CACHE_CAPACITY];
+    std::atomic<uint64_t> m_sequence{0};
+    std::atomic<uint64_t> m_overflows{0};
+};
@@ -0,0 +1,133 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#ifdef _WIN32
+namespace {
+std::string lastErrorMessage(const std::string& what) {
+    return what + " failed with error code " + std::to_string(GetLastError());
+}
+}
+#endif
+
+std::unique_ptr<MappedFile> MappedFile::Create(const std::string& path, size_t size, std::string* error) {
+    std::unique_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+    file->m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file->m_file == INVALID_HANDLE_VALUE) {
+        file->m_file = nullptr;
+        *error = lastErrorMessage("Creating " + path);
+        return nullptr;
+    }
+    LARGE_INTEGER mappingSize;
+    mappingSize.QuadPart = size;
+    file->m_mapping = CreateFileMappingA(file->m_file, nullptr, PAGE_READWRITE, mappingSize.HighPart, mappingSize.LowPart, nullptr);
+    if (file->m_mapping == nullptr) {
+        *error = lastErrorMessage("Mapping " + path);
+        return nullptr;
+    }
+    file->m_data = (uint8_t*)MapViewOfFile(file->m_mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (file->m_data == nullptr) {
+        *error = lastErrorMessage("Mapping " + path);
+        return nullptr;
+    }
+#else
+    file->m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file->m_fd < 0) {
+        *error = "Creating " + path + " failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    if (ftruncate(file->m_fd, size) != 0) {
+        *error = "Resizing " + path + " failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file->m_fd, 0);
+    if (data == MAP_FAILED) {
+        *error = "Mapping " + path + " failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    file->m_data = (uint8_t*)data;
+#endif
+    file->m_size = size;
+    return file;
+}
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path, std::string* error) {
+    std::unique_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+    file->m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file->m_file == INVALID_HANDLE_VALUE) {
+        file->m_file = nullptr;
+        *error = lastErrorMessage("Opening " + path);
+        return nullptr;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file->m_file, &fileSize)) {
+        *error = lastErrorMessage("Reading the size of " + path);
+        return nullptr;
+    }
+    file->m_size = fileSize.QuadPart;
+    if (file->m_size == 0) return file;
+    file->m_mapping = CreateFileMappingA(file->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (file->m_mapping == nullptr) {
+        *error = lastErrorMessage("Mapping " + path);
+        return nullptr;
+    }
+    file->m_data = (uint8_t*)MapViewOfFile(file->m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (file->m_data == nullptr) {
+        *error = lastErrorMessage("Mapping " + path);
+        return nullptr;
+    }
+#else
+    file->m_fd = open(path.c_str(), O_RDONLY);
+    if (file->m_fd < 0) {
+        *error = "Opening " + path + " failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    struct stat fileStat;
+    if (fstat(file->m_fd, &fileStat) != 0) {
+        *error = "Reading the size of " + path + " failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    file->m_size = fileStat.st_size;
+    // mmap() rejects empty mappings, and there is nothing to read anyway
+    if (file->m_size == 0) return file;
+    void* data = mmap(nullptr, file->m_size, PROT_READ, MAP_SHARED, file->m_fd, 0);
+    if (data == MAP_FAILED) {
+        *error = "Mapping " + path + " failed: " + std::strerror(errno);
+        return nullptr;
+    }
+    file->m_data = (uint8_t*)data;
+#endif
+    return file;
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) CloseHandle(m_mapping);
+    if (m_file != nullptr) CloseHandle(m_file);
+#else
+    if (m_data != nullptr) munmap(m_data, m_size);
+    if (m_fd >= 0) close(m_fd);
+#endif
+}
+
+void MappedFile::Flush() {
+    if (m_data == nullptr) return;
+#ifdef _WIN32
+    FlushViewOfFile(m_data, 0);
+    FlushFileBuffers(m_file);
+#else
+    msync(m_data, m_size, MS_SYNC);
+#endif
+}
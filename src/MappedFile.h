@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A file mapped into memory, on POSIX and Windows alike.
+class MappedFile {
+public:
+    // Creates (or truncates) the file, sizes it to size bytes and maps it read-write.
+    // Returns nullptr and sets error on failure.
+    static std::unique_ptr<MappedFile> Create(const std::string& path, size_t size, std::string* error);
+    // Maps an existing file read-only. Returns nullptr and sets error on failure.
+    static std::unique_ptr<MappedFile> Open(const std::string& path, std::string* error);
+
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    uint8_t* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    // Writes modified pages back to the file
+    void Flush();
+
+private:
+    MappedFile() = default;
+
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
@@ -0,0 +1,216 @@
+#include <hal/HAL.h>
+#include "NotifierScheduler.h"
+
+Napi::Object NotifierStats::ToObject(Napi::Env env) const {
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("alarms", Napi::Number::New(env, alarms));
+    stats.Set("overruns", Napi::Number::New(env, overruns));
+    stats.Set("lateWakes", Napi::Number::New(env, lateWakes));
+    stats.Set("maxLatenessUs", Napi::Number::New(env, maxLatenessUs));
+    stats.Set("meanLatenessUs", Napi::Number::New(env, meanLatenessUs));
+    return stats;
+}
+
+NotifierScheduler* NotifierScheduler::Start(Napi::Env env, std::function<void()> onFinalize, int32_t* status) {
+    *status = 0;
+    HAL_NotifierHandle halNotifier = HAL_InitializeNotifier(status);
+    if (*status != 0) return nullptr;
+    HAL_SetNotifierName(halNotifier, "node-can-bridge notifiers", status);
+    *status = 0; // The name is only cosmetic
+
+    NotifierScheduler* scheduler = new NotifierScheduler(halNotifier);
+
+    // Unbounded queue: every batch resolves promises, so none may be dropped. Each alarm fires
+    // once per update, so the queue cannot grow faster than JS sets alarms.
+    scheduler->m_onFired = Napi::ThreadSafeFunction::New(env, Napi::Function(), "CANBridgeNotifiers", 0, 1,
+        [scheduler, onFinalize](Napi::Env) {
+            onFinalize();
+            scheduler->Shutdown();
+            delete scheduler;
+        });
+    // Only pending waits keep the process alive, see Wait() and ResolveWait()
+    scheduler->m_onFired.Unref(env);
+    scheduler->m_thread = std::thread(&NotifierScheduler::Run, scheduler);
+    return scheduler;
+}
+
+uint32_t NotifierScheduler::Create() {
+    std::scoped_lock lock{m_mtx};
+    uint32_t handle = m_nextHandle++;
+    m_notifiers[handle];
+    return handle;
+}
+
+// Only call when holding m_mtx
+void NotifierScheduler::ArmHalAlarm() {
+    uint64_t earliest = 0;
+    for (auto& entry : m_notifiers) {
+        uint64_t triggerTime = entry.second.triggerTime;
+        if (triggerTime != 0 && (earliest == 0 || triggerTime < earliest)) earliest = triggerTime;
+    }
+    if (earliest == m_armedTime) return;
+
+    int32_t status = 0;
+    if (earliest == 0) {
+        HAL_CancelNotifierAlarm(m_halNotifier, &status);
+    } else {
+        HAL_UpdateNotifierAlarm(m_halNotifier, earliest, &status);
+    }
+    m_armedTime = earliest;
+}
+
+bool NotifierScheduler::UpdateAlarm(uint32_t handle, uint64_t triggerTime) {
+    std::scoped_lock lock{m_mtx};
+    auto notifierIterator = m_notifiers.find(handle);
+    if (notifierIterator == m_notifiers.end()) return false;
+    if (notifierIterator->second.stopped) return true;
+
+    // A trigger time of 0 would read as "no alarm"
+    notifierIterator->second.triggerTime = triggerTime > 0 ? triggerTime : 1;
+    ArmHalAlarm();
+    return true;
+}
+
+bool NotifierScheduler::CancelAlarm(uint32_t handle) {
+    std::scoped_lock lock{m_mtx};
+    auto notifierIterator = m_notifiers.find(handle);
+    if (notifierIterator == m_notifiers.end()) return false;
+
+    notifierIterator->second.triggerTime = 0;
+    ArmHalAlarm();
+    return true;
+}
+
+Napi::Promise NotifierScheduler::Wait(Napi::Env env, uint32_t handle) {
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    {
+        std::scoped_lock lock{m_mtx};
+        auto notifierIterator = m_notifiers.find(handle);
+        if (notifierIterator == m_notifiers.end()) {
+            deferred.Reject(Napi::Error::New(env, "Notifier handle not found").Value());
+            return deferred.Promise();
+        }
+
+        Notifier& notifier = notifierIterator->second;
+        if (notifier.waiting) {
+            deferred.Reject(Napi::Error::New(env, "Notifier is already being waited on").Value());
+            return deferred.Promise();
+        }
+        if (notifier.stopped || notifier.firedTime != 0) {
+            deferred.Resolve(Napi::Number::New(env, notifier.stopped ? 0 : notifier.firedTime));
+            notifier.firedTime = 0;
+            return deferred.Promise();
+        }
+        notifier.waiting = true;
+    }
+
+    if (m_pendingWaits.empty()) m_onFired.Ref(env);
+    m_pendingWaits.emplace(handle, deferred);
+    return deferred.Promise();
+}
+
+// Only call from the JS thread
+void NotifierScheduler::ResolveWait(Napi::Env env, uint32_t handle, uint64_t time) {
+    auto waitIterator = m_pendingWaits.find(handle);
+    if (waitIterator == m_pendingWaits.end()) return;
+
+    waitIterator->second.Resolve(Napi::Number::New(env, time));
+    m_pendingWaits.erase(waitIterator);
+    if (m_pendingWaits.empty()) m_onFired.Unref(env);
+}
+
+bool NotifierScheduler::Stop(uint32_t handle) {
+    bool wasWaiting;
+    {
+        std::scoped_lock lock{m_mtx};
+        auto notifierIterator = m_notifiers.find(handle);
+        if (notifierIterator == m_notifiers.end()) return false;
+
+        Notifier& notifier = notifierIterator->second;
+        notifier.stopped = true;
+        notifier.triggerTime = 0;
+        wasWaiting = std::exchange(notifier.waiting, false);
+        ArmHalAlarm();
+    }
+    // If the wait was no longer pending, the timing thread already queued its resolution
+    if (wasWaiting) {
+        auto waitIterator = m_pendingWaits.find(handle);
+        if (waitIterator != m_pendingWaits.end()) ResolveWait(waitIterator->second.Env(), handle, 0);
+    }
+    return true;
+}
+
+bool NotifierScheduler::Clean(uint32_t handle) {
+    if (!Stop(handle)) return false;
+    std::scoped_lock lock{m_mtx};
+    m_notifiers.erase(handle);
+    return true;
+}
+
+bool NotifierScheduler::GetStats(uint32_t handle, NotifierStats* stats) {
+    std::scoped_lock lock{m_mtx};
+    auto notifierIterator = m_notifiers.find(handle);
+    if (notifierIterator == m_notifiers.end()) return false;
+    *stats = notifierIterator->second.stats;
+    return true;
+}
+
+void NotifierScheduler::Run() {
+    int32_t status = 0;
+    while (true) {
+        uint64_t now = HAL_WaitForNotifierAlarm(m_halNotifier, &status);
+        // The HAL returns 0 once the notifier has been stopped
+        if (now == 0 || status != 0) break;
+
+        auto* fired = new FiredAlarms();
+        {
+            std::scoped_lock lock{m_mtx};
+            m_armedTime = 0;
+            for (auto& entry : m_notifiers) {
+                Notifier& notifier = entry.second;
+                if (notifier.triggerTime == 0 || notifier.triggerTime > now) continue;
+
+                uint64_t latenessUs = now - notifier.triggerTime;
+                NotifierStats& stats = notifier.stats;
+                stats.alarms++;
+                if (latenessUs > NOTIFIER_LATE_WAKE_THRESHOLD_US) stats.lateWakes++;
+                if (latenessUs > stats.maxLatenessUs) stats.maxLatenessUs = latenessUs;
+                stats.meanLatenessUs += (latenessUs - stats.meanLatenessUs) / stats.alarms;
+
+                notifier.triggerTime = 0;
+                if (notifier.waiting) {
+                    notifier.waiting = false;
+                    fired->emplace_back(entry.first, now);
+                } else {
+                    stats.overruns++;
+                    notifier.firedTime = now;
+                }
+            }
+            ArmHalAlarm();
+        }
+
+        if (fired->empty()) {
+            delete fired;
+            continue;
+        }
+        napi_status callStatus = m_onFired.BlockingCall(fired,
+            [this](Napi::Env env, Napi::Function, FiredAlarms* fired) {
+                if (env != nullptr) {
+                    for (auto& alarm : *fired) ResolveWait(env, alarm.first, alarm.second);
+                }
+                delete fired;
+            });
+        if (callStatus != napi_ok) {
+            delete fired;
+            break;
+        }
+    }
+    m_onFired.Release();
+}
+
+void NotifierScheduler::Shutdown() {
+    int32_t status = 0;
+    HAL_StopNotifier(m_halNotifier, &status);
+    m_thread.join();
+    HAL_CleanNotifier(m_halNotifier, &status);
+}
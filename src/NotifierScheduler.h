@@ -0,0 +1,84 @@
+#pragma once
+
+#include <napi.h>
+#include <hal/Types.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Alarms that fire this much after their trigger time count as a late wake
+#define NOTIFIER_LATE_WAKE_THRESHOLD_US 1000
+
+struct NotifierStats {
+    uint64_t alarms = 0;
+    // Alarms that fired while nobody was waiting, i.e. the loop was still busy with the previous one
+    uint64_t overruns = 0;
+    uint64_t lateWakes = 0;
+    uint64_t maxLatenessUs = 0;
+    double meanLatenessUs = 0;
+
+    Napi::Object ToObject(Napi::Env env) const;
+};
+
+// Any number of notifiers that share one HAL notifier and one native thread.
+// The thread keeps the HAL alarm set to the earliest trigger time among the
+// notifiers and, when it fires, hands the expired ones to the JS thread
+// through a single ThreadSafeFunction, where their pending waits are resolved.
+// Waiting therefore never occupies a libuv worker thread.
+//
+// Lifetime: the ThreadSafeFunction finalizer calls onFinalize, then stops the
+// thread and deletes the object. That happens when the environment is torn
+// down, or if the HAL reports an error. Handles are never reused.
+class NotifierScheduler {
+public:
+    // Returns nullptr and sets status if the HAL notifier could not be created
+    static NotifierScheduler* Start(Napi::Env env, std::function<void()> onFinalize, int32_t* status);
+
+    uint32_t Create();
+    // These return false if the handle does not exist. Updating a stopped notifier does nothing.
+    bool UpdateAlarm(uint32_t handle, uint64_t triggerTime);
+    bool CancelAlarm(uint32_t handle);
+    // Resolves with the time the alarm fired at, or 0 once the notifier is stopped.
+    // Resolves immediately if the alarm already fired since the last wait.
+    Napi::Promise Wait(Napi::Env env, uint32_t handle);
+    // Wakes a pending wait with 0. Later updates are ignored.
+    bool Stop(uint32_t handle);
+    // Stops the notifier and frees its handle
+    bool Clean(uint32_t handle);
+    bool GetStats(uint32_t handle, NotifierStats* stats);
+
+private:
+    struct Notifier {
+        uint64_t triggerTime = 0; // 0 when no alarm is set
+        uint64_t firedTime = 0;   // Set when an alarm fired that no wait has consumed yet
+        bool waiting = false;
+        bool stopped = false;
+        NotifierStats stats;
+    };
+
+    using FiredAlarms = std::vector<std::pair<uint32_t, uint64_t>>;
+
+    explicit NotifierScheduler(HAL_NotifierHandle halNotifier) : m_halNotifier(halNotifier) {}
+
+    void Run();
+    void ArmHalAlarm();
+    void ResolveWait(Napi::Env env, uint32_t handle, uint64_t time);
+    void Shutdown();
+
+    HAL_NotifierHandle m_halNotifier;
+    std::thread m_thread;
+    Napi::ThreadSafeFunction m_onFired;
+
+    std::mutex m_mtx;
+    // These values should only be accessed while holding m_mtx
+    std::map<uint32_t, Notifier> m_notifiers;
+    uint32_t m_nextHandle = 1;
+    uint64_t m_armedTime = 0;
+
+    // These values should only be accessed from the JS thread
+    std::map<uint32_t, Napi::Promise::Deferred> m_pendingWaits;
+};
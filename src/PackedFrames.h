@@ -0,0 +1,69 @@
+#pragma once
+
+#include <napi.h>
+#include <hal/CAN.h>
+#include <cstdint>
+#include <cstring>
+#include "DeviceClock.h"
+
+// Layout of one record written by the packed read functions. The record is
+// written in host byte order, which is little-endian on every platform we
+// ship for. Keep in sync with PackedFrameView in lib/binding.ts.
+//
+//   offset  size  field
+//   0       4     messageID
+//   4       4     timeStamp, low 32 bits
+//   8       4     timeStamp, high 32 bits
+//   12      1     dataSize
+//   13      3     reserved
+//   16      8     data
+#define PACKED_FRAME_RECORD_SIZE 24
+
+// Layout of one record read by sendCANMessages(). The payload sits at the
+// same offset as in the receive records. Keep in sync with
+// packCanMessages() in lib/binding.ts.
+//
+//   offset  size  field
+//   0       4     messageID
+//   4       4     repeatPeriodMs, signed
+//   8       1     dataSize
+//   9       7     reserved
+//   16      8     data
+#define PACKED_SEND_RECORD_SIZE 24
+
+inline void packFrame(uint8_t* record, uint32_t messageId, uint64_t timeStamp, const uint8_t* data, uint8_t dataSize) {
+    uint32_t timeStampLow = (uint32_t)timeStamp;
+    uint32_t timeStampHigh = (uint32_t)(timeStamp >> 32);
+    if (dataSize > 8) dataSize = 8;
+
+    std::memcpy(record, &messageId, 4);
+    std::memcpy(record + 4, &timeStampLow, 4);
+    std::memcpy(record + 8, &timeStampHigh, 4);
+    record[12] = dataSize;
+    record[13] = record[14] = record[15] = 0;
+    std::memset(record + 16, 0, 8);
+    std::memcpy(record + 16, data, dataSize);
+}
+
+inline void packStreamMessages(uint8_t* records, const HAL_CANStreamMessage* messages, uint32_t count, const DeviceClock& clock) {
+    for (uint32_t i = 0; i < count; i++) {
+        packFrame(records + i * PACKED_FRAME_RECORD_SIZE, messages[i].messageID, clock.Extend(messages[i].timeStamp), messages[i].data, messages[i].dataSize);
+    }
+}
+
+// Resolves an ArrayBuffer or any TypedArray to its backing bytes. Returns false for anything else.
+inline bool getBufferBytes(const Napi::Value& value, uint8_t** data, size_t* byteLength) {
+    if (value.IsTypedArray()) {
+        Napi::TypedArray array = value.As<Napi::TypedArray>();
+        *data = (uint8_t*)array.ArrayBuffer().Data() + array.ByteOffset();
+        *byteLength = array.ByteLength();
+        return true;
+    }
+    if (value.IsArrayBuffer()) {
+        Napi::ArrayBuffer buffer = value.As<Napi::ArrayBuffer>();
+        *data = (uint8_t*)buffer.Data();
+        *byteLength = buffer.ByteLength();
+        return true;
+    }
+    return false;
+}
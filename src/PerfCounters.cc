@@ -0,0 +1,115 @@
+#ifdef CANBRIDGE_PERF_COUNTERS
+
+#include <algorithm>
+#include <bit>
+#include "PerfCounters.h"
+
+thread_local PerfCall* PerfCall::s_current = nullptr;
+thread_local PerfCounters::ThreadCounters* PerfCounters::s_threadCounters = nullptr;
+
+PerfCall::~PerfCall() {
+    s_current = m_previous;
+    auto elapsed = std::chrono::steady_clock::now() - m_start;
+    m_phaseNs[(int)PerfPhase::kTotal] = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    PerfCounters::Instance().Record(m_binding, m_phaseNs);
+}
+
+PerfCounters& PerfCounters::Instance() {
+    static PerfCounters instance;
+    return instance;
+}
+
+uint32_t PerfCounters::RegisterBinding(const char* name) {
+    std::scoped_lock lock{m_mtx};
+    for (uint32_t i = 0; i < m_names.size(); i++) {
+        if (m_names[i] == name) return i;
+    }
+    // Calls of bindings past the limit are counted under the last one
+    if (m_names.size() == PERF_MAX_BINDINGS) return PERF_MAX_BINDINGS - 1;
+    m_names.emplace_back(name);
+    return m_names.size() - 1;
+}
+
+uint32_t PerfCounters::Bucket(uint64_t ns) {
+    if (ns < 4) return ns;
+    uint32_t exponent = std::bit_width(ns) - 1;
+    uint32_t bucket = (exponent - 1) * 4 + ((ns >> (exponent - 2)) & 3);
+    return bucket < PERF_HISTOGRAM_BUCKETS ? bucket : PERF_HISTOGRAM_BUCKETS - 1;
+}
+
+uint64_t PerfCounters::BucketLowerBoundNs(uint32_t bucket) {
+    if (bucket < 4) return bucket;
+    return (uint64_t)(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+void PerfCounters::Add(PhaseCounters& counters, uint64_t ns) {
+    // Only the owning thread adds, but a reset can come from another one
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    counters.histogram[Bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = counters.maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !counters.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+}
+
+void PerfCounters::Record(uint32_t binding, const uint64_t phaseNs[PERF_PHASE_COUNT]) {
+    ThreadCounters* thread = s_threadCounters;
+    if (thread == nullptr) {
+        thread = new ThreadCounters();
+        s_threadCounters = thread;
+        std::scoped_lock lock{m_mtx};
+        m_threads.push_back(thread);
+    }
+
+    BindingCounters* counters = thread->bindings[binding].load(std::memory_order_relaxed);
+    if (counters == nullptr) {
+        counters = new BindingCounters();
+        thread->bindings[binding].store(counters, std::memory_order_release);
+    }
+
+    Add(counters->phases[(int)PerfPhase::kTotal], phaseNs[(int)PerfPhase::kTotal]);
+    // A call that never entered a phase does not count towards it
+    for (int phase = 1; phase < PERF_PHASE_COUNT; phase++) {
+        if (phaseNs[phase] != 0) Add(counters->phases[phase], phaseNs[phase]);
+    }
+}
+
+void PerfCounters::Read(std::vector<PerfBindingStats>* stats) {
+    stats->clear();
+    std::scoped_lock lock{m_mtx};
+    for (uint32_t binding = 0; binding < m_names.size(); binding++) {
+        PerfBindingStats merged;
+        merged.name = m_names[binding];
+        for (ThreadCounters* thread : m_threads) {
+            BindingCounters* counters = thread->bindings[binding].load(std::memory_order_acquire);
+            if (counters == nullptr) continue;
+            for (int phase = 0; phase < PERF_PHASE_COUNT; phase++) {
+                const PhaseCounters& source = counters->phases[phase];
+                merged.count[phase] += source.count.load(std::memory_order_relaxed);
+                merged.totalNs[phase] += source.totalNs.load(std::memory_order_relaxed);
+                merged.maxNs[phase] = std::max(merged.maxNs[phase], source.maxNs.load(std::memory_order_relaxed));
+                for (uint32_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+                    merged.histogram[phase][b] += source.histogram[b].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        if (merged.count[(int)PerfPhase::kTotal] != 0) stats->push_back(merged);
+    }
+}
+
+void PerfCounters::Reset() {
+    std::scoped_lock lock{m_mtx};
+    for (ThreadCounters* thread : m_threads) {
+        for (auto& binding : thread->bindings) {
+            BindingCounters* counters = binding.load(std::memory_order_acquire);
+            if (counters == nullptr) continue;
+            for (PhaseCounters& phase : counters->phases) {
+                phase.count.store(0, std::memory_order_relaxed);
+                phase.totalNs.store(0, std::memory_order_relaxed);
+                phase.maxNs.store(0, std::memory_order_relaxed);
+                for (auto& bucket : phase.histogram) bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,177 @@
+#pragma once
+
+// Call counts and latency histograms of every binding, read by getPerfCounters().
+// Building with CANBRIDGE_PERF_COUNTERS undefined removes all of it: the
+// bindings are exported unwrapped, and PERF_PHASE() expands to nothing.
+
+#ifdef CANBRIDGE_PERF_COUNTERS
+
+#include <napi.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Timed separately within every binding call. Total is the whole call, the
+// others are the parts of it spent in PERF_PHASE() scopes of that kind.
+enum class PerfPhase {
+    kTotal,
+    // Waiting for the device registry lock
+    kLockWait,
+    // Inside CANBridge or the HAL
+    kDriver,
+    // Building JS values from native data
+    kConvert,
+};
+#define PERF_PHASE_COUNT 4
+#define PERF_MAX_BINDINGS 128
+// Log-linear latency buckets in nanoseconds, like an HDR histogram with
+// 4 buckets per power of two: buckets 0-3 hold 0-3 ns, and from then on
+// bucket b holds latencies from (4 + b % 4) << (b / 4 - 1) ns up to the next
+// bucket's lower bound, so no bucket is wider than a quarter of its lower
+// bound. The last bucket holds everything from about 7.5 s up.
+#define PERF_HISTOGRAM_BUCKETS 128
+
+// Times spent in one binding, summed over the threads that called it
+struct PerfBindingStats {
+    std::string name;
+    uint64_t count[PERF_PHASE_COUNT] = {};
+    uint64_t totalNs[PERF_PHASE_COUNT] = {};
+    uint64_t maxNs[PERF_PHASE_COUNT] = {};
+    uint64_t histogram[PERF_PHASE_COUNT][PERF_HISTOGRAM_BUCKETS] = {};
+};
+
+// Every thread that calls a binding records into its own counters, allocated
+// on its first call, so threads never write to the same cache lines. Each
+// binding's block is allocated the first time the thread calls it. Reads
+// merge the counters of every thread; a read concurrent with calls may see
+// a call's total before its phases. Counters of exited threads are kept,
+// since the threads that call bindings are the JS threads, which live as long
+// as their environment.
+class PerfCounters {
+public:
+    static PerfCounters& Instance();
+
+    // Returns the index to record the binding's calls under. Registering the
+    // same name again, as every worker thread that loads the addon does,
+    // returns the same index.
+    uint32_t RegisterBinding(const char* name);
+
+    // Fills stats with every binding that has been called since the last reset
+    void Read(std::vector<PerfBindingStats>* stats);
+    void Reset();
+
+    static uint32_t Bucket(uint64_t ns);
+    static uint64_t BucketLowerBoundNs(uint32_t bucket);
+
+private:
+    struct PhaseCounters {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> maxNs{0};
+        std::atomic<uint64_t> histogram[PERF_HISTOGRAM_BUCKETS] = {};
+    };
+    struct BindingCounters {
+        PhaseCounters phases[PERF_PHASE_COUNT];
+    };
+    struct ThreadCounters {
+        std::atomic<BindingCounters*> bindings[PERF_MAX_BINDINGS] = {};
+    };
+
+    friend class PerfCall;
+    // Records one call of the binding on the calling thread
+    void Record(uint32_t binding, const uint64_t phaseNs[PERF_PHASE_COUNT]);
+    static void Add(PhaseCounters& counters, uint64_t ns);
+
+    std::mutex m_mtx;
+    // These values should only be accessed while holding m_mtx
+    std::vector<std::string> m_names;
+    std::vector<ThreadCounters*> m_threads;
+
+    // Never freed, see above
+    static thread_local ThreadCounters* s_threadCounters;
+};
+
+// Times one call of a binding, and the PERF_PHASE() scopes inside it, on the
+// calling thread
+class PerfCall {
+public:
+    explicit PerfCall(uint32_t binding) : m_binding(binding), m_start(std::chrono::steady_clock::now()) {
+        m_previous = s_current;
+        s_current = this;
+    }
+    ~PerfCall();
+
+    PerfCall(const PerfCall&) = delete;
+    PerfCall& operator=(const PerfCall&) = delete;
+
+private:
+    friend class PerfPhaseScope;
+
+    uint32_t m_binding;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_phaseNs[PERF_PHASE_COUNT] = {};
+    // A binding can call back into JS, which can call another binding
+    PerfCall* m_previous;
+
+    static thread_local PerfCall* s_current;
+};
+
+// Adds the time until the end of the scope to the phase of the binding call
+// running on this thread. Does nothing outside of a binding call, such as on
+// the native threads.
+class PerfPhaseScope {
+public:
+    explicit PerfPhaseScope(PerfPhase phase) : m_call(PerfCall::s_current), m_phase(phase) {
+        if (m_call) m_start = std::chrono::steady_clock::now();
+    }
+    ~PerfPhaseScope() {
+        if (!m_call) return;
+        auto elapsed = std::chrono::steady_clock::now() - m_start;
+        m_call->m_phaseNs[(int)m_phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+    PerfPhaseScope(const PerfPhaseScope&) = delete;
+    PerfPhaseScope& operator=(const PerfPhaseScope&) = delete;
+
+private:
+    PerfCall* m_call;
+    PerfPhase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+// Times the rest of the enclosing scope as the given PerfPhase, e.g. PERF_PHASE(kDriver)
+#define PERF_PHASE(phase) PerfPhaseScope PERF_CONCAT(perfPhase, __LINE__)(PerfPhase::phase)
+
+template <auto Binding>
+inline uint32_t perfBindingIndex = 0;
+
+template <auto Binding>
+auto perfCountedBinding(const Napi::CallbackInfo& info) {
+    PerfCall call(perfBindingIndex<Binding>);
+    return Binding(info);
+}
+
+// Returns the binding as a JS function whose calls are counted under name
+template <auto Binding>
+Napi::Function countedFunction(Napi::Env env, const char* name) {
+    perfBindingIndex<Binding> = PerfCounters::Instance().RegisterBinding(name);
+    return Napi::Function::New(env, perfCountedBinding<Binding>, name);
+}
+
+#else
+
+#include <napi.h>
+
+#define PERF_PHASE(phase)
+
+template <auto Binding>
+Napi::Function countedFunction(Napi::Env env, const char* name) {
+    return Napi::Function::New(env, Binding, name);
+}
+
+#endif
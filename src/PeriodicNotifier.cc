@@ -0,0 +1,111 @@
+#include <hal/HAL.h>
+#include <cmath>
+#include "PeriodicNotifier.h"
+
+namespace {
+struct Tick {
+    uint64_t wakeTime;
+    uint64_t jitterUs;
+};
+}
+
+Napi::Object PeriodicNotifierStats::ToObject(Napi::Env env) const {
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("ticks", Napi::Number::New(env, ticks));
+    stats.Set("missedTicks", Napi::Number::New(env, missedTicks));
+    stats.Set("droppedCallbacks", Napi::Number::New(env, droppedCallbacks));
+    stats.Set("minJitterUs", Napi::Number::New(env, minJitterUs));
+    stats.Set("maxJitterUs", Napi::Number::New(env, maxJitterUs));
+    stats.Set("meanJitterUs", Napi::Number::New(env, meanJitterUs));
+    stats.Set("stdDevJitterUs", Napi::Number::New(env, ticks > 1 ? std::sqrt(jitterM2 / (ticks - 1)) : 0));
+    return stats;
+}
+
+PeriodicNotifier::PeriodicNotifier(HAL_NotifierHandle notifier, uint64_t periodUs)
+    : m_notifier(notifier), m_periodUs(periodUs > 0 ? periodUs : 1) {}
+
+PeriodicNotifier* PeriodicNotifier::Start(Napi::Env env, Napi::Function onTick, uint64_t periodUs,
+                                          std::function<void()> onFinalize, int32_t* status) {
+    *status = 0;
+    HAL_NotifierHandle notifier = HAL_InitializeNotifier(status);
+    if (*status != 0) return nullptr;
+    HAL_SetNotifierName(notifier, "node-can-bridge periodic notifier", status);
+    *status = 0; // The name is only cosmetic
+
+    PeriodicNotifier* periodicNotifier = new PeriodicNotifier(notifier, periodUs);
+
+    // A queue of one tick: if JS has not run the previous callback yet, the next tick is counted as
+    // dropped instead of piling up, so a stalled event loop does not get a burst of stale ticks.
+    periodicNotifier->m_onTick = Napi::ThreadSafeFunction::New(env, onTick, "CANBridgePeriodicNotifier", 1, 1,
+        [periodicNotifier, onFinalize](Napi::Env) {
+            onFinalize();
+            periodicNotifier->m_thread.join();
+            delete periodicNotifier;
+        });
+    periodicNotifier->m_thread = std::thread(&PeriodicNotifier::Run, periodicNotifier);
+    return periodicNotifier;
+}
+
+void PeriodicNotifier::Stop() {
+    m_running = false;
+    int32_t status = 0;
+    // Wakes up the thread if it is waiting for an alarm
+    HAL_StopNotifier(m_notifier, &status);
+}
+
+PeriodicNotifierStats PeriodicNotifier::GetStats() {
+    std::scoped_lock lock{m_statsMtx};
+    return m_stats;
+}
+
+void PeriodicNotifier::RecordTick(uint64_t jitterUs, uint64_t missedTicks) {
+    std::scoped_lock lock{m_statsMtx};
+    m_stats.ticks++;
+    m_stats.missedTicks += missedTicks;
+    if (m_stats.ticks == 1 || jitterUs < m_stats.minJitterUs) m_stats.minJitterUs = jitterUs;
+    if (jitterUs > m_stats.maxJitterUs) m_stats.maxJitterUs = jitterUs;
+
+    double delta = jitterUs - m_stats.meanJitterUs;
+    m_stats.meanJitterUs += delta / m_stats.ticks;
+    m_stats.jitterM2 += delta * (jitterUs - m_stats.meanJitterUs);
+}
+
+void PeriodicNotifier::Run() {
+    int32_t status = 0;
+    uint64_t triggerTime = HAL_GetFPGATime(&status) + m_periodUs;
+
+    while (m_running && status == 0) {
+        HAL_UpdateNotifierAlarm(m_notifier, triggerTime, &status);
+        if (status != 0) break;
+
+        uint64_t wakeTime = HAL_WaitForNotifierAlarm(m_notifier, &status);
+        // The HAL returns 0 once the notifier has been stopped
+        if (wakeTime == 0 || status != 0 || !m_running) break;
+
+        uint64_t jitterUs = wakeTime > triggerTime ? wakeTime - triggerTime : 0;
+        uint64_t missedTicks = jitterUs / m_periodUs;
+        RecordTick(jitterUs, missedTicks);
+        triggerTime += (missedTicks + 1) * m_periodUs;
+
+        Tick* tick = new Tick{wakeTime, jitterUs};
+        napi_status callStatus = m_onTick.NonBlockingCall(tick,
+            [](Napi::Env env, Napi::Function onTick, Tick* tick) {
+                if (env != nullptr && onTick != nullptr) {
+                    onTick.Call({Napi::Number::New(env, tick->wakeTime), Napi::Number::New(env, tick->jitterUs)});
+                }
+                delete tick;
+            });
+        if (callStatus == napi_queue_full) {
+            delete tick;
+            std::scoped_lock lock{m_statsMtx};
+            m_stats.droppedCallbacks++;
+        } else if (callStatus != napi_ok) {
+            delete tick;
+            break;
+        }
+    }
+
+    HAL_StopNotifier(m_notifier, &status);
+    HAL_CleanNotifier(m_notifier, &status);
+    m_onTick.Release();
+}
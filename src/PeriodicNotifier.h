@@ -0,0 +1,61 @@
+#pragma once
+
+#include <napi.h>
+#include <hal/Types.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Jitter is how late a tick woke up compared to its scheduled time, in microseconds
+struct PeriodicNotifierStats {
+    uint64_t ticks = 0;
+    // Ticks that were skipped because the thread woke up more than one period late
+    uint64_t missedTicks = 0;
+    // Ticks that were not delivered because the JS thread had not consumed the previous ones yet
+    uint64_t droppedCallbacks = 0;
+    uint64_t minJitterUs = 0;
+    uint64_t maxJitterUs = 0;
+    double meanJitterUs = 0;
+    // Running sum of squared differences from the mean (Welford's algorithm)
+    double jitterM2 = 0;
+
+    Napi::Object ToObject(Napi::Env env) const;
+};
+
+// Waits on its own HAL notifier on a native thread and calls onTick on the JS
+// thread every periodUs. Ticks are scheduled from the start time rather than
+// from the previous wake-up, so lateness does not accumulate.
+//
+// Lifetime: Stop() wakes the thread and asks it to finish. The thread cleans
+// the HAL notifier and releases the ThreadSafeFunction on its way out, and the
+// finalizer (which runs on the JS thread) calls onFinalize, then joins and
+// deletes the object. The thread also exits by itself if the HAL reports an
+// error, so whoever holds the pointer must forget it in onFinalize.
+class PeriodicNotifier {
+public:
+    // Returns nullptr and sets status if the HAL notifier could not be created
+    static PeriodicNotifier* Start(Napi::Env env, Napi::Function onTick, uint64_t periodUs,
+                                   std::function<void()> onFinalize, int32_t* status);
+
+    void Stop();
+    PeriodicNotifierStats GetStats();
+
+private:
+    PeriodicNotifier(HAL_NotifierHandle notifier, uint64_t periodUs);
+
+    void Run();
+    void RecordTick(uint64_t jitterUs, uint64_t missedTicks);
+
+    HAL_NotifierHandle m_notifier;
+    uint64_t m_periodUs;
+
+    std::atomic<bool> m_running{true};
+    std::thread m_thread;
+    Napi::ThreadSafeFunction m_onTick;
+
+    std::mutex m_statsMtx;
+    // Should only be accessed while holding m_statsMtx
+    PeriodicNotifierStats m_stats;
+};
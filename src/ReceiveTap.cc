@@ -0,0 +1,60 @@
+#include <chrono>
+#include "ReceiveTap.h"
+
+// How long the tap thread sleeps when the session had nothing to read
+#define RECEIVE_TAP_IDLE_POLL_US 500
+#define RECEIVE_TAP_BATCH_SIZE 256
+
+namespace {
+int64_t steadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+ReceiveTap::ReceiveTap(StreamSubscription::ReadFunction read, StreamSubscription::CloseFunction close, std::shared_ptr<DeviceClock> clock)
+    : m_read(std::move(read)), m_close(std::move(close)), m_clock(std::move(clock)) {}
+
+ReceiveTap::~ReceiveTap() {
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    } else {
+        m_close();
+    }
+}
+
+void ReceiveTap::Touch() {
+    m_lastTouchMs.store(steadyNowMs(), std::memory_order_relaxed);
+}
+
+void ReceiveTap::Start() {
+    Touch();
+    m_running = true;
+    m_thread = std::thread(&ReceiveTap::Run, this);
+}
+
+void ReceiveTap::Run() {
+    HAL_CANStreamMessage messages[RECEIVE_TAP_BATCH_SIZE];
+
+    while (m_running) {
+        uint32_t messagesRead = 0;
+        if (!m_read(messages, RECEIVE_TAP_BATCH_SIZE, &messagesRead)) break;
+
+        int captureChannel = m_captureChannel;
+        for (uint32_t i = 0; i < messagesRead; i++) {
+            uint64_t timeStamp = m_clock->Extend(messages[i].timeStamp);
+            m_cache.Update(messages[i].messageID, timeStamp, messages[i].data, messages[i].dataSize);
+            m_traffic.Record(messages[i].messageID, timeStamp);
+            if (captureChannel >= 0) {
+                CaptureLogger::Instance().Record(captureChannel, false, messages[i].messageID, messages[i].data, messages[i].dataSize);
+            }
+        }
+        if (captureChannel < 0 && steadyNowMs() - m_lastTouchMs.load(std::memory_order_relaxed) > RECEIVE_TAP_IDLE_TIMEOUT_MS) break;
+        if (messagesRead == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(RECEIVE_TAP_IDLE_POLL_US));
+        }
+    }
+
+    m_close();
+    m_running = false;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "CaptureLogger.h"
+#include "DeviceClock.h"
+#include "LatestValueCache.h"
+#include "StreamSubscription.h"
+#include "TrafficStats.h"
+
+// Reads every frame a device receives through one wide-open stream session on
+// a native thread, keeps a LatestValueCache and the TrafficStats up to date
+// with them and, while a capture channel is set, records them with the
+// CaptureLogger. Both are kept with the timestamps extended by the device's
+// DeviceClock, which read is expected to feed.
+//
+// The thread starts with Start(), so the cache can be seeded from the JS
+// thread first. After that, only the tap thread writes to the cache and the
+// statistics. The thread stops by itself, closing the session, if the session
+// goes away (for example when the device is unplugged), or if Touch() was not
+// called for RECEIVE_TAP_IDLE_TIMEOUT_MS and no capture is being recorded.
+// Both stay readable after that.
+// A tap nobody read from for this long stops, so it does not keep its session and thread forever
+#define RECEIVE_TAP_IDLE_TIMEOUT_MS 10000
+
+class ReceiveTap {
+public:
+    ReceiveTap(StreamSubscription::ReadFunction read, StreamSubscription::CloseFunction close, std::shared_ptr<DeviceClock> clock);
+    ~ReceiveTap();
+
+    void Start();
+
+    LatestValueCache& Cache() { return m_cache; }
+    TrafficStats& Traffic() { return m_traffic; }
+    const DeviceClock& Clock() const { return *m_clock; }
+    bool IsRunning() const { return m_running; }
+    // Keeps the tap running for another RECEIVE_TAP_IDLE_TIMEOUT_MS
+    void Touch();
+    // -1 stops recording
+    void SetCaptureChannel(int channel) { m_captureChannel = channel; }
+    bool IsCapturing() const { return m_captureChannel >= 0; }
+
+private:
+    void Run();
+
+    StreamSubscription::ReadFunction m_read;
+    StreamSubscription::CloseFunction m_close;
+    std::shared_ptr<DeviceClock> m_clock;
+    LatestValueCache m_cache;
+    TrafficStats m_traffic;
+
+    std::atomic<int> m_captureChannel{-1};
+    // Steady clock time of the last Touch(), in milliseconds
+    std::atomic<int64_t> m_lastTouchMs{0};
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+};
@@ -0,0 +1,129 @@
+#include <cmath>
+#include <cstring>
+#include "ReplayEngine.h"
+
+// The thread sleeps until this long before a deadline, then spins, because sleeps overshoot
+#define REPLAY_SPIN_US 200
+
+Napi::Object ReplayStats::ToObject(Napi::Env env) const {
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("sent", Napi::Number::New(env, sent));
+    stats.Set("failedSends", Napi::Number::New(env, failedSends));
+    stats.Set("lateSends", Napi::Number::New(env, lateSends));
+    stats.Set("loops", Napi::Number::New(env, loops));
+    stats.Set("maxErrorUs", Napi::Number::New(env, maxErrorUs));
+    stats.Set("meanErrorUs", Napi::Number::New(env, meanErrorUs));
+    stats.Set("stdDevErrorUs", Napi::Number::New(env, sent > 1 ? std::sqrt(errorM2 / (sent - 1)) : 0));
+    stats.Set("stopped", Napi::Boolean::New(env, stopped));
+    return stats;
+}
+
+ReplayEngine::ReplayEngine(std::unique_ptr<CaptureReader> reader, SendFunction send, const ReplayOptions& options)
+    : m_reader(std::move(reader)), m_send(std::move(send)), m_options(options) {
+    if (!(m_options.speed > 0)) m_options.speed = 1;
+}
+
+ReplayEngine* ReplayEngine::Start(Napi::Env env, std::unique_ptr<CaptureReader> reader, SendFunction send,
+                                  const ReplayOptions& options, FinishedFunction onFinished) {
+    ReplayEngine* engine = new ReplayEngine(std::move(reader), std::move(send), options);
+
+    engine->m_onFinished = Napi::ThreadSafeFunction::New(env, Napi::Function(), "CANBridgeReplay", 1, 1,
+        [engine](Napi::Env) {
+            engine->m_thread.join();
+            delete engine;
+        });
+    engine->m_thread = std::thread([engine, onFinished]() {
+        engine->Run();
+
+        auto* stats = new ReplayStats(engine->GetStats());
+        napi_status status = engine->m_onFinished.BlockingCall(stats,
+            [onFinished](Napi::Env env, Napi::Function, ReplayStats* stats) {
+                if (env != nullptr) onFinished(*stats);
+                delete stats;
+            });
+        if (status != napi_ok) delete stats;
+        engine->m_onFinished.Release();
+    });
+    return engine;
+}
+
+void ReplayEngine::Stop() {
+    {
+        std::scoped_lock lock{m_mtx};
+        m_running = false;
+        m_stats.stopped = true;
+    }
+    m_cv.notify_one();
+}
+
+ReplayStats ReplayEngine::GetStats() {
+    std::scoped_lock lock{m_mtx};
+    return m_stats;
+}
+
+bool ReplayEngine::Passes(const CaptureRecord& record) const {
+    bool transmit = (record.flags & CAPTURE_RECORD_FLAG_TRANSMIT) != 0;
+    if (transmit ? !m_options.sendTransmitted : !m_options.sendReceived) return false;
+    if (m_options.filters.empty()) return true;
+    for (const auto& filter : m_options.filters) {
+        if ((record.messageId & filter.second) == (filter.first & filter.second)) return true;
+    }
+    return false;
+}
+
+bool ReplayEngine::WaitUntil(Clock::time_point deadline) {
+    {
+        std::unique_lock lock{m_mtx};
+        m_cv.wait_until(lock, deadline - std::chrono::microseconds(REPLAY_SPIN_US), [this]() { return !m_running; });
+        if (!m_running) return false;
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void ReplayEngine::RecordSend(uint64_t errorUs, int status) {
+    std::scoped_lock lock{m_mtx};
+    m_stats.sent++;
+    if (status != 0) m_stats.failedSends++;
+    if (errorUs > REPLAY_LATE_THRESHOLD_US) m_stats.lateSends++;
+    if (errorUs > m_stats.maxErrorUs) m_stats.maxErrorUs = errorUs;
+
+    double delta = errorUs - m_stats.meanErrorUs;
+    m_stats.meanErrorUs += delta / m_stats.sent;
+    m_stats.errorM2 += delta * (errorUs - m_stats.meanErrorUs);
+}
+
+void ReplayEngine::Run() {
+    using namespace std::chrono;
+    const uint64_t count = m_reader->Count();
+    if (count == 0) return;
+
+    const uint64_t firstTimestampUs = m_reader->At(0).timestampUs;
+    do {
+        const auto start = Clock::now();
+        bool sentAny = false;
+        for (uint64_t i = 0; i < count; i++) {
+            const CaptureRecord& record = m_reader->At(i);
+            if (!Passes(record)) continue;
+
+            // Records are in timestamp order, but a damaged file might not be. Those go out immediately.
+            uint64_t offsetUs = record.timestampUs > firstTimestampUs ? record.timestampUs - firstTimestampUs : 0;
+            const auto deadline = start + duration_cast<Clock::duration>(duration<double, std::micro>(offsetUs / m_options.speed));
+            if (!WaitUntil(deadline)) return;
+
+            const auto sendTime = Clock::now();
+            uint8_t data[8];
+            std::memcpy(data, record.data, sizeof(data));
+            int status = m_send(record.messageId, data, record.dataSize);
+            RecordSend(duration_cast<microseconds>(sendTime - deadline).count(), status);
+            sentAny = true;
+        }
+
+        std::scoped_lock lock{m_mtx};
+        m_stats.loops++;
+        // Looping over a file where nothing passes the filters would just spin
+        if (!m_running || !sentAny) return;
+    } while (m_options.loop);
+}
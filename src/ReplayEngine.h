@@ -0,0 +1,84 @@
+#pragma once
+
+#include <napi.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CaptureReader.h"
+
+// A send that starts this much after its scheduled time counts as late
+#define REPLAY_LATE_THRESHOLD_US 1000
+
+struct ReplayOptions {
+    double speed = 1;
+    bool loop = false;
+    bool sendReceived = true;
+    bool sendTransmitted = true;
+    // Records pass if they match any filter, or if there are none
+    std::vector<std::pair<uint32_t, uint32_t>> filters;
+};
+
+// Timing error is how long after its scheduled time a frame was handed to the driver
+struct ReplayStats {
+    uint64_t sent = 0;
+    uint64_t failedSends = 0;
+    uint64_t lateSends = 0;
+    uint64_t loops = 0;
+    uint64_t maxErrorUs = 0;
+    double meanErrorUs = 0;
+    // Running sum of squared differences from the mean (Welford's algorithm)
+    double errorM2 = 0;
+    bool stopped = false;
+
+    Napi::Object ToObject(Napi::Env env) const;
+};
+
+// Sends the records of a capture file with their recorded spacing, divided by
+// the speed multiplier. Every frame is scheduled against the start of the
+// replay rather than the previous frame, so errors do not accumulate. The
+// thread sleeps until shortly before each deadline and spins for the rest.
+//
+// Lifetime: the thread calls onFinished on the JS thread when the replay ends
+// or is stopped, then releases the ThreadSafeFunction; the finalizer joins and
+// deletes the engine. Do not use the engine once onFinished has run.
+class ReplayEngine {
+public:
+    // Returns the status of the send, which is 0 on success
+    using SendFunction = std::function<int(uint32_t messageId, uint8_t* data, uint8_t dataSize)>;
+    using FinishedFunction = std::function<void(const ReplayStats& stats)>;
+
+    static ReplayEngine* Start(Napi::Env env, std::unique_ptr<CaptureReader> reader, SendFunction send,
+                               const ReplayOptions& options, FinishedFunction onFinished);
+
+    void Stop();
+    ReplayStats GetStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    ReplayEngine(std::unique_ptr<CaptureReader> reader, SendFunction send, const ReplayOptions& options);
+
+    void Run();
+    bool Passes(const CaptureRecord& record) const;
+    // Returns false if the replay was stopped while waiting
+    bool WaitUntil(Clock::time_point deadline);
+    void RecordSend(uint64_t errorUs, int status);
+
+    std::unique_ptr<CaptureReader> m_reader;
+    SendFunction m_send;
+    ReplayOptions m_options;
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    // These values should only be accessed while holding m_mtx
+    bool m_running = true;
+    ReplayStats m_stats;
+
+    std::thread m_thread;
+    Napi::ThreadSafeFunction m_onFinished;
+};
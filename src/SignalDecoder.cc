@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cstring>
+#include "SignalDecoder.h"
+
+template <bool Signed, bool Scaled>
+double SignalDecoder::Extract(uint64_t payload, const CompiledSignal& signal) {
+    uint64_t raw = (payload >> signal.shift) & signal.mask;
+    double value;
+    if constexpr (Signed) {
+        value = (double)((int64_t)(raw << signal.signShift) >> signal.signShift);
+    } else {
+        value = (double)raw;
+    }
+    if constexpr (Scaled) {
+        value = value * signal.scale + signal.offset;
+    }
+    return value;
+}
+
+std::unique_ptr<SignalDecoder> SignalDecoder::Create(const std::vector<SignalLayout>& layouts, std::string* error) {
+    std::unique_ptr<SignalDecoder> decoder(new SignalDecoder());
+    for (uint32_t index = 0; index < layouts.size(); index++) {
+        const SignalLayout& layout = layouts[index];
+        if (layout.length == 0 || layout.length > 64 || layout.startBit > 63) {
+            *error = "Signal " + std::to_string(index) + " does not fit in 8 bytes";
+            return nullptr;
+        }
+
+        CompiledSignal signal;
+        signal.index = index;
+        signal.bigEndian = !layout.littleEndian;
+        if (layout.littleEndian) {
+            if (layout.startBit + layout.length > 64) {
+                *error = "Signal " + std::to_string(index) + " does not fit in 8 bytes";
+                return nullptr;
+            }
+            signal.shift = layout.startBit;
+            signal.bytesNeeded = (layout.startBit + layout.length + 7) / 8;
+        } else {
+            // Position of the most significant bit in the payload loaded as a big-endian integer
+            int32_t msbPosition = 56 - 8 * (int32_t)(layout.startBit / 8) + (int32_t)(layout.startBit % 8);
+            int32_t shift = msbPosition - (int32_t)layout.length + 1;
+            if (shift < 0) {
+                *error = "Signal " + std::to_string(index) + " does not fit in 8 bytes";
+                return nullptr;
+            }
+            signal.shift = shift;
+            signal.bytesNeeded = (63 - shift) / 8 + 1;
+        }
+        signal.mask = layout.length == 64 ? UINT64_MAX : (1ull << layout.length) - 1;
+        signal.signShift = 64 - layout.length;
+        signal.scale = layout.scale;
+        signal.offset = layout.offset;
+
+        bool scaled = layout.scale != 1 || layout.offset != 0;
+        if (layout.isSigned) {
+            signal.extract = scaled ? &Extract<true, true> : &Extract<true, false>;
+        } else {
+            signal.extract = scaled ? &Extract<false, true> : &Extract<false, false>;
+        }
+
+        MessageSignals& message = decoder->m_messages[layout.messageId];
+        message.signals.push_back(signal);
+        message.anyLittleEndian |= !signal.bigEndian;
+        message.anyBigEndian |= signal.bigEndian;
+    }
+    decoder->m_signalCount = layouts.size();
+    return decoder;
+}
+
+bool SignalDecoder::Decode(uint32_t messageId, const uint8_t* data, uint8_t dataSize, double* values) const {
+    auto messageIterator = m_messages.find(messageId);
+    if (messageIterator == m_messages.end()) return false;
+    const MessageSignals& message = messageIterator->second;
+
+    uint8_t bytes[8] = {};
+    dataSize = std::min<uint8_t>(dataSize, 8);
+    std::memcpy(bytes, data, dataSize);
+    uint64_t littleEndian = 0;
+    uint64_t bigEndian = 0;
+    if (message.anyLittleEndian) {
+        for (int i = 7; i >= 0; i--) littleEndian = (littleEndian << 8) | bytes[i];
+    }
+    if (message.anyBigEndian) {
+        for (int i = 0; i < 8; i++) bigEndian = (bigEndian << 8) | bytes[i];
+    }
+
+    for (const CompiledSignal& signal : message.signals) {
+        if (dataSize < signal.bytesNeeded) continue;
+        values[signal.index] = signal.extract(signal.bigEndian ? bigEndian : littleEndian, signal);
+    }
+    return true;
+}
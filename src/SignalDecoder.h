@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A signal in DBC terms. For little-endian (Intel) signals startBit is the
+// least significant bit, counting from bit 0 of byte 0. For big-endian
+// (Motorola) signals it is the most significant bit, numbered the same way,
+// as DBC files do.
+struct SignalLayout {
+    uint32_t messageId;
+    uint32_t startBit;
+    uint32_t length;
+    bool littleEndian = true;
+    bool isSigned = false;
+    double scale = 1;
+    double offset = 0;
+};
+
+// Decodes frames into the latest value of each registered signal.
+//
+// Layouts are compiled when the decoder is built: every signal becomes a shift
+// and a mask on the payload loaded as one 64-bit integer, in the signal's byte
+// order, plus a pointer to an extractor specialized for its signedness and
+// whether it is scaled. Decoding a frame is then one hash lookup and a few
+// shifts per signal, with no per-bit work.
+class SignalDecoder {
+public:
+    // Returns nullptr and sets error if a layout does not fit in 64 bits
+    static std::unique_ptr<SignalDecoder> Create(const std::vector<SignalLayout>& layouts, std::string* error);
+
+    // Writes the value of each signal carried by the frame to values[signal index].
+    // Signals that extend past dataSize are left alone. Returns whether the ID has any signals.
+    bool Decode(uint32_t messageId, const uint8_t* data, uint8_t dataSize, double* values) const;
+
+    size_t SignalCount() const { return m_signalCount; }
+
+private:
+    struct CompiledSignal;
+    using Extractor = double (*)(uint64_t payload, const CompiledSignal& signal);
+
+    template <bool Signed, bool Scaled>
+    static double Extract(uint64_t payload, const CompiledSignal& signal);
+
+    struct CompiledSignal {
+        uint32_t index;
+        uint8_t bytesNeeded;
+        bool bigEndian;
+        uint8_t shift;
+        // Moves the sign bit of a signed signal to bit 63
+        uint8_t signShift;
+        uint64_t mask;
+        double scale;
+        double offset;
+        Extractor extract;
+    };
+
+    struct MessageSignals {
+        std::vector<CompiledSignal> signals;
+        bool anyLittleEndian = false;
+        bool anyBigEndian = false;
+    };
+
+    std::unordered_map<uint32_t, MessageSignals> m_messages;
+    size_t m_signalCount = 0;
+};
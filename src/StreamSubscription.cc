@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <chrono>
+#include "StreamSubscription.h"
+#include "canWrapper.h"
+
+// How long the reader thread sleeps when the session had nothing to read
+#define SUBSCRIPTION_IDLE_POLL_US 500
+
+StreamSubscription::StreamSubscription(ReadFunction read, CloseFunction close, std::shared_ptr<DeviceClock> clock,
+                                       uint32_t maxBatchSize, uint32_t maxLatencyMs)
+    : m_read(std::move(read)), m_close(std::move(close)), m_clock(std::move(clock)),
+      m_maxBatchSize(std::max(maxBatchSize, 1u)), m_maxLatencyMs(maxLatencyMs) {}
+
+StreamSubscription* StreamSubscription::Start(Napi::Env env, Napi::Function onBatch, ReadFunction read, CloseFunction close,
+                                              std::shared_ptr<DeviceClock> clock, uint32_t maxBatchSize, uint32_t maxLatencyMs,
+                                              std::function<void()> onFinalize) {
+    StreamSubscription* subscription = new StreamSubscription(std::move(read), std::move(close), std::move(clock), maxBatchSize, maxLatencyMs);
+
+    // Only a few batches may be queued for the JS thread. If JS falls behind, the reader thread
+    // blocks and frames pile up in the stream session buffer instead of in unbounded memory.
+    subscription->m_onBatch = Napi::ThreadSafeFunction::New(env, onBatch, "CANStreamSubscription", 4, 1,
+        [subscription, onFinalize](Napi::Env) {
+            onFinalize();
+            subscription->m_thread.join();
+            delete subscription;
+        });
+    subscription->m_thread = std::thread(&StreamSubscription::Run, subscription);
+    return subscription;
+}
+
+void StreamSubscription::Run() {
+    using namespace std::chrono;
+    std::vector<HAL_CANStreamMessage> buffer(m_maxBatchSize);
+    uint32_t count = 0;
+    auto batchStart = steady_clock::now();
+
+    while (m_running) {
+        uint32_t messagesRead = 0;
+        if (!m_read(buffer.data() + count, m_maxBatchSize - count, &messagesRead)) break;
+
+        const auto now = steady_clock::now();
+        if (count == 0 && messagesRead > 0) {
+            batchStart = now;
+        }
+        count += messagesRead;
+
+        bool batchFull = count >= m_maxBatchSize;
+        bool batchExpired = count > 0 && now - batchStart >= milliseconds(m_maxLatencyMs);
+        if (batchFull || batchExpired) {
+            if (!Flush(buffer, count)) break;
+            count = 0;
+        } else if (messagesRead == 0) {
+            std::this_thread::sleep_for(microseconds(SUBSCRIPTION_IDLE_POLL_US));
+        }
+    }
+
+    m_close();
+    m_onBatch.Release();
+}
+
+bool StreamSubscription::Flush(std::vector<HAL_CANStreamMessage>& buffer, uint32_t count) {
+    auto* batch = new std::vector<HAL_CANStreamMessage>(buffer.begin(), buffer.begin() + count);
+    napi_status status = m_onBatch.BlockingCall(batch,
+        [clock = m_clock](Napi::Env env, Napi::Function onBatch, std::vector<HAL_CANStreamMessage>* batch) {
+            if (env != nullptr && onBatch != nullptr) {
+                onBatch.Call({streamMessagesToArray(env, batch->data(), batch->size(), *clock)});
+            }
+            delete batch;
+        });
+    if (status != napi_ok) {
+        delete batch;
+        return false;
+    }
+    return true;
+}
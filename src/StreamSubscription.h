@@ -0,0 +1,53 @@
+#pragma once
+
+#include <napi.h>
+#include <hal/CAN.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "DeviceClock.h"
+
+// Reads a stream session on a native thread and pushes the frames to a JS
+// callback in batches. A batch is delivered as soon as it holds maxBatchSize
+// frames, or maxLatencyMs after its first frame arrived, whichever is first.
+// Timestamps are extended with the device's clock, which read is expected to
+// feed.
+//
+// Lifetime: Stop() only asks the reader thread to finish. The thread closes
+// the stream session and releases the ThreadSafeFunction on its way out, and
+// the finalizer (which runs on the JS thread) calls onFinalize, then joins and
+// deletes the object. The thread also exits by itself if a read fails (for
+// example because the device was removed), so whoever holds the pointer must
+// forget it in onFinalize.
+class StreamSubscription {
+public:
+    // Fills the buffer with up to maxMessages frames and returns false if the session is gone
+    using ReadFunction = std::function<bool(HAL_CANStreamMessage* messages, uint32_t maxMessages, uint32_t* messagesRead)>;
+    using CloseFunction = std::function<void()>;
+
+    static StreamSubscription* Start(Napi::Env env, Napi::Function onBatch, ReadFunction read, CloseFunction close,
+                                     std::shared_ptr<DeviceClock> clock, uint32_t maxBatchSize, uint32_t maxLatencyMs,
+                                     std::function<void()> onFinalize);
+
+    void Stop() { m_running = false; }
+
+private:
+    StreamSubscription(ReadFunction read, CloseFunction close, std::shared_ptr<DeviceClock> clock,
+                       uint32_t maxBatchSize, uint32_t maxLatencyMs);
+
+    void Run();
+    bool Flush(std::vector<HAL_CANStreamMessage>& buffer, uint32_t count);
+
+    ReadFunction m_read;
+    CloseFunction m_close;
+    std::shared_ptr<DeviceClock> m_clock;
+    uint32_t m_maxBatchSize;
+    uint32_t m_maxLatencyMs;
+
+    std::atomic<bool> m_running{true};
+    std::thread m_thread;
+    Napi::ThreadSafeFunction m_onBatch;
+};
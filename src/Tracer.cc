@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include "Tracer.h"
+
+// Every event is attributed to this process ID, traces only ever hold one process
+#define TRACE_PID 1
+#define TRACE_PERFETTO_SEQUENCE_ID 1
+
+namespace {
+// The calling thread's ring and ID. Gives the ring back when the thread exits, so short-lived threads do
+// not leak rings. The ID is not reused, so events left in the ring stay attributed to the thread that
+// recorded them.
+struct TraceThread {
+    SpscRing<TraceEvent>* ring = nullptr;
+    std::atomic<bool>* owned = nullptr;
+    uint32_t tid = 0;
+    const char* name = nullptr;
+
+    ~TraceThread() {
+        if (owned != nullptr) owned->store(false, std::memory_order_release);
+    }
+};
+
+thread_local TraceThread traceThread;
+
+int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void appendJsonString(std::string& out, const std::string& value) {
+    out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+std::string chromeJson(const std::vector<TraceEvent>& events, const std::vector<std::pair<uint32_t, std::string>>& threadNames) {
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separate = [&]() {
+        if (!first) out += ",\n";
+        first = false;
+    };
+    for (const auto& [tid, name] : threadNames) {
+        separate();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(TRACE_PID) +
+               ",\"tid\":" + std::to_string(tid) + ",\"args\":{\"name\":";
+        appendJsonString(out, name);
+        out += "}}";
+    }
+    char timestamp[32];
+    for (const TraceEvent& event : events) {
+        separate();
+        out += "{\"name\":";
+        appendJsonString(out, event.name);
+        out += ",\"ph\":\"";
+        out += event.phase;
+        // Chrome timestamps are in microseconds
+        snprintf(timestamp, sizeof(timestamp), "%llu.%03u", (unsigned long long)(event.timestampNs / 1000), (unsigned)(event.timestampNs % 1000));
+        out += "\",\"ts\":";
+        out += timestamp;
+        out += ",\"pid\":" + std::to_string(TRACE_PID) + ",\"tid\":" + std::to_string(event.tid);
+        if (event.phase == 'i') out += ",\"s\":\"t\"";
+        if (event.hasArg) out += ",\"args\":{\"arg\":" + std::to_string(event.arg) + "}";
+        out += "}";
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+// Just enough of the protobuf wire format to write Perfetto's trace.proto
+class ProtoWriter {
+public:
+    void Varint(uint32_t field, uint64_t value) {
+        Tag(field, 0);
+        Raw(value);
+    }
+    void Bytes(uint32_t field, const std::string& value) {
+        Tag(field, 2);
+        Raw(value.size());
+        m_out += value;
+    }
+    // Writes the message built by fill() as a length-delimited field
+    template <typename Fill>
+    void Message(uint32_t field, Fill fill) {
+        ProtoWriter nested;
+        fill(nested);
+        Bytes(field, nested.m_out);
+    }
+    const std::string& Out() const { return m_out; }
+
+private:
+    void Tag(uint32_t field, uint32_t wireType) { Raw((uint64_t)field << 3 | wireType); }
+    void Raw(uint64_t value) {
+        while (value >= 0x80) {
+            m_out += (char)(value | 0x80);
+            value >>= 7;
+        }
+        m_out += (char)value;
+    }
+
+    std::string m_out;
+};
+
+// Field numbers from perfetto/protos/perfetto/trace
+namespace proto {
+constexpr uint32_t kTracePacket = 1;
+constexpr uint32_t kPacketTimestamp = 8;
+constexpr uint32_t kPacketSequenceId = 10;
+constexpr uint32_t kPacketTrackEvent = 11;
+constexpr uint32_t kPacketSequenceFlags = 13;
+constexpr uint32_t kPacketTrackDescriptor = 60;
+constexpr uint32_t kSequenceIncrementalStateCleared = 1;
+constexpr uint32_t kTrackUuid = 1;
+constexpr uint32_t kTrackThread = 4;
+constexpr uint32_t kThreadPid = 1;
+constexpr uint32_t kThreadTid = 2;
+constexpr uint32_t kThreadName = 5;
+constexpr uint32_t kEventDebugAnnotation = 4;
+constexpr uint32_t kEventType = 9;
+constexpr uint32_t kEventTrackUuid = 11;
+constexpr uint32_t kEventName = 23;
+constexpr uint32_t kAnnotationUintValue = 3;
+constexpr uint32_t kAnnotationName = 10;
+constexpr uint64_t kSliceBegin = 1;
+constexpr uint64_t kSliceEnd = 2;
+constexpr uint64_t kInstant = 3;
+}
+
+std::string perfettoTrace(const std::vector<TraceEvent>& events, const std::vector<std::pair<uint32_t, std::string>>& threadNames) {
+    ProtoWriter trace;
+    bool first = true;
+    // One track per thread, with the thread's ID as its UUID
+    for (const auto& [tid, name] : threadNames) {
+        trace.Message(proto::kTracePacket, [&](ProtoWriter& packet) {
+            packet.Varint(proto::kPacketSequenceId, TRACE_PERFETTO_SEQUENCE_ID);
+            if (first) packet.Varint(proto::kPacketSequenceFlags, proto::kSequenceIncrementalStateCleared);
+            packet.Message(proto::kPacketTrackDescriptor, [&](ProtoWriter& track) {
+                track.Varint(proto::kTrackUuid, tid);
+                track.Message(proto::kTrackThread, [&](ProtoWriter& thread) {
+                    thread.Varint(proto::kThreadPid, TRACE_PID);
+                    thread.Varint(proto::kThreadTid, tid);
+                    thread.Bytes(proto::kThreadName, name);
+                });
+            });
+        });
+        first = false;
+    }
+    for (const TraceEvent& event : events) {
+        trace.Message(proto::kTracePacket, [&](ProtoWriter& packet) {
+            packet.Varint(proto::kPacketTimestamp, event.timestampNs);
+            packet.Varint(proto::kPacketSequenceId, TRACE_PERFETTO_SEQUENCE_ID);
+            packet.Message(proto::kPacketTrackEvent, [&](ProtoWriter& trackEvent) {
+                uint64_t type = event.phase == 'B' ? proto::kSliceBegin : event.phase == 'E' ? proto::kSliceEnd : proto::kInstant;
+                trackEvent.Varint(proto::kEventType, type);
+                trackEvent.Varint(proto::kEventTrackUuid, event.tid);
+                if (event.phase != 'E') trackEvent.Bytes(proto::kEventName, event.name);
+                if (event.hasArg) {
+                    trackEvent.Message(proto::kEventDebugAnnotation, [&](ProtoWriter& annotation) {
+                        annotation.Bytes(proto::kAnnotationName, "arg");
+                        annotation.Varint(proto::kAnnotationUintValue, event.arg);
+                    });
+                }
+            });
+        });
+    }
+    return trace.Out();
+}
+}
+
+Tracer& Tracer::Instance() {
+    static Tracer* instance = new Tracer();
+    return *instance;
+}
+
+void Tracer::Start() {
+    std::scoped_lock lock{m_drainMtx};
+    std::vector<TraceEvent> discarded;
+    Drain(discarded, nullptr);
+    m_dropped.store(0, std::memory_order_relaxed);
+    m_startNs.store(steadyNowNs(), std::memory_order_relaxed);
+    s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::SetThreadName(const char* name) {
+    traceThread.name = name;
+    if (traceThread.tid == 0) return;
+    Tracer& tracer = Instance();
+    std::scoped_lock lock{tracer.m_ringsMtx};
+    for (auto& threadName : tracer.m_threadNames) {
+        if (threadName.first == traceThread.tid) threadName.second = name;
+    }
+}
+
+Tracer::Ring* Tracer::AcquireRing(uint32_t* tid) {
+    std::scoped_lock lock{m_ringsMtx};
+    *tid = m_nextTid.fetch_add(1, std::memory_order_relaxed);
+    m_threadNames.emplace_back(*tid, traceThread.name ? traceThread.name : "Thread " + std::to_string(*tid));
+    for (auto& producerRing : m_rings) {
+        bool expected = false;
+        if (producerRing->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            producerRing->tid = *tid;
+            traceThread.owned = &producerRing->owned;
+            return &producerRing->ring;
+        }
+    }
+    m_rings.push_back(std::make_unique<ProducerRing>());
+    m_rings.back()->owned = true;
+    m_rings.back()->tid = *tid;
+    traceThread.owned = &m_rings.back()->owned;
+    return &m_rings.back()->ring;
+}
+
+void Tracer::Record(char phase, const char* name, bool hasArg, uint64_t arg) {
+    if (traceThread.ring == nullptr) traceThread.ring = AcquireRing(&traceThread.tid);
+
+    TraceEvent event;
+    int64_t elapsed = steadyNowNs() - m_startNs.load(std::memory_order_relaxed);
+    event.timestampNs = elapsed > 0 ? elapsed : 0;
+    event.name = name;
+    event.arg = arg;
+    event.tid = traceThread.tid;
+    event.phase = phase;
+    event.hasArg = hasArg;
+    if (!traceThread.ring->TryPush(event)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Tracer::Drain(std::vector<TraceEvent>& events, std::vector<std::pair<uint32_t, std::string>>* threadNames) {
+    std::vector<Ring*> rings;
+    std::vector<uint32_t> ownerTids;
+    uint32_t nextTid;
+    {
+        std::scoped_lock lock{m_ringsMtx};
+        for (auto& producerRing : m_rings) {
+            rings.push_back(&producerRing->ring);
+            if (producerRing->owned.load(std::memory_order_acquire)) ownerTids.push_back(producerRing->tid);
+        }
+        nextTid = m_nextTid.load(std::memory_order_relaxed);
+    }
+    TraceEvent event;
+    for (Ring* ring : rings) {
+        while (ring->TryPop(&event)) events.push_back(event);
+    }
+
+    std::scoped_lock lock{m_ringsMtx};
+    if (threadNames != nullptr) *threadNames = m_threadNames;
+    // A thread that had given up its ring before the rings were looked at has had all of its events popped
+    std::erase_if(m_threadNames, [&](const std::pair<uint32_t, std::string>& threadName) {
+        return threadName.first < nextTid && std::find(ownerTids.begin(), ownerTids.end(), threadName.first) == ownerTids.end();
+    });
+}
+
+bool Tracer::Write(const std::string& path, TraceFormat format, TraceStats* stats, std::string* error) {
+    std::vector<TraceEvent> events;
+    std::vector<std::pair<uint32_t, std::string>> threadNames;
+    {
+        std::scoped_lock lock{m_drainMtx};
+        Drain(events, &threadNames);
+        stats->dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    }
+    // Each ring is in order already, this interleaves the threads
+    std::stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        return a.timestampNs < b.timestampNs;
+    });
+    stats->events = events.size();
+
+    std::string contents = format == TraceFormat::kPerfetto ? perfettoTrace(events, threadNames) : chromeJson(events, threadNames);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        *error = "Could not open " + path;
+        return false;
+    }
+    file.write(contents.data(), contents.size());
+    if (!file) {
+        *error = "Could not write " + path;
+        return false;
+    }
+    return true;
+}
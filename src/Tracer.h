@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SpscRing.h"
+
+// Events each thread can hold between writeTrace() calls before new ones are dropped
+#define TRACE_EVENTS_PER_THREAD 65536
+
+enum class TraceFormat {
+    // Chrome trace-event JSON, for chrome://tracing and ui.perfetto.dev
+    kChromeJson,
+    // Perfetto protobuf TrackEvents, for ui.perfetto.dev and trace_processor
+    kPerfetto,
+};
+
+struct TraceEvent {
+    uint64_t timestampNs;
+    // A string literal, events only keep the pointer
+    const char* name;
+    uint64_t arg;
+    uint32_t tid;
+    // 'B', 'E' or 'i', as in the Chrome format
+    char phase;
+    bool hasArg;
+};
+
+struct TraceStats {
+    uint64_t events = 0;
+    // Events lost because a thread's ring was full
+    uint64_t dropped = 0;
+};
+
+// Timeline of begin/end and instant events from every thread, written out
+// on demand. While tracing is off an event costs one relaxed load and a
+// branch. While it is on, every thread that records gets its own SpscRing,
+// leased like CaptureLogger's, so recording never takes a lock once a thread
+// has its ring. Write() drains the rings, so events only need to fit in them
+// between writes.
+//
+// There is one tracer per process, see Instance(). It is never destroyed, so
+// the rings handed out to threads stay valid.
+class Tracer {
+public:
+    static Tracer& Instance();
+
+    static bool Enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // Discards the events that were not written yet and starts recording
+    void Start();
+    void Stop() { s_enabled.store(false, std::memory_order_relaxed); }
+
+    // Writes the events recorded since the last write, oldest first. Returns false and sets error on failure.
+    bool Write(const std::string& path, TraceFormat format, TraceStats* stats, std::string* error);
+
+    // Names the calling thread in traces. Cheap enough to call when tracing is off.
+    static void SetThreadName(const char* name);
+
+    void Record(char phase, const char* name, bool hasArg, uint64_t arg);
+
+private:
+    using Ring = SpscRing<TraceEvent>;
+
+    struct ProducerRing {
+        Ring ring{TRACE_EVENTS_PER_THREAD};
+        std::atomic<bool> owned{false};
+        // Of the thread that leased the ring last. Should only be accessed while holding m_ringsMtx.
+        uint32_t tid = 0;
+    };
+
+    Tracer() = default;
+
+    Ring* AcquireRing(uint32_t* tid);
+    // Only call while holding m_drainMtx. Also forgets the names of threads that have no events left,
+    // after copying every name to threadNames if it is not null.
+    void Drain(std::vector<TraceEvent>& events, std::vector<std::pair<uint32_t, std::string>>* threadNames);
+
+    // Static so that checking it does not go through Instance()
+    static inline std::atomic<bool> s_enabled{false};
+    std::atomic<uint64_t> m_dropped{0};
+    // Only incremented while holding m_ringsMtx, so Drain() can tell which threads leased a ring after it looked
+    std::atomic<uint32_t> m_nextTid{1};
+    // Steady clock time of timestamp 0, in nanoseconds
+    std::atomic<int64_t> m_startNs{0};
+
+    std::mutex m_ringsMtx;
+    // These values should only be accessed while holding m_ringsMtx. m_rings only grows, m_threadNames
+    // holds the threads that still own a ring or have events in one.
+    std::vector<std::unique_ptr<ProducerRing>> m_rings;
+    std::vector<std::pair<uint32_t, std::string>> m_threadNames;
+
+    // Held by the one thread consuming the rings at a time
+    std::mutex m_drainMtx;
+};
+
+// Records a begin event now and the matching end event when the scope ends
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : m_name(Tracer::Enabled() ? name : nullptr) {
+        if (m_name) Tracer::Instance().Record('B', m_name, false, 0);
+    }
+    TraceScope(const char* name, uint64_t arg) : m_name(Tracer::Enabled() ? name : nullptr) {
+        if (m_name) Tracer::Instance().Record('B', m_name, true, arg);
+    }
+    ~TraceScope() {
+        // Also ends the scope if tracing stopped in the middle, so the slice is not left open
+        if (m_name) Tracer::Instance().Record('E', m_name, false, 0);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Traces the rest of the enclosing scope as a slice named name, a string literal,
+// optionally with a numeric argument
+#define TRACE_SCOPE(...) TraceScope TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#define TRACE_INSTANT(name) \
+    do { if (Tracer::Enabled()) Tracer::Instance().Record('i', name, false, 0); } while (0)
+#define TRACE_INSTANT_ARG(name, arg) \
+    do { if (Tracer::Enabled()) Tracer::Instance().Record('i', name, true, arg); } while (0)
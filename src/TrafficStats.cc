@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <bit>
+#include "TrafficStats.h"
+
+// The period estimate starts over after this many late frames in a row
+#define TRAFFIC_PERIOD_RESET_AFTER 4
+
+static_assert((TRAFFIC_STATS_CAPACITY & (TRAFFIC_STATS_CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+namespace {
+uint32_t histogramBucket(uint32_t gapUs) {
+    uint32_t bucket = std::bit_width(gapUs >> 8);
+    return bucket < TRAFFIC_HISTOGRAM_BUCKETS ? bucket : TRAFFIC_HISTOGRAM_BUCKETS - 1;
+}
+
+void increment(std::atomic<uint32_t>& counter, uint32_t amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+}
+
+uint32_t TrafficStats::FindOrClaim(uint32_t messageId) {
+    uint32_t index = (messageId * 0x9E3779B1u) & (TRAFFIC_STATS_CAPACITY - 1);
+    for (uint32_t probes = 0; probes < TRAFFIC_STATS_CAPACITY; probes++) {
+        uint32_t key = m_slots[index].key.load(std::memory_order_relaxed);
+        if (key == messageId || key == EMPTY_KEY) return index;
+        index = (index + 1) & (TRAFFIC_STATS_CAPACITY - 1);
+    }
+    return TRAFFIC_STATS_CAPACITY;
+}
+
+void TrafficStats::Record(uint32_t messageId, uint64_t timeStamp) {
+    if (m_resetRequested.load(std::memory_order_relaxed) && m_resetRequested.exchange(false, std::memory_order_relaxed)) {
+        Reset();
+    }
+
+    uint32_t index = FindOrClaim(messageId);
+    if (index == TRAFFIC_STATS_CAPACITY) {
+        m_overflows.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Slot& slot = m_slots[index];
+    WriterState& state = m_writerState[index];
+    bool firstFrame = slot.key.load(std::memory_order_relaxed) == EMPTY_KEY;
+
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (firstFrame) {
+        state = WriterState{};
+        state.windowStart = timeStamp;
+    } else {
+        // A device clock that jumped back counts as no gap
+        int64_t sinceLastUs = (int64_t)(timeStamp - slot.lastTimeStamp.load(std::memory_order_relaxed));
+        uint32_t gapUs = (uint32_t)std::clamp<int64_t>(sinceLastUs, 0, UINT32_MAX);
+        increment(slot.histogram[histogramBucket(gapUs)]);
+        if (gapUs > slot.maxGapUs.load(std::memory_order_relaxed)) {
+            slot.maxGapUs.store(gapUs, std::memory_order_relaxed);
+        }
+
+        if (state.periodUs < 1) {
+            state.periodUs = gapUs;
+        } else if (gapUs > TRAFFIC_MISSED_PERIOD_FACTOR * state.periodUs) {
+            increment(slot.missed, (uint32_t)(gapUs / state.periodUs + 0.5) - 1);
+            if (++state.lateInARow >= TRAFFIC_PERIOD_RESET_AFTER) {
+                state.periodUs = gapUs;
+                state.lateInARow = 0;
+            }
+        } else {
+            state.lateInARow = 0;
+            state.periodUs += (gapUs - state.periodUs) / 8;
+        }
+        slot.periodUs.store((uint32_t)(state.periodUs + 0.5), std::memory_order_relaxed);
+    }
+
+    state.windowFrames++;
+    uint64_t windowUs = timeStamp - state.windowStart;
+    if (windowUs >= TRAFFIC_RATE_WINDOW_US) {
+        slot.framesPerSecond.store((float)((state.windowFrames - 1) * 1e6 / windowUs), std::memory_order_relaxed);
+        state.windowStart = timeStamp;
+        state.windowFrames = 1;
+    }
+    increment(slot.frames);
+    slot.lastTimeStamp.store(timeStamp, std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+
+    if (firstFrame) {
+        slot.key.store(messageId, std::memory_order_release);
+    }
+    m_newestTimeStamp.store(timeStamp, std::memory_order_relaxed);
+}
+
+void TrafficStats::Reset() {
+    for (uint32_t i = 0; i < TRAFFIC_STATS_CAPACITY; i++) {
+        Slot& slot = m_slots[i];
+        if (slot.key.load(std::memory_order_relaxed) == EMPTY_KEY) continue;
+
+        uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.key.store(EMPTY_KEY, std::memory_order_relaxed);
+        slot.frames.store(0, std::memory_order_relaxed);
+        slot.periodUs.store(0, std::memory_order_relaxed);
+        slot.maxGapUs.store(0, std::memory_order_relaxed);
+        slot.missed.store(0, std::memory_order_relaxed);
+        slot.framesPerSecond.store(0, std::memory_order_relaxed);
+        for (auto& bucket : slot.histogram) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        slot.seq.store(seq + 2, std::memory_order_release);
+        m_writerState[i] = WriterState{};
+    }
+    m_overflows.store(0, std::memory_order_relaxed);
+}
+
+bool TrafficStats::Read(const Slot& slot, Entry* entry) {
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = slot.seq.load(std::memory_order_acquire);
+        entry->messageId = slot.key.load(std::memory_order_relaxed);
+        entry->frames = slot.frames.load(std::memory_order_relaxed);
+        entry->lastTimeStamp = slot.lastTimeStamp.load(std::memory_order_relaxed);
+        entry->periodUs = slot.periodUs.load(std::memory_order_relaxed);
+        entry->maxGapUs = slot.maxGapUs.load(std::memory_order_relaxed);
+        entry->missed = slot.missed.load(std::memory_order_relaxed);
+        entry->framesPerSecond = slot.framesPerSecond.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < TRAFFIC_HISTOGRAM_BUCKETS; i++) {
+            entry->histogram[i] = slot.histogram[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.seq.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    return entry->messageId != EMPTY_KEY;
+}
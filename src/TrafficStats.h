@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Must be a power of two
+#define TRAFFIC_STATS_CAPACITY 2048
+// Inter-arrival histogram buckets. Bucket 0 holds gaps under 256 µs, bucket b
+// holds gaps from 2^(b+7) µs up to twice that, and the last bucket holds
+// everything from about 4.2 s up.
+#define TRAFFIC_HISTOGRAM_BUCKETS 16
+// Rates are measured over windows of this length
+#define TRAFFIC_RATE_WINDOW_US 1000000
+// A gap longer than this many periods counts the periods in between as missed
+#define TRAFFIC_MISSED_PERIOD_FACTOR 1.5
+
+// Per-arbitration-ID traffic statistics, written by a single thread and
+// readable from any thread without locks. It is laid out like
+// LatestValueCache: a fixed open-addressed table where every slot is a
+// seqlock, so recording a frame never allocates.
+//
+// Each ID's period is estimated from its inter-arrival times, ignoring the
+// gaps that are long enough to count as missed frames. If an ID keeps arriving
+// late, the estimate starts over from its latest gap, so a period that was
+// deliberately lengthened is picked up after a few frames. Timestamps are
+// the 64-bit microsecond stream timestamps that DeviceClock extends.
+class TrafficStats {
+public:
+    struct Entry {
+        uint32_t messageId;
+        uint32_t frames;
+        uint64_t lastTimeStamp;
+        uint32_t periodUs;
+        uint32_t maxGapUs;
+        uint32_t missed;
+        float framesPerSecond;
+        uint32_t histogram[TRAFFIC_HISTOGRAM_BUCKETS];
+    };
+
+    // Only call from the writer thread. Frames for new IDs are dropped once the table is full.
+    void Record(uint32_t messageId, uint64_t timeStamp);
+
+    // Asks the writer thread to clear the table before it records its next frame
+    void RequestReset() { m_resetRequested.store(true, std::memory_order_relaxed); }
+
+    // Calls fn(const Entry&) for every ID
+    template <typename Fn>
+    void ForEach(Fn fn) const {
+        Entry entry;
+        for (const Slot& slot : m_slots) {
+            if (slot.key.load(std::memory_order_acquire) == EMPTY_KEY) continue;
+            if (Read(slot, &entry)) fn(entry);
+        }
+    }
+
+    // Latest timestamp of any frame, to tell how long ago each ID was last seen
+    uint64_t NewestTimeStamp() const { return m_newestTimeStamp.load(std::memory_order_relaxed); }
+    uint64_t Overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+
+    // Lower bound of a histogram bucket in microseconds
+    static uint32_t BucketLowerBoundUs(uint32_t bucket) { return bucket == 0 ? 0 : 1u << (bucket + 7); }
+
+private:
+    static constexpr uint32_t EMPTY_KEY = UINT32_MAX;
+
+    struct alignas(64) Slot {
+        std::atomic<uint32_t> key{EMPTY_KEY};
+        std::atomic<uint32_t> seq{0};
+        std::atomic<uint32_t> frames{0};
+        std::atomic<uint64_t> lastTimeStamp{0};
+        std::atomic<uint32_t> periodUs{0};
+        std::atomic<uint32_t> maxGapUs{0};
+        std::atomic<uint32_t> missed{0};
+        std::atomic<float> framesPerSecond{0};
+        std::atomic<uint32_t> histogram[TRAFFIC_HISTOGRAM_BUCKETS] = {};
+    };
+
+    // Bookkeeping only the writer thread touches
+    struct WriterState {
+        double periodUs = 0;
+        uint64_t windowStart = 0;
+        uint32_t windowFrames = 0;
+        uint32_t lateInARow = 0;
+    };
+
+    uint32_t FindOrClaim(uint32_t messageId);
+    void Reset();
+    // Returns false if the slot was cleared while it was being read
+    static bool Read(const Slot& slot, Entry* entry);
+
+    Slot m_slots[TRAFFIC_STATS_CAPACITY];
+    WriterState m_writerState[TRAFFIC_STATS_CAPACITY];
+    std::atomic<uint64_t> m_newestTimeStamp{0};
+    std::atomic<uint64_t> m_overflows{0};
+    std::atomic<bool> m_resetRequested{false};
+};
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstring>
+#include "TransactionEngine.h"
+
+Napi::Object TransactionResult::ToObject(Napi::Env env) const {
+    Napi::Object result = Napi::Object::New(env);
+    switch (status) {
+        case TransactionStatus::kOk: result.Set("status", "ok"); break;
+        case TransactionStatus::kTimeout: result.Set("status", "timeout"); break;
+        case TransactionStatus::kSendFailed: result.Set("status", "sendFailed"); break;
+        default: result.Set("status", "aborted"); break;
+    }
+    result.Set("attempts", Napi::Number::New(env, attempts));
+    if (status == TransactionStatus::kSendFailed) {
+        result.Set("sendStatus", Napi::Number::New(env, sendStatus));
+    }
+    if (status == TransactionStatus::kOk) {
+        result.Set("latencyUs", Napi::Number::New(env, latencyUs));
+        Napi::Array data = Napi::Array::New(env, response.dataSize);
+        for (int i = 0; i < response.dataSize; i++) {
+            data[i] = Napi::Number::New(env, response.data[i]);
+        }
+        Napi::Object message = Napi::Object::New(env);
+        message.Set("messageID", response.messageID);
+        message.Set("timeStamp", Napi::Number::New(env, responseTimeStamp));
+        message.Set("data", data);
+        result.Set("message", message);
+    }
+    return result;
+}
+
+TransactionEngine::TransactionEngine(std::vector<TransactionRequest> requests, uint32_t window, StreamSubscription::ReadFunction read,
+                                     StreamSubscription::CloseFunction close, std::shared_ptr<DeviceClock> clock, SendFunction send)
+    : m_requests(std::move(requests)), m_results(m_requests.size()), m_window(window > 0 ? window : 1),
+      m_read(std::move(read)), m_close(std::move(close)), m_clock(std::move(clock)), m_send(std::move(send)) {
+    m_inFlight.reserve(m_window);
+}
+
+void TransactionEngine::Start(Napi::Env env, std::vector<TransactionRequest> requests, uint32_t window,
+                              StreamSubscription::ReadFunction read, StreamSubscription::CloseFunction close,
+                              std::shared_ptr<DeviceClock> clock, SendFunction send, FinishedFunction onFinished) {
+    TransactionEngine* engine = new TransactionEngine(std::move(requests), window, std::move(read), std::move(close),
+                                                      std::move(clock), std::move(send));
+
+    engine->m_onFinished = Napi::ThreadSafeFunction::New(env, Napi::Function(), "CANBridgeTransaction", 1, 1,
+        [engine](Napi::Env) {
+            engine->m_thread.join();
+            delete engine;
+        });
+    engine->m_thread = std::thread([engine, onFinished]() {
+        engine->Run();
+
+        // The results are only read on the JS thread from here on, and the engine lives until the finalizer
+        napi_status status = engine->m_onFinished.BlockingCall(engine,
+            [onFinished](Napi::Env env, Napi::Function, TransactionEngine* engine) {
+                if (env != nullptr) onFinished(engine->m_results);
+            });
+        (void)status;
+        engine->m_onFinished.Release();
+    });
+}
+
+bool TransactionEngine::Matches(const TransactionRequest& request, const HAL_CANStreamMessage& message) {
+    if (((message.messageID ^ request.responseId) & request.responseMask) != 0) return false;
+    for (int i = 0; i < 8; i++) {
+        if (request.responseDataMask[i] == 0) continue;
+        if (i >= message.dataSize) return false;
+        if (((message.data[i] ^ request.responseData[i]) & request.responseDataMask[i]) != 0) return false;
+    }
+    return true;
+}
+
+bool TransactionEngine::Send(InFlight& request, Clock::time_point now) {
+    const TransactionRequest& transaction = m_requests[request.index];
+    TransactionResult& result = m_results[request.index];
+    if (result.attempts > transaction.retries) {
+        result.status = request.sendFailed ? TransactionStatus::kSendFailed : TransactionStatus::kTimeout;
+        return false;
+    }
+
+    uint8_t data[8];
+    std::memcpy(data, transaction.data, sizeof(data));
+    int status = m_send(transaction.messageId, data, transaction.dataSize);
+    result.attempts++;
+    request.sentAt = now;
+    request.sendFailed = status != 0;
+    if (status != 0) {
+        result.sendStatus = status;
+        request.deadline = now + std::chrono::microseconds(TRANSACTION_SEND_BACKOFF_US);
+    } else {
+        request.deadline = now + std::chrono::microseconds(transaction.timeoutUs);
+    }
+    return true;
+}
+
+void TransactionEngine::Run() {
+    HAL_CANStreamMessage messages[TRANSACTION_READ_BATCH_SIZE];
+    uint32_t next = 0;
+
+    while (next < m_requests.size() || !m_inFlight.empty()) {
+        auto now = Clock::now();
+        for (size_t i = 0; i < m_inFlight.size();) {
+            if (now < m_inFlight[i].deadline || Send(m_inFlight[i], now)) {
+                i++;
+            } else {
+                m_inFlight.erase(m_inFlight.begin() + i);
+            }
+        }
+        while (m_inFlight.size() < m_window && next < m_requests.size()) {
+            InFlight request{next++};
+            if (Send(request, now)) m_inFlight.push_back(request);
+        }
+        if (m_inFlight.empty()) continue;
+
+        uint32_t messagesRead = 0;
+        if (!m_read(messages, TRANSACTION_READ_BATCH_SIZE, &messagesRead)) {
+            for (TransactionResult& result : m_results) {
+                if (result.status == TransactionStatus::kPending) result.status = TransactionStatus::kAborted;
+            }
+            break;
+        }
+
+        auto receivedAt = Clock::now();
+        ClockModel clockModel = messagesRead > 0 ? m_clock->Model() : ClockModel{};
+        for (uint32_t m = 0; m < messagesRead; m++) {
+            for (auto request = m_inFlight.begin(); request != m_inFlight.end(); ++request) {
+                if (!Matches(m_requests[request->index], messages[m])) continue;
+                TransactionResult& result = m_results[request->index];
+                result.status = TransactionStatus::kOk;
+                result.response = messages[m];
+                result.responseTimeStamp = m_clock->Extend(messages[m].timeStamp);
+                // Up to the response's timestamp in host time rather than up to when this thread got around to
+                // reading it, kept between the send and the read in case the clock estimate is off
+                int64_t sentUs = std::chrono::duration_cast<std::chrono::microseconds>(request->sentAt.time_since_epoch()).count();
+                int64_t readUs = std::chrono::duration_cast<std::chrono::microseconds>(receivedAt.time_since_epoch()).count();
+                int64_t receivedUs = clockModel.valid ? (int64_t)clockModel.ToHostUs(result.responseTimeStamp) : readUs;
+                result.latencyUs = std::clamp<int64_t>(receivedUs, sentUs, readUs) - sentUs;
+                m_inFlight.erase(request);
+                break;
+            }
+        }
+        if (messagesRead == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(TRANSACTION_IDLE_POLL_US));
+        }
+    }
+
+    m_close();
+}
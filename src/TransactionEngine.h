@@ -0,0 +1,116 @@
+#pragma once
+
+#include <napi.h>
+#include <hal/CAN.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "DeviceClock.h"
+#include "StreamSubscription.h"
+
+// How long the thread sleeps when nothing was received
+#define TRANSACTION_IDLE_POLL_US 100
+#define TRANSACTION_READ_BATCH_SIZE 64
+// A failed send is retried after this long, so a full transmit queue is not hammered
+#define TRANSACTION_SEND_BACKOFF_US 1000
+
+// A request frame and the response that answers it. A received frame is the
+// response if its ID matches responseId under responseMask, and every byte of
+// its payload matches responseData under responseDataMask. A frame too short
+// to hold the masked bytes does not match.
+struct TransactionRequest {
+    uint32_t messageId = 0;
+    uint8_t data[8] = {};
+    uint8_t dataSize = 0;
+    uint32_t responseId = 0;
+    uint32_t responseMask = 0x1FFFFFFF;
+    uint8_t responseData[8] = {};
+    uint8_t responseDataMask[8] = {};
+    uint32_t timeoutUs = 0;
+    // Sends after the first one
+    uint32_t retries = 0;
+};
+
+enum class TransactionStatus {
+    kPending,
+    kOk,
+    kTimeout,
+    // Every attempt to send the request failed
+    kSendFailed,
+    // The stream session went away before a response came in
+    kAborted,
+};
+
+struct TransactionResult {
+    TransactionStatus status = TransactionStatus::kPending;
+    uint32_t attempts = 0;
+    // From the last send of the request to its response
+    uint64_t latencyUs = 0;
+    // Status of the last failed send
+    int sendStatus = 0;
+    HAL_CANStreamMessage response = {};
+    // The response's timestamp extended to 64 bits
+    uint64_t responseTimeStamp = 0;
+
+    Napi::Object ToObject(Napi::Env env) const;
+};
+
+// Sends requests and matches their responses on a native thread, keeping up
+// to window requests in flight. A request that sees no response within its
+// timeout is sent again, up to its number of retries. Responses are matched
+// against the requests in flight oldest first, so requests whose responses
+// cannot be told apart by their keys are answered in the order they were sent.
+//
+// The stream session the responses are read from must be opened before the
+// engine starts, so that no response can arrive before it is listened for.
+// Latencies are measured up to the responses' timestamps, mapped to host time
+// by the device's clock, which read is expected to feed.
+//
+// Lifetime: the thread calls onFinished on the JS thread once every request
+// has a result, then releases the ThreadSafeFunction; the finalizer joins and
+// deletes the engine. The thread closes the stream session when it is done.
+class TransactionEngine {
+public:
+    // Returns the status of the send, which is 0 on success
+    using SendFunction = std::function<int(uint32_t messageId, uint8_t* data, uint8_t dataSize)>;
+    using FinishedFunction = std::function<void(const std::vector<TransactionResult>& results)>;
+
+    static void Start(Napi::Env env, std::vector<TransactionRequest> requests, uint32_t window,
+                      StreamSubscription::ReadFunction read, StreamSubscription::CloseFunction close,
+                      std::shared_ptr<DeviceClock> clock, SendFunction send, FinishedFunction onFinished);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    TransactionEngine(std::vector<TransactionRequest> requests, uint32_t window, StreamSubscription::ReadFunction read,
+                      StreamSubscription::CloseFunction close, std::shared_ptr<DeviceClock> clock, SendFunction send);
+
+    struct InFlight {
+        uint32_t index = 0;
+        Clock::time_point sentAt{};
+        Clock::time_point deadline{};
+        bool sendFailed = false;
+    };
+
+    void Run();
+    // Sends the request if it has attempts left. Returns false, with its result set, if it has none.
+    bool Send(InFlight& request, Clock::time_point now);
+    static bool Matches(const TransactionRequest& request, const HAL_CANStreamMessage& message);
+
+    std::vector<TransactionRequest> m_requests;
+    std::vector<TransactionResult> m_results;
+    uint32_t m_window;
+    StreamSubscription::ReadFunction m_read;
+    StreamSubscription::CloseFunction m_close;
+    std::shared_ptr<DeviceClock> m_clock;
+    SendFunction m_send;
+
+    // Only touched by the engine thread, oldest first
+    std::vector<InFlight> m_inFlight;
+
+    std::thread m_thread;
+    Napi::ThreadSafeFunction m_onFinished;
+};
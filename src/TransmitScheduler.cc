@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstring>
+#include "TransmitScheduler.h"
+
+Napi::Object TransmitScheduleStats::ToObject(Napi::Env env) const {
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("sent", Napi::Number::New(env, sent));
+    stats.Set("lateSends", Napi::Number::New(env, lateSends));
+    stats.Set("skipped", Napi::Number::New(env, skipped));
+    stats.Set("failedSends", Napi::Number::New(env, failedSends));
+    stats.Set("lastStatus", Napi::Number::New(env, lastStatus));
+    stats.Set("minJitterUs", Napi::Number::New(env, minJitterUs));
+    stats.Set("maxJitterUs", Napi::Number::New(env, maxJitterUs));
+    stats.Set("meanJitterUs", Napi::Number::New(env, meanJitterUs));
+    return stats;
+}
+
+TransmitScheduler::TransmitScheduler(SendFunction send) : m_send(std::move(send)) {}
+
+TransmitScheduler::~TransmitScheduler() {
+    StopThread();
+}
+
+void TransmitScheduler::Add(uint32_t scheduleId, uint32_t messageId, const uint8_t* data, uint8_t dataSize, uint64_t periodUs, uint64_t phaseUs) {
+    using namespace std::chrono;
+    Schedule schedule;
+    schedule.messageId = messageId;
+    schedule.dataSize = std::min<uint8_t>(dataSize, 8);
+    std::memset(schedule.data, 0, sizeof(schedule.data));
+    std::memcpy(schedule.data, data, schedule.dataSize);
+    schedule.period = microseconds(std::max<uint64_t>(periodUs, 1));
+
+    // The first deadline is the earliest epoch + phase + n * period that is not in the past
+    const auto phase = microseconds(phaseUs % schedule.period.count());
+    const auto elapsed = duration_cast<microseconds>(Clock::now() - m_epoch);
+    auto periods = elapsed > phase ? (elapsed - phase + schedule.period - microseconds(1)) / schedule.period : 0;
+    schedule.deadline = m_epoch + phase + periods * schedule.period;
+
+    std::scoped_lock lock{m_mtx};
+    m_schedules[scheduleId] = schedule;
+    m_pending.push({schedule.deadline, scheduleId});
+    if (!m_running) {
+        if (m_thread.joinable()) m_thread.join();
+        m_running = true;
+        m_thread = std::thread(&TransmitScheduler::Run, this);
+    }
+    m_cv.notify_one();
+}
+
+bool TransmitScheduler::Update(uint32_t scheduleId, const uint8_t* data, uint8_t dataSize) {
+    std::scoped_lock lock{m_mtx};
+    auto scheduleIterator = m_schedules.find(scheduleId);
+    if (scheduleIterator == m_schedules.end()) return false;
+
+    Schedule& schedule = scheduleIterator->second;
+    schedule.dataSize = std::min<uint8_t>(dataSize, 8);
+    std::memset(schedule.data, 0, sizeof(schedule.data));
+    std::memcpy(schedule.data, data, schedule.dataSize);
+    return true;
+}
+
+bool TransmitScheduler::Remove(uint32_t scheduleId) {
+    bool empty;
+    {
+        std::scoped_lock lock{m_mtx};
+        m_schedules.erase(scheduleId);
+        empty = m_schedules.empty();
+    }
+    if (empty) StopThread();
+    return empty;
+}
+
+bool TransmitScheduler::GetStats(uint32_t scheduleId, TransmitScheduleStats* stats) {
+    std::scoped_lock lock{m_mtx};
+    auto scheduleIterator = m_schedules.find(scheduleId);
+    if (scheduleIterator == m_schedules.end()) return false;
+    *stats = scheduleIterator->second.stats;
+    return true;
+}
+
+void TransmitScheduler::StopThread() {
+    {
+        std::scoped_lock lock{m_mtx};
+        m_running = false;
+        m_pending = {};
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void TransmitScheduler::Run() {
+    using namespace std::chrono;
+    std::unique_lock lock{m_mtx};
+
+    while (m_running) {
+        if (m_pending.empty()) {
+            m_cv.wait(lock);
+            continue;
+        }
+        const PendingSend next = m_pending.top();
+        if (Clock::now() < next.deadline) {
+            // Wakes early when a schedule with an earlier deadline is added
+            m_cv.wait_until(lock, next.deadline);
+            continue;
+        }
+        m_pending.pop();
+
+        auto scheduleIterator = m_schedules.find(next.scheduleId);
+        if (scheduleIterator == m_schedules.end() || scheduleIterator->second.deadline != next.deadline) continue;
+
+        // Copied so that the payload sent is always one complete Update(), and so the send runs unlocked
+        Schedule& schedule = scheduleIterator->second;
+        uint32_t messageId = schedule.messageId;
+        uint8_t data[8];
+        uint8_t dataSize = schedule.dataSize;
+        std::memcpy(data, schedule.data, sizeof(data));
+
+        lock.unlock();
+        const auto sendTime = Clock::now();
+        int status = m_send(messageId, data, dataSize);
+        lock.lock();
+
+        // The schedule may have been removed or replaced while unlocked
+        scheduleIterator = m_schedules.find(next.scheduleId);
+        if (scheduleIterator == m_schedules.end() || scheduleIterator->second.deadline != next.deadline) continue;
+        Schedule& current = scheduleIterator->second;
+        TransmitScheduleStats& stats = current.stats;
+
+        uint64_t jitterUs = duration_cast<microseconds>(sendTime - next.deadline).count();
+        stats.lastStatus = status;
+        if (status != 0) stats.failedSends++;
+        stats.sent++;
+        if (stats.sent == 1 || jitterUs < stats.minJitterUs) stats.minJitterUs = jitterUs;
+        if (jitterUs > stats.maxJitterUs) stats.maxJitterUs = jitterUs;
+        stats.meanJitterUs += (jitterUs - stats.meanJitterUs) / stats.sent;
+        if (jitterUs > TRANSMIT_LATE_THRESHOLD_US) stats.lateSends++;
+
+        // Deadlines that already passed are skipped rather than sent in a burst
+        current.deadline += current.period;
+        const auto now = Clock::now();
+        if (current.deadline <= now) {
+            auto behind = (now - current.deadline) / current.period + 1;
+            stats.skipped += behind;
+            current.deadline += behind * current.period;
+        }
+        m_pending.push({current.deadline, next.scheduleId});
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <napi.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A send that starts this much after its deadline counts as late
+#define TRANSMIT_LATE_THRESHOLD_US 1000
+
+struct TransmitScheduleStats {
+    uint64_t sent = 0;
+    uint64_t lateSends = 0;
+    // Deadlines that were dropped because the thread fell more than one period behind
+    uint64_t skipped = 0;
+    uint64_t failedSends = 0;
+    int32_t lastStatus = 0;
+    // How long after its deadline each frame was handed to the driver, in microseconds
+    uint64_t minJitterUs = 0;
+    uint64_t maxJitterUs = 0;
+    double meanJitterUs = 0;
+
+    Napi::Object ToObject(Napi::Env env) const;
+};
+
+// Sends periodic frames for one device from a single thread. Pending sends sit
+// in a min-heap keyed by deadline. Deadlines are multiples of the period plus
+// the phase, counted from when the scheduler started, so schedules with the
+// same period keep a fixed offset from each other no matter when they were added.
+//
+// The thread only runs while there is at least one schedule.
+class TransmitScheduler {
+public:
+    // Returns the status of the send, which is 0 on success
+    using SendFunction = std::function<int(uint32_t messageId, uint8_t* data, uint8_t dataSize)>;
+
+    explicit TransmitScheduler(SendFunction send);
+    ~TransmitScheduler();
+
+    void Add(uint32_t scheduleId, uint32_t messageId, const uint8_t* data, uint8_t dataSize, uint64_t periodUs, uint64_t phaseUs);
+    // Replaces the payload without moving the next deadline. Returns false if there is no such schedule.
+    bool Update(uint32_t scheduleId, const uint8_t* data, uint8_t dataSize);
+    // Returns true if no schedules are left
+    bool Remove(uint32_t scheduleId);
+    bool GetStats(uint32_t scheduleId, TransmitScheduleStats* stats);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Schedule {
+        uint32_t messageId;
+        uint8_t data[8];
+        uint8_t dataSize;
+        std::chrono::microseconds period;
+        Clock::time_point deadline;
+        TransmitScheduleStats stats;
+    };
+
+    struct PendingSend {
+        Clock::time_point deadline;
+        uint32_t scheduleId;
+        bool operator>(const PendingSend& other) const { return deadline > other.deadline; }
+    };
+
+    void Run();
+    void StopThread();
+
+    SendFunction m_send;
+    const Clock::time_point m_epoch = Clock::now();
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    // These values should only be accessed while holding m_mtx
+    std::map<uint32_t, Schedule> m_schedules;
+    // May hold entries for removed schedules, which are skipped when they come up
+    std::priority_queue<PendingSend, std::vector<PendingSend>, std::greater<PendingSend>> m_pending;
+    bool m_running = false;
+
+    std::thread m_thread;
+};
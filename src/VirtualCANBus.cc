@@ -0,0 +1,166 @@
+#include <algorithm>
+#include "VirtualCANBus.h"
+#include "VirtualCANDevice.h"
+
+namespace {
+// SOF, 29-bit arbitration field, control field, CRC, ACK, EOF and interframe space
+uint32_t frameBits(uint8_t dataSize) {
+    return 67 + 8 * (uint32_t)dataSize;
+}
+}
+
+VirtualCANBus::~VirtualCANBus() {
+    {
+        std::scoped_lock lock{m_mtx};
+        m_running = false;
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void VirtualCANBus::Attach(VirtualCANDevice* device) {
+    std::scoped_lock lock{m_mtx};
+    m_devices.insert(device);
+}
+
+void VirtualCANBus::Detach(VirtualCANDevice* device) {
+    std::scoped_lock lock{m_mtx};
+    m_devices.erase(device);
+    // Forget the device's frames so that a later device at the same address does not inherit them
+    for (auto pendingIterator = m_pending.begin(); pendingIterator != m_pending.end();) {
+        pendingIterator = pendingIterator->second.sender == device ? m_pending.erase(pendingIterator) : std::next(pendingIterator);
+    }
+    for (auto repeatedIterator = m_repeated.begin(); repeatedIterator != m_repeated.end();) {
+        repeatedIterator = repeatedIterator->first.first == device ? m_repeated.erase(repeatedIterator) : std::next(repeatedIterator);
+    }
+}
+
+VirtualBusOptions VirtualCANBus::GetOptions() {
+    std::scoped_lock lock{m_mtx};
+    return m_options;
+}
+
+void VirtualCANBus::SetOptions(const VirtualBusOptions& options) {
+    std::scoped_lock lock{m_mtx};
+    m_options = options;
+    m_options.dropRate = std::clamp(m_options.dropRate, 0.0, 1.0);
+}
+
+rev::usb::CANStatus VirtualCANBus::Transmit(VirtualCANDevice* sender, const VirtualBusFrame& frame) {
+    std::scoped_lock lock{m_mtx};
+    return TransmitLocked(sender, frame, Clock::now());
+}
+
+void VirtualCANBus::StartRepeating(VirtualCANDevice* sender, const VirtualBusFrame& frame, int periodMs) {
+    {
+        std::scoped_lock lock{m_mtx};
+        m_repeated[{sender, frame.messageId}] = RepeatedFrame{frame, std::chrono::milliseconds(periodMs), Clock::now()};
+        StartThreadLocked();
+    }
+    m_cv.notify_one();
+}
+
+void VirtualCANBus::StopRepeating(VirtualCANDevice* sender, uint32_t messageId) {
+    std::scoped_lock lock{m_mtx};
+    m_repeated.erase({sender, messageId});
+}
+
+float VirtualCANBus::GetUtilization() {
+    using namespace std::chrono;
+    std::scoped_lock lock{m_mtx};
+    const auto now = Clock::now();
+    const double elapsedSeconds = duration<double>(now - m_windowStart).count();
+    if (elapsedSeconds * 1e6 >= VIRTUAL_BUS_UTILIZATION_WINDOW_US) {
+        const double bitrate = m_options.bitrate > 0 ? m_options.bitrate : VIRTUAL_BUS_NOMINAL_BITRATE;
+        m_utilization = (float)std::min(100.0, 100.0 * m_windowBits / (bitrate * elapsedSeconds));
+        m_windowStart = now;
+        m_windowBits = 0;
+    }
+    return m_utilization;
+}
+
+uint32_t VirtualCANBus::GetDroppedFrames() {
+    std::scoped_lock lock{m_mtx};
+    return m_droppedFrames;
+}
+
+rev::usb::CANStatus VirtualCANBus::TransmitLocked(VirtualCANDevice* sender, const VirtualBusFrame& frame, Clock::time_point now) {
+    using namespace std::chrono;
+    const uint32_t bits = frameBits(frame.dataSize);
+
+    auto deliverAt = now;
+    if (m_options.bitrate > 0) {
+        const auto frameTime = duration_cast<Clock::duration>(duration<double>((double)bits / m_options.bitrate));
+        const auto start = std::max(now, m_busFreeAt);
+        if (start - now > frameTime * VIRTUAL_BUS_TX_QUEUE_SIZE) {
+            return rev::usb::CANStatus::kBufferOverrun;
+        }
+        m_busFreeAt = start + frameTime;
+        deliverAt = m_busFreeAt;
+    }
+    deliverAt += microseconds(m_options.latencyUs);
+    m_windowBits += bits;
+
+    // A lost frame still took up the bus
+    if (m_options.dropRate > 0 && m_dropDistribution(m_random) < m_options.dropRate) {
+        m_droppedFrames++;
+        return rev::usb::CANStatus::kOk;
+    }
+
+    if (deliverAt <= now) {
+        DeliverLocked(sender, frame);
+    } else {
+        m_pending.emplace(deliverAt, PendingFrame{sender, frame});
+        StartThreadLocked();
+        m_cv.notify_one();
+    }
+    return rev::usb::CANStatus::kOk;
+}
+
+void VirtualCANBus::DeliverLocked(VirtualCANDevice* sender, const VirtualBusFrame& frame) {
+    for (VirtualCANDevice* device : m_devices) {
+        if (device != sender) {
+            device->InjectFrame(frame.messageId, frame.data, frame.dataSize);
+        }
+    }
+}
+
+void VirtualCANBus::StartThreadLocked() {
+    if (m_running) return;
+    m_running = true;
+    m_thread = std::thread(&VirtualCANBus::Run, this);
+}
+
+void VirtualCANBus::Run() {
+    std::unique_lock lock{m_mtx};
+    while (m_running) {
+        const auto now = Clock::now();
+        while (!m_pending.empty() && m_pending.begin()->first <= now) {
+            DeliverLocked(m_pending.begin()->second.sender, m_pending.begin()->second.frame);
+            m_pending.erase(m_pending.begin());
+        }
+
+        auto wakeup = Clock::time_point::max();
+        for (auto& entry : m_repeated) {
+            RepeatedFrame& repeated = entry.second;
+            if (repeated.next <= now) {
+                TransmitLocked(entry.first.first, repeated.frame, now);
+                repeated.next += repeated.period;
+                // Skip the periods that were missed instead of sending a burst
+                if (repeated.next <= now) repeated.next = now + repeated.period;
+            }
+            wakeup = std::min(wakeup, repeated.next);
+        }
+        if (!m_pending.empty()) {
+            wakeup = std::min(wakeup, m_pending.begin()->first);
+        }
+
+        if (wakeup == Clock::time_point::max()) {
+            m_cv.wait(lock);
+        } else {
+            m_cv.wait_until(lock, wakeup);
+        }
+    }
+}
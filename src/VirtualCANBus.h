@@ -0,0 +1,104 @@
+#pragma once
+
+#include <rev/CANStatus.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <utility>
+
+class VirtualCANDevice;
+
+// Bitrate that bus utilization is measured against when a bus has no bitrate limit
+#define VIRTUAL_BUS_NOMINAL_BITRATE 1000000
+// How many frames can wait for a rate-limited bus before sends fail, like a full transmit FIFO
+#define VIRTUAL_BUS_TX_QUEUE_SIZE 128
+// Bus utilization is averaged over windows of this length
+#define VIRTUAL_BUS_UTILIZATION_WINDOW_US 100000
+
+struct VirtualBusOptions {
+    // Bits per second. 0 delivers frames as fast as they are sent.
+    uint32_t bitrate = 0;
+    // Added between the end of a frame's transmission and its delivery
+    uint32_t latencyUs = 0;
+    // Probability from 0 to 1 that a frame is lost
+    double dropRate = 0;
+};
+
+struct VirtualBusFrame {
+    uint32_t messageId;
+    uint8_t dataSize;
+    uint8_t data[8];
+};
+
+// Connects VirtualCANDevices: a frame sent by one device is received by every
+// other device attached to the same bus.
+//
+// Without a bitrate or latency, frames are delivered on the sending thread, so
+// throughput is bounded only by the receivers. Otherwise each frame occupies the
+// bus for its nominal bit time (an extended data frame without stuffing bits),
+// and the bus thread delivers it once its transmission and the latency are over.
+// Frames repeated with a period, like heartbeats, are always sent from the bus
+// thread. The thread is only started once something needs it.
+class VirtualCANBus {
+public:
+    ~VirtualCANBus();
+
+    void Attach(VirtualCANDevice* device);
+    // Once this returns, the bus never calls into the device again
+    void Detach(VirtualCANDevice* device);
+
+    VirtualBusOptions GetOptions();
+    void SetOptions(const VirtualBusOptions& options);
+
+    // Returns kBufferOverrun if the bus is too far behind to queue the frame
+    rev::usb::CANStatus Transmit(VirtualCANDevice* sender, const VirtualBusFrame& frame);
+    // Sends the frame now and then every periodMs. Replaces any repetition of the same ID by the sender.
+    void StartRepeating(VirtualCANDevice* sender, const VirtualBusFrame& frame, int periodMs);
+    void StopRepeating(VirtualCANDevice* sender, uint32_t messageId);
+
+    // Percentage of the last utilization window the bus was busy
+    float GetUtilization();
+    uint32_t GetDroppedFrames();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct PendingFrame {
+        VirtualCANDevice* sender;
+        VirtualBusFrame frame;
+    };
+
+    struct RepeatedFrame {
+        VirtualBusFrame frame;
+        Clock::duration period;
+        Clock::time_point next;
+    };
+
+    rev::usb::CANStatus TransmitLocked(VirtualCANDevice* sender, const VirtualBusFrame& frame, Clock::time_point now);
+    void DeliverLocked(VirtualCANDevice* sender, const VirtualBusFrame& frame);
+    void StartThreadLocked();
+    void Run();
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    // These values should only be accessed while holding m_mtx
+    VirtualBusOptions m_options;
+    std::set<VirtualCANDevice*> m_devices;
+    std::multimap<Clock::time_point, PendingFrame> m_pending;
+    std::map<std::pair<VirtualCANDevice*, uint32_t>, RepeatedFrame> m_repeated;
+    Clock::time_point m_busFreeAt;
+    Clock::time_point m_windowStart = Clock::now();
+    uint64_t m_windowBits = 0;
+    float m_utilization = 0;
+    uint32_t m_droppedFrames = 0;
+    std::mt19937 m_random{std::random_device{}()};
+    std::uniform_real_distribution<double> m_dropDistribution{0, 1};
+    bool m_running = false;
+
+    std::thread m_thread;
+};
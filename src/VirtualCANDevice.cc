@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "VirtualCANDevice.h"
+
+namespace {
+uint64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool matchesFilter(uint32_t messageId, const rev::usb::CANBridge_CANFilter& filter) {
+    return (messageId & filter.messageMask) == (filter.messageId & filter.messageMask);
+}
+}
+
+VirtualCANDevice::VirtualCANDevice(std::string descriptor, std::shared_ptr<VirtualCANBus> bus)
+    : m_descriptor(std::move(descriptor)), m_bus(std::move(bus)) {
+    m_bus->Attach(this);
+}
+
+VirtualCANDevice::~VirtualCANDevice() {
+    StopInjecting();
+    m_bus->Detach(this);
+}
+
+// Follows the driver: a period of -1 cancels a repeated frame, 0 sends once and cancels it too
+rev::usb::CANStatus VirtualCANDevice::SendCANMessage(const rev::usb::CANMessage& msg, int periodMs) {
+    if (periodMs <= 0) {
+        m_bus->StopRepeating(this, msg.GetMessageId());
+        if (periodMs < 0) return rev::usb::CANStatus::kOk;
+    }
+
+    VirtualBusFrame frame;
+    frame.messageId = msg.GetMessageId();
+    frame.dataSize = std::min<uint8_t>(msg.GetSize(), 8);
+    std::memset(frame.data, 0, sizeof(frame.data));
+    std::memcpy(frame.data, msg.GetData(), frame.dataSize);
+
+    if (periodMs > 0) {
+        m_bus->StartRepeating(this, frame, periodMs);
+        return rev::usb::CANStatus::kOk;
+    }
+    rev::usb::CANStatus status = m_bus->Transmit(this, frame);
+    if (status == rev::usb::CANStatus::kBufferOverrun) {
+        m_txFull++;
+    }
+    return status;
+}
+
+void VirtualCANDevice::stopRepeatedMessage(uint32_t messageId) {
+    m_bus->StopRepeating(this, messageId);
+}
+
+rev::usb::CANStatus VirtualCANDevice::ReceiveCANMessage(std::shared_ptr<rev::usb::CANMessage>& msg, uint32_t messageID, uint32_t messageMask) {
+    std::scoped_lock lock{m_mutex};
+    for (auto& entry : m_receivedMessages) {
+        if ((entry.first & messageMask) == (messageID & messageMask)) {
+            msg = entry.second;
+            return rev::usb::CANStatus::kOk;
+        }
+    }
+    return rev::usb::CANStatus::kTimeout;
+}
+
+rev::usb::CANStatus VirtualCANDevice::OpenStreamSession(uint32_t* sessionHandle, rev::usb::CANBridge_CANFilter filter, uint32_t maxSize) {
+    std::scoped_lock lock{m_mutex};
+    *sessionHandle = m_nextSessionHandle++;
+    m_sessions[*sessionHandle] = StreamSession{filter, std::max(maxSize, 1u), {}};
+    return rev::usb::CANStatus::kOk;
+}
+
+rev::usb::CANStatus VirtualCANDevice::CloseStreamSession(uint32_t sessionHandle) {
+    std::scoped_lock lock{m_mutex};
+    m_sessions.erase(sessionHandle);
+    return rev::usb::CANStatus::kOk;
+}
+
+rev::usb::CANStatus VirtualCANDevice::ReadStreamSession(uint32_t sessionHandle, HAL_CANStreamMessage* msgs, uint32_t messagesToRead, uint32_t* messagesRead) {
+    std::scoped_lock lock{m_mutex};
+    *messagesRead = 0;
+    auto sessionIterator = m_sessions.find(sessionHandle);
+    if (sessionIterator == m_sessions.end()) {
+        return rev::usb::CANStatus::kError;
+    }
+
+    auto& queue = sessionIterator->second.messages;
+    uint32_t count = std::min<uint32_t>(messagesToRead, queue.size());
+    std::copy_n(queue.begin(), count, msgs);
+    queue.erase(queue.begin(), queue.begin() + count);
+    *messagesRead = count;
+    return rev::usb::CANStatus::kOk;
+}
+
+rev::usb::CANStatus VirtualCANDevice::GetCANDetailStatus(float* percentBusUtilization, uint32_t* busOff, uint32_t* txFull, uint32_t* receiveErr, uint32_t* transmitErr) {
+    uint32_t lastErrorTime;
+    return GetCANDetailStatus(percentBusUtilization, busOff, txFull, receiveErr, transmitErr, &lastErrorTime);
+}
+
+rev::usb::CANStatus VirtualCANDevice::GetCANDetailStatus(float* percentBusUtilization, uint32_t* busOff, uint32_t* txFull, uint32_t* receiveErr, uint32_t* transmitErr, uint32_t* lastErrorTime) {
+    *percentBusUtilization = m_bus->GetUtilization();
+    *busOff = 0;
+    *txFull = m_txFull;
+    // Frames lost to the drop rate, counted for the whole bus
+    *receiveErr = m_bus->GetDroppedFrames();
+    *transmitErr = 0;
+    *lastErrorTime = 0;
+    return rev::usb::CANStatus::kOk;
+}
+
+bool VirtualCANDevice::CopyReceivedMessagesMap(std::map<uint32_t, std::shared_ptr<rev::usb::CANMessage>>& receivedMessagesMap) {
+    std::scoped_lock lock{m_mutex};
+    receivedMessagesMap = m_receivedMessages;
+    return true;
+}
+
+void VirtualCANDevice::InjectFrame(uint32_t messageId, const uint8_t* data, uint8_t dataSize) {
+    // Stream sessions only get the low 32 bits, like from a real device's counter
+    uint64_t timeStampUs = nowUs();
+    HAL_CANStreamMessage message;
+    message.messageID = messageId;
+    message.timeStamp = (uint32_t)timeStampUs;
+    message.dataSize = std::min<uint8_t>(dataSize, 8);
+    std::memset(message.data, 0, sizeof(message.data));
+    std::memcpy(message.data, data, message.dataSize);
+
+    std::scoped_lock lock{m_mutex};
+    for (auto& session : m_sessions) {
+        if (!matchesFilter(messageId, session.second.filter)) continue;
+        auto& queue = session.second.messages;
+        if (queue.size() >= session.second.maxSize) {
+            // Behave like the driver's circular buffer and drop the oldest frame
+            queue.pop_front();
+        }
+        queue.push_back(message);
+    }
+    m_receivedMessages[messageId] = std::make_shared<rev::usb::CANMessage>(messageId, message.data, message.dataSize, timeStampUs);
+}
+
+void VirtualCANDevice::SetInjectionRate(uint32_t messageId, double framesPerSecond) {
+    StopInjecting();
+    if (framesPerSecond <= 0) return;
+
+    std::scoped_lock lock{m_injectorMtx};
+    m_injecting = true;
+    m_injector = std::thread(&VirtualCANDevice::RunInjector, this, messageId, framesPerSecond);
+}
+
+void VirtualCANDevice::StopInjecting() {
+    {
+        std::scoped_lock lock{m_injectorMtx};
+        m_injecting = false;
+    }
+    m_injectorCv.notify_all();
+    if (m_injector.joinable()) {
+        m_injector.join();
+    }
+}
+
+void VirtualCANDevice::RunInjector(uint32_t messageId, double framesPerSecond) {
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    uint64_t injected = 0;
+
+    std::unique_lock lock{m_injectorMtx};
+    while (m_injecting) {
+        const uint64_t due = (uint64_t)(duration<double>(steady_clock::now() - start).count() * framesPerSecond);
+
+        lock.unlock();
+        for (; injected < due; injected++) {
+            uint8_t data[8];
+            for (int i = 0; i < 8; i++) {
+                data[i] = (uint8_t)(injected >> (8 * i));
+            }
+            InjectFrame(messageId, data, 8);
+        }
+        lock.lock();
+
+        // Sleep until the next frame is due, but never for more than a millisecond so that
+        // high rates are produced in small batches instead of one frame per wakeup
+        const auto nextFrame = start + duration_cast<steady_clock::duration>(duration<double>((injected + 1) / framesPerSecond));
+        const auto wakeup = std::min(nextFrame, steady_clock::now() + milliseconds(1));
+        m_injectorCv.wait_until(lock, wakeup, [this] { return !m_injecting; });
+    }
+}
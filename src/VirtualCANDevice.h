@@ -0,0 +1,81 @@
+#pragma once
+
+#include <rev/CANDevice.h>
+#include <rev/CANMessage.h>
+#include <rev/CANStatus.h>
+#include <rev/CANBridgeUtils.h>
+#include <hal/CAN.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "VirtualCANBus.h"
+
+#define VIRTUAL_DEVICE_DESCRIPTOR_PREFIX "virtual:"
+#define VIRTUAL_DEVICE_DRIVER_NAME "Virtual"
+
+// An in-process CANDevice with no hardware behind it. Frames sent through it
+// go to the other devices on its VirtualCANBus, and frames can also be produced
+// by an injector thread at a configurable rate. Either way they are delivered to
+// stream sessions, ReceiveCANMessage() and the received messages map exactly
+// like frames read off a real bus.
+class VirtualCANDevice : public rev::usb::CANDevice {
+public:
+    VirtualCANDevice(std::string descriptor, std::shared_ptr<VirtualCANBus> bus);
+    ~VirtualCANDevice() override;
+
+    std::string GetName() const override { return "Virtual CAN Device"; }
+    std::string GetDescriptor() const override { return m_descriptor; }
+    int GetId() const override { return 0; }
+    int GetNumberOfErrors() override { return 0; }
+
+    rev::usb::CANStatus SendCANMessage(const rev::usb::CANMessage& msg, int periodMs) override;
+    rev::usb::CANStatus ReceiveCANMessage(std::shared_ptr<rev::usb::CANMessage>& msg, uint32_t messageID, uint32_t messageMask) override;
+    rev::usb::CANStatus OpenStreamSession(uint32_t* sessionHandle, rev::usb::CANBridge_CANFilter filter, uint32_t maxSize) override;
+    rev::usb::CANStatus CloseStreamSession(uint32_t sessionHandle) override;
+    rev::usb::CANStatus ReadStreamSession(uint32_t sessionHandle, HAL_CANStreamMessage* msgs, uint32_t messagesToRead, uint32_t* messagesRead) override;
+    rev::usb::CANStatus GetCANDetailStatus(float* percentBusUtilization, uint32_t* busOff, uint32_t* txFull, uint32_t* receiveErr, uint32_t* transmitErr) override;
+    rev::usb::CANStatus GetCANDetailStatus(float* percentBusUtilization, uint32_t* busOff, uint32_t* txFull, uint32_t* receiveErr, uint32_t* transmitErr, uint32_t* lastErrorTime) override;
+    bool IsConnected() override { return true; }
+    void stopRepeatedMessage(uint32_t messageId) override;
+    bool CopyReceivedMessagesMap(std::map<uint32_t, std::shared_ptr<rev::usb::CANMessage>>& receivedMessagesMap) override;
+
+    // Delivers a frame as if it had just been received from the bus
+    void InjectFrame(uint32_t messageId, const uint8_t* data, uint8_t dataSize);
+
+    // Starts generating frames with the given arbitration ID at framesPerSecond.
+    // The payload is a little-endian frame counter. A rate of 0 stops injection.
+    void SetInjectionRate(uint32_t messageId, double framesPerSecond);
+
+    const std::shared_ptr<VirtualCANBus>& Bus() const { return m_bus; }
+
+private:
+    struct StreamSession {
+        rev::usb::CANBridge_CANFilter filter;
+        uint32_t maxSize;
+        std::deque<HAL_CANStreamMessage> messages;
+    };
+
+    void StopInjecting();
+    void RunInjector(uint32_t messageId, double framesPerSecond);
+
+    std::string m_descriptor;
+    std::shared_ptr<VirtualCANBus> m_bus;
+    std::atomic<uint32_t> m_txFull{0};
+
+    std::mutex m_mutex;
+    // These values should only be accessed while holding m_mutex
+    std::map<uint32_t, StreamSession> m_sessions;
+    std::map<uint32_t, std::shared_ptr<rev::usb::CANMessage>> m_receivedMessages;
+    uint32_t m_nextSessionHandle = 1;
+
+    std::mutex m_injectorMtx;
+    std::condition_variable m_injectorCv;
+    std::thread m_injector;
+    bool m_injecting = false;
+};
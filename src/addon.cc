@@ -1,57 +1,174 @@
 #include <napi.h>
 #include "canWrapper.h"
+#include "PerfCounters.h"
+#include "Tracer.h"
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    Tracer::SetThreadName("JavaScript");
     exports.Set(Napi::String::New(env, "getDevices"),
-                Napi::Function::New(env, getDevices));
+                countedFunction<getDevices>(env, "getDevices"));
+    exports.Set(Napi::String::New(env, "openDevice"),
+                countedFunction<openDevice>(env, "openDevice"));
+    exports.Set(Napi::String::New(env, "closeDevice"),
+                countedFunction<closeDevice>(env, "closeDevice"));
     exports.Set(Napi::String::New(env, "registerDeviceToHAL"),
-                Napi::Function::New(env, registerDeviceToHAL));
+                countedFunction<registerDeviceToHAL>(env, "registerDeviceToHAL"));
     exports.Set(Napi::String::New(env, "unregisterDeviceFromHAL"),
-                Napi::Function::New(env, unregisterDeviceFromHAL));
+                countedFunction<unregisterDeviceFromHAL>(env, "unregisterDeviceFromHAL"));
     exports.Set(Napi::String::New(env, "receiveMessage"),
-                Napi::Function::New(env, receiveMessage));
+                countedFunction<receiveMessage>(env, "receiveMessage"));
     exports.Set(Napi::String::New(env, "openStreamSession"),
-                Napi::Function::New(env, openStreamSession));
+                countedFunction<openStreamSession>(env, "openStreamSession"));
     exports.Set(Napi::String::New(env, "readStreamSession"),
-                Napi::Function::New(env, readStreamSession));
+                countedFunction<readStreamSession>(env, "readStreamSession"));
+    exports.Set(Napi::String::New(env, "readStreamSessionPacked"),
+                countedFunction<readStreamSessionPacked>(env, "readStreamSessionPacked"));
     exports.Set(Napi::String::New(env, "closeStreamSession"),
-                Napi::Function::New(env, closeStreamSession));
+                countedFunction<closeStreamSession>(env, "closeStreamSession"));
     exports.Set(Napi::String::New(env, "getCANDetailStatus"),
-                Napi::Function::New(env, getCANDetailStatus));
+                countedFunction<getCANDetailStatus>(env, "getCANDetailStatus"));
     exports.Set(Napi::String::New(env, "sendCANMessage"),
-                Napi::Function::New(env, sendCANMessage));
+                countedFunction<sendCANMessage>(env, "sendCANMessage"));
+    exports.Set(Napi::String::New(env, "sendCANMessages"),
+                countedFunction<sendCANMessages>(env, "sendCANMessages"));
     exports.Set(Napi::String::New(env, "sendRtrMessage"),
-        Napi::Function::New(env, sendRtrMessage));
+        countedFunction<sendRtrMessage>(env, "sendRtrMessage"));
     exports.Set(Napi::String::New(env, "sendHALMessage"),
-                Napi::Function::New(env, sendHALMessage));
+                countedFunction<sendHALMessage>(env, "sendHALMessage"));
+    exports.Set(Napi::String::New(env, "addPeriodicFrame"),
+                countedFunction<addPeriodicFrame>(env, "addPeriodicFrame"));
+    exports.Set(Napi::String::New(env, "updatePeriodicFrame"),
+                countedFunction<updatePeriodicFrame>(env, "updatePeriodicFrame"));
+    exports.Set(Napi::String::New(env, "getPeriodicFrameStats"),
+                countedFunction<getPeriodicFrameStats>(env, "getPeriodicFrameStats"));
+    exports.Set(Napi::String::New(env, "removePeriodicFrame"),
+                countedFunction<removePeriodicFrame>(env, "removePeriodicFrame"));
     exports.Set(Napi::String::New(env, "initializeNotifier"),
-                Napi::Function::New(env, initializeNotifier));
+                countedFunction<initializeNotifier>(env, "initializeNotifier"));
     exports.Set(Napi::String::New(env, "waitForNotifierAlarm"),
-                Napi::Function::New(env, waitForNotifierAlarm));
+                countedFunction<waitForNotifierAlarm>(env, "waitForNotifierAlarm"));
     exports.Set(Napi::String::New(env, "stopNotifier"),
-                Napi::Function::New(env, stopNotifier));
+                countedFunction<stopNotifier>(env, "stopNotifier"));
+    exports.Set(Napi::String::New(env, "getFPGATime"),
+                countedFunction<getFPGATime>(env, "getFPGATime"));
+    exports.Set(Napi::String::New(env, "createNotifier"),
+                countedFunction<createNotifier>(env, "createNotifier"));
+    exports.Set(Napi::String::New(env, "updateNotifierAlarm"),
+                countedFunction<updateNotifierAlarm>(env, "updateNotifierAlarm"));
+    exports.Set(Napi::String::New(env, "cancelNotifierAlarm"),
+                countedFunction<cancelNotifierAlarm>(env, "cancelNotifierAlarm"));
+    exports.Set(Napi::String::New(env, "waitForNotifier"),
+                countedFunction<waitForNotifier>(env, "waitForNotifier"));
+    exports.Set(Napi::String::New(env, "cleanNotifier"),
+                countedFunction<cleanNotifier>(env, "cleanNotifier"));
+    exports.Set(Napi::String::New(env, "getNotifierStats"),
+                countedFunction<getNotifierStats>(env, "getNotifierStats"));
+    exports.Set(Napi::String::New(env, "startPeriodicNotifier"),
+                countedFunction<startPeriodicNotifier>(env, "startPeriodicNotifier"));
+    exports.Set(Napi::String::New(env, "getPeriodicNotifierStats"),
+                countedFunction<getPeriodicNotifierStats>(env, "getPeriodicNotifierStats"));
+    exports.Set(Napi::String::New(env, "stopPeriodicNotifier"),
+                countedFunction<stopPeriodicNotifier>(env, "stopPeriodicNotifier"));
     exports.Set(Napi::String::New(env, "writeDfuToBin"),
-    Napi::Function::New(env, writeDfuToBin));
+    countedFunction<writeDfuToBin>(env, "writeDfuToBin"));
+    exports.Set(Napi::String::New(env, "extractDfuElements"),
+                countedFunction<extractDfuElements>(env, "extractDfuElements"));
     exports.Set(Napi::String::New(env, "getImageElements"),
-                Napi::Function::New(env, getImageElements));
+                countedFunction<getImageElements>(env, "getImageElements"));
+    exports.Set(Napi::String::New(env, "verifyDfu"),
+                countedFunction<verifyDfu>(env, "verifyDfu"));
     exports.Set(Napi::String::New(env, "openHALStreamSession"),
-                Napi::Function::New(env, openHALStreamSession));
+                countedFunction<openHALStreamSession>(env, "openHALStreamSession"));
     exports.Set(Napi::String::New(env, "readHALStreamSession"),
-                Napi::Function::New(env, readHALStreamSession));
+                countedFunction<readHALStreamSession>(env, "readHALStreamSession"));
+    exports.Set(Napi::String::New(env, "readHALStreamSessionPacked"),
+                countedFunction<readHALStreamSessionPacked>(env, "readHALStreamSessionPacked"));
     exports.Set(Napi::String::New(env, "closeHALStreamSession"),
-                Napi::Function::New(env, closeHALStreamSession));
+                countedFunction<closeHALStreamSession>(env, "closeHALStreamSession"));
     exports.Set(Napi::String::New(env, "setThreadPriority"),
-                Napi::Function::New(env, setThreadPriority));
+                countedFunction<setThreadPriority>(env, "setThreadPriority"));
     exports.Set(Napi::String::New(env, "setSparkMaxHeartbeatData"),
-                Napi::Function::New(env, setSparkMaxHeartbeatData));
+                countedFunction<setSparkMaxHeartbeatData>(env, "setSparkMaxHeartbeatData"));
     exports.Set(Napi::String::New(env, "startRevCommonHeartbeat"),
-                Napi::Function::New(env, startRevCommonHeartbeat));
+                countedFunction<startRevCommonHeartbeat>(env, "startRevCommonHeartbeat"));
     exports.Set(Napi::String::New(env, "stopHeartbeats"),
-                Napi::Function::New(env, stopHeartbeats));
+                countedFunction<stopHeartbeats>(env, "stopHeartbeats"));
     exports.Set(Napi::String::New(env, "ackHeartbeats"),
-                Napi::Function::New(env, ackHeartbeats));
+                countedFunction<ackHeartbeats>(env, "ackHeartbeats"));
+    exports.Set(Napi::String::New(env, "setHeartbeatTimeout"),
+                countedFunction<setHeartbeatTimeout>(env, "setHeartbeatTimeout"));
+    exports.Set(Napi::String::New(env, "getHeartbeatWatchdogStats"),
+                countedFunction<getHeartbeatWatchdogStats>(env, "getHeartbeatWatchdogStats"));
     exports.Set(Napi::String::New(env, "getLatestMessageOfEveryReceivedArbId"),
-                Napi::Function::New(env, getLatestMessageOfEveryReceivedArbId));
+                countedFunction<getLatestMessageOfEveryReceivedArbId>(env, "getLatestMessageOfEveryReceivedArbId"));
+    exports.Set(Napi::String::New(env, "getLatestMessagesSince"),
+                countedFunction<getLatestMessagesSince>(env, "getLatestMessagesSince"));
+    exports.Set(Napi::String::New(env, "releaseReceiveTap"),
+                countedFunction<releaseReceiveTap>(env, "releaseReceiveTap"));
+    exports.Set(Napi::String::New(env, "readLatestMessagesPacked"),
+                countedFunction<readLatestMessagesPacked>(env, "readLatestMessagesPacked"));
+    exports.Set(Napi::String::New(env, "subscribe"),
+                countedFunction<subscribe>(env, "subscribe"));
+    exports.Set(Napi::String::New(env, "unsubscribe"),
+                countedFunction<unsubscribe>(env, "unsubscribe"));
+    exports.Set(Napi::String::New(env, "registerSignals"),
+                countedFunction<registerSignals>(env, "registerSignals"));
+    exports.Set(Napi::String::New(env, "updateSignals"),
+                countedFunction<updateSignals>(env, "updateSignals"));
+    exports.Set(Napi::String::New(env, "unregisterSignals"),
+                countedFunction<unregisterSignals>(env, "unregisterSignals"));
+    exports.Set(Napi::String::New(env, "getTrafficStats"),
+                countedFunction<getTrafficStats>(env, "getTrafficStats"));
+    exports.Set(Napi::String::New(env, "resetTrafficStats"),
+                countedFunction<resetTrafficStats>(env, "resetTrafficStats"));
+    exports.Set(Napi::String::New(env, "getDeviceClock"),
+                countedFunction<getDeviceClock>(env, "getDeviceClock"));
+    exports.Set(Napi::String::New(env, "startCapture"),
+                countedFunction<startCapture>(env, "startCapture"));
+    exports.Set(Napi::String::New(env, "stopCapture"),
+                countedFunction<stopCapture>(env, "stopCapture"));
+    exports.Set(Napi::String::New(env, "freezeCapture"),
+                countedFunction<freezeCapture>(env, "freezeCapture"));
+    exports.Set(Napi::String::New(env, "getCaptureStats"),
+                countedFunction<getCaptureStats>(env, "getCaptureStats"));
+    exports.Set(Napi::String::New(env, "snapshotCapture"),
+                countedFunction<snapshotCapture>(env, "snapshotCapture"));
+    exports.Set(Napi::String::New(env, "openCaptureFile"),
+                countedFunction<openCaptureFile>(env, "openCaptureFile"));
+    exports.Set(Napi::String::New(env, "readCaptureRecords"),
+                countedFunction<readCaptureRecords>(env, "readCaptureRecords"));
+    exports.Set(Napi::String::New(env, "findCaptureRecord"),
+                countedFunction<findCaptureRecord>(env, "findCaptureRecord"));
+    exports.Set(Napi::String::New(env, "closeCaptureFile"),
+                countedFunction<closeCaptureFile>(env, "closeCaptureFile"));
+    exports.Set(Napi::String::New(env, "startReplay"),
+                countedFunction<startReplay>(env, "startReplay"));
+    exports.Set(Napi::String::New(env, "waitForReplay"),
+                countedFunction<waitForReplay>(env, "waitForReplay"));
+    exports.Set(Napi::String::New(env, "getReplayStats"),
+                countedFunction<getReplayStats>(env, "getReplayStats"));
+    exports.Set(Napi::String::New(env, "stopReplay"),
+                countedFunction<stopReplay>(env, "stopReplay"));
+    exports.Set(Napi::String::New(env, "transact"),
+                countedFunction<transact>(env, "transact"));
+    exports.Set(Napi::String::New(env, "getPerfCounters"),
+                countedFunction<getPerfCounters>(env, "getPerfCounters"));
+    exports.Set(Napi::String::New(env, "resetPerfCounters"),
+                countedFunction<resetPerfCounters>(env, "resetPerfCounters"));
+    exports.Set(Napi::String::New(env, "startTrace"),
+                countedFunction<startTrace>(env, "startTrace"));
+    exports.Set(Napi::String::New(env, "stopTrace"),
+                countedFunction<stopTrace>(env, "stopTrace"));
+    exports.Set(Napi::String::New(env, "writeTrace"),
+                countedFunction<writeTrace>(env, "writeTrace"));
+    exports.Set(Napi::String::New(env, "createVirtualDevice"),
+                countedFunction<createVirtualDevice>(env, "createVirtualDevice"));
+    exports.Set(Napi::String::New(env, "setVirtualBusOptions"),
+                countedFunction<setVirtualBusOptions>(env, "setVirtualBusOptions"));
+    exports.Set(Napi::String::New(env, "setVirtualDeviceInjection"),
+                countedFunction<setVirtualDeviceInjection>(env, "setVirtualDeviceInjection"));
+    exports.Set(Napi::String::New(env, "destroyVirtualDevice"),
+                countedFunction<destroyVirtualDevice>(env, "destroyVirtualDevice"));
     return exports;
 }
 
@@ -10,6 +10,7 @@
 #include <hal/CAN.h>
 #include <napi.h>
 #include <thread>
+#include <algorithm>
 #include <chrono>
 #include <map>
 #include <array>
@@ -18,12 +19,48 @@
 #include <exception>
 #include <mutex>
 #include <ctime>
+#include <cstring>
 #include "canWrapper.h"
+#include "ArbIdDecode.h"
+#include "CaptureLogger.h"
+#include "CaptureReader.h"
+#include "DeviceClock.h"
+#include "DeviceRegistry.h"
+#include "FrameFilter.h"
+#include "HeartbeatWatchdog.h"
 #include "DfuSeFile.h"
-
-#define REV_COMMON_HEARTBEAT_ID 0x00502C0
-#define SPARK_HEARTBEAT_ID 0x2052C80
+#include "NotifierScheduler.h"
+#include "PackedFrames.h"
+#include "PerfCounters.h"
+#include "PeriodicNotifier.h"
+#include "ReceiveTap.h"
+#include "ReplayEngine.h"
+#include "SignalDecoder.h"
+#include "StreamSubscription.h"
+#include "Tracer.h"
+#include "TransactionEngine.h"
+#include "TransmitScheduler.h"
+#include "VirtualCANDevice.h"
+
+#define REV_COMMON_HEARTBEAT_ID FRC_ARB_ID(FRC_DEVICE_TYPE_BROADCAST, FRC_MANUFACTURER_REV, 0, 11, 0) // 0x00502C0
+#define SPARK_HEARTBEAT_ID FRC_ARB_ID(FRC_DEVICE_TYPE_MOTOR_CONTROLLER, FRC_MANUFACTURER_REV, 11, 2, 0) // 0x2052C80
 #define HEARTBEAT_PERIOD_MS 20
+#define HEARTBEAT_DEFAULT_TIMEOUT_MS 1000
+
+#define SUBSCRIPTION_DEFAULT_MAX_BATCH_SIZE 64
+#define SUBSCRIPTION_DEFAULT_MAX_LATENCY_MS 10
+#define SUBSCRIPTION_DEFAULT_SESSION_SIZE 1024
+
+#define RECEIVE_TAP_SESSION_SIZE 4096
+
+#define CAPTURE_DEFAULT_MAX_RECORDS (1 << 20)
+
+#define TRANSACTION_DEFAULT_WINDOW 8
+#define TRANSACTION_DEFAULT_TIMEOUT_MS 100
+// Largest timeout whose microseconds fit TransactionRequest::timeoutUs
+#define TRANSACTION_MAX_TIMEOUT_MS 4294967
+#define TRANSACTION_DEFAULT_RETRIES 2
+#define TRANSACTION_SESSION_SIZE 1024
 
 #define SPARK_HEARTBEAT_LENGTH 8
 #define REV_COMMON_HEARTBEAT_LENGTH 1
@@ -32,21 +69,88 @@ uint8_t disabledRevCommonHeartbeat[] = {0};
 
 rev::usb::CandleWinUSBDriver* driver = new rev::usb::CandleWinUSBDriver();
 
-std::set<std::string> devicesRegisteredToHal; // TODO(Noah): Protect with mutex
 bool halInitialized = false;
 uint32_t m_notifier;
 
-std::mutex canDevicesMtx;
-// These values should only be accessed while holding canDevicesMtx
-std::map<std::string, std::shared_ptr<rev::usb::CANDevice>> canDeviceMap;
+DeviceRegistry deviceRegistry;
+// Serializes device scans. Never taken by the I/O paths.
+std::mutex scanMtx;
+
+// Arbitration IDs the driver (or the HAL) repeats, by descriptor. Sending an ID once also cancels its
+// repeat in the driver, so the native threads that send frames once skip these, see sendMessageOnce().
+std::mutex driverRepeatsMtx;
+// Should only be accessed while holding driverRepeatsMtx
+std::set<std::pair<std::string, uint32_t>> driverRepeats;
 
 std::mutex watchdogMtx;
 // These values should only be accessed while holding watchdogMtx
 std::vector<std::string> heartbeatsRunning;
-bool heartbeatTimeoutExpired = true; // Should only be changed in heartbeatsWatchdog()
+bool heartbeatTimeoutExpired = true; // Should only be changed in heartbeatWatchdogTransition() and stopIdleHeartbeatWatchdog()
 std::map<std::string, std::array<uint8_t, REV_COMMON_HEARTBEAT_LENGTH>> revCommonHeartbeatMap;
 std::map<std::string, std::array<uint8_t, SPARK_HEARTBEAT_LENGTH>> sparkHeartbeatMap;
-auto latestHeartbeatAck = std::chrono::time_point<std::chrono::steady_clock>();
+
+void heartbeatWatchdogTransition(bool expired);
+void stopIdleHeartbeatWatchdog();
+bool stopReceiveTap(const std::string& descriptor);
+// Runs while any heartbeat is running. Only started and stopped from the JS thread.
+HeartbeatWatchdog heartbeatWatchdog(std::chrono::milliseconds(HEARTBEAT_DEFAULT_TIMEOUT_MS), heartbeatWatchdogTransition);
+
+// These values should only be accessed from the JS thread
+std::map<uint32_t, StreamSubscription*> streamSubscriptions;
+uint32_t nextStreamSubscriptionHandle = 1;
+// Filter lists of the stream sessions opened with one, by descriptor and session handle
+std::map<std::pair<std::string, uint32_t>, std::shared_ptr<const FrameFilter>> filteredStreamSessions;
+
+struct SignalDecoderEntry {
+    std::string descriptor;
+    std::unique_ptr<SignalDecoder> decoder;
+    // The Float64Array the values are decoded into
+    Napi::Reference<Napi::Float64Array> values;
+    // How far updateSignals() has read the device's latest-value cache
+    uint64_t cacheSequence = 0;
+};
+std::map<uint32_t, SignalDecoderEntry> signalDecoders;
+uint32_t nextSignalDecoderHandle = 1;
+std::map<uint32_t, PeriodicNotifier*> periodicNotifiers;
+uint32_t nextPeriodicNotifierHandle = 1;
+NotifierScheduler* notifierScheduler = nullptr;
+std::map<std::string, std::unique_ptr<TransmitScheduler>> transmitSchedulers;
+std::map<uint32_t, std::string> transmitScheduleDevices;
+uint32_t nextTransmitScheduleHandle = 1;
+
+struct ReceiveTapEntry {
+    // The device the tap reads from, to notice when a rescan replaced it. Empty for the HAL.
+    std::weak_ptr<rev::usb::CANDevice> device;
+    std::unique_ptr<ReceiveTap> tap;
+};
+std::map<std::string, ReceiveTapEntry> receiveTaps;
+// Clocks of the devices by descriptor, and the one of every frame read through the HAL. The
+// map should only be accessed from the JS thread, the clocks themselves from any thread.
+std::map<std::string, std::shared_ptr<DeviceClock>> deviceClocks;
+std::shared_ptr<DeviceClock> halClock = std::make_shared<DeviceClock>();
+std::vector<LatestValueCache::Entry> latestValueScratch;
+std::vector<TrafficStats::Entry> trafficStatsScratch;
+#ifdef CANBRIDGE_PERF_COUNTERS
+std::vector<PerfBindingStats> perfStatsScratch;
+#endif
+std::map<uint32_t, std::unique_ptr<CaptureReader>> captureReaders;
+uint32_t nextCaptureReaderHandle = 1;
+
+// Removed once the replay has finished and its final statistics were handed to waitForReplay(), or it was stopped
+struct ReplayEntry {
+    // Null once the replay has finished
+    ReplayEngine* engine = nullptr;
+    ReplayStats finalStats;
+    std::vector<Napi::Promise::Deferred> waiters;
+    bool stopped = false;
+};
+std::map<uint32_t, ReplayEntry> replays;
+uint32_t nextReplayHandle = 1;
+uint32_t nextVirtualDeviceId = 0;
+// Buses that virtual devices joined by number. Private buses are not listed.
+std::map<uint32_t, std::weak_ptr<VirtualCANBus>> virtualBuses;
+// Reused by the packed read functions so that reading does not allocate
+std::vector<HAL_CANStreamMessage> packedReadScratch;
 
 void throwDeviceNotFoundError(Napi::Env env) {
     Napi::Error error = Napi::Error::New(env, "CAN bridge device not found. Make sure to run getDevices()");
@@ -54,34 +158,64 @@ void throwDeviceNotFoundError(Napi::Env env) {
     error.ThrowAsJavaScriptException();
 }
 
-// Only call when holding canDevicesMtx
-void removeExtraDevicesFromDeviceMap(std::vector<std::string> descriptors) {
-    for (auto itr = canDeviceMap.begin(); itr != canDeviceMap.end(); ++itr) {
-        bool inDevices = false;
-        for(auto descriptor = descriptors.begin(); descriptor != descriptors.end(); ++descriptor) {
-            if (*descriptor == itr->first){
-                inDevices = true;
-                break;
-            }
-        }
-        if (!inDevices) {
-            canDeviceMap.erase(itr->first);
+// Looks up a device by descriptor. Returns nullptr if it is not in the registry.
+std::shared_ptr<rev::usb::CANDevice> findDevice(const std::string& descriptor) {
+    return deviceRegistry.Find(descriptor);
+}
+
+// Resolves the device parameter of a binding, which is either a descriptor or a handle from
+// openDevice(), and sets descriptor to the device's descriptor either way, so state kept by
+// descriptor is the same for both. Returns nullptr if the device is not in the registry, in
+// which case the caller can check whether descriptor is registered to the HAL.
+std::shared_ptr<rev::usb::CANDevice> findDevice(const Napi::Value& deviceParam, std::string& descriptor) {
+    if (deviceParam.IsNumber()) {
+        return deviceRegistry.FindByHandle(deviceParam.As<Napi::Number>().Uint32Value(), &descriptor);
+    }
+    descriptor = deviceParam.As<Napi::String>().Utf8Value();
+    return findDevice(descriptor);
+}
+
+bool isVirtualDescriptor(const std::string& descriptor) {
+    return descriptor.rfind(VIRTUAL_DEVICE_DESCRIPTOR_PREFIX, 0) == 0;
+}
+
+std::shared_ptr<DeviceClock> deviceClock(const std::string& descriptor) {
+    std::shared_ptr<DeviceClock>& clock = deviceClocks[descriptor];
+    if (!clock) clock = std::make_shared<DeviceClock>();
+    return clock;
+}
+
+// The clock that extends the timestamps of the frames read from device, or through the HAL if device is null
+std::shared_ptr<DeviceClock> clockFor(const std::shared_ptr<rev::usb::CANDevice>& device, const std::string& descriptor) {
+    return device ? deviceClock(descriptor) : halClock;
+}
+
+Napi::Array streamMessagesToArray(Napi::Env env, const HAL_CANStreamMessage* messages, uint32_t count, const DeviceClock& clock) {
+    PERF_PHASE(kConvert);
+    Napi::Array messageArray = Napi::Array::New(env, count);
+    for (uint32_t i = 0; i < count; i++) {
+        Napi::HandleScope scope(env);
+        Napi::Object message = Napi::Object::New(env);
+        message.Set("messageID", messages[i].messageID);
+        message.Set("timeStamp", Napi::Number::New(env, clock.Extend(messages[i].timeStamp)));
+
+        int messageLength = std::min((int)messages[i].dataSize, 8);
+        Napi::Array data = Napi::Array::New(env, messageLength);
+        for (int m = 0; m < messageLength; m++) {
+            data[m] = Napi::Number::New(env, messages[i].data[m]);
         }
+        message.Set("data", data);
+        messageArray[i] = message;
     }
+    return messageArray;
 }
 
-// Only call when holding canDevicesMtx
-bool addDeviceToMap(std::string descriptor) {
+std::shared_ptr<rev::usb::CANDevice> createDevice(std::string descriptor) {
     char* descriptor_chars = &descriptor[0];
     try {
-        std::unique_ptr<rev::usb::CANDevice> canDevice = driver->CreateDeviceFromDescriptor(descriptor_chars);
-        if (canDevice != nullptr) {
-            canDeviceMap[descriptor] = std::move(canDevice);
-            return true;
-        }
-        return false;
+        return driver->CreateDeviceFromDescriptor(descriptor_chars);
     } catch (...) {
-        return false;
+        return nullptr;
     }
 }
 
@@ -93,27 +227,35 @@ class GetDevicesWorker : public Napi::AsyncWorker {
         ~GetDevicesWorker() {}
 
     void Execute() override {
-        std::scoped_lock lock{canDevicesMtx};
-
-        CANHandle = CANBridge_Scan();
+        TRACE_SCOPE("GetDevicesWorker::Execute");
+        // Only other scans wait here. The new set of devices is built without holding any lock
+        // that the I/O paths take, and is swapped into the registry in one step at the end.
+        std::scoped_lock lock{scanMtx};
+
+        {
+            TRACE_SCOPE("CANBridge_Scan");
+            CANHandle = CANBridge_Scan();
+        }
         numDevices = CANBridge_NumDevices(CANHandle);
-        std::vector<std::string> descriptors;
+        DeviceRegistry::DeviceMap scannedDevices;
         for (int i = 0; i < numDevices; i++) {
             std::string descriptor = CANBridge_GetDeviceDescriptor(CANHandle, i);
 
-            if (canDeviceMap.find(descriptor) == canDeviceMap.end()) {
-                if (addDeviceToMap(descriptor)) {
-                    descriptors.push_back(descriptor);
-                    isDeviceAvailable.push_back(true);
-                } else  {
-                    isDeviceAvailable.push_back(false);
-                }
-            } else {
-                descriptors.push_back(descriptor);
-                isDeviceAvailable.push_back(true);
+            std::shared_ptr<rev::usb::CANDevice> device = deviceRegistry.Find(descriptor);
+            if (!device) {
+                device = createDevice(descriptor);
+            }
+            if (device) {
+                scannedDevices[descriptor] = device;
             }
+            isDeviceAvailable.push_back(device != nullptr);
+        }
+
+        // Virtual devices never show up in a scan, they live until destroyVirtualDevice()
+        deviceRegistry.ReplaceScannedDevices(std::move(scannedDevices), isVirtualDescriptor);
+        for (const std::string& descriptor : deviceRegistry.Descriptors()) {
+            if (isVirtualDescriptor(descriptor)) virtualDescriptors.push_back(descriptor);
         }
-        removeExtraDevicesFromDeviceMap(descriptors);
     }
 
     void OnOK() override {
@@ -132,8 +274,18 @@ class GetDevicesWorker : public Napi::AsyncWorker {
 
             devices[i] = deviceInfo;
         }
+        for (const std::string& descriptor : virtualDescriptors) {
+            Napi::Object deviceInfo = Napi::Object::New(Env());
+            deviceInfo.Set("descriptor", descriptor);
+            deviceInfo.Set("name", "Virtual CAN Device");
+            deviceInfo.Set("driverName", VIRTUAL_DEVICE_DRIVER_NAME);
+            deviceInfo.Set("available", Napi::Boolean::New(Env(), true));
+
+            devices[devices.Length()] = deviceInfo;
+        }
 
         CANBridge_FreeScan(CANHandle);
+        stopIdleHeartbeatWatchdog();
         Callback().Call({Env().Null(), devices});
     }
 
@@ -141,6 +293,7 @@ class GetDevicesWorker : public Napi::AsyncWorker {
         c_CANBridge_ScanHandle CANHandle;
         int numDevices;
         std::vector<bool> isDeviceAvailable;
+        std::vector<std::string> virtualDescriptors;
 };
 
 // Params: none
@@ -155,6 +308,135 @@ void getDevices(const Napi::CallbackInfo& info) {
 }
 
 
+// Updates the fields of options that are set in optionsParam
+void readVirtualBusOptions(const Napi::Object& optionsParam, VirtualBusOptions& options) {
+    if (optionsParam.Get("bitrate").IsNumber()) options.bitrate = optionsParam.Get("bitrate").As<Napi::Number>().Uint32Value();
+    if (optionsParam.Get("latencyUs").IsNumber()) options.latencyUs = optionsParam.Get("latencyUs").As<Napi::Number>().Uint32Value();
+    if (optionsParam.Get("dropRate").IsNumber()) options.dropRate = optionsParam.Get("dropRate").As<Napi::Number>().DoubleValue();
+}
+
+// Devices created with the same bus number receive each other's frames. Without one, the
+// device gets a bus of its own.
+// Params:
+//   options: Object{bus?:Number, bitrate?:Number, latencyUs?:Number, dropRate?:Number} (optional)
+// Returns:
+//   descriptor: String
+Napi::String createVirtualDevice(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string descriptor = VIRTUAL_DEVICE_DESCRIPTOR_PREFIX + std::to_string(nextVirtualDeviceId++);
+
+    std::shared_ptr<VirtualCANBus> bus;
+    if (info[0].IsObject() && info[0].As<Napi::Object>().Get("bus").IsNumber()) {
+        uint32_t busNumber = info[0].As<Napi::Object>().Get("bus").As<Napi::Number>().Uint32Value();
+        bus = virtualBuses[busNumber].lock();
+        if (!bus) {
+            bus = std::make_shared<VirtualCANBus>();
+            virtualBuses[busNumber] = bus;
+        }
+    } else {
+        bus = std::make_shared<VirtualCANBus>();
+    }
+    if (info[0].IsObject()) {
+        VirtualBusOptions options = bus->GetOptions();
+        readVirtualBusOptions(info[0].As<Napi::Object>(), options);
+        bus->SetOptions(options);
+    }
+
+    deviceRegistry.Add(descriptor, std::make_shared<VirtualCANDevice>(descriptor, bus));
+    return Napi::String::New(env, descriptor);
+}
+
+// Changes the bus of a virtual device, and so every device on it
+// Params:
+//   descriptor: String
+//   options: Object{bitrate?:Number, latencyUs?:Number, dropRate?:Number}
+void setVirtualBusOptions(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
+
+    std::shared_ptr<VirtualCANDevice> device = std::dynamic_pointer_cast<VirtualCANDevice>(findDevice(descriptor));
+    if (!device) {
+        throwDeviceNotFoundError(env);
+        return;
+    }
+    VirtualBusOptions options = device->Bus()->GetOptions();
+    readVirtualBusOptions(info[1].As<Napi::Object>(), options);
+    device->Bus()->SetOptions(options);
+}
+
+// Params:
+//   descriptor: String
+//   messageId: Number
+//   framesPerSecond: Number (0 stops injection)
+void setVirtualDeviceInjection(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
+    uint32_t messageId = info[1].As<Napi::Number>().Uint32Value();
+    double framesPerSecond = info[2].As<Napi::Number>().DoubleValue();
+
+    std::shared_ptr<VirtualCANDevice> device = std::dynamic_pointer_cast<VirtualCANDevice>(findDevice(descriptor));
+
+    if (!device) {
+        throwDeviceNotFoundError(env);
+        return;
+    }
+    device->SetInjectionRate(messageId, framesPerSecond);
+}
+
+// Params:
+//   descriptor: String
+void destroyVirtualDevice(const Napi::CallbackInfo& info) {
+    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
+    if (!isVirtualDescriptor(descriptor)) return;
+
+    receiveTaps.erase(descriptor);
+    deviceClocks.erase(descriptor);
+    {
+        std::scoped_lock lock{driverRepeatsMtx};
+        for (auto repeatIterator = driverRepeats.begin(); repeatIterator != driverRepeats.end();) {
+            repeatIterator = repeatIterator->first == descriptor ? driverRepeats.erase(repeatIterator) : std::next(repeatIterator);
+        }
+    }
+    deviceRegistry.Remove(descriptor);
+    for (auto decoderIterator = signalDecoders.begin(); decoderIterator != signalDecoders.end();) {
+        decoderIterator = decoderIterator->second.descriptor == descriptor ? signalDecoders.erase(decoderIterator) : std::next(decoderIterator);
+    }
+    for (auto sessionIterator = filteredStreamSessions.begin(); sessionIterator != filteredStreamSessions.end();) {
+        sessionIterator = sessionIterator->first.first == descriptor ? filteredStreamSessions.erase(sessionIterator) : std::next(sessionIterator);
+    }
+    for (auto busIterator = virtualBuses.begin(); busIterator != virtualBuses.end();) {
+        busIterator = busIterator->second.expired() ? virtualBuses.erase(busIterator) : std::next(busIterator);
+    }
+    stopIdleHeartbeatWatchdog();
+}
+
+// Params:
+//   descriptor: String
+// Returns:
+//   deviceHandle: Number, accepted in place of the descriptor by the I/O functions
+Napi::Number openDevice(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
+
+    if (!deviceRegistry.Contains(descriptor) && !deviceRegistry.IsRegisteredToHal(descriptor)) {
+        throwDeviceNotFoundError(env);
+        return Napi::Number::New(env, 0);
+    }
+
+    uint32_t deviceHandle = deviceRegistry.OpenHandle(descriptor);
+    if (deviceHandle == 0) {
+        Napi::Error::New(env, "Too many open device handles").ThrowAsJavaScriptException();
+    }
+    return Napi::Number::New(env, deviceHandle);
+}
+
+// Params:
+//   deviceHandle: Number
+void closeDevice(const Napi::CallbackInfo& info) {
+    uint32_t deviceHandle = info[0].As<Napi::Number>().Uint32Value();
+    deviceRegistry.CloseHandle(deviceHandle);
+}
+
 // Params:
 //   descriptor: Number
 //   messageId: Number
@@ -175,17 +457,11 @@ Napi::Number registerDeviceToHAL(const Napi::CallbackInfo& info) {
         halInitialized = true;
     }
 
-    { // This block exists to define how long we hold canDevicesMtx
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator != canDeviceMap.end()) {
-            canDeviceMap.erase(deviceIterator->first);
-        }
-    }
+    deviceRegistry.Remove(descriptor);
 
     int32_t status;
     CANBridge_RegisterDeviceToHAL(descriptor_chars, messageId, messageMask, &status);
-    if (status == 0) devicesRegisteredToHal.insert(descriptor);
+    if (status == 0) deviceRegistry.SetRegisteredToHal(descriptor, true);
     return Napi::Number::New(env, status);
 }
 
@@ -201,48 +477,64 @@ void unregisterDeviceFromHAL(const Napi::CallbackInfo& info) {
 
     try {
         CANBridge_UnregisterDeviceFromHAL(descriptor_chars);
-        if (devicesRegisteredToHal.find(descriptor) != devicesRegisteredToHal.end())
-            devicesRegisteredToHal.erase(devicesRegisteredToHal.find(descriptor));
+        deviceRegistry.SetRegisteredToHal(descriptor, false);
+        stopReceiveTap(descriptor);
         cb.Call(env.Global(), {env.Null(), Napi::Number::New(env, (int)rev::usb::CANStatus::kOk)});
     } catch (...) {
         cb.Call(env.Global(), {Napi::Number::New(env, (int)rev::usb::CANStatus::kError)});
     }
 }
 
+// Decodes frames received from the device into the values of its signal decoders
+void decodeSignals(const std::string& descriptor, const HAL_CANStreamMessage* messages, uint32_t count) {
+    for (auto& entry : signalDecoders) {
+        if (entry.second.descriptor != descriptor) continue;
+        double* values = entry.second.values.Value().Data();
+        for (uint32_t i = 0; i < count; i++) {
+            entry.second.decoder->Decode(messages[i].messageID, messages[i].data, messages[i].dataSize, values);
+        }
+    }
+}
+
+void decodeSignals(const std::string& descriptor, const rev::usb::CANMessage& message) {
+    for (auto& entry : signalDecoders) {
+        if (entry.second.descriptor != descriptor) continue;
+        entry.second.decoder->Decode(message.GetMessageId(), message.GetData(), message.GetSize(), entry.second.values.Value().Data());
+    }
+}
+
 // Params:
-//   descriptor: Number
+//   descriptor: String, or Number handle from openDevice()
 //   messageId: Number
 //   messageMask: Number
 // Returns:
 //   data: Object{data:Number[], messageID:number, timeStamp:number}
 Napi::Object receiveMessage(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
     uint32_t messageId = info[1].As<Napi::Number>().Uint32Value();
     uint32_t messageMask = info[2].As<Napi::Number>().Uint32Value();
     Napi::Function cb = info[3].As<Napi::Function>();
 
     std::shared_ptr<rev::usb::CANMessage> message;
-    std::shared_ptr<rev::usb::CANDevice> device;
-
-    { // This block exists to define how long we hold canDevicesMtx
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator == canDeviceMap.end()) {
-            if (devicesRegisteredToHal.find(descriptor) != devicesRegisteredToHal.end()) return receiveHalMessage(info);
-            throwDeviceNotFoundError(env);
-            return Napi::Object::New(env);
-        }
-
-        device = deviceIterator->second;
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    if (!device) {
+        if (deviceRegistry.IsRegisteredToHal(descriptor)) return receiveHalMessage(info);
+        throwDeviceNotFoundError(env);
+        return Napi::Object::New(env);
     }
 
-    rev::usb::CANStatus status = device->ReceiveCANMessage(message, messageId, messageMask);
+    rev::usb::CANStatus status;
+    {
+        PERF_PHASE(kDriver);
+        status = device->ReceiveCANMessage(message, messageId, messageMask);
+    }
     if (status != rev::usb::CANStatus::kOk) {
         Napi::Error::New(env, "Receiving message failed with status code " + std::to_string((int)status)).ThrowAsJavaScriptException();
         return Napi::Object::New(env);
     }
 
+    PERF_PHASE(kConvert);
     size_t messageSize = message->GetSize();
     const uint8_t* messageData = message->GetData();
     Napi::Array napiMessage = Napi::Array::New(env, messageSize);
@@ -251,9 +543,11 @@ Napi::Object receiveMessage(const Napi::CallbackInfo& info) {
     }
     Napi::Object messageInfo = Napi::Object::New(env);
     messageInfo.Set("messageID", message->GetMessageId());
-    messageInfo.Set("timeStamp", message->GetTimestampUs());
+    // The latest frame with the ID, which may be old, so it only gets extended
+    messageInfo.Set("timeStamp", Napi::Number::New(env, clockFor(device, descriptor)->Extend((uint32_t)message->GetTimestampUs())));
     messageInfo.Set("data", napiMessage);
 
+    decodeSignals(descriptor, *message);
     return messageInfo;
 }
 
@@ -265,7 +559,6 @@ Napi::Object receiveMessage(const Napi::CallbackInfo& info) {
 //   data: Object{data:Number[], messageID:number, timeStamp:number}
 Napi::Object receiveHalMessage(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
     uint32_t messageId = info[1].As<Napi::Number>().Uint32Value();
     uint32_t messageMask = info[2].As<Napi::Number>().Uint32Value();
     Napi::Function cb = info[3].As<Napi::Function>();
@@ -274,7 +567,11 @@ Napi::Object receiveHalMessage(const Napi::CallbackInfo& info) {
     uint8_t dataSize = 0;
     uint32_t timeStamp = 0;
     int32_t status;
-    HAL_CAN_ReceiveMessage(&messageId, messageMask, data, &dataSize, &timeStamp, &status);
+    {
+        PERF_PHASE(kDriver);
+        TRACE_SCOPE("HAL_CAN_ReceiveMessage", messageId);
+        HAL_CAN_ReceiveMessage(&messageId, messageMask, data, &dataSize, &timeStamp, &status);
+    }
 
     Napi::Array napiMessage = Napi::Array::New(env, dataSize);
     for (int i = 0; i < dataSize; i++) {
@@ -283,64 +580,118 @@ Napi::Object receiveHalMessage(const Napi::CallbackInfo& info) {
 
     Napi::Object messageInfo = Napi::Object::New(env);
     messageInfo.Set("messageID", messageId);
-    messageInfo.Set("timeStamp", timeStamp);
+    messageInfo.Set("timeStamp", Napi::Number::New(env, halClock->Extend(timeStamp)));
     messageInfo.Set("data", napiMessage);
 
     return messageInfo;
 }
 
 // Params:
-//   descriptor: String
+//   descriptor: String, or Number handle from openDevice()
 //   priority: Number
 void setThreadPriority(const Napi::CallbackInfo& info) {
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
     uint32_t priority = info[1].As<Napi::Number>().Uint32Value();
 
-    std::scoped_lock lock{canDevicesMtx};
-    auto deviceIterator = canDeviceMap.find(descriptor);
-    if (deviceIterator == canDeviceMap.end()) return;
-    deviceIterator->second->setThreadPriority(static_cast<rev::usb::utils::ThreadPriority>(priority));
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    if (!device) return;
+    device->setThreadPriority(static_cast<rev::usb::utils::ThreadPriority>(priority));
+}
+
+
+// Reads filters: Array<Object{messageId:Number, messageMask:Number}>.
+// Returns nullptr, with a JS exception pending, if it is not a non-empty list of filters.
+std::shared_ptr<const FrameFilter> readFrameFilter(Napi::Env env, const Napi::Value& filtersParam) {
+    Napi::Array filtersArray = filtersParam.As<Napi::Array>();
+    std::vector<FrameFilter::Filter> filters;
+    for (uint32_t i = 0; i < filtersArray.Length(); i++) {
+        Napi::Value filter = filtersArray.Get(i);
+        if (!filter.IsObject() || !filter.As<Napi::Object>().Get("messageId").IsNumber() ||
+            !filter.As<Napi::Object>().Get("messageMask").IsNumber()) {
+            Napi::TypeError::New(env, "Each filter must have a messageId and a messageMask").ThrowAsJavaScriptException();
+            return nullptr;
+        }
+        filters.emplace_back(filter.As<Napi::Object>().Get("messageId").As<Napi::Number>().Uint32Value(),
+                             filter.As<Napi::Object>().Get("messageMask").As<Napi::Number>().Uint32Value());
+    }
+    if (filters.empty()) {
+        Napi::TypeError::New(env, "filters must not be empty").ThrowAsJavaScriptException();
+        return nullptr;
+    }
+    return std::make_shared<const FrameFilter>(filters);
 }
 
+// Reads a session opened by openStreamSession(), dropping the frames that miss its filter list if it has
+// one, feeds the newest frame to the device's clock, and decodes the frames into the device's signal
+// decoders. Returns the device's clock.
+std::shared_ptr<DeviceClock> readDeviceStreamSession(rev::usb::CANDevice& device, const std::string& descriptor, uint32_t sessionHandle,
+                                                     HAL_CANStreamMessage* messages, uint32_t messagesToRead, uint32_t* messagesRead) {
+    auto filterIterator = filteredStreamSessions.find({descriptor, sessionHandle});
+    TRACE_SCOPE("readStreamSession", sessionHandle);
+    if (filterIterator == filteredStreamSessions.end()) {
+        PERF_PHASE(kDriver);
+        device.ReadStreamSession(sessionHandle, messages, messagesToRead, messagesRead);
+    } else {
+        filterIterator->second->ReadMatching([&](HAL_CANStreamMessage* buffer, uint32_t maxMessages, uint32_t* count) {
+            PERF_PHASE(kDriver);
+            return device.ReadStreamSession(sessionHandle, buffer, maxMessages, count) == rev::usb::CANStatus::kOk;
+        }, messages, messagesToRead, messagesRead);
+    }
+    uint32_t count = std::min(*messagesRead, messagesToRead);
+    std::shared_ptr<DeviceClock> clock = deviceClock(descriptor);
+    if (count > 0) clock->Observe(messages[count - 1].timeStamp);
+    if (!signalDecoders.empty()) {
+        decodeSignals(descriptor, messages, count);
+    }
+    return clock;
+}
 
 // Params:
-//   descriptor: String
+//   descriptor: String, or Number handle from openDevice()
 //   messageId: Number
 //   messageMask: Number
 //   maxSize: Number
+// or
+//   descriptor: String, or Number handle from openDevice()
+//   filters: Array<Object{messageId:Number, messageMask:Number}>, frames matching any of them are read
+//   maxSize: Number
 // Returns:
 //   sessionHandle: Number
 Napi::Number openStreamSession(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
-    uint32_t messageId = info[1].As<Napi::Number>().Uint32Value();
-    uint32_t messageMask = info[2].As<Napi::Number>().Uint32Value();
-    uint32_t maxSize = info[3].As<Napi::Number>().Uint32Value();
-    Napi::Function cb = info[4].As<Napi::Function>();
-
     rev::usb::CANBridge_CANFilter filter;
-    filter.messageId = messageId;
-    filter.messageMask = messageMask;
+    std::shared_ptr<const FrameFilter> frameFilter;
+    uint32_t maxSize;
+    if (info[1].IsArray()) {
+        frameFilter = readFrameFilter(env, info[1]);
+        if (!frameFilter) return Napi::Number::New(env, 0);
+        // The driver session passes everything the list might match, and reads drop the rest
+        filter = frameFilter->Cover();
+        maxSize = info[2].As<Napi::Number>().Uint32Value();
+    } else {
+        filter.messageId = info[1].As<Napi::Number>().Uint32Value();
+        filter.messageMask = info[2].As<Napi::Number>().Uint32Value();
+        maxSize = info[3].As<Napi::Number>().Uint32Value();
+    }
     uint32_t sessionHandle;
 
-    std::shared_ptr<rev::usb::CANDevice> device;
-
-    { // This block exists to define how long we hold canDevicesMtx
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator == canDeviceMap.end()) {
-            throwDeviceNotFoundError(env);
-            return Napi::Number::New(env, 0);
-        }
-
-        device = deviceIterator->second;
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    if (!device) {
+        throwDeviceNotFoundError(env);
+        return Napi::Number::New(env, 0);
     }
 
     try {
-        rev::usb::CANStatus status = device->OpenStreamSession(&sessionHandle, filter, maxSize);
+        rev::usb::CANStatus status;
+        {
+            PERF_PHASE(kDriver);
+            status = device->OpenStreamSession(&sessionHandle, filter, maxSize);
+        }
         if (status != rev::usb::CANStatus::kOk) {
             Napi::Error::New(env, "Opening stream session failed with error code "+(int)status).ThrowAsJavaScriptException();
         } else {
+            if (frameFilter) filteredStreamSessions[{descriptor, sessionHandle}] = frameFilter;
             return Napi::Number::New(env, sessionHandle);
         }
     } catch(...) {
@@ -350,52 +701,29 @@ Napi::Number openStreamSession(const Napi::CallbackInfo& info) {
 }
 
 // Params:
-//   descriptor: String
+//   descriptor: String, or Number handle from openDevice()
 //   sessionHandle: number;
 //   messagesToRead: Number
 // Returns:
 //   messages: Array<Object{messageID:Number, timeStamp:Number, data:Array<Number>}>
 Napi::Array readStreamSession(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
     uint32_t sessionHandle = info[1].As<Napi::Number>().Uint32Value();
     uint32_t messagesToRead = info[2].As<Napi::Number>().Uint32Value();
     Napi::Function cb = info[3].As<Napi::Function>();
     HAL_CANStreamMessage *messages = new HAL_CANStreamMessage[messagesToRead];
     uint32_t messagesRead = 0;
 
-    std::shared_ptr<rev::usb::CANDevice> device;
-
-    { // This block exists to define how long we hold canDevicesMtx
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator == canDeviceMap.end()) {
-            throwDeviceNotFoundError(env);
-            return Napi::Array::New(env);
-        }
-
-        device = deviceIterator->second;
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    if (!device) {
+        throwDeviceNotFoundError(env);
+        return Napi::Array::New(env);
     }
 
     try {
-        device->ReadStreamSession(sessionHandle, messages, messagesToRead, &messagesRead);
-        Napi::HandleScope scope(env);
-        Napi::Array messageArray = Napi::Array::New(env);
-        for (uint32_t i = 0; i < messagesRead; i++) {
-            Napi::HandleScope scope(env);
-            Napi::Object message = Napi::Object::New(env);
-            message.Set("messageID", messages[i].messageID);
-            message.Set("timeStamp", messages[i].timeStamp);
-
-            int messageLength = std::min((int)messages[i].dataSize, 8);
-            Napi::Array data = Napi::Array::New(env, messageLength);
-            for (int m = 0; m < messageLength; m++) {
-                Napi::HandleScope scope(env);
-                data[m] = Napi::Number::New(env, messages[i].data[m]);
-            }
-            message.Set("data", data);
-            messageArray[i] = message;
-        }
+        std::shared_ptr<DeviceClock> clock = readDeviceStreamSession(*device, descriptor, sessionHandle, messages, messagesToRead, &messagesRead);
+        Napi::Array messageArray = streamMessagesToArray(env, messages, std::min(messagesRead, messagesToRead), *clock);
         delete[] messages;
         return messageArray;
     } catch(...) {
@@ -405,48 +733,117 @@ Napi::Array readStreamSession(const Napi::CallbackInfo& info) {
     }
 }
 
+// Reads the optional columns parameter of the packed read functions:
+// Object{deviceType?, manufacturer?, apiClass?, apiIndex?, deviceNumber?}, each a Uint8Array.
+// Lowers maxMessages to the length of the shortest column. Returns false, with a JS exception
+// pending, if a column is not a Uint8Array.
+bool readArbIdColumns(Napi::Env env, const Napi::Value& columnsParam, ArbIdColumns* columns, size_t* maxMessages) {
+    if (!columnsParam.IsObject()) return true;
+    Napi::Object columnsObject = columnsParam.As<Napi::Object>();
+    std::pair<const char*, uint8_t**> fields[] = {
+        {"deviceType", &columns->deviceType},
+        {"manufacturer", &columns->manufacturer},
+        {"apiClass", &columns->apiClass},
+        {"apiIndex", &columns->apiIndex},
+        {"deviceNumber", &columns->deviceNumber},
+    };
+    for (auto& field : fields) {
+        Napi::Value column = columnsObject.Get(field.first);
+        if (column.IsUndefined()) continue;
+        if (!column.IsTypedArray() || column.As<Napi::TypedArray>().TypedArrayType() != napi_uint8_array) {
+            Napi::TypeError::New(env, std::string(field.first) + " must be a Uint8Array").ThrowAsJavaScriptException();
+            return false;
+        }
+        Napi::Uint8Array array = column.As<Napi::Uint8Array>();
+        *field.second = array.Data();
+        *maxMessages = std::min(*maxMessages, array.ElementLength());
+    }
+    return true;
+}
+
 // Params:
-//   descriptor: String
+//   descriptor: String, or Number handle from openDevice()
+//   sessionHandle: Number
+//   buffer: ArrayBuffer | TypedArray, filled with PACKED_FRAME_RECORD_SIZE byte records
+//   columns: Object{deviceType?, manufacturer?, apiClass?, apiIndex?, deviceNumber?} of Uint8Arrays (optional),
+//            filled with the fields of each record's arbitration ID
+// Returns:
+//   messagesRead: Number
+Napi::Number readStreamSessionPacked(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t sessionHandle = info[1].As<Napi::Number>().Uint32Value();
+
+    uint8_t* buffer;
+    size_t byteLength;
+    if (!getBufferBytes(info[2], &buffer, &byteLength)) {
+        Napi::TypeError::New(env, "buffer must be an ArrayBuffer or a TypedArray").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+    size_t maxMessages = byteLength / PACKED_FRAME_RECORD_SIZE;
+    ArbIdColumns columns;
+    if (!readArbIdColumns(env, info[3], &columns, &maxMessages)) return Napi::Number::New(env, 0);
+    uint32_t messagesToRead = maxMessages;
+    uint32_t messagesRead = 0;
+
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    if (!device) {
+        throwDeviceNotFoundError(env);
+        return Napi::Number::New(env, 0);
+    }
+
+    if (packedReadScratch.size() < messagesToRead) packedReadScratch.resize(messagesToRead);
+    std::shared_ptr<DeviceClock> clock;
+    try {
+        clock = readDeviceStreamSession(*device, descriptor, sessionHandle, packedReadScratch.data(), messagesToRead, &messagesRead);
+    } catch(...) {
+        Napi::Error::New(env, "Reading stream session failed").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+
+    PERF_PHASE(kConvert);
+    messagesRead = std::min(messagesRead, messagesToRead);
+    packStreamMessages(buffer, packedReadScratch.data(), messagesRead, *clock);
+    decodePackedArbIds(buffer, messagesRead, columns);
+    return Napi::Number::New(env, messagesRead);
+}
+
+// Params:
+//   descriptor: String, or Number handle from openDevice()
 //   sessionHandle: Number
 // Returns:
 //   status: Number
 Napi::Number closeStreamSession(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
     uint32_t sessionHandle = info[1].As<Napi::Number>().Uint32Value();
     Napi::Function cb = info[1].As<Napi::Function>();
 
-    std::scoped_lock lock{canDevicesMtx};
-    auto deviceIterator = canDeviceMap.find(descriptor);
-    if (deviceIterator == canDeviceMap.end()) {
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    if (!device) {
         throwDeviceNotFoundError(env);
         return Napi::Number::New(env, 0);
     }
 
-    rev::usb::CANStatus status = deviceIterator->second->CloseStreamSession(sessionHandle);
+    filteredStreamSessions.erase({descriptor, sessionHandle});
+    PERF_PHASE(kDriver);
+    rev::usb::CANStatus status = device->CloseStreamSession(sessionHandle);
     return Napi::Number::New(env, (int)status);
 }
 
 // Params:
-//   descriptor: String
+//   descriptor: String, or Number handle from openDevice()
 // Returns:
 //   status: Object{percentBusUtilization:Number, busOff:Number, txFull:Number, receiveErr:Number, transmitError:Number, lastErrorTime:Number}
 Napi::Object getCANDetailStatus(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
     Napi::Function cb = info[1].As<Napi::Function>();
 
-    std::shared_ptr<rev::usb::CANDevice> device;
-
-    { // This block exists to define how long we hold canDevicesMtx
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator == canDeviceMap.end()) {
-            throwDeviceNotFoundError(env);
-            return Napi::Object::New(env);
-        }
-
-        device = deviceIterator->second;
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    if (!device) {
+        throwDeviceNotFoundError(env);
+        return Napi::Object::New(env);
     }
 
     float percentBusUtilization;
@@ -455,7 +852,10 @@ Napi::Object getCANDetailStatus(const Napi::CallbackInfo& info) {
     uint32_t receiveErr;
     uint32_t transmitErr;
     uint32_t lastErrorTime;
-    device->GetCANDetailStatus(&percentBusUtilization, &busOff, &txFull, &receiveErr, &transmitErr, &lastErrorTime);
+    {
+        PERF_PHASE(kDriver);
+        device->GetCANDetailStatus(&percentBusUtilization, &busOff, &txFull, &receiveErr, &transmitErr, &lastErrorTime);
+    }
 
     Napi::Object status = Napi::Object::New(env);
     status.Set("percentBusUtilization", percentBusUtilization);
@@ -467,35 +867,80 @@ Napi::Object getCANDetailStatus(const Napi::CallbackInfo& info) {
     return status;
 }
 
-int _sendCANMessage(std::string descriptor, uint32_t messageId, uint8_t* messageData, int dataSize, int repeatPeriodMs) {
-    std::shared_ptr<rev::usb::CANDevice> device;
-    bool foundDevice = false;
+int sendMessageToDevice(rev::usb::CANDevice& device, uint32_t messageId, uint8_t* messageData, int dataSize, int repeatPeriodMs) {
+    rev::usb::CANMessage message(messageId, messageData, dataSize);
+    rev::usb::CANStatus status;
+    {
+        PERF_PHASE(kDriver);
+        TRACE_SCOPE("SendCANMessage", messageId);
+        status = device.SendCANMessage(message, repeatPeriodMs);
+    }
+    CaptureLogger& capture = CaptureLogger::Instance();
+    if (status == rev::usb::CANStatus::kOk && capture.IsActive()) {
+        capture.Record(capture.ChannelForDevice(&device), true, messageId, messageData, dataSize);
+    }
+    return (int)status;
+}
 
-    { // This block exists to define how long we hold canDevicesMtx
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator != canDeviceMap.end()) {
-            device = deviceIterator->second;
-            foundDevice = true;
-        }
+// Keeps driverRepeats in step with a send that succeeded. Any period but a positive one stops the repeat.
+void noteDriverRepeat(const std::string& descriptor, uint32_t messageId, int repeatPeriodMs) {
+    std::scoped_lock lock{driverRepeatsMtx};
+    if (repeatPeriodMs > 0) {
+        driverRepeats.emplace(descriptor, messageId);
+    } else if (!driverRepeats.empty()) {
+        driverRepeats.erase({descriptor, messageId});
     }
+}
 
-    if (!foundDevice) {
-        if (devicesRegisteredToHal.find(descriptor) != devicesRegisteredToHal.end()) {
-            int32_t status;
-            HAL_CAN_SendMessage(messageId, messageData, dataSize, repeatPeriodMs, &status);
-            return status;
-        }
+bool hasDriverRepeat(const std::string& descriptor, uint32_t messageId) {
+    std::scoped_lock lock{driverRepeatsMtx};
+    return driverRepeats.count({descriptor, messageId}) > 0;
+}
+
+int sendMessageThroughHal(uint32_t messageId, uint8_t* messageData, int dataSize, int repeatPeriodMs) {
+    int32_t status;
+    {
+        PERF_PHASE(kDriver);
+        TRACE_SCOPE("HAL_CAN_SendMessage", messageId);
+        HAL_CAN_SendMessage(messageId, messageData, dataSize, repeatPeriodMs, &status);
+    }
+    CaptureLogger& capture = CaptureLogger::Instance();
+    if (status == 0 && capture.IsActive()) {
+        capture.Record(capture.ChannelForDevice(nullptr), true, messageId, messageData, dataSize);
+    }
+    return status;
+}
+
+// Sends through device if it is set, otherwise through the HAL if descriptor is registered to it.
+// Returns -1 if neither applies.
+int sendMessage(const std::shared_ptr<rev::usb::CANDevice>& device, const std::string& descriptor, uint32_t messageId, uint8_t* messageData, int dataSize, int repeatPeriodMs) {
+    int status;
+    if (device) {
+        status = sendMessageToDevice(*device, messageId, messageData, dataSize, repeatPeriodMs);
+    } else if (deviceRegistry.IsRegisteredToHal(descriptor)) {
+        status = sendMessageThroughHal(messageId, messageData, dataSize, repeatPeriodMs);
+    } else {
         return -1;
     }
+    if (status == 0) noteDriverRepeat(descriptor, messageId, repeatPeriodMs);
+    return status;
+}
 
-    rev::usb::CANMessage* message = new rev::usb::CANMessage(messageId, messageData, dataSize);
-    rev::usb::CANStatus status = device->SendCANMessage(*message, repeatPeriodMs);
-    return (int)status;
+// Sends a frame once, for the native threads that schedule frames themselves. The driver also
+// cancels the repeat of an ID that is sent once, so an ID the driver repeats is not sent, and
+// kError is returned instead. Returns -1 if the device does not exist.
+int sendMessageOnce(const std::string& descriptor, uint32_t messageId, uint8_t* messageData, int dataSize) {
+    if (hasDriverRepeat(descriptor, messageId)) return (int)rev::usb::CANStatus::kError;
+    return sendMessage(findDevice(descriptor), descriptor, messageId, messageData, dataSize, 0);
+}
+
+int _sendCANMessage(std::string descriptor, uint32_t messageId, uint8_t* messageData, int dataSize, int repeatPeriodMs) {
+    TRACE_SCOPE("_sendCANMessage", messageId);
+    return sendMessage(findDevice(descriptor), descriptor, messageId, messageData, dataSize, repeatPeriodMs);
 }
 
 // Params:
-//   descriptor: string
+//   descriptor: String, or Number handle from openDevice()
 //   messageId: Number
 //   messageData: Number[]
 //   repeatPeriod: Number
@@ -503,7 +948,6 @@ int _sendCANMessage(std::string descriptor, uint32_t messageId, uint8_t* message
 //   status: Number
 Napi::Number sendCANMessage(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
     uint32_t messageId = info[1].As<Napi::Number>().Uint32Value();
     Napi::Array dataParam = info[2].As<Napi::Array>();
     int repeatPeriodMs = info[3].As<Napi::Number>().Uint32Value();
@@ -512,7 +956,9 @@ Napi::Number sendCANMessage(const Napi::CallbackInfo& info) {
     for (uint32_t i = 0; i < dataParam.Length(); i++) {
         messageData[i] = dataParam.Get(i).As<Napi::Number>().Uint32Value();
     }
-    int status = _sendCANMessage(descriptor, messageId, messageData, dataParam.Length(), repeatPeriodMs);
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    int status = sendMessage(device, descriptor, messageId, messageData, dataParam.Length(), repeatPeriodMs);
     if (status < 0) {
         throwDeviceNotFoundError(env);
     }
@@ -521,7 +967,51 @@ Napi::Number sendCANMessage(const Napi::CallbackInfo& info) {
 
 
 // Params:
-//   descriptor: string
+//   descriptor: String, or Number handle from openDevice()
+//   messages: ArrayBuffer | TypedArray of PACKED_SEND_RECORD_SIZE byte records
+// Returns:
+//   statuses: Int32Array, one status per record
+Napi::Int32Array sendCANMessages(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    uint8_t* records;
+    size_t byteLength;
+    if (!getBufferBytes(info[1], &records, &byteLength)) {
+        Napi::TypeError::New(env, "messages must be an ArrayBuffer or a TypedArray").ThrowAsJavaScriptException();
+        return Napi::Int32Array::New(env, 0);
+    }
+    size_t count = byteLength / PACKED_SEND_RECORD_SIZE;
+
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    bool sendThroughHal = !device && deviceRegistry.IsRegisteredToHal(descriptor);
+    if (!device && !sendThroughHal) {
+        throwDeviceNotFoundError(env);
+        return Napi::Int32Array::New(env, 0);
+    }
+
+    Napi::Int32Array statuses = Napi::Int32Array::New(env, count);
+    for (size_t i = 0; i < count; i++) {
+        uint8_t* record = records + i * PACKED_SEND_RECORD_SIZE;
+        uint32_t messageId;
+        int32_t repeatPeriodMs;
+        std::memcpy(&messageId, record, 4);
+        std::memcpy(&repeatPeriodMs, record + 4, 4);
+        uint8_t dataSize = std::min<uint8_t>(record[8], 8);
+        uint8_t* messageData = record + 16;
+
+        if (sendThroughHal) {
+            statuses[i] = sendMessageThroughHal(messageId, messageData, dataSize, repeatPeriodMs);
+        } else {
+            statuses[i] = sendMessageToDevice(*device, messageId, messageData, dataSize, repeatPeriodMs);
+        }
+        if (statuses[i] == 0) noteDriverRepeat(descriptor, messageId, repeatPeriodMs);
+    }
+    return statuses;
+}
+
+// Params:
+//   descriptor: String, or Number handle from openDevice()
 //   messageId: Number
 //   messageData: Number[]
 //   repeatPeriod: Number
@@ -529,7 +1019,6 @@ Napi::Number sendCANMessage(const Napi::CallbackInfo& info) {
 //   status: Number
 Napi::Number sendRtrMessage(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
     uint32_t messageId = info[1].As<Napi::Number>().Uint32Value();
     Napi::Array dataParam = info[2].As<Napi::Array>();
     int repeatPeriodMs = info[3].As<Napi::Number>().Uint32Value();
@@ -540,7 +1029,9 @@ Napi::Number sendRtrMessage(const Napi::CallbackInfo& info) {
     for (uint32_t i = 0; i < dataParam.Length(); i++) {
         messageData[i] = dataParam.Get(i).As<Napi::Number>().Uint32Value();
     }
-    int status = _sendCANMessage(descriptor, messageId, messageData, dataParam.Length(), repeatPeriodMs);
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    int status = sendMessage(device, descriptor, messageId, messageData, dataParam.Length(), repeatPeriodMs);
     if (status < 0) {
         throwDeviceNotFoundError(env);
     }
@@ -593,259 +1084,1788 @@ Napi::Number sendHALMessage(const Napi::CallbackInfo& info) {
     return Napi::Number::New(env, (int)status);
 }
 
+// Copies up to 8 bytes of a Number[] into data and returns how many were copied
+uint8_t readMessageData(const Napi::Array& dataParam, uint8_t* data) {
+    uint8_t dataSize = std::min<uint32_t>(dataParam.Length(), 8);
+    for (uint8_t i = 0; i < dataSize; i++) {
+        data[i] = dataParam.Get(i).As<Napi::Number>().Uint32Value();
+    }
+    return dataSize;
+}
+
+// Sends a frame every periodMs from the device's transmit scheduler thread. Works with devices
+// registered to the HAL as well. Each frame is sent once, which in the driver also cancels a repeat
+// of the same ID, so an ID that sendCANMessage() repeats cannot be scheduled, and while a repeat of
+// a scheduled ID is running, the scheduler skips its sends and counts them as failed.
 // Params:
+//   descriptor: String
 //   messageId: Number
-//   messageMask: Number
-//   numMessages: Number
+//   messageData: Number[]
+//   periodMs: Number, may be fractional
+//   phaseMs: Number (optional), offset of the deadlines within the period. Schedules with the same
+//            period and different phases on one device keep that offset from each other.
 // Returns:
-//   streamHandle: Number
-Napi::Number openHALStreamSession(const Napi::CallbackInfo& info) {
+//   Number, the handle to pass to updatePeriodicFrame(), getPeriodicFrameStats() and removePeriodicFrame()
+Napi::Number addPeriodicFrame(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    uint32_t messageId = info[0].As<Napi::Number>().Uint32Value();
-    uint32_t messageMask = info[1].As<Napi::Number>().Uint32Value();
-    uint32_t numMessages = info[2].As<Napi::Number>().Uint32Value();
+    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
+    uint32_t messageId = info[1].As<Napi::Number>().Uint32Value();
+    Napi::Array dataParam = info[2].As<Napi::Array>();
+    double periodMs = info[3].As<Napi::Number>().DoubleValue();
+    double phaseMs = info[4].IsNumber() ? info[4].As<Napi::Number>().DoubleValue() : 0;
 
-    int32_t status;
-    uint32_t streamHandle;
-    HAL_CAN_OpenStreamSession(&streamHandle, messageId, messageMask, numMessages, &status);
+    if (!(periodMs > 0) || phaseMs < 0) {
+        Napi::RangeError::New(env, "periodMs must be greater than 0 and phaseMs must not be negative").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+    if (!deviceRegistry.Contains(descriptor) && !deviceRegistry.IsRegisteredToHal(descriptor)) {
+        throwDeviceNotFoundError(env);
+        return Napi::Number::New(env, 0);
+    }
+    if (hasDriverRepeat(descriptor, messageId)) {
+        Napi::Error::New(env, "The driver already repeats this ID. Stop it with a repeat period of -1 first.").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+
+    uint8_t messageData[8];
+    uint8_t dataSize = readMessageData(dataParam, messageData);
+
+    auto& scheduler = transmitSchedulers[descriptor];
+    if (!scheduler) {
+        // The device is looked up on every send, so a rescan or a switch to the HAL is picked up
+        scheduler = std::make_unique<TransmitScheduler>([descriptor](uint32_t messageId, uint8_t* data, uint8_t dataSize) {
+            return sendMessageOnce(descriptor, messageId, data, dataSize);
+        });
+    }
+
+    uint32_t scheduleHandle = nextTransmitScheduleHandle++;
+    scheduler->Add(scheduleHandle, messageId, messageData, dataSize, (uint64_t)(periodMs * 1000), (uint64_t)(phaseMs * 1000));
+    transmitScheduleDevices[scheduleHandle] = descriptor;
+    return Napi::Number::New(env, scheduleHandle);
+}
+
+// Returns nullptr after throwing if the schedule does not exist
+TransmitScheduler* findTransmitScheduler(Napi::Env env, uint32_t scheduleHandle) {
+    auto deviceIterator = transmitScheduleDevices.find(scheduleHandle);
+    if (deviceIterator == transmitScheduleDevices.end()) {
+        Napi::Error::New(env, "Periodic frame handle not found").ThrowAsJavaScriptException();
+        return nullptr;
+    }
+    return transmitSchedulers[deviceIterator->second].get();
+}
+
+// Replaces the payload of a periodic frame. The next send uses the new payload and keeps its deadline.
+// Params:
+//   scheduleHandle: Number
+//   messageData: Number[]
+void updatePeriodicFrame(const Napi::CallbackInfo& info) {
+    uint32_t scheduleHandle = info[0].As<Napi::Number>().Uint32Value();
+    Napi::Array dataParam = info[1].As<Napi::Array>();
+
+    TransmitScheduler* scheduler = findTransmitScheduler(info.Env(), scheduleHandle);
+    if (scheduler == nullptr) return;
+
+    uint8_t messageData[8];
+    uint8_t dataSize = readMessageData(dataParam, messageData);
+    scheduler->Update(scheduleHandle, messageData, dataSize);
+}
+
+// Params:
+//   scheduleHandle: Number
+// Returns:
+//   Object with send, late send, skip and jitter statistics
+Napi::Value getPeriodicFrameStats(const Napi::CallbackInfo& info) {
+    uint32_t scheduleHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    TransmitScheduler* scheduler = findTransmitScheduler(info.Env(), scheduleHandle);
+    TransmitScheduleStats stats;
+    if (scheduler == nullptr || !scheduler->GetStats(scheduleHandle, &stats)) return info.Env().Undefined();
+    return stats.ToObject(info.Env());
+}
+
+// Params:
+//   scheduleHandle: Number
+void removePeriodicFrame(const Napi::CallbackInfo& info) {
+    uint32_t scheduleHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    auto deviceIterator = transmitScheduleDevices.find(scheduleHandle);
+    if (deviceIterator == transmitScheduleDevices.end()) return;
+
+    // Removing the last schedule of a device stops its thread
+    if (transmitSchedulers[deviceIterator->second]->Remove(scheduleHandle)) {
+        transmitSchedulers.erase(deviceIterator->second);
+    }
+    transmitScheduleDevices.erase(deviceIterator);
+}
+
+// Params:
+//   messageId: Number
+//   messageMask: Number
+//   numMessages: Number
+// Returns:
+//   streamHandle: Number
+Napi::Number openHALStreamSession(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t messageId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t messageMask = info[1].As<Napi::Number>().Uint32Value();
+    uint32_t numMessages = info[2].As<Napi::Number>().Uint32Value();
+
+    int32_t status;
+    uint32_t streamHandle;
+    HAL_CAN_OpenStreamSession(&streamHandle, messageId, messageMask, numMessages, &status);
     return Napi::Number::New(env, (int)streamHandle);
 }
 
 // Params:
-//   streamHandle: Number
-//   numMessages: Number
+//   streamHandle: Number
+//   numMessages: Number
+// Returns:
+//   messages: Array
+Napi::Array readHALStreamSession(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t streamHandle = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t numMessages = info[1].As<Napi::Number>().Uint32Value();
+
+    int32_t status;
+    uint32_t messagesRead = 0;
+    HAL_CANStreamMessage *messages = new HAL_CANStreamMessage[numMessages];
+    {
+        PERF_PHASE(kDriver);
+        TRACE_SCOPE("HAL_CAN_ReadStreamSession", streamHandle);
+        HAL_CAN_ReadStreamSession(streamHandle, messages, numMessages, &messagesRead, &status);
+    }
+    messagesRead = std::min(messagesRead, numMessages);
+    if (messagesRead > 0) halClock->Observe(messages[messagesRead - 1].timeStamp);
+    Napi::Array messageArray = streamMessagesToArray(env, messages, messagesRead, *halClock);
+    delete[] messages;
+    return messageArray;
+}
+
+// Params:
+//   streamHandle: Number
+//   buffer: ArrayBuffer | TypedArray, filled with PACKED_FRAME_RECORD_SIZE byte records
+//   columns: Object{deviceType?, manufacturer?, apiClass?, apiIndex?, deviceNumber?} of Uint8Arrays (optional)
+// Returns:
+//   messagesRead: Number
+Napi::Number readHALStreamSessionPacked(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t streamHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    uint8_t* buffer;
+    size_t byteLength;
+    if (!getBufferBytes(info[1], &buffer, &byteLength)) {
+        Napi::TypeError::New(env, "buffer must be an ArrayBuffer or a TypedArray").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+    size_t maxMessages = byteLength / PACKED_FRAME_RECORD_SIZE;
+    ArbIdColumns columns;
+    if (!readArbIdColumns(env, info[2], &columns, &maxMessages)) return Napi::Number::New(env, 0);
+    uint32_t numMessages = maxMessages;
+
+    int32_t status;
+    uint32_t messagesRead = 0;
+    if (packedReadScratch.size() < numMessages) packedReadScratch.resize(numMessages);
+    {
+        PERF_PHASE(kDriver);
+        TRACE_SCOPE("HAL_CAN_ReadStreamSession", streamHandle);
+        HAL_CAN_ReadStreamSession(streamHandle, packedReadScratch.data(), numMessages, &messagesRead, &status);
+    }
+
+    PERF_PHASE(kConvert);
+    messagesRead = std::min(messagesRead, numMessages);
+    if (messagesRead > 0) halClock->Observe(packedReadScratch[messagesRead - 1].timeStamp);
+    packStreamMessages(buffer, packedReadScratch.data(), messagesRead, *halClock);
+    decodePackedArbIds(buffer, messagesRead, columns);
+    return Napi::Number::New(env, messagesRead);
+}
+
+// Params:
+//   streamHandle: Number
+void closeHALStreamSession(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t streamHandle = info[0].As<Napi::Number>().Uint32Value();
+    HAL_CAN_CloseStreamSession(streamHandle);
+}
+
+// Opens a stream session on the device, or through the HAL if device is null and the descriptor is
+// registered to it, for reading from another thread. Only a weak reference to the device is kept, so
+// the reader ends once the device is removed. Every read feeds the newest frame to the clock set in
+// clock, which extends the timestamps. Returns false after throwing if the session cannot be opened.
+bool openStreamReader(Napi::Env env, const std::shared_ptr<rev::usb::CANDevice>& device, const std::string& descriptor,
+                      uint32_t messageId, uint32_t messageMask, uint32_t maxSize,
+                      StreamSubscription::ReadFunction* read, StreamSubscription::CloseFunction* close,
+                      std::shared_ptr<DeviceClock>* clock) {
+    uint32_t sessionHandle;
+
+    if (device) {
+        rev::usb::CANBridge_CANFilter filter;
+        filter.messageId = messageId;
+        filter.messageMask = messageMask;
+        rev::usb::CANStatus status;
+        try {
+            status = device->OpenStreamSession(&sessionHandle, filter, maxSize);
+        } catch(...) {
+            status = rev::usb::CANStatus::kError;
+        }
+        if (status != rev::usb::CANStatus::kOk) {
+            Napi::Error::New(env, "Opening stream session failed with error code " + std::to_string((int)status)).ThrowAsJavaScriptException();
+            return false;
+        }
+
+        std::weak_ptr<rev::usb::CANDevice> weakDevice = device;
+        *clock = deviceClock(descriptor);
+        *read = [weakDevice, sessionHandle, clock = *clock](HAL_CANStreamMessage* messages, uint32_t maxMessages, uint32_t* messagesRead) {
+            std::shared_ptr<rev::usb::CANDevice> device = weakDevice.lock();
+            if (!device) return false;
+            try {
+                if (device->ReadStreamSession(sessionHandle, messages, maxMessages, messagesRead) != rev::usb::CANStatus::kOk) return false;
+            } catch(...) {
+                return false;
+            }
+            // Callers index their buffers with the count, so never trust the driver to stay within it
+            *messagesRead = std::min(*messagesRead, maxMessages);
+            if (*messagesRead > 0) clock->Observe(messages[*messagesRead - 1].timeStamp);
+            return true;
+        };
+        *close = [weakDevice, sessionHandle]() {
+            std::shared_ptr<rev::usb::CANDevice> device = weakDevice.lock();
+            if (device) device->CloseStreamSession(sessionHandle);
+        };
+    } else if (deviceRegistry.IsRegisteredToHal(descriptor)) {
+        int32_t status;
+        HAL_CAN_OpenStreamSession(&sessionHandle, messageId, messageMask, maxSize, &status);
+        if (status != 0) {
+            Napi::Error::New(env, "Opening HAL stream session failed with error code " + std::to_string(status)).ThrowAsJavaScriptException();
+            return false;
+        }
+
+        *clock = halClock;
+        *read = [sessionHandle](HAL_CANStreamMessage* messages, uint32_t maxMessages, uint32_t* messagesRead) {
+            int32_t status;
+            *messagesRead = 0;
+            HAL_CAN_ReadStreamSession(sessionHandle, messages, maxMessages, messagesRead, &status);
+            *messagesRead = status == 0 ? std::min(*messagesRead, maxMessages) : 0;
+            if (*messagesRead > 0) halClock->Observe(messages[*messagesRead - 1].timeStamp);
+            return true;
+        };
+        *close = [sessionHandle]() { HAL_CAN_CloseStreamSession(sessionHandle); };
+    } else {
+        throwDeviceNotFoundError(env);
+        return false;
+    }
+    return true;
+}
+
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+//   messageId: Number
+//   messageMask: Number
+//   onBatch: Function(messages: Array<Object{messageID:Number, timeStamp:Number, data:Array<Number>}>)
+//   options: Object{maxBatchSize?:Number, maxLatencyMs?:Number, maxSize?:Number,
+//                   filters?:Array<Object{messageId:Number, messageMask:Number}>} (optional)
+//     filters: only frames that also match one of these are delivered
+// Returns:
+//   subscriptionHandle: Number
+Napi::Number subscribe(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t messageId = info[1].As<Napi::Number>().Uint32Value();
+    uint32_t messageMask = info[2].As<Napi::Number>().Uint32Value();
+    Napi::Function onBatch = info[3].As<Napi::Function>();
+
+    uint32_t maxBatchSize = SUBSCRIPTION_DEFAULT_MAX_BATCH_SIZE;
+    uint32_t maxLatencyMs = SUBSCRIPTION_DEFAULT_MAX_LATENCY_MS;
+    uint32_t maxSize = SUBSCRIPTION_DEFAULT_SESSION_SIZE;
+    std::shared_ptr<const FrameFilter> frameFilter;
+    if (info[4].IsObject()) {
+        Napi::Object options = info[4].As<Napi::Object>();
+        if (options.Get("maxBatchSize").IsNumber()) maxBatchSize = options.Get("maxBatchSize").As<Napi::Number>().Uint32Value();
+        if (options.Get("maxLatencyMs").IsNumber()) maxLatencyMs = options.Get("maxLatencyMs").As<Napi::Number>().Uint32Value();
+        if (options.Get("maxSize").IsNumber()) maxSize = options.Get("maxSize").As<Napi::Number>().Uint32Value();
+        if (options.Get("filters").IsArray()) {
+            frameFilter = readFrameFilter(env, options.Get("filters"));
+            if (!frameFilter) return Napi::Number::New(env, 0);
+        }
+    }
+
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+
+    StreamSubscription::ReadFunction read;
+    StreamSubscription::CloseFunction close;
+    std::shared_ptr<DeviceClock> clock;
+    if (!openStreamReader(env, device, descriptor, messageId, messageMask, maxSize, &read, &close, &clock)) {
+        return Napi::Number::New(env, 0);
+    }
+    if (frameFilter) {
+        read = [read, frameFilter](HAL_CANStreamMessage* messages, uint32_t maxMessages, uint32_t* messagesRead) {
+            return frameFilter->ReadMatching(read, messages, maxMessages, messagesRead);
+        };
+    }
+
+    uint32_t subscriptionHandle = nextStreamSubscriptionHandle++;
+    streamSubscriptions[subscriptionHandle] = StreamSubscription::Start(env, onBatch, read, close, clock, maxBatchSize, maxLatencyMs,
+        [subscriptionHandle]() { streamSubscriptions.erase(subscriptionHandle); });
+    return Napi::Number::New(env, subscriptionHandle);
+}
+
+// Params:
+//   subscriptionHandle: Number
+void unsubscribe(const Napi::CallbackInfo& info) {
+    uint32_t subscriptionHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    auto subscriptionIterator = streamSubscriptions.find(subscriptionHandle);
+    if (subscriptionIterator == streamSubscriptions.end()) return;
+
+    // The subscription deletes itself once its reader thread has exited
+    subscriptionIterator->second->Stop();
+    streamSubscriptions.erase(subscriptionIterator);
+}
+
+void initializeNotifier(const Napi::CallbackInfo& info) {
+    int32_t status = 0;
+    m_notifier = HAL_InitializeNotifier(&status);
+    if (status != 0) {
+        Napi::Error::New(info.Env(), "Initializing notifier failed with error code " + std::to_string(status)).ThrowAsJavaScriptException();
+    }
+}
+
+class WaitForNotifierAlarmWorker : public Napi::AsyncWorker {
+    public:
+        WaitForNotifierAlarmWorker(Napi::Function& callback, HAL_NotifierHandle notifier, uint64_t time)
+        : Napi::AsyncWorker(callback), notifier(notifier), time(time) {}
+
+        ~WaitForNotifierAlarmWorker() {}
+
+    void Execute() override {
+        int32_t status = 0;
+        uint64_t now = HAL_GetFPGATime(&status);
+        if (status == 0) HAL_UpdateNotifierAlarm(notifier, now + time, &status);
+        if (status == 0) triggeredTime = HAL_WaitForNotifierAlarm(notifier, &status);
+        if (status != 0) {
+            SetError("Waiting for notifier alarm failed with error code " + std::to_string(status));
+        }
+    }
+
+    void OnOK() override {
+        Napi::HandleScope scope(Env());
+        Callback().Call({Env().Null(), Napi::Number::New(Env(), triggeredTime)});
+    }
+
+    private:
+        HAL_NotifierHandle notifier;
+        uint64_t time;
+        uint64_t triggeredTime = 0;
+};
+
+// Waits on a libuv worker thread, so the event loop keeps running during the wait
+// Params:
+//   time: Number (microseconds)
+//   callback: Function, called with the FPGA time the alarm fired at, or 0 if the notifier was stopped
+void waitForNotifierAlarm(const Napi::CallbackInfo& info) {
+    uint32_t time = info[0].As<Napi::Number>().Uint32Value();
+    Napi::Function cb = info[1].As<Napi::Function>();
+
+    WaitForNotifierAlarmWorker* wk = new WaitForNotifierAlarmWorker(cb, m_notifier, time);
+    wk->Queue();
+}
+
+void throwNotifierNotFoundError(Napi::Env env) {
+    Napi::Error::New(env, "Notifier handle not found").ThrowAsJavaScriptException();
+}
+
+// Starts the shared notifier thread on first use. Returns nullptr after throwing if that fails.
+NotifierScheduler* getNotifierScheduler(Napi::Env env) {
+    if (notifierScheduler != nullptr) return notifierScheduler;
+
+    int32_t status;
+    notifierScheduler = NotifierScheduler::Start(env, []() { notifierScheduler = nullptr; }, &status);
+    if (notifierScheduler == nullptr) {
+        Napi::Error::New(env, "Initializing notifier failed with error code " + std::to_string(status)).ThrowAsJavaScriptException();
+    }
+    return notifierScheduler;
+}
+
+// Params:
+//   notifierHandle: Number (optional), a handle from createNotifier(). Stops the notifier
+//                   created by initializeNotifier() if omitted.
+void stopNotifier(const Napi::CallbackInfo& info) {
+    if (info[0].IsNumber()) {
+        uint32_t notifierHandle = info[0].As<Napi::Number>().Uint32Value();
+        if (notifierScheduler == nullptr || !notifierScheduler->Stop(notifierHandle)) {
+            throwNotifierNotFoundError(info.Env());
+        }
+        return;
+    }
+
+    int32_t status = 0;
+    HAL_StopNotifier(m_notifier, &status);
+    HAL_CleanNotifier(m_notifier, &status);
+}
+
+// Returns:
+//   Number, the current FPGA time in microseconds, for computing notifier trigger times
+Napi::Number getFPGATime(const Napi::CallbackInfo& info) {
+    int32_t status = 0;
+    uint64_t time = HAL_GetFPGATime(&status);
+    if (status != 0) {
+        Napi::Error::New(info.Env(), "Reading FPGA time failed with error code " + std::to_string(status)).ThrowAsJavaScriptException();
+    }
+    return Napi::Number::New(info.Env(), time);
+}
+
+// Every notifier created here shares one native thread and one HAL notifier
+// Returns:
+//   Number, the handle to pass to the other notifier functions
+Napi::Number createNotifier(const Napi::CallbackInfo& info) {
+    NotifierScheduler* scheduler = getNotifierScheduler(info.Env());
+    if (scheduler == nullptr) return Napi::Number::New(info.Env(), 0);
+    return Napi::Number::New(info.Env(), scheduler->Create());
+}
+
+// Params:
+//   notifierHandle: Number
+//   triggerTime: Number, absolute FPGA time in microseconds (see getFPGATime())
+void updateNotifierAlarm(const Napi::CallbackInfo& info) {
+    uint32_t notifierHandle = info[0].As<Napi::Number>().Uint32Value();
+    uint64_t triggerTime = (uint64_t)info[1].As<Napi::Number>().DoubleValue();
+
+    if (notifierScheduler == nullptr || !notifierScheduler->UpdateAlarm(notifierHandle, triggerTime)) {
+        throwNotifierNotFoundError(info.Env());
+    }
+}
+
+// Params:
+//   notifierHandle: Number
+void cancelNotifierAlarm(const Napi::CallbackInfo& info) {
+    uint32_t notifierHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    if (notifierScheduler == nullptr || !notifierScheduler->CancelAlarm(notifierHandle)) {
+        throwNotifierNotFoundError(info.Env());
+    }
+}
+
+// Params:
+//   notifierHandle: Number
+// Returns:
+//   Promise that resolves with the FPGA time the alarm fired at, or 0 once the notifier is stopped
+Napi::Promise waitForNotifier(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t notifierHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    if (notifierScheduler == nullptr) {
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        deferred.Reject(Napi::Error::New(env, "Notifier handle not found").Value());
+        return deferred.Promise();
+    }
+    return notifierScheduler->Wait(env, notifierHandle);
+}
+
+// Stops the notifier and frees its handle
+// Params:
+//   notifierHandle: Number
+void cleanNotifier(const Napi::CallbackInfo& info) {
+    uint32_t notifierHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    if (notifierScheduler == nullptr || !notifierScheduler->Clean(notifierHandle)) {
+        throwNotifierNotFoundError(info.Env());
+    }
+}
+
+// Params:
+//   notifierHandle: Number
+// Returns:
+//   Object with alarm, overrun and late wake counters, or undefined if the handle does not exist
+Napi::Value getNotifierStats(const Napi::CallbackInfo& info) {
+    uint32_t notifierHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    NotifierStats stats;
+    if (notifierScheduler == nullptr || !notifierScheduler->GetStats(notifierHandle, &stats)) {
+        return info.Env().Undefined();
+    }
+    return stats.ToObject(info.Env());
+}
+
+// Params:
+//   periodUs: Number
+//   onTick: Function, called with the FPGA time of the tick and its jitter in microseconds
+// Returns:
+//   Number, the handle to pass to getPeriodicNotifierStats() and stopPeriodicNotifier()
+Napi::Number startPeriodicNotifier(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t periodUs = info[0].As<Napi::Number>().Uint32Value();
+    Napi::Function onTick = info[1].As<Napi::Function>();
+
+    if (periodUs == 0) {
+        Napi::RangeError::New(env, "periodUs must be greater than 0").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+
+    uint32_t notifierHandle = nextPeriodicNotifierHandle++;
+    int32_t status;
+    PeriodicNotifier* notifier = PeriodicNotifier::Start(env, onTick, periodUs,
+        [notifierHandle]() { periodicNotifiers.erase(notifierHandle); }, &status);
+    if (notifier == nullptr) {
+        Napi::Error::New(env, "Initializing notifier failed with error code " + std::to_string(status)).ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+
+    periodicNotifiers[notifierHandle] = notifier;
+    return Napi::Number::New(env, notifierHandle);
+}
+
+// Params:
+//   notifierHandle: Number
+// Returns:
+//   Object with tick, miss and jitter statistics, or undefined if the notifier is not running
+Napi::Value getPeriodicNotifierStats(const Napi::CallbackInfo& info) {
+    uint32_t notifierHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    auto notifierIterator = periodicNotifiers.find(notifierHandle);
+    if (notifierIterator == periodicNotifiers.end()) return info.Env().Undefined();
+    return notifierIterator->second->GetStats().ToObject(info.Env());
+}
+
+// Params:
+//   notifierHandle: Number
+// Returns:
+//   Object with the final statistics, or undefined if the notifier is not running
+Napi::Value stopPeriodicNotifier(const Napi::CallbackInfo& info) {
+    uint32_t notifierHandle = info[0].As<Napi::Number>().Uint32Value();
+
+    auto notifierIterator = periodicNotifiers.find(notifierHandle);
+    if (notifierIterator == periodicNotifiers.end()) return info.Env().Undefined();
+
+    // The notifier deletes itself once its thread has exited
+    PeriodicNotifier* notifier = notifierIterator->second;
+    periodicNotifiers.erase(notifierIterator);
+    notifier->Stop();
+    return notifier->GetStats().ToObject(info.Env());
+}
+
+struct DfuExtraction {
+    uint32_t imageIndex;
+    int elementIndex;
+    std::string fileName;
+};
+
+// Parses a DfuSe file once and writes elements of it to files, on a libuv worker thread. Every
+// index is checked before anything is written.
+class ExtractDfuWorker : public Napi::AsyncWorker {
+    public:
+        ExtractDfuWorker(Napi::Env env, std::string dfuFileName, std::vector<DfuExtraction> extractions, bool resolveWithStatus)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), dfuFileName(std::move(dfuFileName)),
+          extractions(std::move(extractions)), resolveWithStatus(resolveWithStatus) {}
+
+        ~ExtractDfuWorker() {}
+
+        Napi::Promise Promise() { return deferred.Promise(); }
+
+    void Execute() override {
+        const dfuse::DFUFile dfuFile(dfuFileName.c_str());
+        if (!dfuFile) {
+            SetError(dfuFile.Error());
+            return;
+        }
+
+        for (const DfuExtraction& extraction : extractions) {
+            if (extraction.imageIndex >= dfuFile.Images().size()) {
+                SetError("Image index out of range");
+                return;
+            }
+            const dfuse::DFUImage& image = dfuFile.Images()[extraction.imageIndex];
+            if (extraction.elementIndex < 0 || extraction.elementIndex >= image.Elements().size()) {
+                SetError("Element index out of range");
+                return;
+            }
+        }
+
+        for (const DfuExtraction& extraction : extractions) {
+            const dfuse::DFUImage& image = dfuFile.Images()[extraction.imageIndex];
+            std::string error;
+            if (!image.Write(extraction.fileName, extraction.elementIndex, dfuse::writer::Bin, &error)) {
+                SetError(error);
+                return;
+            }
+            bytesWritten += image.Elements()[extraction.elementIndex].Size();
+        }
+    }
+
+    void OnOK() override {
+        // writeDfuToBin() has always resolved to a status of 0
+        deferred.Resolve(Napi::Number::New(Env(), resolveWithStatus ? 0 : (double)bytesWritten));
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
+    }
+
+    private:
+        Napi::Promise::Deferred deferred;
+        std::string dfuFileName;
+        std::vector<DfuExtraction> extractions;
+        bool resolveWithStatus;
+        uint64_t bytesWritten = 0;
+};
+
+// Writes an element of the first image of a DfuSe file to a file, on a libuv worker thread
+// Params:
+//   dfuFileName: String
+//   binFileName: String
+//   elementIndex: Number (optional, defaults to 0)
+// Returns:
+//   Promise resolving to 0, or rejecting if the file is malformed, the element does not exist
+//   or the output file cannot be written
+Napi::Promise writeDfuToBin(const Napi::CallbackInfo& info) {
+    std::string dfuFileName = info[0].As<Napi::String>().Utf8Value();
+    std::string binFileName = info[1].As<Napi::String>().Utf8Value();
+    int elementIndex;
+
+    if(info[2].IsUndefined() || info[2].IsNull()) {
+        elementIndex = 0;
+    } else {
+        elementIndex = info[2].As<Napi::Number>().Int32Value();
+    }
+
+    ExtractDfuWorker* wk = new ExtractDfuWorker(info.Env(), dfuFileName, {{0, elementIndex, binFileName}}, true);
+    Napi::Promise promise = wk->Promise();
+    wk->Queue();
+    return promise;
+}
+
+// Writes any number of elements of a DfuSe file to files, parsing it once, on a libuv worker thread
+// Params:
+//   dfuFileName: String
+//   extractions: Array<Object{image?:Number, element:Number, fileName:String}>, image defaults to 0
+// Returns:
+//   Promise resolving to the number of bytes written, or rejecting like writeDfuToBin()
+Napi::Value extractDfuElements(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string dfuFileName = info[0].As<Napi::String>().Utf8Value();
+    Napi::Array extractionsParam = info[1].As<Napi::Array>();
+
+    std::vector<DfuExtraction> extractions;
+    for (uint32_t i = 0; i < extractionsParam.Length(); i++) {
+        Napi::Object extraction = extractionsParam.Get(i).As<Napi::Object>();
+        if (!extraction.Get("element").IsNumber() || !extraction.Get("fileName").IsString()) {
+            Napi::TypeError::New(env, "Each extraction needs an element and a fileName").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        uint32_t imageIndex = extraction.Get("image").IsNumber() ? extraction.Get("image").As<Napi::Number>().Uint32Value() : 0;
+        extractions.push_back({imageIndex, extraction.Get("element").As<Napi::Number>().Int32Value(),
+                               extraction.Get("fileName").As<Napi::String>().Utf8Value()});
+    }
+
+    ExtractDfuWorker* wk = new ExtractDfuWorker(env, dfuFileName, std::move(extractions), false);
+    Napi::Promise promise = wk->Promise();
+    wk->Queue();
+    return promise;
+}
+
+Napi::Array getImageElements(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string dfuFileName = info[0].As<Napi::String>().Utf8Value();
+    const int imageIndex = info[1].As<Napi::Number>().Int32Value();
+
+    Napi::Array elements = Napi::Array::New(env);
+
+    const dfuse::DFUFile dfuFile(dfuFileName.c_str());
+
+    if(!dfuFile) {
+        Napi::Error::New(env, dfuFile.Error()).ThrowAsJavaScriptException();
+        return elements;
+    }
+
+    if(imageIndex >= dfuFile.Images().size()) {
+        const std::string errorMessage = "Image index out of range";
+        Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
+        return elements;
+    }
+
+    const dfuse::DFUImage& image = dfuFile.Images()[imageIndex];
+
+    uint32_t elementsCount = 0;
+    for(const auto& element: image.Elements()) {
+        Napi::Object elementObject = Napi::Object::New(env);
+        elementObject.Set("startAddress", element.Address());
+        elementObject.Set("size", element.Size());
+
+        elements[elementsCount++] = elementObject;
+    }
+
+    return elements;
+}
+
+class VerifyDfuWorker : public Napi::AsyncWorker {
+    public:
+        VerifyDfuWorker(Napi::Function& callback, std::string fileName)
+        : Napi::AsyncWorker(callback), fileName(std::move(fileName)) {}
+
+        ~VerifyDfuWorker() {}
+
+    void Execute() override {
+        const dfuse::DFUFile dfuFile(fileName.c_str());
+        if (!dfuFile) {
+            error = dfuFile.Error();
+            return;
+        }
+        storedCrc = dfuFile.Crc();
+        computedCrc = dfuFile.ComputeCrc();
+    }
+
+    void OnOK() override {
+        Napi::HandleScope scope(Env());
+        Napi::Object result = Napi::Object::New(Env());
+        result.Set("valid", Napi::Boolean::New(Env(), error.empty() && storedCrc == computedCrc));
+        result.Set("storedCrc", Napi::Number::New(Env(), storedCrc));
+        result.Set("computedCrc", Napi::Number::New(Env(), computedCrc));
+        if (!error.empty()) result.Set("error", error);
+        Callback().Call({Env().Null(), result});
+    }
+
+    private:
+        std::string fileName;
+        std::string error;
+        uint32_t storedCrc = 0;
+        uint32_t computedCrc = 0;
+};
+
+// Checks the layout and the CRC of a DfuSe file on a libuv worker thread
+// Params:
+//   fileName: String
+//   callback: Function, called with Object{valid:Boolean, storedCrc:Number, computedCrc:Number, error?:String}
+void verifyDfu(const Napi::CallbackInfo& info) {
+    std::string fileName = info[0].As<Napi::String>().Utf8Value();
+    Napi::Function cb = info[1].As<Napi::Function>();
+
+    VerifyDfuWorker* wk = new VerifyDfuWorker(cb, fileName);
+    wk->Queue();
+}
+
+// The next tap of the device starts its sequence over, so its signal decoders read its cache from the start
+void restartSignalSequences(const std::string& descriptor) {
+    for (auto& entry : signalDecoders) {
+        if (entry.second.descriptor == descriptor) entry.second.cacheSequence = 0;
+    }
+}
+
+// Returns the tap that keeps the latest-value cache of the device up to date, starting it on first
+// use. Returns nullptr after throwing if the device does not exist or its stream session cannot be opened.
+// If deviceOut is set, it receives the device the tap reads from (nullptr for the HAL).
+//
+// A tap holds a stream session that passes every frame and a native thread polling it. It stops once
+// releaseReceiveTap() is called, its device goes away, or it was not used for RECEIVE_TAP_IDLE_TIMEOUT_MS
+// (unless it is recording a capture). The next call starts a new one.
+ReceiveTap* getReceiveTap(Napi::Env env, const Napi::Value& deviceParam, std::string* descriptorOut = nullptr,
+                          std::shared_ptr<rev::usb::CANDevice>* deviceOut = nullptr) {
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(deviceParam, descriptor);
+    if (descriptorOut != nullptr) *descriptorOut = descriptor;
+    if (deviceOut != nullptr) *deviceOut = device;
+
+    auto tapIterator = receiveTaps.find(descriptor);
+    if (tapIterator != receiveTaps.end()) {
+        ReceiveTapEntry& entry = tapIterator->second;
+        if (entry.tap->IsRunning() && entry.device.lock() == device) {
+            entry.tap->Touch();
+            return entry.tap.get();
+        }
+        receiveTaps.erase(tapIterator);
+        restartSignalSequences(descriptor);
+    }
+
+    StreamSubscription::ReadFunction read;
+    StreamSubscription::CloseFunction close;
+    std::shared_ptr<DeviceClock> clock;
+    if (!openStreamReader(env, device, descriptor, 0, 0, RECEIVE_TAP_SESSION_SIZE, &read, &close, &clock)) return nullptr;
+
+    ReceiveTapEntry entry;
+    entry.device = device;
+    entry.tap = std::make_unique<ReceiveTap>(read, close, clock);
+
+    // Start from what the driver already received, so the first read is not empty
+    std::map<uint32_t, std::shared_ptr<rev::usb::CANMessage>> messages;
+    if (device && device->CopyReceivedMessagesMap(messages)) {
+        for (auto& m : messages) {
+            const auto& message = m.second;
+            entry.tap->Cache().Update(m.first, clock->Extend((uint32_t)message->GetTimestampUs()), message->GetData(), message->GetSize());
+        }
+    }
+    entry.tap->Start();
+
+    ReceiveTap* tap = entry.tap.get();
+    receiveTaps[descriptor] = std::move(entry);
+    return tap;
+}
+
+// Stops the tap of the device and closes its stream session. Returns false if it has none, or if it is
+// recording a capture, in which case it keeps running until the capture stops.
+bool stopReceiveTap(const std::string& descriptor) {
+    auto tapIterator = receiveTaps.find(descriptor);
+    if (tapIterator == receiveTaps.end() || tapIterator->second.tap->IsCapturing()) return false;
+    receiveTaps.erase(tapIterator);
+    restartSignalSequences(descriptor);
+    return true;
+}
+
+Napi::Object latestValueToObject(Napi::Env env, const LatestValueCache::Entry& entry) {
+    Napi::Array data = Napi::Array::New(env, entry.dataSize);
+    for (int i = 0; i < entry.dataSize; i++) {
+        data[i] = Napi::Number::New(env, entry.data[i]);
+    }
+    Napi::Object messageInfo = Napi::Object::New(env);
+    messageInfo.Set("messageID", entry.messageId);
+    messageInfo.Set("timeStamp", Napi::Number::New(env, entry.timeStamp));
+    messageInfo.Set("data", data);
+    return messageInfo;
+}
+
+// Collects the messages of the tap updated after sinceSequence that are at most maxAgeMs old (UINT32_MAX
+// for any age) into an Object mapping arbitration IDs to messages, and returns the sequence to pass next
+// time. Ages are measured on the device clock, so they are only known once it has seen a frame read from
+// the device. Until then, the messages the tap was seeded with count as too old.
+uint64_t collectLatestMessages(Napi::Env env, ReceiveTap& tap, uint64_t sinceSequence, uint32_t maxAgeMs, Napi::Object result) {
+    // Read before the clock, which the tap feeds before it updates the cache
+    const uint64_t sequence = tap.Cache().Sequence();
+    ClockModel clock = tap.Clock().Model();
+    const uint64_t deviceNowUs = clock.ToDeviceUs(DeviceClock::HostNowUs());
+    const uint64_t maxAgeUs = (uint64_t)maxAgeMs * 1000;
+    const bool anyAge = maxAgeMs == UINT32_MAX;
+    if (!anyAge && !clock.valid) return sequence;
+
+    return tap.Cache().ForEachUpdatedSince(sinceSequence, [&](const LatestValueCache::Entry& entry) {
+        if (!anyAge && deviceNowUs > entry.timeStamp && deviceNowUs - entry.timeStamp > maxAgeUs) return;
+        result.Set(entry.messageId, latestValueToObject(env, entry));
+    });
+}
+
+// Served from a native latest-value cache that a background stream session keeps up to date
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+//   maxAgeMs: Number
+// Returns:
+//   messages: Object mapping arbitration IDs to Object{data:Number[], messageID:number, timeStamp:number}
+Napi::Object getLatestMessageOfEveryReceivedArbId(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint32_t maxAgeMs = info[1].As<Napi::Number>().Uint32Value();
+
+    Napi::Object result = Napi::Object::New(env);
+    ReceiveTap* tap = getReceiveTap(env, info[0]);
+    if (tap == nullptr) return result;
+
+    collectLatestMessages(env, *tap, 0, maxAgeMs, result);
+    return result;
+}
+
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+//   sinceSequence: Number, 0 or the sequence returned by the previous call
+//   maxAgeMs: Number (optional)
+// Returns:
+//   Object{sequence:Number, messages:Object mapping arbitration IDs to messages updated after sinceSequence}
+Napi::Object getLatestMessagesSince(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint64_t sinceSequence = (uint64_t)info[1].As<Napi::Number>().DoubleValue();
+    uint32_t maxAgeMs = info[2].IsNumber() ? info[2].As<Napi::Number>().Uint32Value() : UINT32_MAX;
+
+    Napi::Object result = Napi::Object::New(env);
+    ReceiveTap* tap = getReceiveTap(env, info[0]);
+    if (tap == nullptr) return result;
+
+    Napi::Object messages = Napi::Object::New(env);
+    uint64_t sequence = collectLatestMessages(env, *tap, sinceSequence, maxAgeMs, messages);
+    result.Set("sequence", Napi::Number::New(env, sequence));
+    result.Set("messages", messages);
+    return result;
+}
+
+// Stops the native thread and closes the stream session behind the latest-value cache and traffic
+// statistics of the device, which otherwise keep running from the first query until the device goes
+// away or nothing queried them for RECEIVE_TAP_IDLE_TIMEOUT_MS. The next query starts them again with
+// a cache seeded from the received-messages map, and sequences returned before do not carry over. A
+// device that is recording a capture keeps its tap until the capture stops.
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+// Returns:
+//   released: Boolean, false if the device had no tap or it is recording a capture
+Napi::Boolean releaseReceiveTap(const Napi::CallbackInfo& info) {
+    std::string descriptor;
+    findDevice(info[0], descriptor);
+    return Napi::Boolean::New(info.Env(), stopReceiveTap(descriptor));
+}
+
+// Writes the latest message of every arbitration ID updated after sinceSequence into buffer, without
+// allocating a JS object per message. If buffer is too small, the oldest updates are written first and
+// the returned sequence picks up with the rest.
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+//   buffer: ArrayBuffer | TypedArray, filled with PACKED_FRAME_RECORD_SIZE byte records
+//   sinceSequence: Number, 0 or the sequence returned by the previous call
+//   columns: Object{deviceType?, manufacturer?, apiClass?, apiIndex?, deviceNumber?} of Uint8Arrays (optional)
+// Returns:
+//   Object{count:Number, sequence:Number}
+Napi::Object readLatestMessagesPacked(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint64_t sinceSequence = (uint64_t)info[2].As<Napi::Number>().DoubleValue();
+    Napi::Object result = Napi::Object::New(env);
+
+    uint8_t* buffer;
+    size_t byteLength;
+    if (!getBufferBytes(info[1], &buffer, &byteLength)) {
+        Napi::TypeError::New(env, "buffer must be an ArrayBuffer or a TypedArray").ThrowAsJavaScriptException();
+        return result;
+    }
+    size_t maxMessages = byteLength / PACKED_FRAME_RECORD_SIZE;
+    ArbIdColumns columns;
+    if (!readArbIdColumns(env, info[3], &columns, &maxMessages)) return result;
+
+    ReceiveTap* tap = getReceiveTap(env, info[0]);
+    if (tap == nullptr) return result;
+
+    latestValueScratch.clear();
+    uint64_t sequence = tap->Cache().ForEachUpdatedSince(sinceSequence, [](const LatestValueCache::Entry& entry) {
+        latestValueScratch.push_back(entry);
+    });
+    if (latestValueScratch.size() > maxMessages) {
+        std::sort(latestValueScratch.begin(), latestValueScratch.end(), [](const auto& a, const auto& b) {
+            return a.updateSequence < b.updateSequence;
+        });
+        latestValueScratch.resize(maxMessages);
+        sequence = maxMessages > 0 ? latestValueScratch.back().updateSequence : sinceSequence;
+    }
+
+    for (size_t i = 0; i < latestValueScratch.size(); i++) {
+        const LatestValueCache::Entry& entry = latestValueScratch[i];
+        packFrame(buffer + i * PACKED_FRAME_RECORD_SIZE, entry.messageId, entry.timeStamp, entry.data, entry.dataSize);
+    }
+    decodePackedArbIds(buffer, latestValueScratch.size(), columns);
+    result.Set("count", Napi::Number::New(env, latestValueScratch.size()));
+    result.Set("sequence", Napi::Number::New(env, sequence));
+    return result;
+}
+
+// Registers signal layouts for a device. Frames read through receiveMessage(), readStreamSession() and
+// readStreamSessionPacked() are decoded into values as they are read, and updateSignals() decodes
+// whatever else the device received from its received-messages map.
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+//   layouts: Array<Object{messageId:Number, startBit:Number, length:Number, littleEndian?:Boolean,
+//                         signed?:Boolean, scale?:Number, offset?:Number}>
+//   values: Float64Array, values[i] receives the latest value of layouts[i]
+// Returns:
+//   decoderHandle: Number
+Napi::Number registerSignals(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Array layoutsArray = info[1].As<Napi::Array>();
+
+    std::string descriptor;
+    if (!findDevice(info[0], descriptor)) {
+        throwDeviceNotFoundError(env);
+        return Napi::Number::New(env, 0);
+    }
+    if (!info[2].IsTypedArray() || info[2].As<Napi::TypedArray>().TypedArrayType() != napi_float64_array ||
+        info[2].As<Napi::Float64Array>().ElementLength() < layoutsArray.Length()) {
+        Napi::TypeError::New(env, "values must be a Float64Array with an element per layout").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+
+    std::vector<SignalLayout> layouts;
+    for (uint32_t i = 0; i < layoutsArray.Length(); i++) {
+        Napi::Object layoutObject = layoutsArray.Get(i).As<Napi::Object>();
+        SignalLayout layout;
+        layout.messageId = layoutObject.Get("messageId").As<Napi::Number>().Uint32Value();
+        layout.startBit = layoutObject.Get("startBit").As<Napi::Number>().Uint32Value();
+        layout.length = layoutObject.Get("length").As<Napi::Number>().Uint32Value();
+        if (layoutObject.Get("littleEndian").IsBoolean()) layout.littleEndian = layoutObject.Get("littleEndian").As<Napi::Boolean>().Value();
+        if (layoutObject.Get("signed").IsBoolean()) layout.isSigned = layoutObject.Get("signed").As<Napi::Boolean>().Value();
+        if (layoutObject.Get("scale").IsNumber()) layout.scale = layoutObject.Get("scale").As<Napi::Number>().DoubleValue();
+        if (layoutObject.Get("offset").IsNumber()) layout.offset = layoutObject.Get("offset").As<Napi::Number>().DoubleValue();
+        layouts.push_back(layout);
+    }
+
+    std::string error;
+    std::unique_ptr<SignalDecoder> decoder = SignalDecoder::Create(layouts, &error);
+    if (!decoder) {
+        Napi::RangeError::New(env, error).ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+
+    uint32_t decoderHandle = nextSignalDecoderHandle++;
+    SignalDecoderEntry& entry = signalDecoders[decoderHandle];
+    entry.descriptor = descriptor;
+    entry.decoder = std::move(decoder);
+    entry.values = Napi::Persistent(info[2].As<Napi::Float64Array>());
+    return Napi::Number::New(env, decoderHandle);
+}
+
+// Decodes the frames the device received since the last call, from the same cache that backs
+// getLatestMessageOfEveryReceivedArbId(), so it does not consume any stream session.
+// Params:
+//   decoderHandle: Number
 // Returns:
-//   messages: Array
-Napi::Array readHALStreamSession(const Napi::CallbackInfo& info) {
+//   Number of frames decoded
+Napi::Number updateSignals(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    uint32_t streamHandle = info[0].As<Napi::Number>().Uint32Value();
-    uint32_t numMessages = info[1].As<Napi::Number>().Uint32Value();
+    auto decoderIterator = signalDecoders.find(info[0].As<Napi::Number>().Uint32Value());
+    if (decoderIterator == signalDecoders.end()) {
+        Napi::Error::New(env, "Signal decoder handle not found").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+    SignalDecoderEntry& entry = decoderIterator->second;
 
-    int32_t status;
-    uint32_t messagesRead;
-    HAL_CANStreamMessage *messages = new HAL_CANStreamMessage[numMessages];
-    HAL_CAN_ReadStreamSession(streamHandle, messages, numMessages, &messagesRead, &status);
-    Napi::Array messageArray = Napi::Array::New(env);
-    for (uint32_t i = 0; i < messagesRead && i < numMessages; i++) {
-            Napi::HandleScope scope(env);
-            Napi::Object message = Napi::Object::New(env);
-            message.Set("messageID", messages[i].messageID);
-            message.Set("timeStamp", messages[i].timeStamp);
-
-            int messageLength = std::min((int)messages[i].dataSize, 8);
-            Napi::Array data = Napi::Array::New(env, messageLength);
-            for (int m = 0; m < messageLength; m++) {
-                Napi::HandleScope scope(env);
-                data[m] = Napi::Number::New(env, messages[i].data[m]);
-            }
-            message.Set("data", data);
-            messageArray[i] = message;
+    ReceiveTap* tap = getReceiveTap(env, Napi::String::New(env, entry.descriptor));
+    if (tap == nullptr) return Napi::Number::New(env, 0);
+
+    uint32_t decoded = 0;
+    double* values = entry.values.Value().Data();
+    entry.cacheSequence = tap->Cache().ForEachUpdatedSince(entry.cacheSequence, [&](const LatestValueCache::Entry& latest) {
+        if (entry.decoder->Decode(latest.messageId, latest.data, latest.dataSize, values)) decoded++;
+    });
+    return Napi::Number::New(env, decoded);
+}
+
+// Params:
+//   decoderHandle: Number
+void unregisterSignals(const Napi::CallbackInfo& info) {
+    signalDecoders.erase(info[0].As<Napi::Number>().Uint32Value());
+}
+
+// Statistics of every arbitration ID the device received, collected by the same native thread that keeps
+// its latest-value cache up to date. Collection starts with the first call, like the cache. IDs are in
+// ascending order, and histogram holds TRAFFIC_HISTOGRAM_BUCKETS counts per ID, one ID after the other.
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+// Returns:
+//   Object{count:Number, messageId:Uint32Array, frames:Uint32Array, framesPerSecond:Float64Array,
+//          periodUs:Uint32Array, maxGapUs:Uint32Array, missed:Uint32Array, sinceLastUs:Uint32Array,
+//          histogram:Uint32Array, histogramBucketLowerUs:Uint32Array, overflows:Number}
+Napi::Object getTrafficStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object result = Napi::Object::New(env);
+    ReceiveTap* tap = getReceiveTap(env, info[0]);
+    if (tap == nullptr) return result;
+
+    const TrafficStats& traffic = tap->Traffic();
+    uint64_t newestTimeStamp = traffic.NewestTimeStamp();
+    trafficStatsScratch.clear();
+    traffic.ForEach([](const TrafficStats::Entry& entry) {
+        trafficStatsScratch.push_back(entry);
+    });
+    std::sort(trafficStatsScratch.begin(), trafficStatsScratch.end(), [](const auto& a, const auto& b) {
+        return a.messageId < b.messageId;
+    });
+
+    size_t count = trafficStatsScratch.size();
+    Napi::Uint32Array messageIds = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array frames = Napi::Uint32Array::New(env, count);
+    Napi::Float64Array framesPerSecond = Napi::Float64Array::New(env, count);
+    Napi::Uint32Array periodUs = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array maxGapUs = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array missed = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array sinceLastUs = Napi::Uint32Array::New(env, count);
+    Napi::Uint32Array histogram = Napi::Uint32Array::New(env, count * TRAFFIC_HISTOGRAM_BUCKETS);
+    for (size_t i = 0; i < count; i++) {
+        const TrafficStats::Entry& entry = trafficStatsScratch[i];
+        messageIds[i] = entry.messageId;
+        frames[i] = entry.frames;
+        framesPerSecond[i] = entry.framesPerSecond;
+        periodUs[i] = entry.periodUs;
+        maxGapUs[i] = entry.maxGapUs;
+        missed[i] = entry.missed;
+        // An ID recorded after NewestTimeStamp() was read would come out negative
+        int64_t sinceLast = (int64_t)(newestTimeStamp - entry.lastTimeStamp);
+        sinceLastUs[i] = (uint32_t)std::clamp<int64_t>(sinceLast, 0, UINT32_MAX);
+        std::memcpy(histogram.Data() + i * TRAFFIC_HISTOGRAM_BUCKETS, entry.histogram, sizeof(entry.histogram));
     }
-    delete[] messages;
-    return messageArray;
+    Napi::Uint32Array bucketLowerUs = Napi::Uint32Array::New(env, TRAFFIC_HISTOGRAM_BUCKETS);
+    for (uint32_t b = 0; b < TRAFFIC_HISTOGRAM_BUCKETS; b++) {
+        bucketLowerUs[b] = TrafficStats::BucketLowerBoundUs(b);
+    }
+
+    result.Set("count", Napi::Number::New(env, count));
+    result.Set("messageId", messageIds);
+    result.Set("frames", frames);
+    result.Set("framesPerSecond", framesPerSecond);
+    result.Set("periodUs", periodUs);
+    result.Set("maxGapUs", maxGapUs);
+    result.Set("missed", missed);
+    result.Set("sinceLastUs", sinceLastUs);
+    result.Set("histogram", histogram);
+    result.Set("histogramBucketLowerUs", bucketLowerUs);
+    result.Set("overflows", Napi::Number::New(env, (double)traffic.Overflows()));
+    return result;
 }
 
+// Clears the device's traffic statistics. The native thread clears them before it records its next frame.
 // Params:
-//   streamHandle: Number
-void closeHALStreamSession(const Napi::CallbackInfo& info) {
+//   descriptor: String, or Number handle from openDevice()
+void resetTrafficStats(const Napi::CallbackInfo& info) {
+    ReceiveTap* tap = getReceiveTap(info.Env(), info[0]);
+    if (tap == nullptr) return;
+    tap->Traffic().RequestReset();
+}
+
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+// Returns:
+//   Object{samples:Number, offsetUs:Number, referenceUs:Number, driftPpm:Number, windows:Number, resyncs:Number,
+//          hostNowUs:Number, deviceNowUs:Number}
+Napi::Object getDeviceClock(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    uint32_t streamHandle = info[0].As<Napi::Number>().Uint32Value();
-    HAL_CAN_CloseStreamSession(streamHandle);
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    if (!device && !deviceRegistry.IsRegisteredToHal(descriptor)) {
+        throwDeviceNotFoundError(env);
+        return Napi::Object::New(env);
+    }
+    return clockFor(device, descriptor)->Stats().ToObject(env);
 }
 
-void initializeNotifier(const Napi::CallbackInfo& info) {
-    int32_t status;
-    m_notifier = HAL_InitializeNotifier(&status);
+Napi::Object captureStatsToObject(Napi::Env env, const CaptureStats& stats) {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("recorded", Napi::Number::New(env, stats.recorded));
+    result.Set("dropped", Napi::Number::New(env, stats.dropped));
+    return result;
 }
 
-void waitForNotifierAlarm(const Napi::CallbackInfo& info) {
-    uint32_t time = info[0].As<Napi::Number>().Uint32Value();
-    Napi::Function cb = info[1].As<Napi::Function>();
-    int32_t status;
+// Records every frame received by the given devices, and every frame sent to any device, into a
+// memory-mapped ring file. Recording never blocks the send and receive paths.
+// Params:
+//   fileName: String
+//   descriptors: Array<String | Number handle from openDevice()>, the devices to record received frames from
+//   options: Object{maxRecords?:Number} (optional), how many records the ring file holds
+void startCapture(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string fileName = info[0].As<Napi::String>().Utf8Value();
+    Napi::Array descriptors = info[1].As<Napi::Array>();
+
+    uint64_t maxRecords = CAPTURE_DEFAULT_MAX_RECORDS;
+    if (info[2].IsObject()) {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (options.Get("maxRecords").IsNumber()) maxRecords = (uint64_t)options.Get("maxRecords").As<Napi::Number>().DoubleValue();
+    }
+
+    CaptureLogger& capture = CaptureLogger::Instance();
+    if (capture.IsActive()) {
+        Napi::Error::New(env, "A capture is already running").ThrowAsJavaScriptException();
+        return;
+    }
+
+    std::vector<std::pair<std::string, const void*>> channels;
+    std::vector<ReceiveTap*> taps;
+    for (uint32_t i = 0; i < descriptors.Length(); i++) {
+        std::string descriptor;
+        std::shared_ptr<rev::usb::CANDevice> device;
+        ReceiveTap* tap = getReceiveTap(env, descriptors.Get(i), &descriptor, &device);
+        if (tap == nullptr) return;
+        channels.emplace_back(descriptor, device.get());
+        taps.push_back(tap);
+    }
 
-    HAL_UpdateNotifierAlarm(m_notifier, HAL_GetFPGATime(&status) + time, &status);
-    // TODO(Noah): Don't discard the returned value (this function is marked as [nodiscard])
-    HAL_WaitForNotifierAlarm(m_notifier, &status);
-    cb.Call(info.Env().Global(), {info.Env().Null(), Napi::Number::New(info.Env(), status)});
+    std::string error;
+    if (!capture.Start(fileName, maxRecords, channels, &error)) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return;
+    }
+    for (size_t i = 0; i < taps.size(); i++) {
+        taps[i]->SetCaptureChannel(i);
+    }
 }
 
-void stopNotifier(const Napi::CallbackInfo& info) {
-    int32_t status;
-    HAL_StopNotifier(m_notifier, &status);
-    HAL_CleanNotifier(m_notifier, &status);
+Napi::Object stopCaptureAndTaps(Napi::Env env, double lastSeconds) {
+    for (auto& entry : receiveTaps) {
+        entry.second.tap->SetCaptureChannel(-1);
+    }
+    return captureStatsToObject(env, CaptureLogger::Instance().Stop(lastSeconds));
 }
 
-Napi::Promise writeDfuToBin(const Napi::CallbackInfo& info) {
-    std::string dfuFileName = info[0].As<Napi::String>().Utf8Value();
-    std::string binFileName = info[1].As<Napi::String>().Utf8Value();
-    int elementIndex;
+// Returns:
+//   Object{recorded:Number, dropped:Number}
+Napi::Object stopCapture(const Napi::CallbackInfo& info) {
+    return stopCaptureAndTaps(info.Env(), 0);
+}
 
-    if(info[2].IsUndefined() || info[2].IsNull()) {
-        elementIndex = 0;
-    } else {
-        elementIndex = info[2].As<Napi::Number>().Int32Value();
+// Stops the capture and trims it to the last lastSeconds seconds, so the file keeps what led up to an event
+// Params:
+//   lastSeconds: Number
+// Returns:
+//   Object{recorded:Number, dropped:Number}
+Napi::Object freezeCapture(const Napi::CallbackInfo& info) {
+    double lastSeconds = info[0].As<Napi::Number>().DoubleValue();
+    if (!(lastSeconds > 0)) {
+        Napi::RangeError::New(info.Env(), "lastSeconds must be greater than 0").ThrowAsJavaScriptException();
+        return Napi::Object::New(info.Env());
     }
+    return stopCaptureAndTaps(info.Env(), lastSeconds);
+}
 
-    dfuse::DFUFile dfuFile(dfuFileName.c_str());
-    int status = 0;
-    if (dfuFile && dfuFile.Images().size() > 0 && dfuFile.Images()[0]) {
-        dfuFile.Images()[0].Write(binFileName, elementIndex, dfuse::writer::Bin);
-    } else {
-        status = 1;
-    }
-    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(info.Env());
+// Returns:
+//   Object{recorded:Number, dropped:Number}
+Napi::Object getCaptureStats(const Napi::CallbackInfo& info) {
+    return captureStatsToObject(info.Env(), CaptureLogger::Instance().GetStats());
+}
 
-    deferred.Resolve(Napi::Number::New(info.Env(), status));
-    return deferred.Promise();
+// Copies the running capture to a new file while it keeps running
+// Params:
+//   fileName: String
+//   lastSeconds: Number (optional), only copy this many seconds. Copies everything if omitted.
+// Returns:
+//   Number, the number of records copied
+Napi::Number snapshotCapture(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string fileName = info[0].As<Napi::String>().Utf8Value();
+    double lastSeconds = info[1].IsNumber() ? info[1].As<Napi::Number>().DoubleValue() : 0;
+
+    std::string error;
+    int64_t count = CaptureLogger::Instance().Snapshot(fileName, lastSeconds, &error);
+    if (count < 0) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+    return Napi::Number::New(env, count);
 }
 
-Napi::Array getImageElements(const Napi::CallbackInfo& info) {
+// Maps a capture file for reading without loading it
+// Params:
+//   fileName: String
+// Returns:
+//   Object{handle:Number, recordCount:Number, droppedRecords:Number, startWallTimeUs:Number, frozen:Boolean, channels:String[]}
+Napi::Object openCaptureFile(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string dfuFileName = info[0].As<Napi::String>().Utf8Value();
-    const int imageIndex = info[1].As<Napi::Number>().Int32Value();
+    std::string fileName = info[0].As<Napi::String>().Utf8Value();
+    Napi::Object result = Napi::Object::New(env);
 
-    Napi::Array elements = Napi::Array::New(env);
+    std::string error;
+    std::unique_ptr<CaptureReader> reader = CaptureReader::Open(fileName, &error);
+    if (!reader) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return result;
+    }
 
-    const dfuse::DFUFile dfuFile(dfuFileName.c_str());
+    const CaptureFileHeader& header = reader->Header();
+    Napi::Array channels = Napi::Array::New(env, header.channelCount);
+    for (uint32_t i = 0; i < header.channelCount; i++) {
+        channels[i] = Napi::String::New(env, std::string(header.channels[i], strnlen(header.channels[i], CAPTURE_CHANNEL_NAME_SIZE)));
+    }
 
-    if(imageIndex >= dfuFile.Images().size()) {
-        const std::string errorMessage = "Image index out of range";
-        Napi::Error::New(env, errorMessage).ThrowAsJavaScriptException();
-        return elements;
+    uint32_t readerHandle = nextCaptureReaderHandle++;
+    result.Set("handle", Napi::Number::New(env, readerHandle));
+    result.Set("recordCount", Napi::Number::New(env, reader->Count()));
+    result.Set("droppedRecords", Napi::Number::New(env, header.droppedRecords));
+    result.Set("startWallTimeUs", Napi::Number::New(env, header.startWallTimeUs));
+    result.Set("frozen", Napi::Boolean::New(env, (header.flags & CAPTURE_FLAG_FROZEN) != 0));
+    result.Set("channels", channels);
+    captureReaders[readerHandle] = std::move(reader);
+    return result;
+}
+
+// Returns nullptr after throwing if the handle is not open
+CaptureReader* findCaptureReader(Napi::Env env, const Napi::Value& handleParam) {
+    auto readerIterator = captureReaders.find(handleParam.As<Napi::Number>().Uint32Value());
+    if (readerIterator == captureReaders.end()) {
+        Napi::Error::New(env, "Capture file handle not found").ThrowAsJavaScriptException();
+        return nullptr;
     }
+    return readerIterator->second.get();
+}
 
-    const dfuse::DFUImage image = dfuFile.Images()[imageIndex];
+// Params:
+//   handle: Number, from openCaptureFile()
+//   firstRecord: Number
+//   buffer: ArrayBuffer | TypedArray, filled with CAPTURE_RECORD_SIZE byte records
+// Returns:
+//   Number, the number of records written
+Napi::Number readCaptureRecords(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    uint64_t firstRecord = (uint64_t)info[1].As<Napi::Number>().DoubleValue();
 
-    uint32_t elementsCount = 0;
-    for(auto element: image.Elements()) {
-        Napi::Object elementObject = Napi::Object::New(env);
-        elementObject.Set("startAddress", element.Address());
-        elementObject.Set("size", element.Size());
+    CaptureReader* reader = findCaptureReader(env, info[0]);
+    if (reader == nullptr) return Napi::Number::New(env, 0);
 
-        elements[elementsCount++] = elementObject;
+    uint8_t* buffer;
+    size_t byteLength;
+    if (!getBufferBytes(info[2], &buffer, &byteLength)) {
+        Napi::TypeError::New(env, "buffer must be an ArrayBuffer or a TypedArray").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
     }
 
-    return elements;
+    uint64_t count = 0;
+    uint64_t maxRecords = byteLength / CAPTURE_RECORD_SIZE;
+    for (uint64_t i = firstRecord; i < reader->Count() && count < maxRecords; i++, count++) {
+        std::memcpy(buffer + count * CAPTURE_RECORD_SIZE, &reader->At(i), CAPTURE_RECORD_SIZE);
+    }
+    return Napi::Number::New(env, count);
 }
 
-Napi::Object getLatestMessageOfEveryReceivedArbId(const Napi::CallbackInfo& info) {
+// Params:
+//   handle: Number, from openCaptureFile()
+//   timeUs: Number, microseconds since the capture started
+// Returns:
+//   Number, the first record at or after timeUs, or the record count if there is none
+Napi::Number findCaptureRecord(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
-    std::string descriptor = info[0].As<Napi::String>().Utf8Value();
-    uint32_t maxAgeMs = info[1].As<Napi::Number>().Uint32Value();
+    uint64_t timeUs = (uint64_t)info[1].As<Napi::Number>().DoubleValue();
+
+    CaptureReader* reader = findCaptureReader(env, info[0]);
+    if (reader == nullptr) return Napi::Number::New(env, 0);
+    return Napi::Number::New(env, reader->Find(timeUs));
+}
 
-    std::shared_ptr<rev::usb::CANDevice> device;
+// Params:
+//   handle: Number, from openCaptureFile()
+void closeCaptureFile(const Napi::CallbackInfo& info) {
+    captureReaders.erase(info[0].As<Napi::Number>().Uint32Value());
+}
 
-    { // This block exists to define how long we hold canDevicesMtx
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator == canDeviceMap.end()) {
-            if (devicesRegisteredToHal.find(descriptor) != devicesRegisteredToHal.end()) return receiveHalMessage(info);
-            throwDeviceNotFoundError(env);
-            return Napi::Object::New(env);
+// Sends the records of a capture file to a device with their recorded timing, from a native thread.
+// Works with virtual devices and devices registered to the HAL. Records are sent once, which in the
+// driver also cancels a repeat of the same ID, so records of an ID that sendCANMessage() repeats are
+// skipped and counted as failed sends.
+// Params:
+//   fileName: String
+//   descriptor: String
+//   options: Object{speed?:Number, loop?:Boolean, direction?:"all"|"received"|"sent",
+//                   filters?:Array<Object{messageId:Number, messageMask:Number}>} (optional)
+// Returns:
+//   Number, the handle to pass to waitForReplay(), getReplayStats() and stopReplay()
+Napi::Number startReplay(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string fileName = info[0].As<Napi::String>().Utf8Value();
+    std::string descriptor = info[1].As<Napi::String>().Utf8Value();
+
+    ReplayOptions options;
+    if (info[2].IsObject()) {
+        Napi::Object optionsParam = info[2].As<Napi::Object>();
+        if (optionsParam.Get("speed").IsNumber()) options.speed = optionsParam.Get("speed").As<Napi::Number>().DoubleValue();
+        if (optionsParam.Get("loop").IsBoolean()) options.loop = optionsParam.Get("loop").As<Napi::Boolean>().Value();
+        if (optionsParam.Get("direction").IsString()) {
+            std::string direction = optionsParam.Get("direction").As<Napi::String>().Utf8Value();
+            options.sendReceived = direction != "sent";
+            options.sendTransmitted = direction != "received";
+        }
+        if (optionsParam.Get("filters").IsArray()) {
+            Napi::Array filters = optionsParam.Get("filters").As<Napi::Array>();
+            for (uint32_t i = 0; i < filters.Length(); i++) {
+                Napi::Object filter = filters.Get(i).As<Napi::Object>();
+                options.filters.emplace_back(filter.Get("messageId").As<Napi::Number>().Uint32Value(),
+                                             filter.Get("messageMask").As<Napi::Number>().Uint32Value());
+            }
         }
-        device = deviceIterator->second;
+    }
+    if (!(options.speed > 0)) {
+        Napi::RangeError::New(env, "speed must be greater than 0").ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
+    }
+    if (!deviceRegistry.Contains(descriptor) && !deviceRegistry.IsRegisteredToHal(descriptor)) {
+        throwDeviceNotFoundError(env);
+        return Napi::Number::New(env, 0);
     }
 
-    std::map<uint32_t, std::shared_ptr<rev::usb::CANMessage>> messages;
-    bool success = device->CopyReceivedMessagesMap(messages);
-    if (!success) {
-        Napi::Error::New(env, "Failed to copy the map of received messages").ThrowAsJavaScriptException();
-        return Napi::Object::New(env);
+    std::string error;
+    std::unique_ptr<CaptureReader> reader = CaptureReader::Open(fileName, &error);
+    if (!reader) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return Napi::Number::New(env, 0);
     }
 
-     // TODO(Harper): Use HAL clock
-    const auto nowMs = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()).time_since_epoch().count();
+    uint32_t replayHandle = nextReplayHandle++;
+    ReplayEngine* engine = ReplayEngine::Start(env, std::move(reader),
+        [descriptor](uint32_t messageId, uint8_t* data, uint8_t dataSize) {
+            return sendMessageOnce(descriptor, messageId, data, dataSize);
+        },
+        options,
+        [replayHandle](const ReplayStats& stats) {
+            auto replayIterator = replays.find(replayHandle);
+            if (replayIterator == replays.end()) return;
+            ReplayEntry& entry = replayIterator->second;
+            if (entry.waiters.empty() && !entry.stopped) {
+                // Kept for the waitForReplay() that is yet to come
+                entry.engine = nullptr;
+                entry.finalStats = stats;
+                return;
+            }
+            for (auto& deferred : entry.waiters) {
+                deferred.Resolve(stats.ToObject(deferred.Env()));
+            }
+            replays.erase(replayIterator);
+        });
+    replays[replayHandle].engine = engine;
+    return Napi::Number::New(env, replayHandle);
+}
 
-    Napi::Object result = Napi::Object::New(env);
-    for (auto& m: messages) {
-        uint32_t arbId = m.first;
-        auto message = m.second;
-        uint32_t timestampMs = message->GetTimestampUs();
+// The handle is released once the promise resolves. A stopped replay's handle is released once it has
+// ended, so wait for it in the same tick as stopReplay().
+// Params:
+//   replayHandle: Number
+// Returns:
+//   Promise that resolves with the final statistics once the replay has ended or was stopped
+Napi::Promise waitForReplay(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+    auto replayIterator = replays.find(info[0].As<Napi::Number>().Uint32Value());
+    if (replayIterator == replays.end()) {
+        deferred.Reject(Napi::Error::New(env, "Replay handle not found").Value());
+    } else if (replayIterator->second.engine == nullptr) {
+        deferred.Resolve(replayIterator->second.finalStats.ToObject(env));
+        replays.erase(replayIterator);
+    } else {
+        replayIterator->second.waiters.push_back(deferred);
+    }
+    return deferred.Promise();
+}
+
+// Params:
+//   replayHandle: Number
+// Returns:
+//   Object with sent, failed and late counts and the timing error against the recorded schedule
+Napi::Value getReplayStats(const Napi::CallbackInfo& info) {
+    auto replayIterator = replays.find(info[0].As<Napi::Number>().Uint32Value());
+    if (replayIterator == replays.end()) return info.Env().Undefined();
+
+    ReplayEntry& entry = replayIterator->second;
+    return (entry.engine != nullptr ? entry.engine->GetStats() : entry.finalStats).ToObject(info.Env());
+}
+
+// Stops the replay and releases its handle. Pending waitForReplay() promises resolve once its thread has exited.
+// Params:
+//   replayHandle: Number
+void stopReplay(const Napi::CallbackInfo& info) {
+    auto replayIterator = replays.find(info[0].As<Napi::Number>().Uint32Value());
+    if (replayIterator == replays.end()) return;
+    if (replayIterator->second.engine == nullptr) {
+        replays.erase(replayIterator);
+        return;
+    }
+    replayIterator->second.stopped = true;
+    replayIterator->second.engine->Stop();
+}
+
+// Reads the bytes of a JS array into a frame payload of at most 8 bytes
+uint8_t readPayload(const Napi::Value& value, uint8_t* payload) {
+    if (!value.IsArray()) return 0;
+    Napi::Array array = value.As<Napi::Array>();
+    uint8_t size = std::min<uint32_t>(array.Length(), 8);
+    for (uint8_t i = 0; i < size; i++) {
+        payload[i] = array.Get(i).As<Napi::Number>().Uint32Value();
+    }
+    return size;
+}
+
+// Sends requests and matches their responses on a native thread, keeping up to options.window requests in
+// flight. Unanswered requests are sent again after their timeout, up to their number of retries.
+// Params:
+//   descriptor: String, or Number handle from openDevice()
+//   requests: Array<Object{messageId:Number, data:Number[], timeoutMs?:Number, retries?:Number,
+//             response:Object{messageId:Number, messageMask?:Number, data?:Number[], dataMask?:Number[]}}>
+//     response.data: payload bytes the response must start with, compared under response.dataMask,
+//                    which defaults to comparing every given byte
+//   options: Object{window?:Number, timeoutMs?:Number, retries?:Number} (optional), defaults for every request
+// Returns:
+//   Promise resolving to an Array, in the order of requests, of Object{status:String, attempts:Number,
+//   latencyUs?:Number, sendStatus?:Number, message?:Object{messageID:Number, timeStamp:Number, data:Number[]}},
+//   where status is "ok", "timeout", "sendFailed" or "aborted"
+// Requests are sent once, which in the driver also cancels a repeat of the same ID, so requests with an
+// ID that sendCANMessage() repeats are not sent and end as "sendFailed".
+Napi::Value transact(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Array requestsParam = info[1].As<Napi::Array>();
+
+    uint32_t window = TRANSACTION_DEFAULT_WINDOW;
+    double defaultTimeoutMs = TRANSACTION_DEFAULT_TIMEOUT_MS;
+    uint32_t defaultRetries = TRANSACTION_DEFAULT_RETRIES;
+    if (info[2].IsObject()) {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (options.Get("window").IsNumber()) window = options.Get("window").As<Napi::Number>().Uint32Value();
+        if (options.Get("timeoutMs").IsNumber()) defaultTimeoutMs = options.Get("timeoutMs").As<Napi::Number>().DoubleValue();
+        if (options.Get("retries").IsNumber()) defaultRetries = options.Get("retries").As<Napi::Number>().Uint32Value();
+    }
 
-        if (nowMs - timestampMs > maxAgeMs) {
-            continue;
+    std::vector<TransactionRequest> requests(requestsParam.Length());
+    std::vector<FrameFilter::Filter> responseFilters;
+    for (uint32_t i = 0; i < requestsParam.Length(); i++) {
+        Napi::Object requestParam = requestsParam.Get(i).As<Napi::Object>();
+        if (!requestParam.Get("messageId").IsNumber() || !requestParam.Get("response").IsObject()) {
+            Napi::TypeError::New(env, "Each request needs a messageId and a response").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        TransactionRequest& request = requests[i];
+        request.messageId = requestParam.Get("messageId").As<Napi::Number>().Uint32Value();
+        request.dataSize = readPayload(requestParam.Get("data"), request.data);
+        double timeoutMs = requestParam.Get("timeoutMs").IsNumber() ? requestParam.Get("timeoutMs").As<Napi::Number>().DoubleValue() : defaultTimeoutMs;
+        // Also rejects NaN
+        if (!(timeoutMs > 0 && timeoutMs <= TRANSACTION_MAX_TIMEOUT_MS)) {
+            Napi::RangeError::New(env, "timeoutMs must be greater than 0 and at most " + std::to_string(TRANSACTION_MAX_TIMEOUT_MS)).ThrowAsJavaScriptException();
+            return env.Undefined();
         }
+        request.timeoutUs = (uint32_t)(timeoutMs * 1000);
+        request.retries = requestParam.Get("retries").IsNumber() ? requestParam.Get("retries").As<Napi::Number>().Uint32Value() : defaultRetries;
+
+        Napi::Object response = requestParam.Get("response").As<Napi::Object>();
+        request.responseId = response.Get("messageId").As<Napi::Number>().Uint32Value();
+        if (response.Get("messageMask").IsNumber()) request.responseMask = response.Get("messageMask").As<Napi::Number>().Uint32Value();
+        uint8_t keySize = readPayload(response.Get("data"), request.responseData);
+        if (response.Get("dataMask").IsArray()) {
+            readPayload(response.Get("dataMask"), request.responseDataMask);
+        } else {
+            std::memset(request.responseDataMask, 0xFF, keySize);
+        }
+        responseFilters.emplace_back(request.responseId, request.responseMask);
+    }
+
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    if (requests.empty()) {
+        deferred.Resolve(Napi::Array::New(env));
+        return deferred.Promise();
+    }
+
+    // One session that passes every response. The engine tells them apart.
+    rev::usb::CANBridge_CANFilter cover = FrameFilter(responseFilters).Cover();
+    std::string descriptor;
+    std::shared_ptr<rev::usb::CANDevice> device = findDevice(info[0], descriptor);
+    StreamSubscription::ReadFunction read;
+    StreamSubscription::CloseFunction close;
+    std::shared_ptr<DeviceClock> clock;
+    if (!openStreamReader(env, device, descriptor, cover.messageId, cover.messageMask, TRANSACTION_SESSION_SIZE, &read, &close, &clock)) {
+        return env.Undefined();
+    }
+
+    auto pending = std::make_shared<Napi::Promise::Deferred>(deferred);
+    TransactionEngine::Start(env, std::move(requests), window, read, close, clock,
+        [descriptor](uint32_t messageId, uint8_t* data, uint8_t dataSize) {
+            return sendMessageOnce(descriptor, messageId, data, dataSize);
+        },
+        [pending](const std::vector<TransactionResult>& results) {
+            Napi::Env env = pending->Env();
+            Napi::Array array = Napi::Array::New(env, results.size());
+            for (uint32_t i = 0; i < results.size(); i++) {
+                array[i] = results[i].ToObject(env);
+            }
+            pending->Resolve(array);
+        });
+    return deferred.Promise();
+}
 
-        size_t messageSize = message->GetSize();
-        const uint8_t* messageData = message->GetData();
-        Napi::Array napiMessage = Napi::Array::New(env, messageSize);
-        for (int i = 0; i < messageSize; i++) {
-            napiMessage[i] =  messageData[i];
+// Call counts and latencies of every binding called since the last reset, merged over the threads that called
+// them. Each binding's calls are timed as a whole, and in the phases listed in phases: waiting for the device
+// registry lock, inside CANBridge or the HAL, and building JS values. A phase only counts the calls that entered
+// it. Bindings that return a Promise are timed up to the return. Every typed array holds phases.length values
+// per binding, one binding after the other, and histogram holds PERF_HISTOGRAM_BUCKETS counts per phase.
+// Returns:
+//   undefined if the addon was built without CANBRIDGE_PERF_COUNTERS, or
+//   Object{count:Number, names:String[], phases:String[], calls:Float64Array, totalNs:Float64Array,
+//          maxNs:Float64Array, histogram:Float64Array, histogramBucketLowerNs:Float64Array}
+Napi::Value getPerfCounters(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+#ifdef CANBRIDGE_PERF_COUNTERS
+    PerfCounters::Instance().Read(&perfStatsScratch);
+
+    size_t count = perfStatsScratch.size();
+    Napi::Array names = Napi::Array::New(env, count);
+    Napi::Float64Array calls = Napi::Float64Array::New(env, count * PERF_PHASE_COUNT);
+    Napi::Float64Array totalNs = Napi::Float64Array::New(env, count * PERF_PHASE_COUNT);
+    Napi::Float64Array maxNs = Napi::Float64Array::New(env, count * PERF_PHASE_COUNT);
+    Napi::Float64Array histogram = Napi::Float64Array::New(env, count * PERF_PHASE_COUNT * PERF_HISTOGRAM_BUCKETS);
+    for (size_t i = 0; i < count; i++) {
+        const PerfBindingStats& stats = perfStatsScratch[i];
+        names[i] = Napi::String::New(env, stats.name);
+        for (int phase = 0; phase < PERF_PHASE_COUNT; phase++) {
+            size_t index = i * PERF_PHASE_COUNT + phase;
+            calls[index] = (double)stats.count[phase];
+            totalNs[index] = (double)stats.totalNs[phase];
+            maxNs[index] = (double)stats.maxNs[phase];
+            for (uint32_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+                histogram[index * PERF_HISTOGRAM_BUCKETS + b] = (double)stats.histogram[phase][b];
+            }
         }
-        Napi::Object messageInfo = Napi::Object::New(env);
-        messageInfo.Set("messageID", message->GetMessageId());
-        messageInfo.Set("timeStamp", timestampMs);
-        messageInfo.Set("data", napiMessage);
-        result.Set(arbId, messageInfo);
     }
+    Napi::Float64Array bucketLowerNs = Napi::Float64Array::New(env, PERF_HISTOGRAM_BUCKETS);
+    for (uint32_t b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+        bucketLowerNs[b] = (double)PerfCounters::BucketLowerBoundNs(b);
+    }
+    Napi::Array phases = Napi::Array::New(env, PERF_PHASE_COUNT);
+    phases[(uint32_t)PerfPhase::kTotal] = Napi::String::New(env, "total");
+    phases[(uint32_t)PerfPhase::kLockWait] = Napi::String::New(env, "lockWait");
+    phases[(uint32_t)PerfPhase::kDriver] = Napi::String::New(env, "driver");
+    phases[(uint32_t)PerfPhase::kConvert] = Napi::String::New(env, "convert");
 
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("count", Napi::Number::New(env, count));
+    result.Set("names", names);
+    result.Set("phases", phases);
+    result.Set("calls", calls);
+    result.Set("totalNs", totalNs);
+    result.Set("maxNs", maxNs);
+    result.Set("histogram", histogram);
+    result.Set("histogramBucketLowerNs", bucketLowerNs);
     return result;
+#else
+    return env.Undefined();
+#endif
+}
+
+void resetPerfCounters([[maybe_unused]] const Napi::CallbackInfo& info) {
+#ifdef CANBRIDGE_PERF_COUNTERS
+    PerfCounters::Instance().Reset();
+#endif
+}
+
+// Starts recording trace events from the native threads, discarding the events that were not written yet
+void startTrace([[maybe_unused]] const Napi::CallbackInfo& info) {
+    Tracer::Instance().Start();
+}
+
+// Stops recording trace events. The recorded ones can still be written with writeTrace().
+void stopTrace([[maybe_unused]] const Napi::CallbackInfo& info) {
+    Tracer::Instance().Stop();
+}
+
+// Drains the trace events into a file on a libuv worker thread
+class WriteTraceWorker : public Napi::AsyncWorker {
+    public:
+        WriteTraceWorker(Napi::Env env, std::string fileName, TraceFormat format)
+        : Napi::AsyncWorker(env), deferred(Napi::Promise::Deferred::New(env)), fileName(std::move(fileName)), format(format) {}
+
+        ~WriteTraceWorker() {}
+
+        Napi::Promise Promise() { return deferred.Promise(); }
+
+    void Execute() override {
+        std::string error;
+        if (!Tracer::Instance().Write(fileName, format, &stats, &error)) SetError(error);
+    }
+
+    void OnOK() override {
+        Napi::Object result = Napi::Object::New(Env());
+        result.Set("events", Napi::Number::New(Env(), (double)stats.events));
+        result.Set("dropped", Napi::Number::New(Env(), (double)stats.dropped));
+        deferred.Resolve(result);
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred.Reject(error.Value());
+    }
+
+    private:
+        Napi::Promise::Deferred deferred;
+        std::string fileName;
+        TraceFormat format;
+        TraceStats stats;
+};
+
+// Writes the trace events recorded since startTrace() or the last writeTrace() to a file, on a libuv worker
+// thread. Tracing can keep running meanwhile.
+// Params:
+//   fileName: String
+//   format: "chrome" | "perfetto" (optional), Chrome trace-event JSON or Perfetto protobuf. Defaults to "chrome".
+// Returns:
+//   Promise resolving to Object{events:Number, dropped:Number}, dropped counting the events lost to full buffers
+Napi::Value writeTrace(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    std::string fileName = info[0].As<Napi::String>().Utf8Value();
+    TraceFormat format = TraceFormat::kChromeJson;
+    if (info[1].IsString()) {
+        std::string formatName = info[1].As<Napi::String>().Utf8Value();
+        if (formatName == "perfetto") {
+            format = TraceFormat::kPerfetto;
+        } else if (formatName != "chrome") {
+            Napi::TypeError::New(env, "format must be \"chrome\" or \"perfetto\"").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    WriteTraceWorker* worker = new WriteTraceWorker(env, fileName, format);
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
 }
 
 void cleanupHeartbeatsRunning() {
     // Erase removed CAN buses from heartbeatsRunning
-    std::scoped_lock lock{watchdogMtx, canDevicesMtx};
-    for(int i = 0; i < heartbeatsRunning.size(); i++) {
-        auto deviceIterator = canDeviceMap.find(heartbeatsRunning[i]);
-        if (deviceIterator == canDeviceMap.end()) {
-            heartbeatsRunning.erase(heartbeatsRunning.begin() + i);
-        }
+    std::scoped_lock lock{watchdogMtx};
+    std::erase_if(heartbeatsRunning, [](const std::string& descriptor) {
+        return !deviceRegistry.Contains(descriptor);
+    });
+}
+
+// Stops the watchdog thread once every device with a running heartbeat is gone
+void stopIdleHeartbeatWatchdog() {
+    cleanupHeartbeatsRunning();
+    {
+        std::scoped_lock lock{watchdogMtx};
+        if (!heartbeatsRunning.empty()) return;
     }
+    heartbeatWatchdog.Stop();
+
+    std::scoped_lock lock{watchdogMtx};
+    heartbeatTimeoutExpired = true;
 }
 
-void heartbeatsWatchdog() {
-    while (true) {
-        std::this_thread::sleep_for (std::chrono::milliseconds(250));
+// Called on the watchdog thread when the heartbeat timeout expires and when it is un-expired by an ack
+void heartbeatWatchdogTransition(bool expired) {
+    TRACE_SCOPE(expired ? "heartbeat timeout expired" : "heartbeat timeout recovered");
+    cleanupHeartbeatsRunning();
+
+    std::scoped_lock lock{watchdogMtx};
+    heartbeatTimeoutExpired = expired;
+    if (expired) {
+        // The heartbeat timeout just expired
+        for(int i = 0; i < heartbeatsRunning.size(); i++) {
+            if (sparkHeartbeatMap.contains(heartbeatsRunning[i])) {
+                // Clear the scheduled heartbeat that has outdated data so that the updated one gets sent out immediately
+                _sendCANMessage(heartbeatsRunning[i], SPARK_HEARTBEAT_ID, disabledSparkHeartbeat, SPARK_HEARTBEAT_LENGTH, -1);
 
-        cleanupHeartbeatsRunning();
+                _sendCANMessage(heartbeatsRunning[i], SPARK_HEARTBEAT_ID, disabledSparkHeartbeat, SPARK_HEARTBEAT_LENGTH, HEARTBEAT_PERIOD_MS);
+            }
+            if (revCommonHeartbeatMap.contains(heartbeatsRunning[i])) {
+                // Clear the scheduled heartbeat that has outdated data so that the updated one gets sent out immediately
+                _sendCANMessage(heartbeatsRunning[i], REV_COMMON_HEARTBEAT_ID, disabledRevCommonHeartbeat, REV_COMMON_HEARTBEAT_LENGTH, -1);
 
-        std::scoped_lock lock{watchdogMtx};
+                _sendCANMessage(heartbeatsRunning[i], REV_COMMON_HEARTBEAT_ID, disabledRevCommonHeartbeat, REV_COMMON_HEARTBEAT_LENGTH, HEARTBEAT_PERIOD_MS);
+            }
+        }
+    } else {
+        // The heartbeat timeout is newly un-expired
+        for(int i = 0; i < heartbeatsRunning.size(); i++) {
+            if (auto heartbeatEntry = sparkHeartbeatMap.find(heartbeatsRunning[i]); heartbeatEntry != sparkHeartbeatMap.end()) {
+                // Clear the scheduled heartbeat that has outdated data so that the updated one gets sent out immediately
+                _sendCANMessage(heartbeatsRunning[i], SPARK_HEARTBEAT_ID, heartbeatEntry->second.data(), SPARK_HEARTBEAT_LENGTH, -1);
 
-        if (heartbeatsRunning.size() < 1) { break; }
-
-        auto now = std::chrono::steady_clock::now();
-        std::chrono::duration<double> elapsed_seconds = now-latestHeartbeatAck;
-        if (elapsed_seconds.count() >= 1 && !heartbeatTimeoutExpired) {
-            // The heartbeat timeout just expired
-            heartbeatTimeoutExpired = true;
-            for(int i = 0; i < heartbeatsRunning.size(); i++) {
-                if (sparkHeartbeatMap.contains(heartbeatsRunning[i])) {
-                    // Clear the scheduled heartbeat that has outdated data so that the updated one gets sent out immediately
-                    _sendCANMessage(heartbeatsRunning[i], SPARK_HEARTBEAT_ID, disabledSparkHeartbeat, SPARK_HEARTBEAT_LENGTH, -1);
-
-                    _sendCANMessage(heartbeatsRunning[i], SPARK_HEARTBEAT_ID, disabledSparkHeartbeat, SPARK_HEARTBEAT_LENGTH, HEARTBEAT_PERIOD_MS);
-                }
-                if (revCommonHeartbeatMap.contains(heartbeatsRunning[i])) {
-                    // Clear the scheduled heartbeat that has outdated data so that the updated one gets sent out immediately
-                    _sendCANMessage(heartbeatsRunning[i], REV_COMMON_HEARTBEAT_ID, disabledRevCommonHeartbeat, REV_COMMON_HEARTBEAT_LENGTH, -1);
-
-                    _sendCANMessage(heartbeatsRunning[i], REV_COMMON_HEARTBEAT_ID, disabledRevCommonHeartbeat, REV_COMMON_HEARTBEAT_LENGTH, HEARTBEAT_PERIOD_MS);
-                }
+                _sendCANMessage(heartbeatsRunning[i], SPARK_HEARTBEAT_ID, heartbeatEntry->second.data(), SPARK_HEARTBEAT_LENGTH, HEARTBEAT_PERIOD_MS);
             }
-        } else if (elapsed_seconds.count() < 1 && heartbeatTimeoutExpired) {
-            // The heartbeat timeout is newly un-expired
-            heartbeatTimeoutExpired = false;
-            for(int i = 0; i < heartbeatsRunning.size(); i++) {
-                if (auto heartbeatEntry = sparkHeartbeatMap.find(heartbeatsRunning[i]); heartbeatEntry != sparkHeartbeatMap.end()) {
-                    // Clear the scheduled heartbeat that has outdated data so that the updated one gets sent out immediately
-                    _sendCANMessage(heartbeatsRunning[i], SPARK_HEARTBEAT_ID, heartbeatEntry->second.data(), SPARK_HEARTBEAT_LENGTH, -1);
-
-                    _sendCANMessage(heartbeatsRunning[i], SPARK_HEARTBEAT_ID, heartbeatEntry->second.data(), SPARK_HEARTBEAT_LENGTH, HEARTBEAT_PERIOD_MS);
-                }
-                if (auto heartbeatEntry = revCommonHeartbeatMap.find(heartbeatsRunning[i]); heartbeatEntry != revCommonHeartbeatMap.end()) {
-                    // Clear the scheduled heartbeat that has outdated data so that the updated one gets sent out immediately
-                    _sendCANMessage(heartbeatsRunning[i], REV_COMMON_HEARTBEAT_ID, heartbeatEntry->second.data(), REV_COMMON_HEARTBEAT_LENGTH, -1);
-
-                    _sendCANMessage(heartbeatsRunning[i], REV_COMMON_HEARTBEAT_ID, heartbeatEntry->second.data(), REV_COMMON_HEARTBEAT_LENGTH, HEARTBEAT_PERIOD_MS);
-                }
+            if (auto heartbeatEntry = revCommonHeartbeatMap.find(heartbeatsRunning[i]); heartbeatEntry != revCommonHeartbeatMap.end()) {
+                // Clear the scheduled heartbeat that has outdated data so that the updated one gets sent out immediately
+                _sendCANMessage(heartbeatsRunning[i], REV_COMMON_HEARTBEAT_ID, heartbeatEntry->second.data(), REV_COMMON_HEARTBEAT_LENGTH, -1);
+
+                _sendCANMessage(heartbeatsRunning[i], REV_COMMON_HEARTBEAT_ID, heartbeatEntry->second.data(), REV_COMMON_HEARTBEAT_LENGTH, HEARTBEAT_PERIOD_MS);
             }
         }
     }
 }
 
 void ackHeartbeats(const Napi::CallbackInfo& info) {
-    std::scoped_lock lock{watchdogMtx};
-    latestHeartbeatAck = std::chrono::steady_clock::now();
+    TRACE_INSTANT("ackHeartbeats");
+    heartbeatWatchdog.Ack();
+}
+
+// Sets how long after the last ackHeartbeats() call the heartbeats are disabled
+// Params:
+//   timeoutMs: Number, greater than 0 and at most INT32_MAX
+void setHeartbeatTimeout(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    double timeoutMs = info[0].IsNumber() ? info[0].As<Napi::Number>().DoubleValue() : 0;
+
+    // Also rejects NaN
+    if (!(timeoutMs > 0 && timeoutMs <= INT32_MAX)) {
+        Napi::RangeError::New(env, "timeoutMs must be a number greater than 0 and at most 2147483647").ThrowAsJavaScriptException();
+        return;
+    }
+    heartbeatWatchdog.SetTimeout(std::chrono::microseconds((int64_t)(timeoutMs * 1000)));
+}
+
+// Returns:
+//   Object with ack and timeout counts, the time between acks and how late expiries were acted on
+Napi::Object getHeartbeatWatchdogStats(const Napi::CallbackInfo& info) {
+    return heartbeatWatchdog.GetStats().ToObject(info.Env());
 }
 
 // Params:
@@ -854,11 +2874,7 @@ void startRevCommonHeartbeat(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
     std::string descriptor = info[0].As<Napi::String>().Utf8Value();
 
-    {
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator == canDeviceMap.end()) return;
-    }
+    if (!deviceRegistry.Contains(descriptor)) return;
 
     std::array<uint8_t, REV_COMMON_HEARTBEAT_LENGTH> payload = {1};
 
@@ -870,16 +2886,13 @@ void startRevCommonHeartbeat(const Napi::CallbackInfo& info) {
 
     revCommonHeartbeatMap[descriptor] = payload;
 
-    if (heartbeatsRunning.size() == 0) {
-        heartbeatsRunning.push_back(descriptor);
-        latestHeartbeatAck = std::chrono::steady_clock::now();
-        std::thread hb(heartbeatsWatchdog);
-        hb.detach();
-    } else {
-        for(int i = 0; i < heartbeatsRunning.size(); i++) {
-            if (heartbeatsRunning[i].compare(descriptor) == 0) return;
-        }
-        heartbeatsRunning.push_back(descriptor);
+    for(int i = 0; i < heartbeatsRunning.size(); i++) {
+        if (heartbeatsRunning[i].compare(descriptor) == 0) return;
+    }
+    heartbeatsRunning.push_back(descriptor);
+    if (heartbeatsRunning.size() == 1) {
+        // Heartbeats stay disabled until the watchdog thread un-expires the timeout
+        heartbeatWatchdog.Start();
     }
 }
 
@@ -893,11 +2906,7 @@ void setSparkMaxHeartbeatData(const Napi::CallbackInfo& info) {
 
     std::array<uint8_t, SPARK_HEARTBEAT_LENGTH> heartbeat = {0, 0, 0, 0, 0, 0, 0, 0};
 
-    {
-        std::scoped_lock lock{canDevicesMtx};
-        auto deviceIterator = canDeviceMap.find(descriptor);
-        if (deviceIterator == canDeviceMap.end()) return;
-    }
+    if (!deviceRegistry.Contains(descriptor)) return;
 
     int sum = 0;
     for (uint32_t i = 0; i < dataParam.Length(); i++) {
@@ -916,16 +2925,13 @@ void setSparkMaxHeartbeatData(const Napi::CallbackInfo& info) {
 
     sparkHeartbeatMap[descriptor] = heartbeat;
 
-    if (heartbeatsRunning.size() == 0) {
-        heartbeatsRunning.push_back(descriptor);
-        latestHeartbeatAck = std::chrono::steady_clock::now();
-        std::thread hb(heartbeatsWatchdog);
-        hb.detach();
-    } else {
-        for(int i = 0; i < heartbeatsRunning.size(); i++) {
-            if (heartbeatsRunning[i].compare(descriptor) == 0) return;
-        }
-        heartbeatsRunning.push_back(descriptor);
+    for(int i = 0; i < heartbeatsRunning.size(); i++) {
+        if (heartbeatsRunning[i].compare(descriptor) == 0) return;
+    }
+    heartbeatsRunning.push_back(descriptor);
+    if (heartbeatsRunning.size() == 1) {
+        // Heartbeats stay disabled until the watchdog thread un-expires the timeout
+        heartbeatWatchdog.Start();
     }
 }
 
@@ -1,32 +1,93 @@
 #ifndef CAN_LIB
 #define CAN_LIB
 #include <napi.h>
+#include <hal/CAN.h>
+#include "DeviceClock.h"
 
 void getDevices(const Napi::CallbackInfo& info);
+Napi::Number openDevice(const Napi::CallbackInfo& info);
+void closeDevice(const Napi::CallbackInfo& info);
 Napi::Number registerDeviceToHAL(const Napi::CallbackInfo& info);
 void unregisterDeviceFromHAL(const Napi::CallbackInfo& info);
 Napi::Object receiveMessage(const Napi::CallbackInfo& info);
 Napi::Object receiveHalMessage(const Napi::CallbackInfo& info);
 Napi::Number openStreamSession(const Napi::CallbackInfo& info);
 Napi::Array readStreamSession(const Napi::CallbackInfo& info);
+Napi::Number readStreamSessionPacked(const Napi::CallbackInfo& info);
 Napi::Number closeStreamSession(const Napi::CallbackInfo& info);
 Napi::Object getCANDetailStatus(const Napi::CallbackInfo& info);
 Napi::Number sendCANMessage(const Napi::CallbackInfo& info);
+Napi::Int32Array sendCANMessages(const Napi::CallbackInfo& info);
 Napi::Number sendRtrMessage(const Napi::CallbackInfo& info);
 Napi::Number sendCANMessageThroughHal(const Napi::CallbackInfo& info);
 Napi::Number sendHALMessage(const Napi::CallbackInfo& info);
+Napi::Number addPeriodicFrame(const Napi::CallbackInfo& info);
+void updatePeriodicFrame(const Napi::CallbackInfo& info);
+Napi::Value getPeriodicFrameStats(const Napi::CallbackInfo& info);
+void removePeriodicFrame(const Napi::CallbackInfo& info);
 void initializeNotifier(const Napi::CallbackInfo& info);
 void waitForNotifierAlarm(const Napi::CallbackInfo& info);
 void stopNotifier(const Napi::CallbackInfo& info);
+Napi::Number getFPGATime(const Napi::CallbackInfo& info);
+Napi::Number createNotifier(const Napi::CallbackInfo& info);
+void updateNotifierAlarm(const Napi::CallbackInfo& info);
+void cancelNotifierAlarm(const Napi::CallbackInfo& info);
+Napi::Promise waitForNotifier(const Napi::CallbackInfo& info);
+void cleanNotifier(const Napi::CallbackInfo& info);
+Napi::Value getNotifierStats(const Napi::CallbackInfo& info);
+Napi::Number startPeriodicNotifier(const Napi::CallbackInfo& info);
+Napi::Value getPeriodicNotifierStats(const Napi::CallbackInfo& info);
+Napi::Value stopPeriodicNotifier(const Napi::CallbackInfo& info);
 Napi::Promise writeDfuToBin(const Napi::CallbackInfo& info);
+Napi::Value extractDfuElements(const Napi::CallbackInfo& info);
 Napi::Array getImageElements(const Napi::CallbackInfo& info);
+void verifyDfu(const Napi::CallbackInfo& info);
 Napi::Number openHALStreamSession(const Napi::CallbackInfo& info);
 Napi::Array readHALStreamSession(const Napi::CallbackInfo& info);
+Napi::Number readHALStreamSessionPacked(const Napi::CallbackInfo& info);
 void closeHALStreamSession(const Napi::CallbackInfo& info);
 void setThreadPriority(const Napi::CallbackInfo& info);
 void setSparkMaxHeartbeatData(const Napi::CallbackInfo& info);
 void startRevCommonHeartbeat(const Napi::CallbackInfo& info);
 void stopHeartbeats(const Napi::CallbackInfo& info);
 void ackHeartbeats(const Napi::CallbackInfo& info);
+void setHeartbeatTimeout(const Napi::CallbackInfo& info);
+Napi::Object getHeartbeatWatchdogStats(const Napi::CallbackInfo& info);
 Napi::Object getLatestMessageOfEveryReceivedArbId(const Napi::CallbackInfo& info);
+Napi::Object getLatestMessagesSince(const Napi::CallbackInfo& info);
+Napi::Boolean releaseReceiveTap(const Napi::CallbackInfo& info);
+Napi::Object readLatestMessagesPacked(const Napi::CallbackInfo& info);
+Napi::Number subscribe(const Napi::CallbackInfo& info);
+void unsubscribe(const Napi::CallbackInfo& info);
+Napi::Number registerSignals(const Napi::CallbackInfo& info);
+Napi::Number updateSignals(const Napi::CallbackInfo& info);
+void unregisterSignals(const Napi::CallbackInfo& info);
+Napi::Object getTrafficStats(const Napi::CallbackInfo& info);
+void resetTrafficStats(const Napi::CallbackInfo& info);
+Napi::Object getDeviceClock(const Napi::CallbackInfo& info);
+void startCapture(const Napi::CallbackInfo& info);
+Napi::Object stopCapture(const Napi::CallbackInfo& info);
+Napi::Object freezeCapture(const Napi::CallbackInfo& info);
+Napi::Object getCaptureStats(const Napi::CallbackInfo& info);
+Napi::Number snapshotCapture(const Napi::CallbackInfo& info);
+Napi::Object openCaptureFile(const Napi::CallbackInfo& info);
+Napi::Number readCaptureRecords(const Napi::CallbackInfo& info);
+Napi::Number findCaptureRecord(const Napi::CallbackInfo& info);
+void closeCaptureFile(const Napi::CallbackInfo& info);
+Napi::Number startReplay(const Napi::CallbackInfo& info);
+Napi::Promise waitForReplay(const Napi::CallbackInfo& info);
+Napi::Value getReplayStats(const Napi::CallbackInfo& info);
+void stopReplay(const Napi::CallbackInfo& info);
+Napi::Value transact(const Napi::CallbackInfo& info);
+Napi::Value getPerfCounters(const Napi::CallbackInfo& info);
+void resetPerfCounters(const Napi::CallbackInfo& info);
+void startTrace(const Napi::CallbackInfo& info);
+void stopTrace(const Napi::CallbackInfo& info);
+Napi::Value writeTrace(const Napi::CallbackInfo& info);
+Napi::String createVirtualDevice(const Napi::CallbackInfo& info);
+void setVirtualBusOptions(const Napi::CallbackInfo& info);
+void setVirtualDeviceInjection(const Napi::CallbackInfo& info);
+void destroyVirtualDevice(const Napi::CallbackInfo& info);
+
+Napi::Array streamMessagesToArray(Napi::Env env, const HAL_CANStreamMessage* messages, uint32_t count, const DeviceClock& clock);
 #endif
@@ -1,5 +1,8 @@
 
 const addon = require("../dist/binding.js");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
 const assert = require("assert").strict;
 
 let devices = [];
@@ -182,6 +185,71 @@ function testStopNotifier() {
     }
 }
 
+async function testWaitForNotifierAlarmDoesNotBlock() {
+    try {
+        canBridge.initializeNotifier();
+        let timerFired = false;
+        setTimeout(() => timerFired = true, 10);
+        await canBridge.waitForNotifierAlarm(100000);
+        assert(timerFired, "The event loop was blocked while waiting for the alarm");
+        canBridge.stopNotifier();
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testNotifierHandles() {
+    assert(canBridge.createNotifier, "createNotifier is undefined");
+    try {
+        const fast = canBridge.createNotifier();
+        const slow = canBridge.createNotifier();
+        assert.notEqual(fast, slow, "Notifiers should get different handles");
+
+        let fastAlarms = 0;
+        const slowDone = (async () => {
+            canBridge.updateNotifierAlarm(slow, canBridge.getFPGATime() + 50000);
+            assert(await canBridge.waitForNotifier(slow) > 0, "Slow notifier did not fire");
+        })();
+        let triggerTime = canBridge.getFPGATime();
+        for (let i = 0; i < 20; i++) {
+            triggerTime += 1000;
+            canBridge.updateNotifierAlarm(fast, triggerTime);
+            assert(await canBridge.waitForNotifier(fast) >= triggerTime, "Fast notifier fired early");
+            fastAlarms++;
+        }
+        await slowDone;
+
+        const stats = canBridge.getNotifierStats(fast);
+        console.log("Notifier stats:", stats);
+        assert.equal(stats.alarms, fastAlarms, "Wrong alarm count");
+
+        const stopped = canBridge.waitForNotifier(slow);
+        canBridge.stopNotifier(slow);
+        assert.equal(await stopped, 0, "Stopping should wake the waiter with 0");
+        canBridge.cleanNotifier(fast);
+        canBridge.cleanNotifier(slow);
+        assert.equal(canBridge.getNotifierStats(fast), undefined, "Cleaned notifier should be gone");
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testPeriodicNotifier() {
+    assert(canBridge.startPeriodicNotifier, "startPeriodicNotifier is undefined");
+    try {
+        let ticks = 0;
+        const notifierHandle = canBridge.startPeriodicNotifier(5000, () => ticks++);
+        await new Promise(resolve => {setTimeout(resolve, 200)});
+        const stats = canBridge.stopPeriodicNotifier(notifierHandle);
+        console.log("Periodic notifier stats:", stats);
+        assert(ticks > 0, "onTick was never called");
+        assert(stats.ticks >= ticks, "More callbacks than ticks");
+        assert.equal(canBridge.getPeriodicNotifierStats(notifierHandle), undefined, "Stopped notifier should be gone");
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
 async function testOpenHALStreamSession() {
     try {
         const handle = canBridge.openHALStreamSession(0, 0, 8);
@@ -227,6 +295,852 @@ async function testHeartbeat() {
     }
 }
 
+async function testSubscribe() {
+    assert(canBridge.subscribe, "subscribe is undefined");
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051801, 2000);
+
+        let batches = 0;
+        let received = 0;
+        const handle = canBridge.subscribe(descriptor, 0, 0, (messages) => {
+            assert(messages.length > 0 && messages.length <= 32, `Unexpected batch size ${messages.length}`);
+            batches++;
+            received += messages.length;
+        }, {maxBatchSize: 32, maxLatencyMs: 5});
+        await new Promise(resolve => {setTimeout(resolve, 500)});
+        canBridge.unsubscribe(handle);
+        canBridge.destroyVirtualDevice(descriptor);
+
+        console.log(`Subscription received ${received} messages in ${batches} batches`);
+        assert(received > 0, "Subscription did not receive any messages");
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testReadStreamSessionPacked() {
+    assert(canBridge.readStreamSessionPacked, "readStreamSessionPacked is undefined");
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        const sessionHandle = canBridge.openStreamSession(descriptor, 0x2051801, 0x1FFFFFFF, 64);
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051801, 1000);
+        await new Promise(resolve => {setTimeout(resolve, 100)});
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051801, 0);
+
+        const buffer = addon.PackedFrameView.allocate(16);
+        const count = canBridge.readStreamSessionPacked(descriptor, sessionHandle, buffer);
+        const frames = new addon.PackedFrameView(buffer, count);
+        assert(count > 0 && count <= 16, `Unexpected record count ${count}`);
+        for (let i = 0; i < frames.count; i++) {
+            assert.equal(frames.messageId(i), 0x2051801);
+            assert.equal(frames.dataSize(i), 8);
+        }
+        canBridge.closeStreamSession(descriptor, sessionHandle);
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testSendCANMessages() {
+    assert(canBridge.sendCANMessages, "sendCANMessages is undefined");
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        const messages = [];
+        for (let i = 0; i < 100; i++) {
+            messages.push({messageId: 0x2050000 + i, data: [i, 1, 2, 3], repeatPeriod: 0});
+        }
+        const statuses = canBridge.sendCANMessages(descriptor, addon.packCanMessages(messages));
+        assert.equal(statuses.length, messages.length, "Wrong number of statuses");
+        statuses.forEach((status) => assert.equal(status, 0, "Sending message failed"));
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testDeviceHandles() {
+    assert(canBridge.openDevice, "openDevice is undefined");
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        const handle = canBridge.openDevice(descriptor);
+        assert.equal(canBridge.openDevice(descriptor), handle, "Opening a device twice should return the same handle");
+
+        assert.equal(canBridge.sendCANMessage(handle, 0x2051D81, [1, 2, 3], 0), 0, "Sending by handle failed");
+        const sessionHandle = canBridge.openStreamSession(handle, 0, 0, 8);
+        canBridge.readStreamSession(handle, sessionHandle, 8);
+        assert.equal(canBridge.closeStreamSession(handle, sessionHandle), 0, "Closing stream by handle failed");
+        console.log("CAN Status by handle:", canBridge.getCANDetailStatus(handle));
+
+        canBridge.closeDevice(handle);
+        canBridge.closeDevice(handle);
+        assert.throws(() => canBridge.getCANDetailStatus(handle), "Closed handle should not resolve");
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testScanDuringSends() {
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        const handle = canBridge.openDevice(descriptor);
+        const scans = [];
+        for (let i = 0; i < 10; i++) {
+            scans.push(canBridge.getDevices());
+        }
+
+        let maxSendMs = 0;
+        const start = Date.now();
+        while (Date.now() - start < 200) {
+            const sendStart = process.hrtime.bigint();
+            assert.equal(canBridge.sendCANMessage(descriptor, 0x2051D81, [1, 2, 3], 0), 0, "Sending by descriptor failed");
+            assert.equal(canBridge.sendCANMessage(handle, 0x2051D81, [1, 2, 3], 0), 0, "Sending by handle failed");
+            maxSendMs = Math.max(maxSendMs, Number(process.hrtime.bigint() - sendStart) / 1e6);
+        }
+        await Promise.all(scans);
+        console.log(`Slowest send while scanning: ${maxSendMs.toFixed(3)}ms`);
+
+        canBridge.closeDevice(handle);
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testPeriodicFrames() {
+    assert(canBridge.addPeriodicFrame, "addPeriodicFrame is undefined");
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        const first = canBridge.addPeriodicFrame(descriptor, 0x2051D81, [1, 2, 3], 10);
+        const second = canBridge.addPeriodicFrame(descriptor, 0x2051D82, [4, 5, 6], 10, 5);
+        await new Promise(resolve => {setTimeout(resolve, 100)});
+        canBridge.updatePeriodicFrame(first, [7, 8, 9]);
+        await new Promise(resolve => {setTimeout(resolve, 100)});
+
+        for (const scheduleHandle of [first, second]) {
+            const stats = canBridge.getPeriodicFrameStats(scheduleHandle);
+            console.log("Periodic frame stats:", stats);
+            assert(stats.sent > 0, "No frames were sent");
+            assert.equal(stats.failedSends, 0, "Sending a periodic frame failed");
+        }
+        canBridge.removePeriodicFrame(first);
+        canBridge.removePeriodicFrame(second);
+        assert.throws(() => canBridge.getPeriodicFrameStats(first), "Removed frame should be gone");
+
+        // Sending an ID once cancels its repeat in the driver, so a repeated ID cannot be scheduled
+        const receiver = canBridge.createVirtualDevice({bus: 11});
+        const sender = canBridge.createVirtualDevice({bus: 11});
+        const sessionHandle = canBridge.openStreamSession(receiver, 0x2051D83, 0x1FFFFFFF, 64);
+        canBridge.sendCANMessage(sender, 0x2051D83, [1], 10);
+        assert.throws(() => canBridge.addPeriodicFrame(sender, 0x2051D83, [2], 10), "An ID the driver repeats should not be scheduled");
+        canBridge.sendCANMessage(sender, 0x2051D83, [3], 0);
+        await new Promise(resolve => {setTimeout(resolve, 20)});
+        canBridge.readStreamSession(receiver, sessionHandle, 64);
+        await new Promise(resolve => {setTimeout(resolve, 50)});
+        assert.equal(canBridge.readStreamSession(receiver, sessionHandle, 64).length, 0, "Sending once should cancel the repeat");
+        const third = canBridge.addPeriodicFrame(sender, 0x2051D83, [2], 10);
+        canBridge.removePeriodicFrame(third);
+        canBridge.closeStreamSession(receiver, sessionHandle);
+        canBridge.destroyVirtualDevice(sender);
+        canBridge.destroyVirtualDevice(receiver);
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testLatestValueCache() {
+    assert(canBridge.getLatestMessagesSince, "getLatestMessagesSince is undefined");
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        const first = canBridge.getLatestMessagesSince(descriptor, 0);
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051801, 1000);
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051802, 1000);
+        await new Promise(resolve => {setTimeout(resolve, 50)});
+
+        const latest = canBridge.getLatestMessageOfEveryReceivedArbId(descriptor, 1000);
+        assert(latest[0x2051801] && latest[0x2051802], "Injected IDs missing from the cache");
+        const updated = canBridge.getLatestMessagesSince(descriptor, first.sequence);
+        assert(updated.sequence > first.sequence, "Sequence did not advance");
+        assert(updated.messages[0x2051801], "Updated ID missing");
+
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051801, 0);
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051802, 0);
+        await new Promise(resolve => {setTimeout(resolve, 10)});
+        const settled = canBridge.getLatestMessagesSince(descriptor, 0).sequence;
+        assert.deepEqual(canBridge.getLatestMessagesSince(descriptor, settled).messages, {}, "Nothing should have changed");
+
+        const buffer = addon.PackedFrameView.allocate(1);
+        const packed = canBridge.readLatestMessagesPacked(descriptor, buffer, 0);
+        assert.equal(packed.count, 1, "Packed read should stop at the buffer size");
+        const rest = canBridge.readLatestMessagesPacked(descriptor, buffer, packed.sequence);
+        assert.equal(rest.count, 1, "Second packed read should return the other ID");
+
+        assert(canBridge.releaseReceiveTap(descriptor), "Running cache should be released");
+        assert(!canBridge.releaseReceiveTap(descriptor), "Released cache should not be released twice");
+        const restarted = canBridge.getLatestMessagesSince(descriptor, 0);
+        assert(restarted.messages[0x2051801], "Restarted cache should be seeded from the received messages");
+        assert(restarted.messages[0x2051801].timeStamp > 0, "Received messages should keep their timestamps");
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testLatestValueAge() {
+    try {
+        // Frames the device received before anything read from it are of unknown age
+        const descriptor = canBridge.createVirtualDevice();
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051804, 1000);
+        await new Promise(resolve => {setTimeout(resolve, 20)});
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051804, 0);
+        await new Promise(resolve => {setTimeout(resolve, 200)});
+        assert.equal(canBridge.getLatestMessageOfEveryReceivedArbId(descriptor, 100)[0x2051804], undefined,
+            "Old frames of a silent device should be filtered out");
+
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051804, 1000);
+        await new Promise(resolve => {setTimeout(resolve, 50)});
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051804, 0);
+        assert(canBridge.getLatestMessageOfEveryReceivedArbId(descriptor, 1000)[0x2051804], "New frames should be returned");
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testCapture() {
+    assert(canBridge.startCapture, "startCapture is undefined");
+    const fileName = path.join(os.tmpdir(), `canbridge-test-${process.pid}.cap`);
+    const snapshotName = path.join(os.tmpdir(), `canbridge-test-${process.pid}-snapshot.cap`);
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        canBridge.startCapture(fileName, [descriptor], {maxRecords: 4096});
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051801, 1000);
+        for (let i = 0; i < 10; i++) {
+            canBridge.sendCANMessage(descriptor, 0x2051D81, [i], 0);
+        }
+        await new Promise(resolve => {setTimeout(resolve, 100)});
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051801, 0);
+        assert(canBridge.snapshotCapture(snapshotName) > 0, "Snapshot is empty");
+        const stats = canBridge.stopCapture();
+        console.log("Capture stats:", stats);
+
+        const capture = canBridge.openCaptureFile(fileName);
+        assert.deepEqual(capture.channels, [descriptor]);
+        assert.equal(capture.recordCount, stats.recorded, "Record count does not match the stats");
+        const buffer = addon.CaptureRecordView.allocate(capture.recordCount);
+        const records = new addon.CaptureRecordView(buffer, canBridge.readCaptureRecords(capture.handle, 0, buffer));
+        let sent = 0;
+        let received = 0;
+        for (let i = 0; i < records.count; i++) {
+            if (i > 0) assert(records.timestampUs(i) >= records.timestampUs(i - 1), "Records out of order");
+            if (records.isTransmit(i)) {
+                assert.equal(records.messageId(i), 0x2051D81);
+                sent++;
+            } else {
+                assert.equal(records.channel(i), 0);
+                received++;
+            }
+        }
+        assert.equal(sent, 10, "Missing sent frames");
+        assert(received > 0, "Missing received frames");
+        assert.equal(canBridge.findCaptureRecord(capture.handle, 0), 0);
+        canBridge.closeCaptureFile(capture.handle);
+
+        const snapshot = canBridge.openCaptureFile(snapshotName);
+        assert(snapshot.recordCount > 0 && snapshot.recordCount <= capture.recordCount, "Unexpected snapshot size");
+        canBridge.closeCaptureFile(snapshot.handle);
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    } finally {
+        fs.rmSync(fileName, {force: true});
+        fs.rmSync(snapshotName, {force: true});
+    }
+}
+
+async function testReplay() {
+    assert(canBridge.startReplay, "startReplay is undefined");
+    const fileName = path.join(os.tmpdir(), `canbridge-test-${process.pid}-replay.cap`);
+    try {
+        const source = canBridge.createVirtualDevice();
+        const target = canBridge.createVirtualDevice();
+        canBridge.startCapture(fileName, [source], {maxRecords: 4096});
+        for (let i = 0; i < 20; i++) {
+            canBridge.sendCANMessage(source, 0x2051D81 + (i % 2), [i], 0);
+            await new Promise(resolve => {setTimeout(resolve, 5)});
+        }
+        canBridge.stopCapture();
+
+        const replayHandle = canBridge.startReplay(fileName, target, {
+            speed: 2,
+            direction: "sent",
+            filters: [{messageId: 0x2051D81, messageMask: 0x1FFFFFFF}],
+        });
+        const stats = await canBridge.waitForReplay(replayHandle);
+        console.log("Replay stats:", stats);
+        assert.equal(stats.sent, 10, "Filter was not applied");
+        assert.equal(stats.failedSends, 0);
+        assert(!stats.stopped, "Replay should have finished on its own");
+        assert.equal(canBridge.getReplayStats(replayHandle), undefined, "Awaited replay should release its handle");
+
+        const loopHandle = canBridge.startReplay(fileName, target, {loop: true, speed: 10});
+        await new Promise(resolve => {setTimeout(resolve, 50)});
+        canBridge.stopReplay(loopHandle);
+        assert((await canBridge.waitForReplay(loopHandle)).stopped, "Looping replay did not stop");
+
+        // A damaged payload length must not reach the send path
+        const damaged = fs.readFileSync(fileName);
+        // Records fill the end of the file. recordCapacity is at offset 24 of the header, dataSize at 14 of a record.
+        const recordCapacity = Number(damaged.readBigUInt64LE(24));
+        damaged[damaged.length - recordCapacity * addon.CAPTURE_RECORD_SIZE + 14] = 200;
+        fs.writeFileSync(fileName, damaged);
+        assert.throws(() => canBridge.startReplay(fileName, target), "A record longer than 8 bytes should be rejected");
+
+        canBridge.destroyVirtualDevice(source);
+        canBridge.destroyVirtualDevice(target);
+    } catch(error) {
+        assert.fail(error);
+    } finally {
+        fs.rmSync(fileName, {force: true});
+    }
+}
+
+async function testVirtualLoopback() {
+    assert(canBridge.setVirtualBusOptions, "setVirtualBusOptions is undefined");
+    try {
+        const sender = canBridge.createVirtualDevice({bus: 1});
+        const receiver = canBridge.createVirtualDevice({bus: 1});
+        const listed = (await canBridge.getDevices()).filter((device) => device.driverName === "Virtual");
+        assert(listed.some((device) => device.descriptor === sender), "Virtual device is not listed");
+
+        // An unlimited bus should carry far more than a 1 Mbit/s bus (about 7400 8-byte frames per second)
+        const frameCount = 20000;
+        const sessionHandle = canBridge.openStreamSession(receiver, 0x2050000, 0x1FFF0000, frameCount);
+        const messages = [];
+        for (let i = 0; i < 1000; i++) {
+            messages.push({messageId: 0x2050000 + (i % 64), data: [i & 0xFF, 1, 2, 3, 4, 5, 6, 7], repeatPeriod: 0});
+        }
+        const packed = addon.packCanMessages(messages);
+        const start = process.hrtime.bigint();
+        for (let sent = 0; sent < frameCount; sent += messages.length) {
+            canBridge.sendCANMessages(sender, packed);
+        }
+        const framesPerSecond = frameCount / (Number(process.hrtime.bigint() - start) / 1e9);
+        const buffer = addon.PackedFrameView.allocate(frameCount);
+        assert.equal(canBridge.readStreamSessionPacked(receiver, sessionHandle, buffer), frameCount, "Frames were lost in loopback");
+        console.log(`Virtual loopback: ${Math.round(framesPerSecond)} frames/s`);
+        assert(framesPerSecond > 7400, "Virtual bus is slower than a 1 Mbit/s bus");
+
+        canBridge.setVirtualBusOptions(sender, {bitrate: 125000, latencyUs: 2000});
+        canBridge.sendCANMessages(sender, addon.packCanMessages(messages.slice(0, 10)));
+        assert.equal(canBridge.readStreamSessionPacked(receiver, sessionHandle, buffer), 0, "Frames arrived before the latency");
+        await new Promise(resolve => {setTimeout(resolve, 50)});
+        assert.equal(canBridge.readStreamSessionPacked(receiver, sessionHandle, buffer), 10, "Delayed frames did not arrive");
+
+        canBridge.sendCANMessage(sender, 0x2051801, [1, 2, 3, 4, 5, 6, 7, 8], 10);
+        await new Promise(resolve => {setTimeout(resolve, 100)});
+        canBridge.sendCANMessage(sender, 0x2051801, [], -1);
+        const repeated = canBridge.readStreamSessionPacked(receiver, sessionHandle, buffer);
+        assert(repeated >= 5, `Only ${repeated} repeated frames arrived`);
+        console.log("Virtual bus status:", canBridge.getCANDetailStatus(receiver));
+
+        canBridge.setVirtualBusOptions(receiver, {bitrate: 0, latencyUs: 0, dropRate: 1});
+        canBridge.sendCANMessages(sender, addon.packCanMessages(messages.slice(0, 10)));
+        assert.equal(canBridge.readStreamSessionPacked(receiver, sessionHandle, buffer), 0, "Dropped frames arrived");
+        assert(canBridge.getCANDetailStatus(receiver).receiveErr >= 10, "Dropped frames were not counted");
+
+        canBridge.closeStreamSession(receiver, sessionHandle);
+        canBridge.destroyVirtualDevice(sender);
+        canBridge.destroyVirtualDevice(receiver);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testStreamFilters() {
+    try {
+        const sender = canBridge.createVirtualDevice({bus: 2});
+        const receiver = canBridge.createVirtualDevice({bus: 2});
+        // Devices 1 to 40 of one device type, whatever the API, plus one standard ID
+        const filters = [{messageId: 0x123, messageMask: 0x7FF}];
+        for (let deviceNumber = 1; deviceNumber <= 40; deviceNumber++) {
+            filters.push({messageId: 0x2050000 + deviceNumber, messageMask: 0x1FFF003F});
+        }
+        const matches = (messageId) => filters.some((filter) => ((messageId ^ filter.messageId) & filter.messageMask) === 0);
+
+        const sessionHandle = canBridge.openStreamSession(receiver, filters, 1024);
+        const received = [];
+        const subscriptionHandle = canBridge.subscribe(receiver, 0, 0, (messages) => received.push(...messages),
+            {maxLatencyMs: 1, filters});
+
+        const messages = [];
+        for (let i = 0; i < 512; i++) {
+            messages.push({messageId: i % 8 === 0 ? (i % 16 === 0 ? 0x123 : 0x124) : 0x2050000 + (i << 6) % 0x4000 + (i % 64), data: [i & 0xFF], repeatPeriod: 0});
+        }
+        const expected = messages.filter((message) => matches(message.messageId)).length;
+        canBridge.sendCANMessages(sender, addon.packCanMessages(messages));
+
+        const read = canBridge.readStreamSession(receiver, sessionHandle, 1024);
+        assert.equal(read.length, expected, "Wrong number of frames passed the filters");
+        read.forEach((message) => assert(matches(message.messageID), `Frame ${message.messageID} should have been filtered`));
+
+        await new Promise(resolve => {setTimeout(resolve, 50)});
+        canBridge.unsubscribe(subscriptionHandle);
+        assert.equal(received.length, expected, "Wrong number of frames passed the subscription filters");
+
+        assert.throws(() => canBridge.openStreamSession(receiver, [], 16), "An empty filter list should be rejected");
+        canBridge.closeStreamSession(receiver, sessionHandle);
+
+        // Sessions opened through a handle belong to its device, whichever way they are read
+        const other = canBridge.createVirtualDevice({bus: 2});
+        const receiverHandle = canBridge.openDevice(receiver);
+        const otherHandle = canBridge.openDevice(other);
+        const filteredSession = canBridge.openStreamSession(receiverHandle, filters, 1024);
+        const otherSession = canBridge.openStreamSession(otherHandle, 0, 0, 1024);
+        canBridge.sendCANMessages(sender, addon.packCanMessages(messages));
+        assert.equal(canBridge.readStreamSession(receiverHandle, filteredSession, 1024).length, expected,
+            "A session opened by handle should be filtered");
+        assert.equal(canBridge.readStreamSession(otherHandle, otherSession, 1024).length, messages.length,
+            "Another device's session should not be filtered");
+        canBridge.sendCANMessages(sender, addon.packCanMessages(messages));
+        assert.equal(canBridge.readStreamSession(receiver, filteredSession, 1024).length, expected,
+            "A session opened by handle should be filtered when read by descriptor");
+
+        canBridge.closeStreamSession(receiverHandle, filteredSession);
+        canBridge.closeStreamSession(otherHandle, otherSession);
+        canBridge.closeDevice(receiverHandle);
+        canBridge.closeDevice(otherHandle);
+        canBridge.destroyVirtualDevice(other);
+        canBridge.destroyVirtualDevice(sender);
+        canBridge.destroyVirtualDevice(receiver);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testArbIdColumns() {
+    try {
+        const descriptor = canBridge.createVirtualDevice();
+        const sessionHandle = canBridge.openStreamSession(descriptor, 0, 0, 64);
+        // Periodic status 0 of SPARK MAX #17
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051811, 1000);
+        await new Promise(resolve => {setTimeout(resolve, 50)});
+        canBridge.setVirtualDeviceInjection(descriptor, 0x2051811, 0);
+
+        const buffer = addon.PackedFrameView.allocate(64);
+        const columns = addon.allocateArbIdColumns(16);
+        const count = canBridge.readStreamSessionPacked(descriptor, sessionHandle, buffer, columns);
+        assert(count > 0 && count <= 16, `Reads should stop at the column length, got ${count}`);
+        for (let i = 0; i < count; i++) {
+            assert.equal(columns.deviceType[i], 2);
+            assert.equal(columns.manufacturer[i], 5);
+            assert.equal(columns.apiClass[i], 6);
+            assert.equal(columns.apiIndex[i], 0);
+            assert.equal(columns.deviceNumber[i], 17);
+        }
+
+        const deviceNumbers = new Uint8Array(64);
+        const latest = canBridge.readLatestMessagesPacked(descriptor, buffer, 0, {deviceNumber: deviceNumbers});
+        assert.equal(latest.count, 1);
+        assert.equal(deviceNumbers[0], 17);
+        assert.throws(() => canBridge.readStreamSessionPacked(descriptor, sessionHandle, buffer, {apiClass: new Uint16Array(4)}),
+            "Columns must be Uint8Arrays");
+
+        canBridge.closeStreamSession(descriptor, sessionHandle);
+        canBridge.destroyVirtualDevice(descriptor);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testSignalDecoding() {
+    assert(canBridge.registerSignals, "registerSignals is undefined");
+    try {
+        const sender = canBridge.createVirtualDevice({bus: 3});
+        const receiver = canBridge.createVirtualDevice({bus: 3});
+        const values = new Float64Array(4).fill(NaN);
+        const decoderHandle = canBridge.registerSignals(receiver, [
+            {messageId: 0x2051841, startBit: 0, length: 32, signed: true, scale: 0.001},
+            {messageId: 0x2051841, startBit: 32, length: 8},
+            {messageId: 0x2051841, startBit: 47, length: 8, littleEndian: false, offset: -40},
+            {messageId: 0x2051881, startBit: 0, length: 16},
+        ], values);
+
+        const sessionHandle = canBridge.openStreamSession(receiver, 0, 0, 16);
+        // -1500 in the first 32 bits, 0x23 in byte 4 and 70 in byte 5
+        canBridge.sendCANMessage(sender, 0x2051841, [0x24, 0xFA, 0xFF, 0xFF, 0x23, 70, 0, 0], 0);
+        assert.equal(canBridge.readStreamSessionPacked(receiver, sessionHandle, addon.PackedFrameView.allocate(16)), 1);
+        assert.equal(values[0], -1.5);
+        assert.equal(values[1], 0x23);
+        assert.equal(values[2], 30);
+        assert(Number.isNaN(values[3]), "A signal of another ID was written");
+
+        canBridge.sendCANMessage(sender, 0x2051881, [0x34, 0x12], 0);
+        await new Promise(resolve => {setTimeout(resolve, 20)});
+        assert(canBridge.updateSignals(decoderHandle) >= 1, "Nothing was decoded from the received-messages map");
+        assert.equal(values[3], 0x1234);
+
+        assert.throws(() => canBridge.registerSignals(receiver, [{messageId: 1, startBit: 60, length: 8}], new Float64Array(1)),
+            "A signal past the end of the payload should be rejected");
+        canBridge.unregisterSignals(decoderHandle);
+
+        // A decoder registered through a handle belongs to the device, whichever way it is read
+        const receiverHandle = canBridge.openDevice(receiver);
+        const handleValues = new Float64Array(2).fill(NaN);
+        const handleDecoder = canBridge.registerSignals(receiverHandle, [
+            {messageId: 0x2051841, startBit: 32, length: 8},
+            {messageId: 0x2051881, startBit: 0, length: 16},
+        ], handleValues);
+        canBridge.sendCANMessage(sender, 0x2051841, [0, 0, 0, 0, 0x42, 0, 0, 0], 0);
+        assert.equal(canBridge.readStreamSession(receiver, sessionHandle, 16).length, 1);
+        assert.equal(handleValues[0], 0x42, "Reading by descriptor should decode into a decoder registered by handle");
+        canBridge.sendCANMessage(sender, 0x2051841, [0, 0, 0, 0, 0x43, 0, 0, 0], 0);
+        assert.equal(canBridge.readStreamSession(receiverHandle, sessionHandle, 16).length, 1);
+        assert.equal(handleValues[0], 0x43, "Reading by handle should decode");
+        canBridge.sendCANMessage(sender, 0x2051881, [0x78, 0x56], 0);
+        await new Promise(resolve => {setTimeout(resolve, 20)});
+        assert(canBridge.updateSignals(handleDecoder) >= 1, "A decoder registered by handle should update");
+        assert.equal(handleValues[1], 0x5678);
+        canBridge.unregisterSignals(handleDecoder);
+        canBridge.closeDevice(receiverHandle);
+
+        canBridge.closeStreamSession(receiver, sessionHandle);
+        canBridge.destroyVirtualDevice(sender);
+        canBridge.destroyVirtualDevice(receiver);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testTrafficStats() {
+    assert(canBridge.getTrafficStats, "getTrafficStats is undefined");
+    try {
+        const sender = canBridge.createVirtualDevice({bus: 4});
+        const receiver = canBridge.createVirtualDevice({bus: 4});
+        assert.equal(canBridge.getTrafficStats(receiver).count, 0);
+
+        canBridge.sendCANMessage(sender, 0x2051801, [1, 2, 3, 4], 10);
+        await new Promise(resolve => {setTimeout(resolve, 1300)});
+        canBridge.sendCANMessage(sender, 0x2051801, [], -1);
+
+        const stats = canBridge.getTrafficStats(receiver);
+        assert.equal(stats.count, 1);
+        assert.equal(stats.messageId[0], 0x2051801);
+        assert(stats.frames[0] >= 100, `Only ${stats.frames[0]} frames were counted`);
+        assert(Math.abs(stats.framesPerSecond[0] - 100) < 15, `Rate was ${stats.framesPerSecond[0]}`);
+        assert(Math.abs(stats.periodUs[0] - 10000) < 2000, `Period was ${stats.periodUs[0]}`);
+        const histogram = stats.histogram.subarray(0, stats.histogramBucketLowerUs.length);
+        assert.equal(histogram.reduce((sum, count) => sum + count, 0), stats.frames[0] - 1);
+
+        canBridge.resetTrafficStats(receiver);
+        canBridge.sendCANMessage(sender, 0x2051802, [], 0);
+        await new Promise(resolve => {setTimeout(resolve, 20)});
+        const afterReset = canBridge.getTrafficStats(receiver);
+        assert.equal(afterReset.count, 1);
+        assert.equal(afterReset.messageId[0], 0x2051802);
+        canBridge.destroyVirtualDevice(sender);
+        canBridge.destroyVirtualDevice(receiver);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testDeviceClock() {
+    assert(canBridge.getDeviceClock, "getDeviceClock is undefined");
+    try {
+        const sender = canBridge.createVirtualDevice({bus: 9});
+        const receiver = canBridge.createVirtualDevice({bus: 9});
+        assert.equal(canBridge.getDeviceClock(receiver).samples, 0);
+        const sessionHandle = canBridge.openStreamSession(receiver, 0x2051803, 0x1FFFFFFF, 64);
+        canBridge.getLatestMessageOfEveryReceivedArbId(receiver, 1000);
+
+        canBridge.sendCANMessage(sender, 0x2051803, [1, 2, 3], 10);
+        await new Promise(resolve => {setTimeout(resolve, 300)});
+        const messages = canBridge.readStreamSession(receiver, sessionHandle, 64);
+        const clock = canBridge.getDeviceClock(receiver);
+        assert(messages.length > 0);
+        assert(clock.samples > 0);
+        assert(Math.abs(clock.driftPpm) <= 500, `Drift was ${clock.driftPpm} ppm`);
+        // The newest frame was received within the last few periods, and never after now
+        const timeStamp = messages[messages.length - 1].timeStamp;
+        const hostUs = timeStamp + clock.offsetUs + (timeStamp - clock.referenceUs) * clock.driftPpm / 1e6;
+        assert(hostUs <= clock.hostNowUs && hostUs > clock.hostNowUs - 100000, `Received ${clock.hostNowUs - hostUs} us ago`);
+
+        // Handles share the clock of the device they resolve to, and no other
+        const receiverHandle = canBridge.openDevice(receiver);
+        const idle = canBridge.createVirtualDevice({bus: 10});
+        const idleHandle = canBridge.openDevice(idle);
+        await new Promise(resolve => {setTimeout(resolve, 50)});
+        assert(canBridge.readStreamSession(receiverHandle, sessionHandle, 64).length > 0);
+        assert(canBridge.getDeviceClock(receiverHandle).samples > clock.samples, "Reads by handle should feed the device's clock");
+        assert.equal(canBridge.getDeviceClock(idleHandle).samples, 0, "Another device's clock should not be fed");
+        canBridge.closeDevice(receiverHandle);
+        canBridge.closeDevice(idleHandle);
+        canBridge.destroyVirtualDevice(idle);
+
+        canBridge.sendCANMessage(sender, 0x2051803, [], -1);
+        await new Promise(resolve => {setTimeout(resolve, 300)});
+        assert.equal(canBridge.getLatestMessageOfEveryReceivedArbId(receiver, 100)[0x2051803], undefined);
+        assert.deepEqual(canBridge.getLatestMessageOfEveryReceivedArbId(receiver, 1000)[0x2051803].data, [1, 2, 3]);
+
+        canBridge.closeStreamSession(receiver, sessionHandle);
+        canBridge.destroyVirtualDevice(sender);
+        canBridge.destroyVirtualDevice(receiver);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testHeartbeatWatchdog() {
+    assert(canBridge.setHeartbeatTimeout, "setHeartbeatTimeout is undefined");
+    const revCommonHeartbeatId = 0x00502C0;
+    try {
+        const sender = canBridge.createVirtualDevice({bus: 5});
+        const receiver = canBridge.createVirtualDevice({bus: 5});
+        canBridge.getLatestMessageOfEveryReceivedArbId(receiver, 1000);
+        for (const timeoutMs of [NaN, 0, -100, "100", 2 ** 31]) {
+            assert.throws(() => canBridge.setHeartbeatTimeout(timeoutMs), RangeError, `Timeout ${timeoutMs} should be rejected`);
+        }
+        canBridge.setHeartbeatTimeout(100);
+        canBridge.startRevCommonHeartbeat(sender);
+
+        const interval = setInterval(canBridge.ackHeartbeats, 20);
+        await new Promise(resolve => {setTimeout(resolve, 200)});
+        clearInterval(interval);
+        const enabled = canBridge.getLatestMessageOfEveryReceivedArbId(receiver, 1000)[revCommonHeartbeatId];
+        assert(enabled, "No heartbeat was received");
+        assert.deepEqual(enabled.data, [1]);
+
+        await new Promise(resolve => {setTimeout(resolve, 200)});
+        const disabled = canBridge.getLatestMessageOfEveryReceivedArbId(receiver, 1000)[revCommonHeartbeatId];
+        assert.deepEqual(disabled.data, [0], "Heartbeats were not disabled after the timeout");
+        const stats = canBridge.getHeartbeatWatchdogStats();
+        assert(stats.timeouts >= 1, "No timeout was counted");
+        assert(stats.maxTimeoutLatencyUs < 20000, `The timeout was acted on ${stats.maxTimeoutLatencyUs} µs late`);
+
+        canBridge.stopHeartbeats(sender, false);
+        canBridge.setHeartbeatTimeout(1000);
+        canBridge.destroyVirtualDevice(sender);
+        canBridge.destroyVirtualDevice(receiver);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testTransact() {
+    assert(canBridge.transact, "transact is undefined");
+    try {
+        const requester = canBridge.createVirtualDevice({bus: 6});
+        const responder = canBridge.createVirtualDevice({bus: 6});
+        // Stands in for a device answering every request
+        canBridge.sendCANMessage(responder, 0x2051D82, [0xAA, 1, 2], 5);
+
+        const results = await canBridge.transact(requester, [
+            {messageId: 0x2051D81, data: [1], response: {messageId: 0x2051D82, data: [0xAA]}},
+            {messageId: 0x2051D81, data: [2], response: {messageId: 0x2051D82, data: [0xBB]}, retries: 1},
+            {messageId: 0x2051D81, data: [3], response: {messageId: 0x2051D80, messageMask: 0x1FFFFFFC, data: [0xA0], dataMask: [0xF0]}},
+        ], {timeoutMs: 30, window: 2});
+        assert.equal(results.length, 3);
+        assert.equal(results[0].status, "ok");
+        assert.deepEqual(results[0].message.data, [0xAA, 1, 2]);
+        assert.equal(results[1].status, "timeout");
+        assert.equal(results[1].attempts, 2);
+        assert.equal(results[2].status, "ok");
+        assert.equal(results[2].message.messageID, 0x2051D82);
+
+        assert.throws(() => canBridge.transact(requester, [
+            {messageId: 0x2051D81, data: [1], response: {messageId: 0x2051D82}, timeoutMs: -1},
+        ]), RangeError, "A negative timeout should be rejected");
+        assert.throws(() => canBridge.transact(requester, [
+            {messageId: 0x2051D81, data: [1], response: {messageId: 0x2051D82}},
+        ], {timeoutMs: 5000000}), RangeError, "A timeout that overflows should be rejected");
+
+        // Sending the request once would cancel the driver's repeat of the same ID
+        canBridge.sendCANMessage(requester, 0x2051D83, [1], 10);
+        const [repeated] = await canBridge.transact(requester, [
+            {messageId: 0x2051D83, data: [2], response: {messageId: 0x2051D84}, retries: 0},
+        ], {timeoutMs: 30});
+        assert.equal(repeated.status, "sendFailed");
+        canBridge.sendCANMessage(requester, 0x2051D83, [], -1);
+
+        canBridge.sendCANMessage(responder, 0x2051D82, [], -1);
+        canBridge.destroyVirtualDevice(requester);
+        canBridge.destroyVirtualDevice(responder);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testPerfCounters() {
+    assert(canBridge.getPerfCounters, "getPerfCounters is undefined");
+    try {
+        canBridge.resetPerfCounters();
+        const device = canBridge.createVirtualDevice({bus: 7});
+        for (let i = 0; i < 10; i++) {
+            canBridge.sendCANMessage(device, 0x2051D81, [i], 0);
+        }
+        canBridge.destroyVirtualDevice(device);
+
+        const counters = canBridge.getPerfCounters();
+        if (counters === undefined) return;
+        const binding = counters.names.indexOf("sendCANMessage");
+        assert(binding >= 0, "sendCANMessage was not counted");
+        const phases = counters.phases.length;
+        const buckets = counters.histogramBucketLowerNs.length;
+        const total = binding * phases + counters.phases.indexOf("total");
+        assert.equal(counters.calls[total], 10);
+        assert.equal(counters.calls[binding * phases + counters.phases.indexOf("driver")], 10);
+        const histogram = counters.histogram.subarray(total * buckets, (total + 1) * buckets);
+        assert.equal(histogram.reduce((sum, count) => sum + count, 0), 10);
+        assert(counters.maxNs[total] * 10 >= counters.totalNs[total]);
+
+        canBridge.resetPerfCounters();
+        assert.equal(canBridge.getPerfCounters().names.indexOf("sendCANMessage"), -1);
+    } catch(error) {
+        assert.fail(error);
+    }
+}
+
+async function testTrace() {
+    assert(canBridge.startTrace, "startTrace is undefined");
+    const fileName = path.join(os.tmpdir(), `canbridge-test-${process.pid}.trace`);
+    try {
+        const device = canBridge.createVirtualDevice({bus: 8});
+        canBridge.startTrace();
+        for (let i = 0; i < 5; i++) {
+            canBridge.sendCANMessage(device, 0x2051D81 + i, [i], 0);
+        }
+        canBridge.stopTrace();
+        canBridge.sendCANMessage(device, 0x2051D81, [], 0);
+
+        const stats = await canBridge.writeTrace(fileName);
+        assert.equal(stats.dropped, 0);
+        const trace = JSON.parse(fs.readFileSync(fileName, "utf8"));
+        const sends = trace.traceEvents.filter(event => event.name === "SendCANMessage");
+        assert.equal(sends.length, 10, "Every send should have a begin and an end event");
+        assert.deepEqual(sends.filter(event => event.ph === "B").map(event => event.args.arg),
+            [0, 1, 2, 3, 4].map(i => 0x2051D81 + i));
+        assert(trace.traceEvents.some(event => event.ph === "M" && event.args.name === "JavaScript"));
+        assert.equal((await canBridge.writeTrace(fileName)).events, 0, "Written events should be drained");
+
+        canBridge.startTrace();
+        canBridge.sendCANMessage(device, 0x2051D81, [], 0);
+        canBridge.stopTrace();
+        assert((await canBridge.writeTrace(fileName, "perfetto")).events >= 2);
+        assert(fs.statSync(fileName).size > 0);
+        await assert.rejects(canBridge.writeTrace(path.join(fileName, "missing", "trace.json")));
+
+        canBridge.destroyVirtualDevice(device);
+    } catch(error) {
+        assert.fail(error);
+    } finally {
+        fs.rmSync(fileName, {force: true});
+    }
+}
+
+// Builds a DfuSe file with one image holding the given elements
+function buildDfuSeFile(elements) {
+    const elementBuffers = elements.map(({address, data}) => {
+        const prefix = Buffer.alloc(8);
+        prefix.writeUInt32LE(address, 0);
+        prefix.writeUInt32LE(data.length, 4);
+        return Buffer.concat([prefix, Buffer.from(data)]);
+    });
+    const imageBytes = Buffer.concat(elementBuffers);
+    const imagePrefix = Buffer.alloc(274);
+    imagePrefix.write("Target", 0, "latin1");
+    imagePrefix.writeUInt32LE(1, 7);
+    imagePrefix.write("Test", 11, "latin1");
+    imagePrefix.writeUInt32LE(imageBytes.length, 266);
+    imagePrefix.writeUInt32LE(elements.length, 270);
+
+    const prefix = Buffer.alloc(11);
+    prefix.write("DfuSe", 0, "latin1");
+    prefix.writeUInt8(1, 5);
+    prefix.writeUInt32LE(11 + imagePrefix.length + imageBytes.length, 6);
+    prefix.writeUInt8(1, 10);
+
+    const suffix = Buffer.alloc(16);
+    suffix.writeUInt16LE(0xFFFF, 0);
+    suffix.writeUInt16LE(0xDF11, 2);
+    suffix.writeUInt16LE(0x0483, 4);
+    suffix.writeUInt16LE(0x011A, 6);
+    suffix.write("UFD", 8, "latin1");
+    suffix.writeUInt8(16, 11);
+    const file = Buffer.concat([prefix, imagePrefix, imageBytes, suffix]);
+    file.writeUInt32LE(dfuCrc(file.subarray(0, file.length - 4)), file.length - 4);
+    return file;
+}
+
+// CRC-32 as DFU files store it: no final inversion
+function dfuCrc(bytes) {
+    let crc = 0xFFFFFFFF;
+    for (const byte of bytes) {
+        crc ^= byte;
+        for (let bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >>> 1) ^ 0xEDB88320 : crc >>> 1;
+        }
+    }
+    return crc >>> 0;
+}
+
+async function testDfuFile() {
+    assert(canBridge.getImageElements, "getImageElements is undefined");
+    const dfuFileName = path.join(os.tmpdir(), `canbridge-test-${process.pid}.dfu`);
+    const binFileName = path.join(os.tmpdir(), `canbridge-test-${process.pid}.bin`);
+    try {
+        const firmware = Buffer.alloc(300000).map((_, i) => (i * 31) & 0xFF);
+        const dfu = buildDfuSeFile([{address: 0x08000000, data: [1, 2, 3, 4]}, {address: 0x08008000, data: firmware}]);
+        fs.writeFileSync(dfuFileName, dfu);
+
+        assert.deepEqual(canBridge.getImageElements(dfuFileName, 0), [
+            {startAddress: 0x08000000, size: 4},
+            {startAddress: 0x08008000, size: firmware.length},
+        ]);
+        assert.equal(await canBridge.writeDfuToBin(dfuFileName, binFileName, 1), 0);
+        assert(fs.readFileSync(binFileName).equals(firmware), "The element was not written out unchanged");
+        await assert.rejects(canBridge.writeDfuToBin(dfuFileName, binFileName, 2), "A missing element was written");
+        assert.throws(() => canBridge.getImageElements(dfuFileName, 1));
+
+        const elementFileName = path.join(os.tmpdir(), `canbridge-test-${process.pid}-0.bin`);
+        const written = await canBridge.extractDfuElements(dfuFileName, [
+            {element: 0, fileName: elementFileName},
+            {image: 0, element: 1, fileName: binFileName},
+        ]);
+        assert.equal(written, 4 + firmware.length);
+        assert.deepEqual([...fs.readFileSync(elementFileName)], [1, 2, 3, 4]);
+        assert(fs.readFileSync(binFileName).equals(firmware));
+        fs.rmSync(elementFileName);
+        await assert.rejects(canBridge.extractDfuElements(dfuFileName, [
+            {element: 0, fileName: elementFileName},
+            {image: 1, element: 0, fileName: binFileName},
+        ]));
+        assert(!fs.existsSync(elementFileName), "Elements were written before every index was checked");
+
+        const verification = await canBridge.verifyDfu(dfuFileName);
+        assert(verification.valid, `CRC ${verification.computedCrc} does not match ${verification.storedCrc}`);
+
+        const corrupt = Buffer.from(dfu);
+        corrupt[1000] ^= 0x40;
+        fs.writeFileSync(dfuFileName, corrupt);
+        assert.equal((await canBridge.verifyDfu(dfuFileName)).valid, false, "A corrupt byte went unnoticed");
+
+        // A truncated file
+        fs.writeFileSync(dfuFileName, dfu.subarray(0, dfu.length - 1000));
+        assert.throws(() => canBridge.getImageElements(dfuFileName, 0));
+        await assert.rejects(canBridge.writeDfuToBin(dfuFileName, binFileName, 0));
+        assert.equal((await canBridge.verifyDfu(dfuFileName)).valid, false);
+    } catch(error) {
+        assert.fail(error);
+    } finally {
+        fs.rmSync(dfuFileName, {force: true});
+        fs.rmSync(binFileName, {force: true});
+    }
+}
+
 process.on('uncaughtException', function (exception) {
     console.log(exception);
 });
@@ -250,7 +1164,31 @@ testGetDevices()
     .then(testInitializeNotifier)
     .then(testWaitForNotifierAlarm)
     .then(testStopNotifier)
+    .then(testWaitForNotifierAlarmDoesNotBlock)
+    .then(testNotifierHandles)
+    .then(testPeriodicNotifier)
     .then(testSetThreadPriority)
+    .then(testSubscribe)
+    .then(testReadStreamSessionPacked)
+    .then(testSendCANMessages)
+    .then(testDeviceHandles)
+    .then(testScanDuringSends)
+    .then(testPeriodicFrames)
+    .then(testLatestValueCache)
+    .then(testLatestValueAge)
+    .then(testCapture)
+    .then(testReplay)
+    .then(testVirtualLoopback)
+    .then(testStreamFilters)
+    .then(testArbIdColumns)
+    .then(testSignalDecoding)
+    .then(testTrafficStats)
+    .then(testDeviceClock)
+    .then(testHeartbeatWatchdog)
+    .then(testDfuFile)
+    .then(testTransact)
+    .then(testPerfCounters)
+    .then(testTrace)
     /*.then(testHeartbeat)*/
     .catch((error)  => {
         console.log(error);